@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         CoAP resource exporting the energest subsystem profile
+ */
+
+/**
+ * \addtogroup energest-profile
+ * @{
+ */
+
+#include "contiki.h"
+#include "energest-profile.h"
+#include "rest-engine.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ENERGEST_PROFILE_CONF_COAP_PATH
+#define ENERGEST_PROFILE_COAP_PATH ENERGEST_PROFILE_CONF_COAP_PATH
+#else /* ENERGEST_PROFILE_CONF_COAP_PATH */
+#define ENERGEST_PROFILE_COAP_PATH "profile/energest"
+#endif /* ENERGEST_PROFILE_CONF_COAP_PATH */
+
+static void res_get_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+static void res_event_handler(void);
+
+/*
+ * GET returns the profile as a JSON object with one member per
+ * subsystem, or only the subsystem given with ?s=<name>. The profile
+ * is larger than a CoAP block and is sent blockwise. Observers are
+ * notified after every interval.
+ */
+EVENT_RESOURCE(res_energest_profile,
+               "title=\"Energest profile: ?s=<subsystem>\";rt=\"json\";obs",
+               res_get_handler,
+               NULL,
+               NULL,
+               NULL,
+               res_event_handler);
+
+static struct energest_profile_notification notification;
+
+/* Writes the part of the payload that falls into the requested block */
+struct writer {
+  uint8_t *buffer;
+  uint16_t size;
+  int32_t offset;
+  uint16_t bufpos;
+  int32_t strpos;
+};
+/*---------------------------------------------------------------------------*/
+static void
+append(struct writer *w, const char *str)
+{
+  for(; *str != '\0'; str++, w->strpos++) {
+    if(w->strpos >= w->offset && w->bufpos < w->size) {
+      w->buffer[w->bufpos++] = *str;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+append_histogram(struct writer *w, const char *name, const uint16_t *histogram)
+{
+  char str[8];
+  int i;
+
+  append(w, name);
+  for(i = 0; i < ENERGEST_PROFILE_BUCKETS; i++) {
+    snprintf(str, sizeof(str), "%c%u", i == 0 ? '[' : ',', histogram[i]);
+    append(w, str);
+  }
+  append(w, "]");
+}
+/*---------------------------------------------------------------------------*/
+static void
+append_subsystem(struct writer *w, int subsystem)
+{
+  const struct energest_profile *p;
+  char str[48];
+
+  p = energest_profile_get(subsystem);
+  append(w, ",\"");
+  append(w, energest_subsystem_name(subsystem));
+  snprintf(str, sizeof(str), "\":{\"cpu\":%lu,\"radio\":%lu,", p->cpu, p->radio);
+  append(w, str);
+  snprintf(str, sizeof(str), "\"last\":[%u,%u],", p->last_cpu, p->last_radio);
+  append(w, str);
+  append_histogram(w, "\"hcpu\":", p->cpu_histogram);
+  append_histogram(w, ",\"hradio\":", p->radio_histogram);
+  append(w, "}");
+}
+/*---------------------------------------------------------------------------*/
+static void
+res_get_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  struct writer w;
+  const char *name = NULL;
+  char str[40];
+  int len;
+  int i;
+
+  w.buffer = buffer;
+  w.size = preferred_size;
+  w.offset = *offset;
+  w.bufpos = 0;
+  w.strpos = 0;
+
+  len = REST.get_query_variable(request, "s", &name);
+
+  snprintf(str, sizeof(str), "{\"interval\":%lu,\"n\":%u",
+           (unsigned long)(energest_profile_interval() / CLOCK_SECOND),
+           energest_profile_intervals());
+  append(&w, str);
+  for(i = 0; i < ENERGEST_SUBSYSTEM_MAX; i++) {
+    if(len > 0 && (strlen(energest_subsystem_name(i)) != (size_t)len ||
+                   strncmp(energest_subsystem_name(i), name, len) != 0)) {
+      continue;
+    }
+    append_subsystem(&w, i);
+  }
+  append(&w, "}");
+
+  if(w.offset >= w.strpos) {
+    REST.set_response_status(response, REST.status.BAD_OPTION);
+    return;
+  }
+
+  REST.set_header_content_type(response, REST.type.APPLICATION_JSON);
+  REST.set_response_payload(response, buffer, w.bufpos);
+
+  *offset += w.bufpos;
+  if(*offset >= w.strpos) {
+    *offset = -1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+res_event_handler(void)
+{
+  REST.notify_subscribers(&res_energest_profile);
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_profile_coap_init(void)
+{
+  rest_activate_resource(&res_energest_profile, ENERGEST_PROFILE_COAP_PATH);
+  energest_profile_notification_add(&notification, res_event_handler);
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
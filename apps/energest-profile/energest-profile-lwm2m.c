@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         LWM2M object exporting the energest subsystem profile
+ */
+
+/**
+ * \addtogroup energest-profile
+ * @{
+ */
+
+#include "contiki.h"
+#include "energest-profile.h"
+
+#if HAVE_OMA_LWM2M
+
+#include "lwm2m-object.h"
+#include "lwm2m-engine.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ENERGEST_PROFILE_CONF_LWM2M_OBJECT_ID
+#define ENERGEST_PROFILE_LWM2M_OBJECT_ID ENERGEST_PROFILE_CONF_LWM2M_OBJECT_ID
+#else /* ENERGEST_PROFILE_CONF_LWM2M_OBJECT_ID */
+/* First object ID of the private range */
+#define ENERGEST_PROFILE_LWM2M_OBJECT_ID 32769
+#endif /* ENERGEST_PROFILE_CONF_LWM2M_OBJECT_ID */
+
+/* Resources of each instance, one instance per subsystem */
+#define RESOURCE_NAME            0
+#define RESOURCE_CPU             1 /* milliseconds */
+#define RESOURCE_RADIO           2 /* milliseconds */
+#define RESOURCE_LAST_CPU        3 /* 1024ths of the last interval */
+#define RESOURCE_LAST_RADIO      4 /* 1024ths of the last interval */
+#define RESOURCE_CPU_HISTOGRAM   5 /* comma-separated interval counts */
+#define RESOURCE_RADIO_HISTOGRAM 6 /* comma-separated interval counts */
+#define RESOURCE_INTERVAL        7 /* seconds */
+#define RESOURCE_INTERVALS       8
+
+static struct energest_profile_notification notification;
+/*---------------------------------------------------------------------------*/
+static int32_t
+clamp(unsigned long value)
+{
+  return value > 0x7fffffffUL ? 0x7fffffff : (int32_t)value;
+}
+/*---------------------------------------------------------------------------*/
+static int
+write_histogram(lwm2m_context_t *ctx, uint8_t *outbuf, size_t outsize,
+                const uint16_t *histogram)
+{
+  /* Up to five digits and a separator per bucket */
+  char str[ENERGEST_PROFILE_BUCKETS * 6];
+  int len;
+  int i;
+
+  len = 0;
+  for(i = 0; i < ENERGEST_PROFILE_BUCKETS; i++) {
+    len += snprintf(str + len, sizeof(str) - len, "%s%u",
+                    i == 0 ? "" : ",", histogram[i]);
+  }
+  return ctx->writer->write_string(ctx, outbuf, outsize, str, len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_profile(lwm2m_context_t *ctx, uint8_t *outbuf, size_t outsize)
+{
+  const struct energest_profile *p;
+  const char *name;
+
+  p = energest_profile_get(ctx->object_instance_id);
+  if(p == NULL) {
+    return 0;
+  }
+
+  switch(ctx->resource_id) {
+  case RESOURCE_NAME:
+    name = energest_subsystem_name(ctx->object_instance_id);
+    return ctx->writer->write_string(ctx, outbuf, outsize, name, strlen(name));
+  case RESOURCE_CPU:
+    return ctx->writer->write_int(ctx, outbuf, outsize, clamp(p->cpu));
+  case RESOURCE_RADIO:
+    return ctx->writer->write_int(ctx, outbuf, outsize, clamp(p->radio));
+  case RESOURCE_LAST_CPU:
+    return ctx->writer->write_int(ctx, outbuf, outsize, p->last_cpu);
+  case RESOURCE_LAST_RADIO:
+    return ctx->writer->write_int(ctx, outbuf, outsize, p->last_radio);
+  case RESOURCE_CPU_HISTOGRAM:
+    return write_histogram(ctx, outbuf, outsize, p->cpu_histogram);
+  case RESOURCE_RADIO_HISTOGRAM:
+    return write_histogram(ctx, outbuf, outsize, p->radio_histogram);
+  case RESOURCE_INTERVAL:
+    return ctx->writer->write_int(ctx, outbuf, outsize,
+                                  energest_profile_interval() / CLOCK_SECOND);
+  case RESOURCE_INTERVALS:
+    return ctx->writer->write_int(ctx, outbuf, outsize,
+                                  energest_profile_intervals());
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+LWM2M_RESOURCES(profile_resources,
+                LWM2M_RESOURCE_CALLBACK(RESOURCE_NAME, { read_profile, NULL, NULL }),
+                LWM2M_RESOURCE_CALLBACK(RESOURCE_CPU, { read_profile, NULL, NULL }),
+                LWM2M_RESOURCE_CALLBACK(RESOURCE_RADIO, { read_profile, NULL, NULL }),
+                LWM2M_RESOURCE_CALLBACK(RESOURCE_LAST_CPU, { read_profile, NULL, NULL }),
+                LWM2M_RESOURCE_CALLBACK(RESOURCE_LAST_RADIO, { read_profile, NULL, NULL }),
+                LWM2M_RESOURCE_CALLBACK(RESOURCE_CPU_HISTOGRAM, { read_profile, NULL, NULL }),
+                LWM2M_RESOURCE_CALLBACK(RESOURCE_RADIO_HISTOGRAM, { read_profile, NULL, NULL }),
+                LWM2M_RESOURCE_CALLBACK(RESOURCE_INTERVAL, { read_profile, NULL, NULL }),
+                LWM2M_RESOURCE_CALLBACK(RESOURCE_INTERVALS, { read_profile, NULL, NULL }),
+                );
+LWM2M_INSTANCES(profile_instances,
+                LWM2M_INSTANCE(ENERGEST_SUBSYSTEM_OTHER, profile_resources),
+                LWM2M_INSTANCE(ENERGEST_SUBSYSTEM_MAC, profile_resources),
+                LWM2M_INSTANCE(ENERGEST_SUBSYSTEM_SICSLOWPAN, profile_resources),
+                LWM2M_INSTANCE(ENERGEST_SUBSYSTEM_RPL, profile_resources),
+                LWM2M_INSTANCE(ENERGEST_SUBSYSTEM_COAP, profile_resources),
+                LWM2M_INSTANCE(ENERGEST_SUBSYSTEM_LWM2M, profile_resources),
+                LWM2M_INSTANCE(ENERGEST_SUBSYSTEM_APP, profile_resources));
+LWM2M_OBJECT(energest_profile, ENERGEST_PROFILE_LWM2M_OBJECT_ID,
+             profile_instances);
+/*---------------------------------------------------------------------------*/
+static void
+handle_interval(void)
+{
+  lwm2m_object_notify_observers(&energest_profile, NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_profile_lwm2m_init(void)
+{
+  lwm2m_engine_register_object(&energest_profile);
+  energest_profile_notification_add(&notification, handle_interval);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* HAVE_OMA_LWM2M */
+/** @} */
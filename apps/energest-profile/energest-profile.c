@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Per-subsystem CPU and radio profile built on energest
+ */
+
+/**
+ * \addtogroup energest-profile
+ * @{
+ */
+
+#include "contiki.h"
+#include "energest-profile.h"
+#include "lib/list.h"
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+static struct energest_profile profiles[ENERGEST_SUBSYSTEM_MAX];
+
+/* Energest counters at the start of the current interval */
+static unsigned long last_cpu[ENERGEST_SUBSYSTEM_MAX];
+static unsigned long last_radio[ENERGEST_SUBSYSTEM_MAX];
+
+static struct ctimer interval_timer;
+static clock_time_t interval;
+static clock_time_t interval_start;
+static uint16_t intervals;
+
+LIST(notification_list);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ticks_to_ms(unsigned long ticks)
+{
+  return (ticks / RTIMER_ARCH_SECOND) * 1000 +
+    (ticks % RTIMER_ARCH_SECOND) * 1000 / RTIMER_ARCH_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+share(unsigned long ms, unsigned long interval_ms)
+{
+  if(ms >= interval_ms) {
+    return ENERGEST_PROFILE_SHARE_MAX;
+  }
+  return ms * ENERGEST_PROFILE_SHARE_MAX / interval_ms;
+}
+/*---------------------------------------------------------------------------*/
+static void
+histogram_add(uint16_t *histogram, uint16_t share)
+{
+  int bucket;
+
+  for(bucket = 0; share > 0 && bucket < ENERGEST_PROFILE_BUCKETS - 1;
+      bucket++) {
+    share >>= 1;
+  }
+  if(histogram[bucket] < 0xffff) {
+    histogram[bucket]++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_interval_timer(void *ptr)
+{
+  struct energest_profile_notification *n;
+  struct energest_profile *p;
+  clock_time_t now;
+  unsigned long interval_ms;
+  unsigned long cpu;
+  unsigned long radio;
+  unsigned long cpu_ms;
+  unsigned long radio_ms;
+  int i;
+
+  now = clock_time();
+  interval_ms = (unsigned long)(clock_time_t)(now - interval_start) *
+    1000 / CLOCK_SECOND;
+  interval_start = now;
+  if(interval_ms == 0) {
+    interval_ms = 1;
+  }
+
+  for(i = 0; i < ENERGEST_SUBSYSTEM_MAX; i++) {
+    p = &profiles[i];
+    cpu = energest_subsystem_cpu(i);
+    radio = energest_subsystem_radio(i);
+    cpu_ms = ticks_to_ms(cpu - last_cpu[i]);
+    radio_ms = ticks_to_ms(radio - last_radio[i]);
+    last_cpu[i] = cpu;
+    last_radio[i] = radio;
+
+    p->cpu += cpu_ms;
+    p->radio += radio_ms;
+    p->last_cpu = share(cpu_ms, interval_ms);
+    p->last_radio = share(radio_ms, interval_ms);
+    histogram_add(p->cpu_histogram, p->last_cpu);
+    histogram_add(p->radio_histogram, p->last_radio);
+
+    PRINTF("energest-profile: %s cpu %lu ms (%u) radio %lu ms (%u)\n",
+           energest_subsystem_name(i), cpu_ms, p->last_cpu,
+           radio_ms, p->last_radio);
+  }
+  if(intervals < 0xffff) {
+    intervals++;
+  }
+
+  ctimer_reset(&interval_timer);
+
+  for(n = list_head(notification_list); n != NULL; n = list_item_next(n)) {
+    n->callback();
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_profile_reset(void)
+{
+  int i;
+
+  memset(profiles, 0, sizeof(profiles));
+  intervals = 0;
+  for(i = 0; i < ENERGEST_SUBSYSTEM_MAX; i++) {
+    last_cpu[i] = energest_subsystem_cpu(i);
+    last_radio[i] = energest_subsystem_radio(i);
+  }
+  interval_start = clock_time();
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_profile_start(clock_time_t period)
+{
+  interval = period;
+  energest_profile_reset();
+  ctimer_set(&interval_timer, interval, handle_interval_timer, NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_profile_stop(void)
+{
+  ctimer_stop(&interval_timer);
+}
+/*---------------------------------------------------------------------------*/
+const struct energest_profile *
+energest_profile_get(int subsystem)
+{
+  if(subsystem < 0 || subsystem >= ENERGEST_SUBSYSTEM_MAX) {
+    return NULL;
+  }
+  return &profiles[subsystem];
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+energest_profile_interval(void)
+{
+  return interval;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+energest_profile_intervals(void)
+{
+  return intervals;
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_profile_notification_add(struct energest_profile_notification *n,
+                                  energest_profile_callback_t c)
+{
+  if(n != NULL && c != NULL) {
+    n->callback = c;
+    list_add(notification_list, n);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_profile_notification_rm(struct energest_profile_notification *n)
+{
+  list_remove(notification_list, n);
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Per-subsystem CPU and radio profile built on energest
+ */
+
+/**
+ * \defgroup energest-profile Energest subsystem profile
+ *
+ * The profile samples the per-subsystem energest counters (see
+ * ENERGEST_CONF_SUBSYSTEMS) once per interval. For every subsystem it
+ * keeps the totals, the share of the last interval that the CPU and
+ * the radio spent on it, and a histogram of these shares over all
+ * intervals. Bucket 0 counts intervals with no time at all; bucket
+ * b > 0 counts intervals with a share of 2^(b-1) to 2^b - 1 1024ths.
+ * The last bucket also counts all larger shares. All state is
+ * statically allocated.
+ *
+ * The profile can be read over CoAP (energest_profile_coap_init())
+ * and as an LWM2M object (energest_profile_lwm2m_init()).
+ *
+ * @{
+ */
+
+#ifndef ENERGEST_PROFILE_H_
+#define ENERGEST_PROFILE_H_
+
+#include "contiki.h"
+
+#ifdef ENERGEST_PROFILE_CONF_BUCKETS
+#define ENERGEST_PROFILE_BUCKETS ENERGEST_PROFILE_CONF_BUCKETS
+#else /* ENERGEST_PROFILE_CONF_BUCKETS */
+/* Enough for shares from 1/1024 to 100% */
+#define ENERGEST_PROFILE_BUCKETS 12
+#endif /* ENERGEST_PROFILE_CONF_BUCKETS */
+
+/* Shares are given in 1024ths of the interval */
+#define ENERGEST_PROFILE_SHARE_MAX 1024
+
+struct energest_profile {
+  /* Totals since the profile was started, in milliseconds */
+  unsigned long cpu;
+  unsigned long radio;
+  /* Shares of the last interval */
+  uint16_t last_cpu;
+  uint16_t last_radio;
+  /* Number of intervals per share bucket */
+  uint16_t cpu_histogram[ENERGEST_PROFILE_BUCKETS];
+  uint16_t radio_histogram[ENERGEST_PROFILE_BUCKETS];
+};
+
+typedef void (* energest_profile_callback_t)(void);
+
+/* Called after every interval, e.g. to notify observers */
+struct energest_profile_notification {
+  struct energest_profile_notification *next;
+  energest_profile_callback_t callback;
+};
+
+void energest_profile_start(clock_time_t interval);
+void energest_profile_stop(void);
+void energest_profile_reset(void);
+
+const struct energest_profile *energest_profile_get(int subsystem);
+clock_time_t energest_profile_interval(void);
+uint16_t energest_profile_intervals(void);
+
+void energest_profile_notification_add(struct energest_profile_notification *n,
+                                       energest_profile_callback_t c);
+void energest_profile_notification_rm(struct energest_profile_notification *n);
+
+/* Exports, see energest-profile-coap.c and energest-profile-lwm2m.c */
+void energest_profile_coap_init(void);
+void energest_profile_lwm2m_init(void);
+
+#endif /* ENERGEST_PROFILE_H_ */
+/** @} */
@@ -43,6 +43,11 @@
 #define COAP_LINK_FORMAT_FILTERING     0
 #define COAP_PROXY_OPTION_PROCESSING   0
 
+/* Secure CoAP over DTLS with pre-shared keys on COAP_DEFAULT_SECURE_PORT */
+#ifndef WITH_DTLS
+#define WITH_DTLS                      0
+#endif
+
 /* Listening port for the CoAP REST Engine */
 #ifndef COAP_SERVER_PORT
 #define COAP_SERVER_PORT               COAP_DEFAULT_PORT
@@ -40,6 +40,7 @@
 #define ER_COAP_CONSTANTS_H_
 
 #define COAP_DEFAULT_PORT                    5683
+#define COAP_DEFAULT_SECURE_PORT             5684
 
 #define COAP_DEFAULT_MAX_AGE                 60
 #define COAP_RESPONSE_TIMEOUT                3
@@ -0,0 +1,1449 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *      DTLS 1.2 record layer and PSK handshake for secure CoAP.
+ */
+
+#include "er-coap-dtls.h"
+#include "er-coap.h"
+#include "lib/aes-128.h"
+#include "lib/ccm-star.h"
+#include "lib/sha-256.h"
+#include "lib/random.h"
+#include "sys/ctimer.h"
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#define VERSION_MAJOR             0xfe
+#define VERSION_MINOR             0xfd /* DTLS 1.2 */
+#define VERSION_MINOR_1_0         0xff
+
+#define RECORD_HEADER_LENGTH      13
+#define HANDSHAKE_HEADER_LENGTH   12
+#define EXPLICIT_NONCE_LENGTH     8
+#define MIC_LENGTH                8
+#define RANDOM_LENGTH             32
+#define SESSION_ID_MAX_LENGTH     32
+#define SESSION_ID_LENGTH         16
+#define COOKIE_LENGTH             16
+#define COOKIE_MAX_LENGTH         32
+#define MASTER_SECRET_LENGTH      48
+#define VERIFY_DATA_LENGTH        12
+#define KEY_LENGTH                16
+#define IV_LENGTH                 4
+#define KEY_BLOCK_LENGTH          (2 * (KEY_LENGTH + IV_LENGTH))
+
+#define CONTENT_CHANGE_CIPHER_SPEC 20
+#define CONTENT_ALERT             21
+#define CONTENT_HANDSHAKE         22
+#define CONTENT_APPLICATION_DATA  23
+
+#define HS_CLIENT_HELLO           1
+#define HS_SERVER_HELLO           2
+#define HS_HELLO_VERIFY_REQUEST   3
+#define HS_SERVER_HELLO_DONE      14
+#define HS_CLIENT_KEY_EXCHANGE    16
+#define HS_FINISHED               20
+
+#define ALERT_LEVEL_WARNING       1
+#define ALERT_CLOSE_NOTIFY        0
+
+#define TLS_PSK_WITH_AES_128_CCM_8 0xc0a8
+#define TLS_EMPTY_RENEGOTIATION_INFO_SCSV 0x00ff
+#define EXTENSION_RENEGOTIATION_INFO 0xff01
+
+/* each flight entry starts with content type, epoch, and length */
+#define FLIGHT_ENTRY_HEADER_LENGTH 4
+#define FLIGHT_BUFFER_SIZE        (128 + COAP_DTLS_PSK_IDENTITY_LENGTH)
+
+/* datagrams are assembled where uip_udp_packet_send() expects the payload */
+#define DATAGRAM_BUF              (&uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN])
+#define DATAGRAM_BUF_SIZE         (UIP_BUFSIZE - UIP_LLH_LEN - UIP_IPUDPH_LEN)
+#if COAP_MAX_PACKET_SIZE + COAP_DTLS_RECORD_OVERHEAD > DATAGRAM_BUF_SIZE
+#error "UIP_CONF_BUFFER_SIZE too small for REST_MAX_CHUNK_SIZE with DTLS"
+#endif
+
+/* a handshake that stalls for this long is given up */
+#define HANDSHAKE_TIMEOUT         (COAP_DTLS_RETRANSMIT_TIMEOUT << COAP_DTLS_MAX_RETRANSMISSIONS)
+
+enum {
+  STATE_FREE,
+  STATE_CLIENT_WAIT_SERVER_HELLO,
+  STATE_CLIENT_WAIT_SERVER_HELLO_DONE,
+  STATE_CLIENT_WAIT_FINISHED,
+  STATE_SERVER_WAIT_KEY_EXCHANGE,
+  STATE_SERVER_WAIT_FINISHED,
+  STATE_ESTABLISHED
+};
+
+struct session {
+  uip_ipaddr_t addr;
+  uint16_t port;
+  uint8_t state;
+  uint8_t is_client;
+  uint8_t is_resumed;
+  uint8_t resend;
+  uint8_t is_unconfirmed;
+  uint8_t has_renegotiation_info;
+  uint8_t retransmissions;
+  clock_time_t last_used;
+  struct ctimer timer;
+
+  uint8_t client_random[RANDOM_LENGTH];
+  uint8_t server_random[RANDOM_LENGTH];
+  uint8_t session_id[SESSION_ID_MAX_LENGTH];
+  uint8_t session_id_len;
+  uint8_t master_secret[MASTER_SECRET_LENGTH];
+  uint8_t key_block[KEY_BLOCK_LENGTH];
+  struct sha_256_ctx handshake_hash;
+
+  uint16_t next_send_seq;
+  uint16_t next_receive_seq;
+  uint8_t write_epoch;
+  uint8_t read_epoch;
+  uint32_t write_seq[2];
+  uint32_t read_seq;
+  uint32_t replay_window;
+
+  uint8_t flight[FLIGHT_BUFFER_SIZE];
+  uint8_t flight_len;
+  uint8_t pending[COAP_MAX_PACKET_SIZE];
+  uint16_t pending_len;
+};
+
+struct cache_entry {
+  uip_ipaddr_t addr;
+  uint16_t port;
+  uint8_t session_id[SESSION_ID_MAX_LENGTH];
+  uint8_t session_id_len;
+  uint8_t master_secret[MASTER_SECRET_LENGTH];
+};
+
+#define CLIENT_WRITE_KEY(s)       ((s)->key_block)
+#define SERVER_WRITE_KEY(s)       ((s)->key_block + KEY_LENGTH)
+#define CLIENT_WRITE_IV(s)        ((s)->key_block + 2 * KEY_LENGTH)
+#define SERVER_WRITE_IV(s)        ((s)->key_block + 2 * KEY_LENGTH + IV_LENGTH)
+#define WRITE_KEY(s) ((s)->is_client ? CLIENT_WRITE_KEY(s) : SERVER_WRITE_KEY(s))
+#define READ_KEY(s)  ((s)->is_client ? SERVER_WRITE_KEY(s) : CLIENT_WRITE_KEY(s))
+#define WRITE_IV(s)  ((s)->is_client ? CLIENT_WRITE_IV(s) : SERVER_WRITE_IV(s))
+#define READ_IV(s)   ((s)->is_client ? SERVER_WRITE_IV(s) : CLIENT_WRITE_IV(s))
+
+struct coap_dtls_stats coap_dtls_stats;
+
+static struct session sessions[COAP_DTLS_MAX_SESSIONS];
+static struct cache_entry cache[COAP_DTLS_SESSION_CACHE_SIZE];
+static uint8_t next_cache_entry;
+static uint8_t datagram_buf_used;
+static uint8_t cookie_secret[KEY_LENGTH];
+static coap_dtls_output_t output;
+
+static uint8_t psk_identity[COAP_DTLS_PSK_IDENTITY_LENGTH];
+static uint8_t psk_identity_len;
+static uint8_t psk_key[COAP_DTLS_PSK_KEY_LENGTH];
+static uint8_t psk_key_len;
+
+static void retransmit(void *ptr);
+static void handshake_timeout(void *ptr);
+
+/*---------------------------------------------------------------------------*/
+/*- Helpers -----------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get16(const uint8_t *p)
+{
+  return ((uint16_t)p[0] << 8) | p[1];
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get24(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+}
+/*---------------------------------------------------------------------------*/
+static void
+put16(uint8_t *p, uint16_t v)
+{
+  p[0] = v >> 8;
+  p[1] = v;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put24(uint8_t *p, uint32_t v)
+{
+  p[0] = v >> 16;
+  p[1] = v >> 8;
+  p[2] = v;
+}
+/*---------------------------------------------------------------------------*/
+static void
+random_bytes(uint8_t *p, uint8_t len)
+{
+#ifdef COAP_DTLS_RANDOM
+  COAP_DTLS_RANDOM(p, len);
+#else /* COAP_DTLS_RANDOM */
+  uint16_t r;
+
+  /* Predictable, see COAP_CONF_DTLS_RANDOM */
+  while(len) {
+    r = random_rand();
+    *p++ = r;
+    if(--len) {
+      *p++ = r >> 8;
+      len--;
+    }
+  }
+#endif /* COAP_DTLS_RANDOM */
+}
+/*---------------------------------------------------------------------------*/
+/* TLS 1.2 PRF with SHA-256 (RFC 5246, Section 5), seed = label + s1 + s2 */
+static void
+prf(const uint8_t *secret, uint8_t secret_len, const char *label,
+    const uint8_t *s1, uint8_t s1_len,
+    const uint8_t *s2, uint8_t s2_len,
+    uint8_t *out, uint8_t out_len)
+{
+  struct sha_256_hmac_ctx ctx;
+  uint8_t a[SHA_256_DIGEST_LENGTH];
+  uint8_t block[SHA_256_DIGEST_LENGTH];
+  uint8_t label_len;
+  uint8_t n;
+
+  label_len = strlen(label);
+
+  /* A(1) */
+  sha_256_hmac_init(&ctx, secret, secret_len);
+  sha_256_hmac_update(&ctx, (const uint8_t *)label, label_len);
+  sha_256_hmac_update(&ctx, s1, s1_len);
+  sha_256_hmac_update(&ctx, s2, s2_len);
+  sha_256_hmac_final(&ctx, a);
+
+  while(out_len) {
+    sha_256_hmac_init(&ctx, secret, secret_len);
+    sha_256_hmac_update(&ctx, a, SHA_256_DIGEST_LENGTH);
+    sha_256_hmac_update(&ctx, (const uint8_t *)label, label_len);
+    sha_256_hmac_update(&ctx, s1, s1_len);
+    sha_256_hmac_update(&ctx, s2, s2_len);
+    sha_256_hmac_final(&ctx, block);
+
+    n = out_len < SHA_256_DIGEST_LENGTH ? out_len : SHA_256_DIGEST_LENGTH;
+    memcpy(out, block, n);
+    out += n;
+    out_len -= n;
+
+    if(out_len) {
+      sha_256_hmac(secret, secret_len, a, SHA_256_DIGEST_LENGTH, a);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* derives the master secret from the PSK (RFC 4279, Section 2) */
+static void
+derive_master_secret(struct session *s)
+{
+  uint8_t premaster[4 + 2 * COAP_DTLS_PSK_KEY_LENGTH];
+
+  put16(premaster, psk_key_len);
+  memset(premaster + 2, 0, psk_key_len);
+  put16(premaster + 2 + psk_key_len, psk_key_len);
+  memcpy(premaster + 4 + psk_key_len, psk_key, psk_key_len);
+
+  prf(premaster, 4 + 2 * psk_key_len, "master secret",
+      s->client_random, RANDOM_LENGTH,
+      s->server_random, RANDOM_LENGTH,
+      s->master_secret, MASTER_SECRET_LENGTH);
+}
+/*---------------------------------------------------------------------------*/
+static void
+derive_keys(struct session *s)
+{
+  prf(s->master_secret, MASTER_SECRET_LENGTH, "key expansion",
+      s->server_random, RANDOM_LENGTH,
+      s->client_random, RANDOM_LENGTH,
+      s->key_block, KEY_BLOCK_LENGTH);
+}
+/*---------------------------------------------------------------------------*/
+static void
+compute_verify_data(struct session *s, int from_client, uint8_t *verify_data)
+{
+  struct sha_256_ctx ctx;
+  uint8_t digest[SHA_256_DIGEST_LENGTH];
+
+  /* the running hash continues after this */
+  memcpy(&ctx, &s->handshake_hash, sizeof(ctx));
+  sha_256_final(&ctx, digest);
+  prf(s->master_secret, MASTER_SECRET_LENGTH,
+      from_client ? "client finished" : "server finished",
+      digest, SHA_256_DIGEST_LENGTH, NULL, 0,
+      verify_data, VERIFY_DATA_LENGTH);
+}
+/*---------------------------------------------------------------------------*/
+static void
+compute_cookie(const uip_ipaddr_t *addr, uint16_t port,
+               const uint8_t *client_random, uint8_t *cookie)
+{
+  struct sha_256_hmac_ctx ctx;
+  uint8_t mac[SHA_256_DIGEST_LENGTH];
+
+  sha_256_hmac_init(&ctx, cookie_secret, sizeof(cookie_secret));
+  sha_256_hmac_update(&ctx, (const uint8_t *)addr, sizeof(uip_ipaddr_t));
+  sha_256_hmac_update(&ctx, (const uint8_t *)&port, sizeof(port));
+  sha_256_hmac_update(&ctx, client_random, RANDOM_LENGTH);
+  sha_256_hmac_final(&ctx, mac);
+  memcpy(cookie, mac, COOKIE_LENGTH);
+}
+/*---------------------------------------------------------------------------*/
+/*- Sessions and session cache ----------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+static struct session *
+find_session(const uip_ipaddr_t *addr, uint16_t port)
+{
+  uint8_t i;
+
+  for(i = 0; i < COAP_DTLS_MAX_SESSIONS; i++) {
+    if(sessions[i].state != STATE_FREE
+       && sessions[i].port == port
+       && uip_ipaddr_cmp(&sessions[i].addr, addr)) {
+      return &sessions[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_session(struct session *s)
+{
+  ctimer_stop(&s->timer);
+  s->state = STATE_FREE;
+}
+/*---------------------------------------------------------------------------*/
+/* Takes a free slot or evicts the least recently used established session */
+static struct session *
+new_session(const uip_ipaddr_t *addr, uint16_t port, int is_client)
+{
+  struct session *s;
+  clock_time_t now;
+  uint8_t i;
+
+  s = NULL;
+  now = clock_time();
+  for(i = 0; i < COAP_DTLS_MAX_SESSIONS; i++) {
+    if(sessions[i].state == STATE_FREE) {
+      s = &sessions[i];
+      break;
+    }
+    if(sessions[i].state == STATE_ESTABLISHED
+       && (s == NULL
+           || now - sessions[i].last_used > now - s->last_used)) {
+      s = &sessions[i];
+    }
+  }
+  if(s == NULL) {
+    return NULL;
+  }
+  if(s->state != STATE_FREE) {
+    PRINTF("dtls: evicting session\n");
+    free_session(s);
+  }
+
+  memset(s, 0, sizeof(struct session));
+  uip_ipaddr_copy(&s->addr, addr);
+  s->port = port;
+  s->is_client = is_client;
+  s->last_used = clock_time();
+  return s;
+}
+/*---------------------------------------------------------------------------*/
+static struct cache_entry *
+cache_find_by_peer(const uip_ipaddr_t *addr, uint16_t port)
+{
+  uint8_t i;
+
+  for(i = 0; i < COAP_DTLS_SESSION_CACHE_SIZE; i++) {
+    if(cache[i].session_id_len
+       && cache[i].port == port
+       && uip_ipaddr_cmp(&cache[i].addr, addr)) {
+      return &cache[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct cache_entry *
+cache_find_by_id(const uint8_t *id, uint8_t id_len)
+{
+  uint8_t i;
+
+  for(i = 0; i < COAP_DTLS_SESSION_CACHE_SIZE; i++) {
+    if(cache[i].session_id_len == id_len
+       && !memcmp(cache[i].session_id, id, id_len)) {
+      return &cache[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+cache_store(struct session *s)
+{
+  struct cache_entry *e;
+
+  if(!s->session_id_len) {
+    /* the server does not want the session to be resumed */
+    return;
+  }
+  e = cache_find_by_peer(&s->addr, s->port);
+  if(e == NULL) {
+    e = &cache[next_cache_entry];
+    next_cache_entry = (next_cache_entry + 1) % COAP_DTLS_SESSION_CACHE_SIZE;
+  }
+  uip_ipaddr_copy(&e->addr, &s->addr);
+  e->port = s->port;
+  memcpy(e->session_id, s->session_id, s->session_id_len);
+  e->session_id_len = s->session_id_len;
+  memcpy(e->master_secret, s->master_secret, MASTER_SECRET_LENGTH);
+}
+/*---------------------------------------------------------------------------*/
+static void
+cache_remove(const uip_ipaddr_t *addr, uint16_t port)
+{
+  struct cache_entry *e;
+
+  e = cache_find_by_peer(addr, port);
+  if(e != NULL) {
+    e->session_id_len = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*- Record layer ------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+/*
+ * Completes the record at r, whose plaintext of length len is already in
+ * place, i.e., behind the header and, in epoch 1, behind the explicit
+ * nonce. Returns the length of the record.
+ */
+static uint16_t
+seal_record(struct session *s, uint8_t *r, uint8_t type, uint8_t epoch,
+            uint16_t len)
+{
+  uint8_t nonce[CCM_STAR_TLS_NONCE_LENGTH];
+  uint8_t aad[RECORD_HEADER_LENGTH];
+  uint32_t seq;
+
+  seq = s->write_seq[epoch]++;
+  r[0] = type;
+  r[1] = VERSION_MAJOR;
+  r[2] = VERSION_MINOR;
+  r[3] = 0;
+  r[4] = epoch;
+  r[5] = 0;
+  r[6] = 0;
+  r[7] = seq >> 24;
+  r[8] = seq >> 16;
+  r[9] = seq >> 8;
+  r[10] = seq;
+
+  if(epoch == 0) {
+    put16(r + 11, len);
+    return RECORD_HEADER_LENGTH + len;
+  }
+
+  /* the explicit nonce is the 64-bit sequence number (RFC 6655) */
+  memcpy(r + RECORD_HEADER_LENGTH, r + 3, EXPLICIT_NONCE_LENGTH);
+  memcpy(nonce, WRITE_IV(s), IV_LENGTH);
+  memcpy(nonce + IV_LENGTH, r + 3, EXPLICIT_NONCE_LENGTH);
+  memcpy(aad, r + 3, 8);
+  memcpy(aad + 8, r, 3);
+  put16(aad + 11, len);
+
+  AES_128.set_key(WRITE_KEY(s));
+  ccm_star_tls_aead(nonce,
+                    r + RECORD_HEADER_LENGTH + EXPLICIT_NONCE_LENGTH, len,
+                    aad, sizeof(aad),
+                    r + RECORD_HEADER_LENGTH + EXPLICIT_NONCE_LENGTH + len,
+                    MIC_LENGTH, 1);
+
+  len += EXPLICIT_NONCE_LENGTH + MIC_LENGTH;
+  put16(r + 11, len);
+  return RECORD_HEADER_LENGTH + len;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Authenticates and decrypts an epoch 1 record in place. On success, the
+ * plaintext starts at *body.
+ */
+static int
+open_record(struct session *s, const uint8_t *r, uint8_t **body, uint16_t *len)
+{
+  uint8_t nonce[CCM_STAR_TLS_NONCE_LENGTH];
+  uint8_t aad[RECORD_HEADER_LENGTH];
+  uint8_t mic[MIC_LENGTH];
+  uint16_t m_len;
+  uint32_t seq;
+  uint32_t diff;
+
+  if(*len < EXPLICIT_NONCE_LENGTH + MIC_LENGTH || r[5] || r[6]) {
+    return 0;
+  }
+  seq = ((uint32_t)r[7] << 24) | ((uint32_t)r[8] << 16)
+      | ((uint32_t)r[9] << 8) | r[10];
+
+  /* anti-replay with a sliding window (RFC 6347, Section 4.1.2.6) */
+  if(s->replay_window && seq <= s->read_seq) {
+    diff = s->read_seq - seq;
+    if(diff >= 32 || (s->replay_window & ((uint32_t)1 << diff))) {
+      return 0;
+    }
+  }
+
+  m_len = *len - EXPLICIT_NONCE_LENGTH - MIC_LENGTH;
+  memcpy(nonce, READ_IV(s), IV_LENGTH);
+  memcpy(nonce + IV_LENGTH, *body, EXPLICIT_NONCE_LENGTH);
+  memcpy(aad, r + 3, 8);
+  memcpy(aad + 8, r, 3);
+  put16(aad + 11, m_len);
+
+  *body += EXPLICIT_NONCE_LENGTH;
+  AES_128.set_key(READ_KEY(s));
+  ccm_star_tls_aead(nonce, *body, m_len, aad, sizeof(aad),
+                    mic, MIC_LENGTH, 0);
+  if(ccm_star_mic_cmp(mic, *body + m_len, MIC_LENGTH)) {
+    return 0;
+  }
+
+  if(!s->replay_window) {
+    s->read_seq = seq;
+    s->replay_window = 1;
+  } else if(seq > s->read_seq) {
+    diff = seq - s->read_seq;
+    s->replay_window = diff >= 32 ? 1 : (s->replay_window << diff) | 1;
+    s->read_seq = seq;
+  } else {
+    s->replay_window |= (uint32_t)1 << (s->read_seq - seq);
+  }
+
+  *len = m_len;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/*- Flights -----------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+/* Appends a handshake message to the flight and returns its body */
+static uint8_t *
+begin_handshake(struct session *s, uint8_t msg_type)
+{
+  uint8_t *hs;
+
+  hs = s->flight + s->flight_len + FLIGHT_ENTRY_HEADER_LENGTH;
+  hs[0] = msg_type;
+  put16(hs + 4, s->next_send_seq++);
+  put24(hs + 6, 0);
+  return hs + HANDSHAKE_HEADER_LENGTH;
+}
+/*---------------------------------------------------------------------------*/
+static void
+end_handshake(struct session *s, const uint8_t *end)
+{
+  uint8_t *entry;
+  uint8_t *hs;
+  uint16_t len;
+
+  entry = s->flight + s->flight_len;
+  hs = entry + FLIGHT_ENTRY_HEADER_LENGTH;
+  len = end - hs - HANDSHAKE_HEADER_LENGTH;
+  put24(hs + 1, len);
+  put24(hs + 9, len);
+
+  entry[0] = CONTENT_HANDSHAKE;
+  entry[1] = s->write_epoch;
+  put16(entry + 2, HANDSHAKE_HEADER_LENGTH + len);
+  sha_256_update(&s->handshake_hash, hs, HANDSHAKE_HEADER_LENGTH + len);
+  s->flight_len += FLIGHT_ENTRY_HEADER_LENGTH + HANDSHAKE_HEADER_LENGTH + len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_change_cipher_spec(struct session *s)
+{
+  uint8_t *entry;
+
+  entry = s->flight + s->flight_len;
+  entry[0] = CONTENT_CHANGE_CIPHER_SPEC;
+  entry[1] = s->write_epoch;
+  put16(entry + 2, 1);
+  entry[FLIGHT_ENTRY_HEADER_LENGTH] = 1;
+  s->flight_len += FLIGHT_ENTRY_HEADER_LENGTH + 1;
+
+  s->write_epoch = 1;
+  s->write_seq[1] = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_finished(struct session *s)
+{
+  uint8_t *p;
+
+  p = begin_handshake(s, HS_FINISHED);
+  compute_verify_data(s, s->is_client, p);
+  end_handshake(s, p + VERIFY_DATA_LENGTH);
+}
+/*---------------------------------------------------------------------------*/
+/* Appends an application record with the given plaintext to the datagram */
+static uint16_t
+add_application_data(struct session *s, uint16_t offset,
+                     const uint8_t *data, uint16_t len)
+{
+  uint8_t *r;
+
+  if(offset + len + COAP_DTLS_RECORD_OVERHEAD > DATAGRAM_BUF_SIZE) {
+    return offset;
+  }
+  datagram_buf_used = 1;
+  r = DATAGRAM_BUF + offset;
+  /* data may be uip_appdata and thus overlap */
+  memmove(r + RECORD_HEADER_LENGTH + EXPLICIT_NONCE_LENGTH, data, len);
+  return offset + seal_record(s, r, CONTENT_APPLICATION_DATA, 1, len);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Sends the current flight in one datagram, with fresh record sequence
+ * numbers. Queued application data is appended if the flight completes
+ * the handshake.
+ */
+static void
+transmit_flight(struct session *s)
+{
+  uint8_t *entry;
+  uint8_t *r;
+  uint16_t len;
+  uint16_t offset;
+  uint8_t pos;
+
+  datagram_buf_used = 1;
+  offset = 0;
+  for(pos = 0; pos < s->flight_len;
+      pos += FLIGHT_ENTRY_HEADER_LENGTH + len) {
+    entry = s->flight + pos;
+    len = get16(entry + 2);
+    r = DATAGRAM_BUF + offset;
+    memcpy(r + RECORD_HEADER_LENGTH + (entry[1] ? EXPLICIT_NONCE_LENGTH : 0),
+           entry + FLIGHT_ENTRY_HEADER_LENGTH, len);
+    offset += seal_record(s, r, entry[0], entry[1], len);
+  }
+
+  if(s->state == STATE_ESTABLISHED && s->pending_len) {
+    offset = add_application_data(s, offset, s->pending, s->pending_len);
+    s->pending_len = 0;
+  }
+
+  coap_dtls_stats.flights_sent++;
+  output(&s->addr, s->port, DATAGRAM_BUF, offset);
+}
+/*---------------------------------------------------------------------------*/
+/* Sends a flight that the peer has to answer */
+static void
+send_flight(struct session *s)
+{
+  s->retransmissions = 0;
+  transmit_flight(s);
+  ctimer_set(&s->timer, COAP_DTLS_RETRANSMIT_TIMEOUT, retransmit, s);
+}
+/*---------------------------------------------------------------------------*/
+static void
+retransmit(void *ptr)
+{
+  struct session *s;
+
+  s = ptr;
+  if(s->retransmissions >= COAP_DTLS_MAX_RETRANSMISSIONS) {
+    PRINTF("dtls: handshake failed\n");
+    coap_dtls_stats.failed_handshakes++;
+    free_session(s);
+    return;
+  }
+  s->retransmissions++;
+  coap_dtls_stats.retransmissions++;
+  transmit_flight(s);
+  ctimer_set(&s->timer, COAP_DTLS_RETRANSMIT_TIMEOUT << s->retransmissions,
+             retransmit, s);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handshake_timeout(void *ptr)
+{
+  struct session *s;
+
+  s = ptr;
+  if(s->state != STATE_ESTABLISHED || s->is_unconfirmed) {
+    PRINTF("dtls: handshake timed out\n");
+    coap_dtls_stats.failed_handshakes++;
+    free_session(s);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The peer answered our last flight: stop retransmitting it */
+static void
+flight_acknowledged(struct session *s)
+{
+  if(s->state == STATE_ESTABLISHED) {
+    ctimer_stop(&s->timer);
+  } else {
+    ctimer_set(&s->timer, HANDSHAKE_TIMEOUT, handshake_timeout, s);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+establish(struct session *s)
+{
+  s->state = STATE_ESTABLISHED;
+  if(s->is_client && s->is_resumed) {
+    /*
+     * If our final flight got lost too often, the server gave up while
+     * we consider the session established. Until the server sends
+     * application data, treat the session as half-open.
+     */
+    s->is_unconfirmed = 1;
+    ctimer_set(&s->timer, HANDSHAKE_TIMEOUT, handshake_timeout, s);
+  } else {
+    ctimer_stop(&s->timer);
+  }
+  if(s->is_resumed) {
+    coap_dtls_stats.abbreviated_handshakes++;
+  } else {
+    coap_dtls_stats.full_handshakes++;
+  }
+  cache_store(s);
+  PRINTF("dtls: session established (%s)\n",
+         s->is_resumed ? "abbreviated" : "full");
+}
+/*---------------------------------------------------------------------------*/
+/*- Handshake ---------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+static void
+send_client_hello(struct session *s, const uint8_t *cookie, uint8_t cookie_len)
+{
+  uint8_t *p;
+
+  /* only the ClientHello that the server answers goes into the hash */
+  sha_256_init(&s->handshake_hash);
+  s->flight_len = 0;
+
+  p = begin_handshake(s, HS_CLIENT_HELLO);
+  *p++ = VERSION_MAJOR;
+  *p++ = VERSION_MINOR;
+  memcpy(p, s->client_random, RANDOM_LENGTH);
+  p += RANDOM_LENGTH;
+  *p++ = s->session_id_len;
+  memcpy(p, s->session_id, s->session_id_len);
+  p += s->session_id_len;
+  *p++ = cookie_len;
+  memcpy(p, cookie, cookie_len);
+  p += cookie_len;
+  /* signal RFC 5746 support, as we never renegotiate */
+  put16(p, 4);
+  put16(p + 2, TLS_PSK_WITH_AES_128_CCM_8);
+  put16(p + 4, TLS_EMPTY_RENEGOTIATION_INFO_SCSV);
+  p += 6;
+  *p++ = 1;
+  *p++ = 0; /* null compression */
+  end_handshake(s, p);
+
+  s->state = STATE_CLIENT_WAIT_SERVER_HELLO;
+  send_flight(s);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_hello_verify_request(const uip_ipaddr_t *addr, uint16_t port,
+                          const uint8_t *record_seq, uint16_t msg_seq,
+                          const uint8_t *cookie)
+{
+  uint8_t *r;
+  uint8_t *hs;
+  uint8_t *p;
+  uint16_t len;
+
+  /* stateless: reuse the record sequence number of the ClientHello */
+  datagram_buf_used = 1;
+  r = DATAGRAM_BUF;
+  hs = r + RECORD_HEADER_LENGTH;
+  p = hs + HANDSHAKE_HEADER_LENGTH;
+  *p++ = VERSION_MAJOR;
+  *p++ = VERSION_MINOR_1_0;
+  *p++ = COOKIE_LENGTH;
+  memcpy(p, cookie, COOKIE_LENGTH);
+  p += COOKIE_LENGTH;
+  len = p - hs - HANDSHAKE_HEADER_LENGTH;
+
+  hs[0] = HS_HELLO_VERIFY_REQUEST;
+  put24(hs + 1, len);
+  put16(hs + 4, msg_seq);
+  put24(hs + 6, 0);
+  put24(hs + 9, len);
+
+  r[0] = CONTENT_HANDSHAKE;
+  r[1] = VERSION_MAJOR;
+  r[2] = VERSION_MINOR;
+  memmove(r + 3, record_seq, 8);
+  put16(r + 11, HANDSHAKE_HEADER_LENGTH + len);
+
+  coap_dtls_stats.hello_verify_requests++;
+  output(addr, port, r, RECORD_HEADER_LENGTH + HANDSHAKE_HEADER_LENGTH + len);
+}
+/*---------------------------------------------------------------------------*/
+/* Handles a ClientHello. Returns 0 if processing of the datagram must stop. */
+static int
+handle_client_hello(struct session **sp, const uip_ipaddr_t *addr,
+                    uint16_t port, const uint8_t *record, const uint8_t *msg)
+{
+  struct session *s;
+  struct cache_entry *e;
+  const uint8_t *p;
+  const uint8_t *end;
+  const uint8_t *random;
+  const uint8_t *session_id;
+  const uint8_t *cookie;
+  uint8_t *q;
+  uint8_t expected_cookie[COOKIE_LENGTH];
+  uint8_t session_id_len;
+  uint8_t cookie_len;
+  uint16_t msg_seq;
+  uint16_t n;
+  uint16_t ext_len;
+  int found;
+  int renegotiation_info;
+
+  s = *sp;
+  msg_seq = get16(msg + 4);
+  p = msg + HANDSHAKE_HEADER_LENGTH;
+  end = p + get24(msg + 1);
+
+  if(end - p < 2 + RANDOM_LENGTH + 1
+     || p[0] != VERSION_MAJOR || p[1] < VERSION_MINOR) {
+    return 1;
+  }
+  random = p + 2;
+  p += 2 + RANDOM_LENGTH;
+
+  if(s != NULL && !s->is_client
+     && !memcmp(s->client_random, random, RANDOM_LENGTH)) {
+    /* a retransmission: the client missed our last flight */
+    s->resend = 1;
+    return 1;
+  }
+
+  session_id_len = *p++;
+  session_id = p;
+  p += session_id_len;
+  if(session_id_len > SESSION_ID_MAX_LENGTH || end - p < 1) {
+    return 1;
+  }
+  cookie_len = *p++;
+  cookie = p;
+  p += cookie_len;
+  if(end - p < 2) {
+    return 1;
+  }
+  n = get16(p);
+  p += 2;
+  if(end - p < n + 1) {
+    return 1;
+  }
+  found = 0;
+  renegotiation_info = 0;
+  for(; n >= 2; n -= 2, p += 2) {
+    found |= get16(p) == TLS_PSK_WITH_AES_128_CCM_8;
+    renegotiation_info |= get16(p) == TLS_EMPTY_RENEGOTIATION_INFO_SCSV;
+  }
+  p += n;
+  if(!found) {
+    PRINTF("dtls: no common cipher suite\n");
+    return 1;
+  }
+  /* null compression is mandatory, so skip the compression methods */
+  p += 1 + *p;
+  if(end - p >= 2) {
+    /* renegotiation_info is the only extension that we care about */
+    n = get16(p);
+    p += 2;
+    while(n >= 4 && end - p >= 4) {
+      renegotiation_info |= get16(p) == EXTENSION_RENEGOTIATION_INFO;
+      ext_len = get16(p + 2);
+      if(ext_len + 4 > n) {
+        break;
+      }
+      p += 4 + ext_len;
+      n -= 4 + ext_len;
+    }
+  }
+
+  e = session_id_len ? cache_find_by_id(session_id, session_id_len) : NULL;
+  if(e == NULL) {
+    /* a full handshake needs a return-routability check first */
+    compute_cookie(addr, port, random, expected_cookie);
+    if(cookie_len != COOKIE_LENGTH
+       || ccm_star_mic_cmp(cookie, expected_cookie, COOKIE_LENGTH)) {
+      send_hello_verify_request(addr, port, record + 3, msg_seq,
+                                expected_cookie);
+      return 0;
+    }
+  }
+
+  if(s != NULL) {
+    /* the client starts over */
+    free_session(s);
+  }
+  s = new_session(addr, port, 0);
+  *sp = s;
+  if(s == NULL) {
+    PRINTF("dtls: no free session\n");
+    return 1;
+  }
+
+  memcpy(s->client_random, random, RANDOM_LENGTH);
+  random_bytes(s->server_random, RANDOM_LENGTH);
+  s->has_renegotiation_info = renegotiation_info;
+  s->next_send_seq = msg_seq;
+  s->next_receive_seq = msg_seq + 1;
+  sha_256_init(&s->handshake_hash);
+  sha_256_update(&s->handshake_hash, msg,
+                 HANDSHAKE_HEADER_LENGTH + get24(msg + 1));
+
+  if(e != NULL) {
+    s->is_resumed = 1;
+    memcpy(s->session_id, e->session_id, e->session_id_len);
+    s->session_id_len = e->session_id_len;
+    memcpy(s->master_secret, e->master_secret, MASTER_SECRET_LENGTH);
+    derive_keys(s);
+  } else {
+    random_bytes(s->session_id, SESSION_ID_LENGTH);
+    s->session_id_len = SESSION_ID_LENGTH;
+  }
+
+  /* ServerHello */
+  s->flight_len = 0;
+  q = begin_handshake(s, HS_SERVER_HELLO);
+  *q++ = VERSION_MAJOR;
+  *q++ = VERSION_MINOR;
+  memcpy(q, s->server_random, RANDOM_LENGTH);
+  q += RANDOM_LENGTH;
+  *q++ = s->session_id_len;
+  memcpy(q, s->session_id, s->session_id_len);
+  q += s->session_id_len;
+  put16(q, TLS_PSK_WITH_AES_128_CCM_8);
+  q += 2;
+  *q++ = 0;
+  if(s->has_renegotiation_info) {
+    /* an empty renegotiation_info extension (RFC 5746) */
+    put16(q, 5);
+    put16(q + 2, EXTENSION_RENEGOTIATION_INFO);
+    put16(q + 4, 1);
+    q[6] = 0;
+    q += 7;
+  }
+  end_handshake(s, q);
+
+  if(s->is_resumed) {
+    add_change_cipher_spec(s);
+    add_finished(s);
+  } else {
+    end_handshake(s, begin_handshake(s, HS_SERVER_HELLO_DONE));
+  }
+  s->state = s->is_resumed
+      ? STATE_SERVER_WAIT_FINISHED : STATE_SERVER_WAIT_KEY_EXCHANGE;
+  send_flight(s);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_hello_verify_request(struct session *s, const uint8_t *body,
+                            uint16_t len)
+{
+  if(len < 3 || body[2] > len - 3 || body[2] > COOKIE_MAX_LENGTH) {
+    return;
+  }
+  send_client_hello(s, body + 3, body[2]);
+}
+/*---------------------------------------------------------------------------*/
+static int
+handle_server_hello(struct session *s, const uint8_t *body, uint16_t len)
+{
+  uint8_t id_len;
+
+  if(len < 2 + RANDOM_LENGTH + 1
+     || body[0] != VERSION_MAJOR || body[1] != VERSION_MINOR) {
+    return 0;
+  }
+  id_len = body[2 + RANDOM_LENGTH];
+  if(id_len > SESSION_ID_MAX_LENGTH || len < 2 + RANDOM_LENGTH + 1 + id_len + 3
+     || get16(body + 3 + RANDOM_LENGTH + id_len) != TLS_PSK_WITH_AES_128_CCM_8
+     || body[5 + RANDOM_LENGTH + id_len] != 0) {
+    return 0;
+  }
+  memcpy(s->server_random, body + 2, RANDOM_LENGTH);
+
+  if(id_len && id_len == s->session_id_len
+     && !memcmp(s->session_id, body + 3 + RANDOM_LENGTH, id_len)) {
+    /* the server resumes the session, master_secret is from the cache */
+    s->is_resumed = 1;
+    derive_keys(s);
+    s->state = STATE_CLIENT_WAIT_FINISHED;
+  } else {
+    memcpy(s->session_id, body + 3 + RANDOM_LENGTH, id_len);
+    s->session_id_len = id_len;
+    s->state = STATE_CLIENT_WAIT_SERVER_HELLO_DONE;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_client_key_exchange(struct session *s)
+{
+  uint8_t *p;
+
+  derive_master_secret(s);
+  derive_keys(s);
+
+  s->flight_len = 0;
+  p = begin_handshake(s, HS_CLIENT_KEY_EXCHANGE);
+  put16(p, psk_identity_len);
+  memcpy(p + 2, psk_identity, psk_identity_len);
+  end_handshake(s, p + 2 + psk_identity_len);
+  add_change_cipher_spec(s);
+  add_finished(s);
+
+  s->state = STATE_CLIENT_WAIT_FINISHED;
+  send_flight(s);
+}
+/*---------------------------------------------------------------------------*/
+static int
+handle_client_key_exchange(struct session *s, const uint8_t *body,
+                           uint16_t len)
+{
+  if(len < 2 || get16(body) != len - 2
+     || len - 2 != psk_identity_len
+     || memcmp(body + 2, psk_identity, psk_identity_len)) {
+    PRINTF("dtls: unknown PSK identity\n");
+    return 0;
+  }
+  derive_master_secret(s);
+  derive_keys(s);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_finished(struct session *s, const uint8_t *body, uint16_t len)
+{
+  uint8_t verify_data[VERIFY_DATA_LENGTH];
+
+  if(len != VERIFY_DATA_LENGTH) {
+    return 0;
+  }
+  compute_verify_data(s, !s->is_client, verify_data);
+  return !ccm_star_mic_cmp(verify_data, body, VERIFY_DATA_LENGTH);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Handles a handshake message other than a ClientHello. Returns 0 if the
+ * handshake failed.
+ */
+static int
+handle_handshake(struct session *s, const uint8_t *msg, uint8_t epoch)
+{
+  const uint8_t *body;
+  uint16_t msg_seq;
+  uint16_t len;
+  uint8_t type;
+
+  type = msg[0];
+  len = get24(msg + 1);
+  msg_seq = get16(msg + 4);
+  body = msg + HANDSHAKE_HEADER_LENGTH;
+
+  if(msg_seq < s->next_receive_seq) {
+    /* the peer retransmits because it missed our last flight */
+    s->resend = s->flight_len != 0;
+    return 1;
+  }
+  if(msg_seq > s->next_receive_seq
+     && s->state != STATE_CLIENT_WAIT_SERVER_HELLO) {
+    /* out of order, wait for the retransmission */
+    return 1;
+  }
+
+  switch(s->state) {
+  case STATE_CLIENT_WAIT_SERVER_HELLO:
+    if(type == HS_HELLO_VERIFY_REQUEST) {
+      s->next_receive_seq = msg_seq + 1;
+      handle_hello_verify_request(s, body, len);
+      return 1;
+    }
+    if(type != HS_SERVER_HELLO) {
+      return 1;
+    }
+    if(!handle_server_hello(s, body, len)) {
+      return 0;
+    }
+    break;
+  case STATE_CLIENT_WAIT_SERVER_HELLO_DONE:
+    if(type != HS_SERVER_HELLO_DONE) {
+      return 1;
+    }
+    s->next_receive_seq = msg_seq + 1;
+    sha_256_update(&s->handshake_hash, msg, HANDSHAKE_HEADER_LENGTH + len);
+    send_client_key_exchange(s);
+    return 1;
+  case STATE_SERVER_WAIT_KEY_EXCHANGE:
+    if(type != HS_CLIENT_KEY_EXCHANGE) {
+      return 1;
+    }
+    if(!handle_client_key_exchange(s, body, len)) {
+      return 0;
+    }
+    s->state = STATE_SERVER_WAIT_FINISHED;
+    break;
+  case STATE_CLIENT_WAIT_FINISHED:
+  case STATE_SERVER_WAIT_FINISHED:
+    if(type != HS_FINISHED || epoch != 1) {
+      return 1;
+    }
+    if(!check_finished(s, body, len)) {
+      PRINTF("dtls: bad Finished\n");
+      return 0;
+    }
+    s->next_receive_seq = msg_seq + 1;
+    sha_256_update(&s->handshake_hash, msg, HANDSHAKE_HEADER_LENGTH + len);
+    if(s->is_client == s->is_resumed) {
+      /* the peer finished first: reply with our final flight */
+      s->flight_len = 0;
+      add_change_cipher_spec(s);
+      add_finished(s);
+      establish(s);
+      transmit_flight(s);
+    } else {
+      establish(s);
+    }
+    return 1;
+  default:
+    return 1;
+  }
+
+  s->next_receive_seq = msg_seq + 1;
+  sha_256_update(&s->handshake_hash, msg, HANDSHAKE_HEADER_LENGTH + len);
+  flight_acknowledged(s);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_alert(struct session *s, uint8_t level, uint8_t description)
+{
+  uint8_t *r;
+
+  datagram_buf_used = 1;
+  r = DATAGRAM_BUF;
+  r[RECORD_HEADER_LENGTH + EXPLICIT_NONCE_LENGTH] = level;
+  r[RECORD_HEADER_LENGTH + EXPLICIT_NONCE_LENGTH + 1] = description;
+  output(&s->addr, s->port, r, seal_record(s, r, CONTENT_ALERT, 1, 2));
+}
+/*---------------------------------------------------------------------------*/
+/*- API ---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+void
+coap_dtls_init(coap_dtls_output_t out)
+{
+  output = out;
+  random_bytes(cookie_secret, sizeof(cookie_secret));
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_dtls_set_psk(const uint8_t *identity, uint8_t identity_len,
+                  const uint8_t *key, uint8_t key_len)
+{
+  if(identity_len > COAP_DTLS_PSK_IDENTITY_LENGTH
+     || key_len > COAP_DTLS_PSK_KEY_LENGTH) {
+    return 0;
+  }
+  if(identity_len != psk_identity_len || key_len != psk_key_len
+     || memcmp(identity, psk_identity, identity_len)
+     || memcmp(key, psk_key, key_len)) {
+    /* cached sessions were authenticated with the old key */
+    memset(cache, 0, sizeof(cache));
+  }
+  memcpy(psk_identity, identity, identity_len);
+  psk_identity_len = identity_len;
+  memcpy(psk_key, key, key_len);
+  psk_key_len = key_len;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_dtls_connect(const uip_ipaddr_t *addr, uint16_t port)
+{
+  struct session *s;
+  struct cache_entry *e;
+
+  s = find_session(addr, port);
+  if(s != NULL) {
+    return 1;
+  }
+  s = new_session(addr, port, 1);
+  if(s == NULL) {
+    return 0;
+  }
+
+  random_bytes(s->client_random, RANDOM_LENGTH);
+  e = cache_find_by_peer(addr, port);
+  if(e != NULL) {
+    /* offer to resume */
+    memcpy(s->session_id, e->session_id, e->session_id_len);
+    s->session_id_len = e->session_id_len;
+    memcpy(s->master_secret, e->master_secret, MASTER_SECRET_LENGTH);
+  }
+  send_client_hello(s, NULL, 0);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_dtls_close(const uip_ipaddr_t *addr, uint16_t port)
+{
+  struct session *s;
+
+  s = find_session(addr, port);
+  if(s == NULL) {
+    return;
+  }
+  if(s->state == STATE_ESTABLISHED) {
+    send_alert(s, ALERT_LEVEL_WARNING, ALERT_CLOSE_NOTIFY);
+  }
+  free_session(s);
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_dtls_send(const uip_ipaddr_t *addr, uint16_t port,
+               const uint8_t *data, uint16_t len)
+{
+  struct session *s;
+  uint16_t n;
+
+  s = find_session(addr, port);
+  if(s != NULL && s->state == STATE_ESTABLISHED
+     && s->write_seq[1] == 0xffffffff) {
+    /* the sequence numbers are exhausted, start a new session */
+    coap_dtls_close(addr, port);
+    cache_remove(addr, port);
+    s = NULL;
+  }
+
+  if(s == NULL || s->state != STATE_ESTABLISHED) {
+    if(len > COAP_MAX_PACKET_SIZE) {
+      return 0;
+    }
+    if(s == NULL) {
+      if(!coap_dtls_connect(addr, port)) {
+        return 0;
+      }
+      s = find_session(addr, port);
+    } else if(s->pending_len != 0) {
+      /* do not replace what is queued already */
+      return 0;
+    }
+    memcpy(s->pending, data, len);
+    s->pending_len = len;
+    return 1;
+  }
+
+  s->last_used = clock_time();
+  n = add_application_data(s, 0, data, len);
+  if(n == 0) {
+    return 0;
+  }
+  output(&s->addr, s->port, DATAGRAM_BUF, n);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+coap_dtls_input(const uip_ipaddr_t *addr, uint16_t port,
+                uint8_t *data, uint16_t len)
+{
+  struct session *s;
+  uip_ipaddr_t peer;
+  uint8_t *record;
+  uint8_t *body;
+  uint8_t *app_data;
+  uint16_t app_data_len;
+  uint16_t body_len;
+  uint16_t msg_len;
+  uint16_t n;
+  uint8_t epoch;
+  uint8_t *start;
+
+  /* addr may point into uip_buf, which is overwritten when we reply */
+  uip_ipaddr_copy(&peer, addr);
+  s = find_session(&peer, port);
+  if(s != NULL) {
+    s->resend = 0;
+  }
+  datagram_buf_used = 0;
+  start = data;
+  app_data = NULL;
+  app_data_len = 0;
+
+  while(len >= RECORD_HEADER_LENGTH) {
+    record = data;
+    body = record + RECORD_HEADER_LENGTH;
+    body_len = get16(record + 11);
+    if(record[1] != VERSION_MAJOR || body_len > len - RECORD_HEADER_LENGTH) {
+      break;
+    }
+    data += RECORD_HEADER_LENGTH + body_len;
+    len -= RECORD_HEADER_LENGTH + body_len;
+
+    if(record[3] || record[4] > 1) {
+      continue;
+    }
+    epoch = record[4];
+    if(epoch == 1) {
+      if(s == NULL || s->read_epoch != 1
+         || !open_record(s, record, &body, &body_len)) {
+        coap_dtls_stats.records_dropped++;
+        continue;
+      }
+    } else if(record[0] != CONTENT_HANDSHAKE
+              && (s == NULL || s->read_epoch != 0)) {
+      /* once keys are in place, only handshake retransmissions may go unprotected */
+      continue;
+    }
+
+    switch(record[0]) {
+    case CONTENT_HANDSHAKE:
+      while(body_len >= HANDSHAKE_HEADER_LENGTH) {
+        msg_len = get24(body + 1);
+        if(msg_len > body_len - HANDSHAKE_HEADER_LENGTH) {
+          break;
+        }
+        /* fragmented messages are not supported */
+        if(get24(body + 6) == 0 && get24(body + 9) == msg_len) {
+          if(body[0] == HS_CLIENT_HELLO) {
+            if(epoch == 0
+               && !handle_client_hello(&s, &peer, port, record, body)) {
+              return 0;
+            }
+          } else if(s != NULL && !handle_handshake(s, body, epoch)) {
+            coap_dtls_stats.failed_handshakes++;
+            cache_remove(&s->addr, s->port);
+            free_session(s);
+            return 0;
+          }
+        }
+        body += HANDSHAKE_HEADER_LENGTH + msg_len;
+        body_len -= HANDSHAKE_HEADER_LENGTH + msg_len;
+      }
+      break;
+    case CONTENT_CHANGE_CIPHER_SPEC:
+      if(s != NULL && s->read_epoch == 0 && body_len == 1 && body[0] == 1
+         && (s->state == STATE_CLIENT_WAIT_FINISHED
+             || s->state == STATE_SERVER_WAIT_FINISHED)) {
+        s->read_epoch = 1;
+        s->replay_window = 0;
+      }
+      break;
+    case CONTENT_ALERT:
+      if(s != NULL && body_len == 2) {
+        PRINTF("dtls: alert %u/%u\n", body[0], body[1]);
+        if(body[1] != ALERT_CLOSE_NOTIFY) {
+          cache_remove(&s->addr, s->port);
+        }
+        free_session(s);
+        return 0;
+      }
+      break;
+    case CONTENT_APPLICATION_DATA:
+      if(epoch == 1 && s->state == STATE_ESTABLISHED && app_data == NULL) {
+        app_data = body;
+        app_data_len = body_len;
+        if(s->is_unconfirmed) {
+          s->is_unconfirmed = 0;
+          ctimer_stop(&s->timer);
+        }
+      }
+      break;
+    }
+  }
+
+  if(s == NULL || s->state == STATE_FREE) {
+    return 0;
+  }
+  s->last_used = clock_time();
+
+  if(s->resend) {
+    transmit_flight(s);
+  }
+  if(s->state == STATE_ESTABLISHED && s->pending_len) {
+    /* the handshake completed with the peer's flight */
+    n = add_application_data(s, 0, s->pending, s->pending_len);
+    s->pending_len = 0;
+    if(n) {
+      output(&s->addr, s->port, DATAGRAM_BUF, n);
+    }
+  }
+
+  if(app_data == NULL || datagram_buf_used) {
+    /* a reply may have been assembled where the application data was */
+    return 0;
+  }
+  memmove(start, app_data, app_data_len);
+  return app_data_len;
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_dtls_is_connected(const uip_ipaddr_t *addr, uint16_t port)
+{
+  struct session *s;
+
+  s = find_session(addr, port);
+  return s != NULL && s->state == STATE_ESTABLISHED;
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_dtls_is_secure_peer(const uip_ipaddr_t *addr, uint16_t port)
+{
+  return port == UIP_HTONS(COAP_DEFAULT_SECURE_PORT)
+      || find_session(addr, port) != NULL
+      || cache_find_by_peer(addr, port) != NULL;
+}
+/*---------------------------------------------------------------------------*/
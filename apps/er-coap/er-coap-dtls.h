@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *      DTLS 1.2 record layer and PSK handshake for secure CoAP.
+ *
+ *      Only TLS_PSK_WITH_AES_128_CCM_8 (RFC 6655), the mandatory cipher
+ *      suite of CoAP in PreSharedKey mode (RFC 7252), is supported.
+ *      Since handshake round trips dominate the cost of a secure session
+ *      on a lossy mesh, the implementation
+ *      - sends every handshake flight in a single datagram,
+ *      - keeps the master secrets of recent sessions so that a session
+ *        can be resumed with an abbreviated handshake (one round trip,
+ *        no cookie exchange, no key exchange),
+ *      - piggybacks the first application record on the final flight of
+ *        an abbreviated handshake, and
+ *      - retransmits whole flights with exponential backoff instead of
+ *        relying on CoAP retransmissions.
+ *
+ *      Records are assembled in uip_buf, like CoAP messages are.
+ *      Randoms, session IDs and the cookie secret must be
+ *      unpredictable: set COAP_CONF_DTLS_RANDOM to the platform's
+ *      cryptographically secure random number generator.
+ */
+
+#ifndef ER_COAP_DTLS_H_
+#define ER_COAP_DTLS_H_
+
+#include "contiki-net.h"
+
+/* Maximum number of concurrent sessions */
+#ifdef COAP_CONF_DTLS_MAX_SESSIONS
+#define COAP_DTLS_MAX_SESSIONS COAP_CONF_DTLS_MAX_SESSIONS
+#else
+#define COAP_DTLS_MAX_SESSIONS          2
+#endif /* COAP_CONF_DTLS_MAX_SESSIONS */
+
+/* Number of closed or evicted sessions that can be resumed */
+#ifdef COAP_CONF_DTLS_SESSION_CACHE_SIZE
+#define COAP_DTLS_SESSION_CACHE_SIZE COAP_CONF_DTLS_SESSION_CACHE_SIZE
+#else
+#define COAP_DTLS_SESSION_CACHE_SIZE    2
+#endif /* COAP_CONF_DTLS_SESSION_CACHE_SIZE */
+
+/* Initial flight retransmission timeout, doubled after each attempt */
+#ifdef COAP_CONF_DTLS_RETRANSMIT_TIMEOUT
+#define COAP_DTLS_RETRANSMIT_TIMEOUT COAP_CONF_DTLS_RETRANSMIT_TIMEOUT
+#else
+#define COAP_DTLS_RETRANSMIT_TIMEOUT    (2 * CLOCK_SECOND)
+#endif /* COAP_CONF_DTLS_RETRANSMIT_TIMEOUT */
+
+#ifdef COAP_CONF_DTLS_MAX_RETRANSMISSIONS
+#define COAP_DTLS_MAX_RETRANSMISSIONS COAP_CONF_DTLS_MAX_RETRANSMISSIONS
+#else
+#define COAP_DTLS_MAX_RETRANSMISSIONS   4
+#endif /* COAP_CONF_DTLS_MAX_RETRANSMISSIONS */
+
+#ifdef COAP_CONF_DTLS_PSK_IDENTITY_LENGTH
+#define COAP_DTLS_PSK_IDENTITY_LENGTH COAP_CONF_DTLS_PSK_IDENTITY_LENGTH
+#else
+#define COAP_DTLS_PSK_IDENTITY_LENGTH   32
+#endif /* COAP_CONF_DTLS_PSK_IDENTITY_LENGTH */
+
+#ifdef COAP_CONF_DTLS_PSK_KEY_LENGTH
+#define COAP_DTLS_PSK_KEY_LENGTH COAP_CONF_DTLS_PSK_KEY_LENGTH
+#else
+#define COAP_DTLS_PSK_KEY_LENGTH        16
+#endif /* COAP_CONF_DTLS_PSK_KEY_LENGTH */
+
+/*
+ * Function that fills p with len cryptographically secure random bytes,
+ * declared as void f(uint8_t *p, uint8_t len). If it is not set,
+ * random_rand() is used instead. random_rand() is not cryptographically
+ * secure: an attacker who sees a few randoms can predict the cookie
+ * secret and the randoms of later handshakes, however well it was
+ * seeded.
+ */
+#ifdef COAP_CONF_DTLS_RANDOM
+#define COAP_DTLS_RANDOM COAP_CONF_DTLS_RANDOM
+void COAP_DTLS_RANDOM(uint8_t *p, uint8_t len);
+#endif /* COAP_CONF_DTLS_RANDOM */
+
+/* record header, explicit nonce, and MIC */
+#define COAP_DTLS_RECORD_OVERHEAD       (13 + 8 + 8)
+
+typedef void (*coap_dtls_output_t)(const uip_ipaddr_t *addr, uint16_t port,
+                                   const uint8_t *data, uint16_t len);
+
+struct coap_dtls_stats {
+  uint16_t full_handshakes;
+  uint16_t abbreviated_handshakes;
+  uint16_t failed_handshakes;
+  uint16_t flights_sent;
+  uint16_t retransmissions;
+  uint16_t hello_verify_requests;
+  uint16_t records_dropped;
+};
+
+extern struct coap_dtls_stats coap_dtls_stats;
+
+/**
+ * \brief         Initializes the DTLS layer
+ * \param output  Called to send a datagram to a peer. Ports are in network
+ *                byte order throughout this API.
+ */
+void coap_dtls_init(coap_dtls_output_t output);
+
+/**
+ * \brief         Sets the PSK identity and key used as client, and expected
+ *                from clients when acting as server
+ * \retval 0      <-> the identity or the key is too long
+ */
+int coap_dtls_set_psk(const uint8_t *identity, uint8_t identity_len,
+                      const uint8_t *key, uint8_t key_len);
+
+/**
+ * \brief         Starts a handshake with a server, resuming a cached
+ *                session with it if possible
+ * \retval 0      <-> no session could be allocated
+ */
+int coap_dtls_connect(const uip_ipaddr_t *addr, uint16_t port);
+
+/**
+ * \brief         Sends a close_notify alert and frees the session. The
+ *                session can still be resumed later on.
+ */
+void coap_dtls_close(const uip_ipaddr_t *addr, uint16_t port);
+
+/**
+ * \brief         Sends data as an application record. Without an
+ *                established session, the data is queued and a
+ *                handshake is started.
+ * \retval 0      <-> the data was dropped, e.g., because other data
+ *                is still queued for the peer
+ */
+int coap_dtls_send(const uip_ipaddr_t *addr, uint16_t port,
+                   const uint8_t *data, uint16_t len);
+
+/**
+ * \brief         Processes a received datagram
+ * \param data    The datagram. The application data is decrypted in place
+ *                and moved to its start.
+ * \return        The length of the application data, 0 if there was none
+ */
+uint16_t coap_dtls_input(const uip_ipaddr_t *addr, uint16_t port,
+                         uint8_t *data, uint16_t len);
+
+/**
+ * \retval 1      <-> there is an established session with the peer
+ */
+int coap_dtls_is_connected(const uip_ipaddr_t *addr, uint16_t port);
+
+/**
+ * \retval 1      <-> traffic with the peer must go through DTLS, i.e., there
+ *                is a session, a cached session, or the peer listens on
+ *                COAP_DEFAULT_SECURE_PORT
+ */
+int coap_dtls_is_secure_peer(const uip_ipaddr_t *addr, uint16_t port);
+
+#endif /* ER_COAP_DTLS_H_ */
@@ -37,10 +37,14 @@
  */
 
 #include "sys/cc.h"
+#include "sys/energest.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "er-coap-engine.h"
+#if WITH_DTLS
+#include "er-coap-dtls.h"
+#endif
 
 #define DEBUG 0
 #if DEBUG
@@ -76,16 +80,29 @@ coap_receive(void)
   static coap_packet_t message[1]; /* this way the packet can be treated as pointer as usual */
   static coap_packet_t response[1];
   static coap_transaction_t *transaction = NULL;
+  uint16_t data_len;
 
   if(uip_newdata()) {
+    data_len = uip_datalen();
+
+#if WITH_DTLS
+    if(coap_is_secure_connection(uip_udp_conn)) {
+      /* the application data is decrypted in place */
+      data_len = coap_dtls_input(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport,
+                                 uip_appdata, data_len);
+      if(data_len == 0) {
+        return erbium_status_code;
+      }
+    }
+#endif
 
     PRINTF("receiving UDP datagram from: ");
     PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
     PRINTF(":%u\n  Length: %u\n", uip_ntohs(UIP_UDP_BUF->srcport),
-           uip_datalen());
+           data_len);
 
     erbium_status_code =
-      coap_parse_message(message, uip_appdata, uip_datalen());
+      coap_parse_message(message, uip_appdata, data_len);
 
     if(erbium_status_code == NO_ERROR) {
 
@@ -327,9 +344,6 @@ coap_get_rest_method(void *packet)
 
 /* the discover resource is automatically included for CoAP */
 extern resource_t res_well_known_core;
-#ifdef WITH_DTLS
-extern resource_t res_dtls;
-#endif
 
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(coap_engine, ev, data)
@@ -346,10 +360,14 @@ PROCESS_THREAD(coap_engine, ev, data)
     PROCESS_YIELD();
 
     if(ev == tcpip_event) {
+      ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_COAP);
       coap_receive();
+      ENERGEST_SUBSYSTEM_LEAVE();
     } else if(ev == PROCESS_EVENT_TIMER) {
       /* retransmissions are handled here */
+      ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_COAP);
       coap_check_transactions();
+      ENERGEST_SUBSYSTEM_LEAVE();
     }
   } /* while (1) */
 
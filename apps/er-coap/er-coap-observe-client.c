@@ -128,8 +128,8 @@ coap_obs_remove_observee(coap_observee_t *o)
 {
   PRINTF("Removing obs_subject for /%s [0x%02X%02X]\n", o->url, o->token[0],
          o->token[1]);
-  memb_free(&obs_subjects_memb, o);
   list_remove(obs_subjects_list, o);
+  memb_free(&obs_subjects_memb, o);
 }
 /*----------------------------------------------------------------------------*/
 coap_observee_t *
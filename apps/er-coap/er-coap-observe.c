@@ -54,7 +54,7 @@
 
 /*---------------------------------------------------------------------------*/
 MEMB(observers_memb, coap_observer_t, COAP_MAX_OBSERVERS);
-LIST(observers_list);
+DLIST(observers_list);
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -81,9 +81,10 @@ add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
     o->last_mid = 0;
 
     PRINTF("Adding observer (%u/%u) for /%s [0x%02X%02X]\n",
-           list_length(observers_list) + 1, COAP_MAX_OBSERVERS,
+           dlist_length(observers_list) + 1, COAP_MAX_OBSERVERS,
            o->url, o->token[0], o->token[1]);
-    list_add(observers_list, o);
+    dlist_init_item(o);
+    dlist_add(observers_list, o);
   }
 
   return o;
@@ -97,8 +98,8 @@ coap_remove_observer(coap_observer_t *o)
   PRINTF("Removing observer for /%s [0x%02X%02X]\n", o->url, o->token[0],
          o->token[1]);
 
+  dlist_remove(observers_list, o);
   memb_free(&observers_memb, o);
-  list_remove(observers_list, o);
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -107,7 +108,7 @@ coap_remove_observer_by_client(uip_ipaddr_t *addr, uint16_t port)
   int removed = 0;
   coap_observer_t *obs = NULL;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
+  for(obs = (coap_observer_t *)dlist_head(observers_list); obs;
       obs = obs->next) {
     PRINTF("Remove check client ");
     PRINT6ADDR(addr);
@@ -127,7 +128,7 @@ coap_remove_observer_by_token(uip_ipaddr_t *addr, uint16_t port,
   int removed = 0;
   coap_observer_t *obs = NULL;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
+  for(obs = (coap_observer_t *)dlist_head(observers_list); obs;
       obs = obs->next) {
     PRINTF("Remove check Token 0x%02X%02X\n", token[0], token[1]);
     if(uip_ipaddr_cmp(&obs->addr, addr) && obs->port == port
@@ -147,7 +148,7 @@ coap_remove_observer_by_uri(uip_ipaddr_t *addr, uint16_t port,
   int removed = 0;
   coap_observer_t *obs = NULL;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
+  for(obs = (coap_observer_t *)dlist_head(observers_list); obs;
       obs = obs->next) {
     PRINTF("Remove check URL %p\n", uri);
     if((addr == NULL
@@ -166,7 +167,7 @@ coap_remove_observer_by_mid(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
   int removed = 0;
   coap_observer_t *obs = NULL;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
+  for(obs = (coap_observer_t *)dlist_head(observers_list); obs;
       obs = obs->next) {
     PRINTF("Remove check MID %u\n", mid);
     if(uip_ipaddr_cmp(&obs->addr, addr) && obs->port == port
@@ -212,7 +213,7 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
 
   /* iterate over observers */
   url_len = strlen(url);
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
+  for(obs = (coap_observer_t *)dlist_head(observers_list); obs;
       obs = obs->next) {
     obs_url_len = strlen(obs->url);
 
@@ -286,7 +287,7 @@ coap_observe_handler(resource_t *resource, void *request, void *response)
           coap_set_payload(coap_res,
                            content,
                            snprintf(content, sizeof(content), "Added %u/%u",
-                                    list_length(observers_list),
+                                    dlist_length(observers_list),
                                     COAP_MAX_OBSERVERS));
 #endif
         } else {
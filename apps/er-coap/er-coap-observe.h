@@ -54,7 +54,8 @@ typedef struct coap_observable {
 } coap_observable_t;
 
 typedef struct coap_observer {
-  struct coap_observer *next;   /* for LIST */
+  struct coap_observer *next;   /* for DLIST */
+  struct coap_observer *prev;
 
   char url[COAP_OBSERVER_URL_LEN];
   uip_ipaddr_t addr;
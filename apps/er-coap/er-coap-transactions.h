@@ -50,7 +50,8 @@
 
 /* container for transactions with message buffer and retransmission info */
 typedef struct coap_transaction {
-  struct coap_transaction *next;        /* for LIST */
+  struct coap_transaction *next;        /* for DLIST */
+  struct coap_transaction *prev;
 
   uint16_t mid;
   struct etimer retrans_timer;
@@ -44,6 +44,9 @@
 
 #include "er-coap.h"
 #include "er-coap-transactions.h"
+#if WITH_DTLS
+#include "er-coap-dtls.h"
+#endif
 
 #define DEBUG 0
 #if DEBUG
@@ -61,6 +64,9 @@
 /*- Variables ---------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
 static struct uip_udp_conn *udp_conn = NULL;
+#if WITH_DTLS
+static struct uip_udp_conn *dtls_conn = NULL;
+#endif
 static uint16_t current_mid = 0;
 
 coap_status_t erbium_status_code = NO_ERROR;
@@ -272,6 +278,22 @@ coap_get_variable(const char *buffer, size_t length, const char *name,
   }
   return 0;
 }
+#if WITH_DTLS
+static void
+dtls_output(const uip_ipaddr_t *addr, uint16_t port, const uint8_t *data,
+            uint16_t length)
+{
+  uip_ipaddr_copy(&dtls_conn->ripaddr, addr);
+  dtls_conn->rport = port;
+
+  uip_udp_packet_send(dtls_conn, data, length);
+
+  PRINTF("-sent DTLS datagram (%u)-\n", length);
+
+  memset(&dtls_conn->ripaddr, 0, sizeof(dtls_conn->ripaddr));
+  dtls_conn->rport = 0;
+}
+#endif /* WITH_DTLS */
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -283,6 +305,13 @@ coap_init_connection(uint16_t port)
   udp_bind(udp_conn, port);
   PRINTF("Listening on port %u\n", uip_ntohs(udp_conn->lport));
 
+#if WITH_DTLS
+  dtls_conn = udp_new(NULL, 0, NULL);
+  udp_bind(dtls_conn, UIP_HTONS(COAP_DEFAULT_SECURE_PORT));
+  PRINTF("Listening on port %u\n", uip_ntohs(dtls_conn->lport));
+  coap_dtls_init(dtls_output);
+#endif
+
   /* initialize transaction ID */
   current_mid = random_rand();
 }
@@ -293,6 +322,16 @@ coap_get_mid()
   return ++current_mid;
 }
 /*---------------------------------------------------------------------------*/
+int
+coap_is_secure_connection(struct uip_udp_conn *conn)
+{
+#if WITH_DTLS
+  return conn != NULL && conn == dtls_conn;
+#else
+  return 0;
+#endif
+}
+/*---------------------------------------------------------------------------*/
 void
 coap_init_message(void *packet, coap_message_type_t type, uint8_t code,
                   uint16_t mid)
@@ -426,6 +465,13 @@ void
 coap_send_message(uip_ipaddr_t *addr, uint16_t port, uint8_t *data,
                   uint16_t length)
 {
+#if WITH_DTLS
+  if(coap_dtls_is_secure_peer(addr, port)) {
+    coap_dtls_send(addr, port, data, length);
+    return;
+  }
+#endif
+
   /* configure connection to reply to client */
   uip_ipaddr_copy(&udp_conn->ripaddr, addr);
   udp_conn->rport = port;
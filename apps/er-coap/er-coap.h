@@ -178,6 +178,7 @@ extern char *coap_error_message;
 
 void coap_init_connection(uint16_t port);
 uint16_t coap_get_mid(void);
+int coap_is_secure_connection(struct uip_udp_conn *conn);
 
 void coap_init_message(void *packet, coap_message_type_t type, uint8_t code,
                        uint16_t mid);
@@ -49,6 +49,9 @@
 #include "rest-engine.h"
 #include "er-coap-constants.h"
 #include "er-coap-engine.h"
+#if WITH_DTLS
+#include "er-coap-dtls.h"
+#endif
 #include "oma-tlv.h"
 #include "oma-tlv-writer.h"
 #include "net/ipv6/uip-ds6.h"
@@ -73,6 +76,20 @@
 #define MAX_OBJECTS 10
 #endif /* LWM2M_ENGINE_CONF_MAX_OBJECTS */
 
+/* How often the RD client checks for network access while waiting
+   to join, and how long it waits between registration attempts. */
+#ifdef LWM2M_ENGINE_CONF_NETWORK_CHECK_INTERVAL
+#define NETWORK_CHECK_INTERVAL LWM2M_ENGINE_CONF_NETWORK_CHECK_INTERVAL
+#else /* LWM2M_ENGINE_CONF_NETWORK_CHECK_INTERVAL */
+#define NETWORK_CHECK_INTERVAL CLOCK_SECOND
+#endif /* LWM2M_ENGINE_CONF_NETWORK_CHECK_INTERVAL */
+
+#ifdef LWM2M_ENGINE_CONF_REGISTRATION_INTERVAL
+#define REGISTRATION_INTERVAL LWM2M_ENGINE_CONF_REGISTRATION_INTERVAL
+#else /* LWM2M_ENGINE_CONF_REGISTRATION_INTERVAL */
+#define REGISTRATION_INTERVAL (15 * CLOCK_SECOND)
+#endif /* LWM2M_ENGINE_CONF_REGISTRATION_INTERVAL */
+
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
 
@@ -115,6 +132,18 @@ client_chunk_handler(void *response)
   printf("|%.*s\n", len, (char *)chunk);
 }
 /*---------------------------------------------------------------------------*/
+static void
+registration_chunk_handler(void *response)
+{
+#if UIP_CONF_IPV6_RPL
+  /* Any other response means that the server rejected the registration */
+  if(((coap_packet_t *)response)->code == CREATED_2_01) {
+    rpl_join_stage_reached(RPL_JOIN_STAGE_REGISTERED);
+  }
+#endif /* UIP_CONF_IPV6_RPL */
+  client_chunk_handler(response);
+}
+/*---------------------------------------------------------------------------*/
 static int
 index_of(const uint8_t *data, int offset, int len, uint8_t c)
 {
@@ -129,6 +158,34 @@ index_of(const uint8_t *data, int offset, int len, uint8_t c)
   return -1;
 }
 /*---------------------------------------------------------------------------*/
+#if WITH_DTLS
+static int
+set_psk(const lwm2m_instance_t *instance, lwm2m_context_t *context)
+{
+  const lwm2m_resource_t *rsc;
+  const uint8_t *identity;
+  const uint8_t *key;
+  uint16_t identity_len;
+  uint16_t key_len;
+
+  context->resource_id = LWM2M_SECURITY_CLIENT_PKI;
+  rsc = get_resource(instance, context);
+  identity = lwm2m_object_get_resource_string(rsc, context);
+  identity_len = lwm2m_object_get_resource_strlen(rsc, context);
+
+  context->resource_id = LWM2M_SECURITY_KEY;
+  rsc = get_resource(instance, context);
+  key = lwm2m_object_get_resource_string(rsc, context);
+  key_len = lwm2m_object_get_resource_strlen(rsc, context);
+
+  if(identity == NULL || key == NULL || key_len == 0
+     || identity_len > 255 || key_len > 255) {
+    return 0;
+  }
+  return coap_dtls_set_psk(identity, identity_len, key, key_len);
+}
+#endif /* WITH_DTLS */
+/*---------------------------------------------------------------------------*/
 static int
 has_network_access(void)
 {
@@ -249,7 +306,7 @@ PROCESS_THREAD(lwm2m_rd_client, ev, data)
 
   printf("RD Client started with endpoint '%s'\n", endpoint);
 
-  etimer_set(&et, 15 * CLOCK_SECOND);
+  etimer_set(&et, NETWORK_CHECK_INTERVAL);
 
   while(1) {
     PROCESS_YIELD();
@@ -257,6 +314,8 @@ PROCESS_THREAD(lwm2m_rd_client, ev, data)
     if(etimer_expired(&et)) {
       if(!has_network_access()) {
         /* Wait until for a network to join */
+        etimer_set(&et, NETWORK_CHECK_INTERVAL);
+        continue;
       } else if(use_bootstrap && bootstrapped == 0) {
         if(update_bootstrap_server()) {
           /* prepare request, TID is set by COAP_BLOCKING_REQUEST() */
@@ -309,11 +368,7 @@ PROCESS_THREAD(lwm2m_rd_client, ev, data)
               if(first[end + 1] == ':' &&
                  lwm2m_plain_text_read_int(first + end + 2, len - end - 2, &port)) {
               } else if(secure) {
-                /**
-                 * Secure CoAP should use a different port but for now
-                 * the same port is used.
-                 */
-                port = COAP_DEFAULT_PORT;
+                port = COAP_DEFAULT_SECURE_PORT;
               } else {
                 port = COAP_DEFAULT_PORT;
               }
@@ -321,7 +376,18 @@ PROCESS_THREAD(lwm2m_rd_client, ev, data)
               PRINT6ADDR(&addr);
               PRINTF(" port %ld%s\n", (long)port, secure ? " (secure)" : "");
               if(secure) {
+#if WITH_DTLS
+                if(set_psk(instance, &context)
+                   && coap_dtls_connect(&addr, UIP_HTONS((uint16_t)port))) {
+                  lwm2m_engine_register_with_server(&addr,
+                                                    UIP_HTONS((uint16_t)port));
+                  bootstrapped++;
+                } else {
+                  printf("No usable PSK for secure CoAP - can not bootstrap\n");
+                }
+#else /* WITH_DTLS */
                 printf("Secure CoAP requested but not supported - can not bootstrap\n");
+#endif /* WITH_DTLS */
               } else {
                 lwm2m_engine_register_with_server(&addr,
                                                   UIP_HTONS((uint16_t)port));
@@ -371,10 +437,10 @@ PROCESS_THREAD(lwm2m_rd_client, ev, data)
         printf("Registering lwm2m endpoint '%s': '%.*s'\n", endpoint,
                pos, rd_data);
         COAP_BLOCKING_REQUEST(&server_ipaddr, server_port, request,
-                              client_chunk_handler);
+                              registration_chunk_handler);
       }
       /* for now only register once...   registered = 0; */
-      etimer_set(&et, 15 * CLOCK_SECOND);
+      etimer_set(&et, REGISTRATION_INTERVAL);
     }
   }
   PROCESS_END();
@@ -580,11 +646,11 @@ get_resource(const lwm2m_instance_t *instance, lwm2m_context_t *context)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
-void
-lwm2m_engine_handler(const lwm2m_object_t *object,
-                     void *request, void *response,
-                     uint8_t *buffer, uint16_t preferred_size,
-                     int32_t *offset)
+static void
+handle_request(const lwm2m_object_t *object,
+               void *request, void *response,
+               uint8_t *buffer, uint16_t preferred_size,
+               int32_t *offset)
 {
   int len;
   const char *url;
@@ -883,6 +949,17 @@ lwm2m_engine_handler(const lwm2m_object_t *object,
 }
 /*---------------------------------------------------------------------------*/
 void
+lwm2m_engine_handler(const lwm2m_object_t *object,
+                     void *request, void *response,
+                     uint8_t *buffer, uint16_t preferred_size,
+                     int32_t *offset)
+{
+  ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_LWM2M);
+  handle_request(object, request, response, buffer, preferred_size, offset);
+  ENERGEST_SUBSYSTEM_LEAVE();
+}
+/*---------------------------------------------------------------------------*/
+void
 lwm2m_engine_delete_handler(const lwm2m_object_t *object, void *request,
                             void *response, uint8_t *buffer,
                             uint16_t preferred_size, int32_t *offset)
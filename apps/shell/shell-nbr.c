@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Contiki shell neighbor table commands
+ */
+
+#include "contiki.h"
+#include "shell-nbr.h"
+#include "net/nbr-table.h"
+
+#include <stdio.h>
+
+#define BUFLEN 64
+
+/*---------------------------------------------------------------------------*/
+PROCESS(shell_nbr_stats_process, "nbr-stats");
+SHELL_COMMAND(nbr_stats_command,
+	      "nbr-stats",
+	      "nbr-stats: show neighbor table eviction statistics",
+	      &shell_nbr_stats_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_nbr_stats_process, ev, data)
+{
+  char buf[BUFLEN];
+  PROCESS_BEGIN();
+
+  snprintf(buf, BUFLEN, "%s, %d/%d neighbors",
+           NBR_TABLE_POLICY.name, nbr_table_num_neighbors(),
+           NBR_TABLE_MAX_NEIGHBORS);
+  shell_output_str(&nbr_stats_command, "policy ", buf);
+  snprintf(buf, BUFLEN, "%lu added, %lu evicted, %lu failed",
+           nbr_table_stats.adds, nbr_table_stats.evictions,
+           nbr_table_stats.failures);
+  shell_output_str(&nbr_stats_command, "stats ", buf);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_nbr_init(void)
+{
+  shell_register_command(&nbr_stats_command);
+}
+/*---------------------------------------------------------------------------*/
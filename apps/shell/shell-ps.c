@@ -43,6 +43,10 @@
 #include <stdio.h>
 #include <string.h>
 
+#if PROCESS_CONF_PROFILE
+#include "sys/rtimer.h"
+#endif /* PROCESS_CONF_PROFILE */
+
 /*---------------------------------------------------------------------------*/
 PROCESS(shell_ps_process, "ps");
 SHELL_COMMAND(ps_command,
@@ -65,9 +69,79 @@ PROCESS_THREAD(shell_ps_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_PROFILE
+PROCESS(shell_pstats_process, "pstats");
+SHELL_COMMAND(pstats_command,
+	      "pstats",
+	      "pstats [reset]: show or clear the time spent per process and event",
+	      &shell_pstats_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ticks_to_us(unsigned long ticks)
+{
+  return (unsigned long)((unsigned long long)ticks * 1000000UL / RTIMER_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+static void
+output_profile(const char *name, const struct process_profile *profile,
+               int with_line)
+{
+  char buf[100];
+  int len;
+
+  len = snprintf(buf, sizeof(buf), "%.20s: %lu calls, avg %lu us, max %lu us",
+                 name, profile->count,
+                 ticks_to_us(profile->total / profile->count),
+                 ticks_to_us(profile->max));
+  if(with_line && (size_t)len < sizeof(buf)) {
+    len += snprintf(buf + len, sizeof(buf) - len, " at line %lu",
+                    (unsigned long)profile->max_lc);
+  }
+  if((size_t)len < sizeof(buf)) {
+    snprintf(buf + len, sizeof(buf) - len, ", %lu over", profile->overruns);
+  }
+  shell_output_str(&pstats_command, buf, "");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_pstats_process, ev, data)
+{
+  struct process *p;
+  char name[16];
+  int i;
+
+  PROCESS_BEGIN();
+
+  if(data != NULL && strcmp(data, "reset") == 0) {
+    process_profile_reset();
+    PROCESS_EXIT();
+  }
+
+  for(p = PROCESS_LIST(); p != NULL; p = p->next) {
+    if(p->profile.count > 0) {
+      output_profile(PROCESS_NAME_STRING(p), &p->profile, 1);
+    }
+  }
+  for(i = 0; i <= PROCESS_CONF_PROFILE_EVENTS; i++) {
+    if(process_profile_events[i].count > 0) {
+      if(i < PROCESS_CONF_PROFILE_EVENTS) {
+        snprintf(name, sizeof(name), "event 0x%02x", PROCESS_EVENT_NONE + i);
+      } else {
+        strcpy(name, "other events");
+      }
+      output_profile(name, &process_profile_events[i], 0);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+#endif /* PROCESS_CONF_PROFILE */
 void
 shell_ps_init(void)
 {
   shell_register_command(&ps_command);
+#if PROCESS_CONF_PROFILE
+  shell_register_command(&pstats_command);
+#endif /* PROCESS_CONF_PROFILE */
 }
 /*---------------------------------------------------------------------------*/
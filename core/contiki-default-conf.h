@@ -256,6 +256,14 @@
 #define SICSLOWPAN_CONF_COMPRESSION SICSLOWPAN_COMPRESSION_HC06
 #endif /* SICSLOWPAN_CONF_COMPRESSION */
 
+/* SICSLOWPAN_CONF_IPHC_CACHE_SIZE sets the number of flows for which
+   the compressed IPHC header is cached, so that repeated packets of a
+   flow only need their UDP checksum patched in. Each entry takes about
+   100 bytes of RAM. */
+#ifndef SICSLOWPAN_CONF_IPHC_CACHE_SIZE
+#define SICSLOWPAN_CONF_IPHC_CACHE_SIZE 0
+#endif /* SICSLOWPAN_CONF_IPHC_CACHE_SIZE */
+
 /*---------------------------------------------------------------------------*/
 /* ContikiMAC configuration options.
  *
@@ -36,6 +36,7 @@
 
 #include "contiki.h"
 #include "lib/list.h"
+#include "lib/dlist.h"
 #include "lib/memb.h"
 #include "lib/mmem.h"
 #include "lib/random.h"
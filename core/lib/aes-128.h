@@ -45,6 +45,29 @@
 #define AES_128_BLOCK_SIZE 16
 #define AES_128_KEY_LENGTH 16
 
+/*
+ * The software driver can use a 1 KB lookup table that merges SubBytes,
+ * ShiftRows and MixColumns into one 32-bit lookup per byte and round.
+ * This is several times faster than the byte-oriented implementation,
+ * but costs flash and makes encryption time depend on cache behavior.
+ * Enable it on flash-rich platforms and on native.
+ */
+#ifdef AES_128_CONF_WITH_T_TABLE
+#define AES_128_WITH_T_TABLE AES_128_CONF_WITH_T_TABLE
+#else /* AES_128_CONF_WITH_T_TABLE */
+#define AES_128_WITH_T_TABLE 0
+#endif /* AES_128_CONF_WITH_T_TABLE */
+
+/*
+ * Number of expanded keys the software driver keeps. set_key() with one
+ * of the cached keys only switches to its key schedule.
+ */
+#ifdef AES_128_CONF_KEY_CACHE_SIZE
+#define AES_128_KEY_CACHE_SIZE AES_128_CONF_KEY_CACHE_SIZE
+#else /* AES_128_CONF_KEY_CACHE_SIZE */
+#define AES_128_KEY_CACHE_SIZE 1
+#endif /* AES_128_CONF_KEY_CACHE_SIZE */
+
 #ifdef AES_128_CONF
 #define AES_128            AES_128_CONF
 #else /* AES_128_CONF */
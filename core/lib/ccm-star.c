@@ -43,53 +43,66 @@
 #include <string.h>
 
 /* see RFC 3610 */
-#define CCM_STAR_AUTH_FLAGS(Adata, M) ((Adata ? (1u << 6) : 0) | (((M - 2u) >> 1) << 3) | 1u)
-#define CCM_STAR_ENCRYPTION_FLAGS     1
+#define CCM_STAR_AUTH_FLAGS(Adata, M, L) ((Adata ? (1u << 6) : 0) | (((M - 2u) >> 1) << 3) | (L - 1u))
+#define CCM_STAR_ENCRYPTION_FLAGS(L)     (L - 1u)
+
+/* size of the length field of 802.15.4 and (D)TLS, respectively */
+#define CCM_STAR_L     (AES_128_BLOCK_SIZE - 1 - CCM_STAR_NONCE_LENGTH)
+#define CCM_STAR_TLS_L (AES_128_BLOCK_SIZE - 1 - CCM_STAR_TLS_NONCE_LENGTH)
 
 /*---------------------------------------------------------------------------*/
 static void
 set_iv(uint8_t *iv,
     uint8_t flags,
-    const uint8_t *nonce,
-    uint8_t counter)
+    const uint8_t *nonce, uint8_t l,
+    uint16_t counter)
 {
   iv[0] = flags;
-  memcpy(iv + 1, nonce, CCM_STAR_NONCE_LENGTH);
-  iv[14] = 0;
+  memcpy(iv + 1, nonce, AES_128_BLOCK_SIZE - 1 - l);
+  memset(iv + AES_128_BLOCK_SIZE - l, 0, l - 2);
+  iv[14] = counter >> 8;
   iv[15] = counter;
 }
 /*---------------------------------------------------------------------------*/
-/* XORs the block m[pos] ... m[pos + 15] with K_{counter} */
+/* Encrypts the counter block A_{counter} to obtain the key stream block S_{counter} */
 static void
-ctr_step(const uint8_t *nonce,
-    uint8_t pos,
-    uint8_t *m_and_result,
-    uint8_t m_len,
-    uint8_t counter)
+key_stream(uint8_t *s, const uint8_t *a0, uint16_t counter)
 {
-  uint8_t a[AES_128_BLOCK_SIZE];
-  uint8_t i;
-  
-  set_iv(a, CCM_STAR_ENCRYPTION_FLAGS, nonce, counter);
-  AES_128.encrypt(a);
-  
-  for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
-    m_and_result[pos + i] ^= a[i];
-  }
+  memcpy(s, a0, AES_128_BLOCK_SIZE);
+  s[14] = counter >> 8;
+  s[15] = counter;
+  AES_128.encrypt(s);
 }
 /*---------------------------------------------------------------------------*/
 static void
-mic(const uint8_t *nonce,
-    const uint8_t *m, uint8_t m_len,
+set_key(const uint8_t *key)
+{
+  AES_128.set_key(key);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Authenticates and encrypts (or decrypts and authenticates) in a
+ * single pass over m: each 16-byte block is fed into the CBC-MAC and
+ * XORed with its key stream block before moving on to the next one.
+ * l is the size of the length field, i.e., the nonce is 15 - l bytes long.
+ */
+static void
+ccm(const uint8_t *nonce, uint8_t l,
+    uint8_t *m, uint16_t m_len,
     const uint8_t *a, uint8_t a_len,
-    uint8_t *result,
-    uint8_t mic_len)
+    uint8_t *result, uint8_t mic_len,
+    int forward)
 {
   uint8_t x[AES_128_BLOCK_SIZE];
-  uint8_t pos;
+  uint8_t s[AES_128_BLOCK_SIZE];
+  uint8_t a0[AES_128_BLOCK_SIZE];
+  uint16_t pos;
+  uint8_t len;
+  uint16_t counter;
   uint8_t i;
   
-  set_iv(x, CCM_STAR_AUTH_FLAGS(a_len, mic_len), nonce, m_len);
+  /* B_0 */
+  set_iv(x, CCM_STAR_AUTH_FLAGS(a_len, mic_len, l), nonce, l, m_len);
   AES_128.encrypt(x);
   
   if(a_len) {
@@ -110,64 +123,65 @@ mic(const uint8_t *nonce,
     }
   }
   
-  if(m_len) {
-    pos = 0;
-    while(pos < m_len) {
-      for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
+  set_iv(a0, CCM_STAR_ENCRYPTION_FLAGS(l), nonce, l, 0);
+  counter = 1;
+  for(pos = 0; pos < m_len; pos += len) {
+    len = m_len - pos > AES_128_BLOCK_SIZE ? AES_128_BLOCK_SIZE : m_len - pos;
+    key_stream(s, a0, counter++);
+    if(forward) {
+      for(i = 0; i < len; i++) {
+        x[i] ^= m[pos + i];
+        m[pos + i] ^= s[i];
+      }
+    } else {
+      for(i = 0; i < len; i++) {
+        m[pos + i] ^= s[i];
         x[i] ^= m[pos + i];
       }
-      pos += AES_128_BLOCK_SIZE;
-      AES_128.encrypt(x);
     }
+    AES_128.encrypt(x);
   }
   
-  ctr_step(nonce, 0, x, AES_128_BLOCK_SIZE, 0);
-  
-  memcpy(result, x, mic_len);
-}
-/*---------------------------------------------------------------------------*/
-static void
-ctr(const uint8_t *nonce, uint8_t *m, uint8_t m_len)
-{
-  uint8_t pos;
-  uint8_t counter;
-  
-  pos = 0;
-  counter = 1;
-  while(pos < m_len) {
-    ctr_step(nonce, pos, m, m_len, counter++);
-    pos += AES_128_BLOCK_SIZE;
+  /* U = T XOR S_0 */
+  key_stream(s, a0, 0);
+  for(i = 0; i < mic_len; i++) {
+    result[i] = x[i] ^ s[i];
   }
 }
 /*---------------------------------------------------------------------------*/
 static void
-set_key(const uint8_t *key)
-{
-  AES_128.set_key(key);
-}
-/*---------------------------------------------------------------------------*/
-static void
 aead(const uint8_t* nonce,
     uint8_t* m, uint8_t m_len,
     const uint8_t* a, uint8_t a_len,
     uint8_t *result, uint8_t mic_len,
     int forward)
 {
-  if(!forward) {
-    /* decrypt */
-    ctr(nonce, m, m_len);
-  }
-  
-  mic(nonce,
-    m, m_len,
-    a, a_len,
-    result,
-    mic_len);
+  ccm(nonce, CCM_STAR_L, m, m_len, a, a_len, result, mic_len, forward);
+}
+/*---------------------------------------------------------------------------*/
+void
+ccm_star_tls_aead(const uint8_t *nonce,
+    uint8_t *m, uint16_t m_len,
+    const uint8_t *a, uint8_t a_len,
+    uint8_t *result, uint8_t mic_len,
+    int forward)
+{
+  ccm(nonce, CCM_STAR_TLS_L, m, m_len, a, a_len, result, mic_len, forward);
+}
+/*---------------------------------------------------------------------------*/
+int
+ccm_star_mic_cmp(const uint8_t *mic1, const uint8_t *mic2, uint8_t mic_len)
+{
+  uint8_t diff;
+  uint8_t i;
   
-  if(forward) {
-    /* encrypt */
-    ctr(nonce, m, m_len);
+  /* Do not return early, so that the comparison time does not reveal
+     how many leading bytes of a forged MIC are correct. */
+  diff = 0;
+  for(i = 0; i < mic_len; i++) {
+    diff |= mic1[i] ^ mic2[i];
   }
+  return diff != 0;
 }
 /*---------------------------------------------------------------------------*/
 const struct ccm_star_driver ccm_star_driver = {
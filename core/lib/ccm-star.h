@@ -49,6 +49,7 @@
 #endif /* CCM_STAR_CONF */
 
 #define CCM_STAR_NONCE_LENGTH 13
+#define CCM_STAR_TLS_NONCE_LENGTH 12
 
 /**
  * Structure of CCM* drivers.
@@ -79,4 +80,25 @@ struct ccm_star_driver {
 
 extern const struct ccm_star_driver CCM_STAR;
 
+/**
+ * \brief         Compares two MICs in constant time.
+ * \return        0 if the MICs are equal, non-zero otherwise.
+ */
+int ccm_star_mic_cmp(const uint8_t *mic1, const uint8_t *mic2, uint8_t mic_len);
+
+/**
+ * \brief         CCM with a 12-byte nonce and a 3-byte length field, as used
+ *                by the AES-CCM cipher suites of TLS and DTLS (RFC 6655).
+ *                This always runs in software on top of AES_128, whose key
+ *                must have been set before.
+ * \param nonce   The nonce to use. CCM_STAR_TLS_NONCE_LENGTH bytes long.
+ *
+ *                The other parameters are as in ccm_star_driver.aead().
+ */
+void ccm_star_tls_aead(const uint8_t *nonce,
+    uint8_t *m, uint16_t m_len,
+    const uint8_t *a, uint8_t a_len,
+    uint8_t *result, uint8_t mic_len,
+    int forward);
+
 #endif /* CCM_STAR_H_ */
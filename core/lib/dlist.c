@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Doubly linked lists with constant-time append and remove
+ */
+
+/**
+ * \addtogroup dlist
+ * @{
+ */
+
+#include "lib/dlist.h"
+
+#define NULL 0
+
+struct dlist_item {
+  struct dlist_item *next;
+  struct dlist_item *prev;
+};
+
+/*---------------------------------------------------------------------------*/
+/**
+ * Initialize a doubly linked list. The list will be empty after this
+ * function has been called.
+ *
+ * \param list The list to be initialized.
+ */
+void
+dlist_init(dlist_t list)
+{
+  list->head = list->tail = NULL;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Get the first element of a list, or NULL if the list is empty.
+ */
+void *
+dlist_head(dlist_t list)
+{
+  return list->head;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Get the last element of a list, or NULL if the list is empty.
+ */
+void *
+dlist_tail(dlist_t list)
+{
+  return list->tail;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Mark an element as not being on any list. This must be done once
+ * after the element is allocated, before it is added to a list.
+ *
+ * \param item The element.
+ */
+void
+dlist_init_item(void *item)
+{
+  struct dlist_item *i = item;
+
+  i->next = i->prev = NULL;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Check if an element is on a list.
+ *
+ * \param list The list.
+ * \param item An element that is on this list or on no list at all,
+ * as set up by dlist_init_item() or dlist_remove().
+ */
+int
+dlist_contains(dlist_t list, void *item)
+{
+  return list->head == item ||
+    ((struct dlist_item *)item)->prev != NULL;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Add an element at the end of a list. If the element already was on
+ * the list, it is moved to the end.
+ *
+ * \param list The list.
+ * \param item The element to add.
+ */
+void
+dlist_add(dlist_t list, void *item)
+{
+  struct dlist_item *i = item;
+
+  /* Make sure not to add the same element twice */
+  dlist_remove(list, item);
+
+  i->next = NULL;
+  i->prev = list->tail;
+  if(list->tail == NULL) {
+    list->head = i;
+  } else {
+    ((struct dlist_item *)list->tail)->next = i;
+  }
+  list->tail = i;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Add an element at the start of a list. If the element already was
+ * on the list, it is moved to the start.
+ *
+ * \param list The list.
+ * \param item The element to add.
+ */
+void
+dlist_push(dlist_t list, void *item)
+{
+  struct dlist_item *i = item;
+
+  /* Make sure not to add the same element twice */
+  dlist_remove(list, item);
+
+  i->prev = NULL;
+  i->next = list->head;
+  if(list->head == NULL) {
+    list->tail = i;
+  } else {
+    ((struct dlist_item *)list->head)->prev = i;
+  }
+  list->head = i;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Remove the last element of a list.
+ *
+ * \return The removed element, or NULL if the list was empty.
+ */
+void *
+dlist_chop(dlist_t list)
+{
+  void *item;
+
+  item = list->tail;
+  if(item != NULL) {
+    dlist_remove(list, item);
+  }
+  return item;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Remove the first element of a list.
+ *
+ * \return The removed element, or NULL if the list was empty.
+ */
+void *
+dlist_pop(dlist_t list)
+{
+  void *item;
+
+  item = list->head;
+  if(item != NULL) {
+    dlist_remove(list, item);
+  }
+  return item;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Remove an element from a list. Removing an element that is not on
+ * any list has no effect.
+ *
+ * \param list The list.
+ * \param item The element to remove.
+ */
+void
+dlist_remove(dlist_t list, void *item)
+{
+  struct dlist_item *i = item;
+
+  if(!dlist_contains(list, item)) {
+    return;
+  }
+
+  if(i->prev == NULL) {
+    list->head = i->next;
+  } else {
+    i->prev->next = i->next;
+  }
+  if(i->next == NULL) {
+    list->tail = i->prev;
+  } else {
+    i->next->prev = i->prev;
+  }
+  i->next = i->prev = NULL;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Get the number of elements on a list. This walks the whole list.
+ */
+int
+dlist_length(dlist_t list)
+{
+  struct dlist_item *i;
+  int n = 0;
+
+  for(i = list->head; i != NULL; i = i->next) {
+    ++n;
+  }
+
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Insert an element after a given element on a list.
+ *
+ * \param list The list.
+ * \param previtem The element after which to insert, or NULL to insert
+ * at the start of the list.
+ * \param newitem The element to insert, which must not be on the list.
+ */
+void
+dlist_insert(dlist_t list, void *previtem, void *newitem)
+{
+  struct dlist_item *p = previtem;
+  struct dlist_item *i = newitem;
+
+  if(p == NULL) {
+    dlist_push(list, newitem);
+  } else {
+    i->prev = p;
+    i->next = p->next;
+    if(p->next == NULL) {
+      list->tail = i;
+    } else {
+      p->next->prev = i;
+    }
+    p->next = i;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Get the element after an element, or NULL if it is the last one.
+ */
+void *
+dlist_item_next(void *item)
+{
+  return item == NULL ? NULL : ((struct dlist_item *)item)->next;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Get the element before an element, or NULL if it is the first one.
+ */
+void *
+dlist_item_prev(void *item)
+{
+  return item == NULL ? NULL : ((struct dlist_item *)item)->prev;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -47,57 +47,119 @@
 #include "contiki.h"
 #include "lib/memb.h"
 
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/* Freed blocks hold a pointer to the next freed block in their last
+   bytes, away from the next pointer that list items keep first.
+   Blocks too small for both are found by scanning instead. */
+#define LINKABLE(m) ((m)->size >= 2 * sizeof(void *))
+#define LINK(m, block) ((char *)(block) + (m)->size - sizeof(void *))
+
+/*---------------------------------------------------------------------------*/
+static void *
+next_free(struct memb *m, void *block)
+{
+  void *next;
+
+  /* The blocks need not be aligned for a pointer */
+  memcpy(&next, LINK(m, block), sizeof(next));
+  return next;
+}
 /*---------------------------------------------------------------------------*/
 void
 memb_init(struct memb *m)
 {
   memset(m->count, 0, m->num);
   memset(m->mem, 0, m->size * m->num);
+  m->free = NULL;
+  m->fresh = 0;
+  m->used = 0;
+#if MEMB_STATS
+  m->maxused = 0;
+#endif /* MEMB_STATS */
 }
 /*---------------------------------------------------------------------------*/
 void *
 memb_alloc(struct memb *m)
 {
+  char *block;
   int i;
 
-  for(i = 0; i < m->num; ++i) {
-    if(m->count[i] == 0) {
-      /* If this block was unused, we increase the reference count to
-	 indicate that it now is used and return a pointer to the
-	 memory block. */
-      ++(m->count[i]);
-      return (void *)((char *)m->mem + (i * m->size));
+  if(m->free != NULL) {
+    /* Reuse the most recently freed block */
+    block = m->free;
+    m->free = next_free(m, block);
+    memset(LINK(m, block), 0, sizeof(void *));
+    i = (block - (char *)m->mem) / m->size;
+  } else if(m->fresh < m->num) {
+    /* Take a block that was never allocated */
+    i = m->fresh++;
+    block = (char *)m->mem + (i * m->size);
+  } else if(!LINKABLE(m)) {
+    /* Freed blocks are not on the list: look for one */
+    for(i = 0; i < m->num && m->count[i] != 0; ++i);
+    if(i == m->num) {
+      return NULL;
     }
+    block = (char *)m->mem + (i * m->size);
+  } else {
+    /* No free block was found, so we return NULL to indicate failure to
+       allocate block. */
+    return NULL;
   }
 
-  /* No free block was found, so we return NULL to indicate failure to
-     allocate block. */
-  return NULL;
+  /* Increase the reference count to indicate that the block now is
+     used. */
+  ++(m->count[i]);
+  ++(m->used);
+#if MEMB_STATS
+  if(m->used > m->maxused) {
+    m->maxused = m->used;
+  }
+#endif /* MEMB_STATS */
+  return block;
 }
 /*---------------------------------------------------------------------------*/
 char
 memb_free(struct memb *m, void *ptr)
 {
   int i;
-  char *ptr2;
+  unsigned long offset;
 
-  /* Walk through the list of blocks and try to find the block to
-     which the pointer "ptr" points to. */
-  ptr2 = (char *)m->mem;
-  for(i = 0; i < m->num; ++i) {
-    
-    if(ptr2 == (char *)ptr) {
-      /* We've found to block to which "ptr" points so we decrease the
-	 reference count and return the new value of it. */
-      if(m->count[i] > 0) {
-	/* Make sure that we don't deallocate free memory. */
-	--(m->count[i]);
-      }
-      return m->count[i];
+  /* The blocks are of the same size in one array, so the index of the
+     block follows from the pointer. */
+  if(!memb_inmemb(m, ptr)) {
+    PRINTF("memb_free: %p is not in memb %p\n", ptr, m);
+    return -1;
+  }
+  offset = (char *)ptr - (char *)m->mem;
+  if(offset % m->size != 0) {
+    PRINTF("memb_free: %p is not the start of a block in memb %p\n", ptr, m);
+    return -1;
+  }
+  i = offset / m->size;
+
+  if(m->count[i] == 0) {
+    /* Make sure that we don't deallocate free memory. */
+    PRINTF("memb_free: block %d in memb %p is already free\n", i, m);
+    return 0;
+  }
+
+  /* Decrease the reference count and return the new value of it. */
+  if(--(m->count[i]) == 0) {
+    --(m->used);
+    if(LINKABLE(m)) {
+      memcpy(LINK(m, ptr), &m->free, sizeof(void *));
+      m->free = ptr;
     }
-    ptr2 += m->size;
   }
-  return -1;
+  return m->count[i];
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -110,15 +172,6 @@ memb_inmemb(struct memb *m, void *ptr)
 int
 memb_numfree(struct memb *m)
 {
-  int i;
-  int num_free = 0;
-
-  for(i = 0; i < m->num; ++i) {
-    if(m->count[i] == 0) {
-      ++num_free;
-    }
-  }
-
-  return num_free;
+  return m->num - m->used;
 }
 /** @} */
@@ -65,6 +65,13 @@
 
 #include "sys/cc.h"
 
+/* Keep a high-water mark of the blocks in use in each memory block */
+#ifdef MEMB_CONF_STATS
+#define MEMB_STATS MEMB_CONF_STATS
+#else
+#define MEMB_STATS 0
+#endif
+
 /**
  * Declare a memory block.
  *
@@ -98,6 +105,14 @@ struct memb {
   unsigned short num;
   char *count;
   void *mem;
+  /* Blocks that have been freed, linked through their last bytes */
+  void *free;
+  /* Blocks from this index on have never been allocated */
+  unsigned short fresh;
+  unsigned short used;
+#if MEMB_STATS
+  unsigned short maxused;
+#endif /* MEMB_STATS */
 };
 
 /**
@@ -110,7 +125,14 @@ void  memb_init(struct memb *m);
 /**
  * Allocate a memory block from a block of memory declared with MEMB().
  *
+ * Blocks that have never been allocated before are all zero. Blocks
+ * that are allocated again after being freed hold their old contents,
+ * except that the last bytes may have been overwritten.
+ *
  * \param m A memory block previously declared with MEMB().
+ *
+ * \return A pointer to the allocated block, or NULL if all blocks are
+ * in use.
  */
 void *memb_alloc(struct memb *m);
 
@@ -132,6 +154,16 @@ int memb_inmemb(struct memb *m, void *ptr);
 
 int  memb_numfree(struct memb *m);
 
+#if MEMB_STATS
+/**
+ * Get the largest number of blocks that have been in use at once
+ * since memb_init().
+ *
+ * \param m A memory block previously declared with MEMB().
+ */
+#define memb_maxused(m) ((m)->maxused)
+#endif /* MEMB_STATS */
+
 /** @} */
 /** @} */
 
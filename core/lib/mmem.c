@@ -55,10 +55,288 @@
 #define MMEM_SIZE 4096
 #endif
 
+#if MMEM_SIZE_CLASSES
+/* Smallest block handed out, header included. Must be a multiple of
+   four pointers, and large enough for the block header and a pointer. */
+#ifdef MMEM_CONF_MIN_BLOCK
+#define MMEM_MIN_BLOCK MMEM_CONF_MIN_BLOCK
+#else
+#define MMEM_MIN_BLOCK 32
+#endif
+
+/* Number of size classes. There are four classes for each doubling of
+   the block size, so no more than a fifth of a block goes unused. By
+   default, there are just enough classes for a block that spans the
+   whole memory. */
+#define MMEM_SPANS(doublings) ((MMEM_MIN_BLOCK << (doublings)) >= MMEM_SIZE)
+#ifdef MMEM_CONF_CLASSES
+#define MMEM_CLASSES MMEM_CONF_CLASSES
+#elif MMEM_SPANS(2)
+#define MMEM_CLASSES 9
+#elif MMEM_SPANS(3)
+#define MMEM_CLASSES 13
+#elif MMEM_SPANS(4)
+#define MMEM_CLASSES 17
+#elif MMEM_SPANS(5)
+#define MMEM_CLASSES 21
+#elif MMEM_SPANS(6)
+#define MMEM_CLASSES 25
+#elif MMEM_SPANS(7)
+#define MMEM_CLASSES 29
+#elif MMEM_SPANS(8)
+#define MMEM_CLASSES 33
+#elif MMEM_SPANS(9)
+#define MMEM_CLASSES 37
+#elif MMEM_SPANS(10)
+#define MMEM_CLASSES 41
+#else
+#error "MMEM_CONF_SIZE is too large for MMEM_CONF_MIN_BLOCK, set MMEM_CONF_CLASSES"
+#endif
+
+/* How many classes larger a freed block may be and still be reused
+   for an allocation, before the memory is compacted instead */
+#ifdef MMEM_CONF_REUSE_CLASSES
+#define MMEM_REUSE_CLASSES MMEM_CONF_REUSE_CLASSES
+#else
+#define MMEM_REUSE_CLASSES 1
+#endif
+
+/*
+ * Every block starts with a header naming the struct mmem that owns
+ * it, so that the memory can be walked block by block when it is
+ * compacted.
+ */
+struct block {
+  struct mmem *owner;           /* NULL while the block is free */
+  unsigned char class;
+};
+
+#define HDR_SIZE    sizeof(struct block)
+#define BLOCK_SIZE(class) \
+  ((((4U + ((class) & 3)) * MMEM_MIN_BLOCK) / 4) << ((class) >> 2))
+
+/* Word-aligned memory, so that block headers are aligned */
+static void *memory_words[MMEM_SIZE / sizeof(void *)];
+#define memory ((char *)memory_words)
+#define MEMORY_END (memory + sizeof(memory_words))
+
+/* Freed blocks of each class, linked through their first payload
+   bytes */
+static struct block *free_blocks[MMEM_CLASSES];
+/* Start of the memory that no block has used since the last
+   compaction */
+static char *top;
+#else /* MMEM_SIZE_CLASSES */
 LIST(mmemlist);
-unsigned int avail_memory;
 static char memory[MMEM_SIZE];
+#endif /* MMEM_SIZE_CLASSES */
+
+unsigned int avail_memory;
+
+#if MMEM_STATS
+struct mmem_stats mmem_stats;
+
+#define MMEM_STATS_MOVED(bytes) do {              \
+    mmem_stats.moved += (bytes);                  \
+    if((bytes) > mmem_stats.max_moved) {          \
+      mmem_stats.max_moved = (bytes);             \
+    }                                             \
+  } while(0)
+#else
+#define MMEM_STATS_MOVED(bytes)
+#endif /* MMEM_STATS */
+
+#if MMEM_SIZE_CLASSES
+/*---------------------------------------------------------------------------*/
+static struct block *
+next_free(struct block *b)
+{
+  return *(struct block **)(b + 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+push_free(struct block *b)
+{
+  *(struct block **)(b + 1) = free_blocks[b->class];
+  free_blocks[b->class] = b;
+#if MMEM_STATS
+  mmem_stats.listed += BLOCK_SIZE(b->class);
+#endif /* MMEM_STATS */
+}
+/*---------------------------------------------------------------------------*/
+static struct block *
+pop_free(int class)
+{
+  struct block *b;
 
+  b = free_blocks[class];
+  if(b != NULL) {
+    free_blocks[class] = next_free(b);
+#if MMEM_STATS
+    mmem_stats.listed -= BLOCK_SIZE(class);
+#endif /* MMEM_STATS */
+  }
+  return b;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Compact the managed memory
+ *
+ *             Slides all allocated blocks down to the start of the
+ *             memory, so that all free memory is in one piece at the
+ *             end. Freed blocks are then no longer kept by size class.
+ *             This is done by mmem_alloc() when there is no other way
+ *             to fit a block, but may also be called when the system
+ *             is idle to avoid doing it later.
+ */
+void
+mmem_compact(void)
+{
+  char *src, *dst;
+  struct block *b;
+  unsigned int size, moved;
+  int i;
+
+  moved = 0;
+  dst = memory;
+  for(src = memory; src < top; src += size) {
+    b = (struct block *)src;
+    size = BLOCK_SIZE(b->class);
+    if(b->owner != NULL) {
+      if(dst != src) {
+        memmove(dst, src, size);
+        moved += size;
+        b = (struct block *)dst;
+        b->owner->ptr = dst + HDR_SIZE;
+      }
+      dst += size;
+    }
+  }
+  top = dst;
+
+  for(i = 0; i < MMEM_CLASSES; i++) {
+    free_blocks[i] = NULL;
+  }
+#if MMEM_STATS
+  mmem_stats.listed = 0;
+  mmem_stats.compactions++;
+#endif /* MMEM_STATS */
+  MMEM_STATS_MOVED(moved);
+}
+/*---------------------------------------------------------------------------*/
+static struct block *
+take_block(int class)
+{
+  struct block *b;
+  int c;
+
+  /* A freed block of the right size */
+  b = pop_free(class);
+  if(b != NULL) {
+    return b;
+  }
+
+  /* Memory that no block uses */
+  if(BLOCK_SIZE(class) <= (unsigned int)(MEMORY_END - top)) {
+    b = (struct block *)top;
+    top += BLOCK_SIZE(class);
+    b->class = class;
+    return b;
+  }
+
+  /* A slightly larger freed block, rather than moving memory */
+  for(c = class + 1; c < MMEM_CLASSES && c <= class + MMEM_REUSE_CLASSES; c++) {
+    b = pop_free(c);
+    if(b != NULL) {
+      return b;
+    }
+  }
+
+  /* Put all free memory in one piece */
+  mmem_compact();
+  if(BLOCK_SIZE(class) <= (unsigned int)(MEMORY_END - top)) {
+    b = (struct block *)top;
+    top += BLOCK_SIZE(class);
+    b->class = class;
+    return b;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+mmem_alloc(struct mmem *m, unsigned int size)
+{
+  struct block *b;
+  int class;
+
+  /* Find the smallest class that fits the block and its header */
+  for(class = 0;
+      class < MMEM_CLASSES && BLOCK_SIZE(class) - HDR_SIZE < size;
+      class++);
+  if(class == MMEM_CLASSES || BLOCK_SIZE(class) > avail_memory) {
+#if MMEM_STATS
+    mmem_stats.failed++;
+#endif /* MMEM_STATS */
+    return 0;
+  }
+
+  b = take_block(class);
+  if(b == NULL) {
+#if MMEM_STATS
+    mmem_stats.failed++;
+#endif /* MMEM_STATS */
+    return 0;
+  }
+
+  b->owner = m;
+  m->next = NULL;
+  m->ptr = (char *)b + HDR_SIZE;
+  m->size = size;
+  avail_memory -= BLOCK_SIZE(b->class);
+#if MMEM_STATS
+  mmem_stats.internal += BLOCK_SIZE(b->class) - size;
+#endif /* MMEM_STATS */
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+mmem_free(struct mmem *m)
+{
+  struct block *b;
+
+  b = (struct block *)((char *)m->ptr - HDR_SIZE);
+  b->owner = NULL;
+  avail_memory += BLOCK_SIZE(b->class);
+#if MMEM_STATS
+  mmem_stats.internal -= BLOCK_SIZE(b->class) - m->size;
+#endif /* MMEM_STATS */
+
+  if((char *)b + BLOCK_SIZE(b->class) == top) {
+    /* The last block goes back to the unused memory */
+    top = (char *)b;
+  } else {
+    push_free(b);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+mmem_init(void)
+{
+  static int inited = 0;
+  int i;
+
+  if(inited) {
+    return;
+  }
+  for(i = 0; i < MMEM_CLASSES; i++) {
+    free_blocks[i] = NULL;
+  }
+  top = memory;
+  avail_memory = sizeof(memory_words);
+  inited = 1;
+}
+#else /* MMEM_SIZE_CLASSES */
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Allocate a managed memory block
@@ -84,9 +362,11 @@ mmem_alloc(struct mmem *m, unsigned int size)
 {
   /* Check if we have enough memory left for this allocation. */
   if(avail_memory < size) {
+#if MMEM_STATS
+    mmem_stats.failed++;
+#endif /* MMEM_STATS */
     return 0;
   }
-
   /* We had enough memory so we add this memory block to the end of
      the list of allocated memory blocks. */
   list_add(mmemlist, m);
@@ -125,6 +405,8 @@ mmem_free(struct mmem *m)
        by moving it downwards. */
     memmove(m->ptr, m->next->ptr,
 	    &memory[MMEM_SIZE - avail_memory] - (char *)m->next->ptr);
+    MMEM_STATS_MOVED((unsigned int)(&memory[MMEM_SIZE - avail_memory] -
+                                    (char *)m->next->ptr));
     
     /* Update all the memory pointers that points to memory that is
        after the allocation that is to be removed. */
@@ -159,6 +441,7 @@ mmem_init(void)
   avail_memory = MMEM_SIZE;
   inited = 1;
 }
+#endif /* MMEM_SIZE_CLASSES */
 /*---------------------------------------------------------------------------*/
 
 /** @} */
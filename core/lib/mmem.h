@@ -39,7 +39,10 @@
  *
  * The managed memory allocator is a fragmentation-free memory
  * manager. It keeps the allocated memory free from fragmentation by
- * compacting the memory when blocks are freed. A program that uses
+ * compacting the memory when blocks are freed. With
+ * MMEM_CONF_SIZE_CLASSES, freed blocks are instead reused for blocks
+ * of the same size class, and the memory is compacted only when an
+ * allocation does not fit otherwise. A program that uses
  * the managed memory module cannot be sure that allocated memory
  * stays in place. Therefore, a level of indirection is used: access
  * to allocated memory must always be done using a special macro.
@@ -59,6 +62,26 @@
 #ifndef MMEM_H_
 #define MMEM_H_
 
+#include "contiki-conf.h"
+
+/* Set to 1 to allocate blocks by size class and compact the memory
+   only when it is needed, instead of on every mmem_free(). The
+   largest block, header included, is then MMEM_CONF_MIN_BLOCK (default
+   32) bytes doubled once for every four of the MMEM_CONF_CLASSES size
+   classes after the first, and larger allocations fail. By default
+   there are enough classes for a block as large as MMEM_CONF_SIZE. */
+#ifdef MMEM_CONF_SIZE_CLASSES
+#define MMEM_SIZE_CLASSES MMEM_CONF_SIZE_CLASSES
+#else
+#define MMEM_SIZE_CLASSES 0
+#endif
+
+#ifdef MMEM_CONF_STATS
+#define MMEM_STATS MMEM_CONF_STATS
+#else
+#define MMEM_STATS 0
+#endif
+
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Get a pointer to the managed memory
@@ -87,6 +110,30 @@ int  mmem_alloc(struct mmem *m, unsigned int size);
 void mmem_free(struct mmem *);
 void mmem_init(void);
 
+#if MMEM_SIZE_CLASSES
+void mmem_compact(void);
+#endif /* MMEM_SIZE_CLASSES */
+
+#if MMEM_STATS
+struct mmem_stats {
+  /* Allocations that failed */
+  unsigned int failed;
+  /* Bytes moved to compact the memory, in total and at most at once */
+  unsigned long moved;
+  unsigned int max_moved;
+#if MMEM_SIZE_CLASSES
+  /* Times the memory was compacted */
+  unsigned int compactions;
+  /* Free bytes held in freed blocks, apart from the unused memory */
+  unsigned int listed;
+  /* Bytes allocated beyond the requested sizes */
+  unsigned int internal;
+#endif /* MMEM_SIZE_CLASSES */
+};
+
+extern struct mmem_stats mmem_stats;
+#endif /* MMEM_STATS */
+
 #endif /* MMEM_H_ */
 
 /** @} */
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         SHA-256 and HMAC-SHA-256 (FIPS 180-4, RFC 2104).
+ */
+
+#ifndef SHA_256_H_
+#define SHA_256_H_
+
+#include "contiki.h"
+
+#define SHA_256_DIGEST_LENGTH 32
+#define SHA_256_BLOCK_SIZE    64
+
+struct sha_256_ctx {
+  uint32_t state[8];
+  uint32_t bit_count_lo;
+  uint32_t bit_count_hi;
+  uint8_t buf[SHA_256_BLOCK_SIZE];
+  uint8_t buf_len;
+};
+
+struct sha_256_hmac_ctx {
+  struct sha_256_ctx hash;
+  uint8_t key[SHA_256_BLOCK_SIZE];
+};
+
+void sha_256_init(struct sha_256_ctx *ctx);
+void sha_256_update(struct sha_256_ctx *ctx, const uint8_t *data, uint16_t len);
+
+/**
+ * \brief         Writes the digest. The context is left in an undefined state.
+ */
+void sha_256_final(struct sha_256_ctx *ctx, uint8_t *digest);
+
+void sha_256_hash(const uint8_t *data, uint16_t len, uint8_t *digest);
+
+/**
+ * \brief         Starts an HMAC computation. Keys longer than
+ *                SHA_256_BLOCK_SIZE bytes are hashed first.
+ */
+void sha_256_hmac_init(struct sha_256_hmac_ctx *ctx,
+    const uint8_t *key, uint16_t key_len);
+void sha_256_hmac_update(struct sha_256_hmac_ctx *ctx,
+    const uint8_t *data, uint16_t len);
+void sha_256_hmac_final(struct sha_256_hmac_ctx *ctx, uint8_t *mac);
+
+void sha_256_hmac(const uint8_t *key, uint16_t key_len,
+    const uint8_t *data, uint16_t data_len,
+    uint8_t *mac);
+
+#endif /* SHA_256_H_ */
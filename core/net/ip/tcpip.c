@@ -526,6 +526,7 @@ tcpip_ipv6_output(void)
 {
   uip_ds6_nbr_t *nbr = NULL;
   uip_ipaddr_t *nexthop;
+  uip_ds6_route_t *route = NULL;
 
   if(uip_len == 0) {
     return;
@@ -547,13 +548,23 @@ tcpip_ipv6_output(void)
     /* Next hop determination */
     nbr = NULL;
 
+#if UIP_DS6_NEXTHOP_CACHE_NB
+    /* Fast path: a recently used destination whose next hop is still
+       a reachable neighbor needs neither a route nor a neighbor cache
+       lookup. This is what most forwarded packets hit. */
+    nbr = uip_ds6_nexthop_cache_lookup(&UIP_IP_BUF->destipaddr);
+    if(nbr != NULL) {
+      nexthop = &nbr->ipaddr;
+      goto nexthop_found;
+    }
+#endif /* UIP_DS6_NEXTHOP_CACHE_NB */
+
     /* We first check if the destination address is on our immediate
        link. If so, we simply use the destination address as our
        nexthop address. */
     if(uip_ds6_is_addr_onlink(&UIP_IP_BUF->destipaddr)){
       nexthop = &UIP_IP_BUF->destipaddr;
     } else {
-      uip_ds6_route_t *route;
       /* Check if we have a route to the destination address. */
       route = uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr);
 
@@ -634,14 +645,17 @@ tcpip_ipv6_output(void)
     }
 
     /* End of next hop determination */
+    nbr = uip_ds6_nbr_lookup(nexthop);
 
+#if UIP_DS6_NEXTHOP_CACHE_NB
+ nexthop_found:
+#endif /* UIP_DS6_NEXTHOP_CACHE_NB */
 #if UIP_CONF_IPV6_RPL
     if(rpl_update_header_final(nexthop)) {
       uip_clear_buf();
       return;
     }
 #endif /* UIP_CONF_IPV6_RPL */
-    nbr = uip_ds6_nbr_lookup(nexthop);
     if(nbr == NULL) {
 #if UIP_ND6_SEND_NA
       if((nbr = uip_ds6_nbr_add(nexthop, NULL, 0, NBR_INCOMPLETE)) == NULL) {
@@ -700,6 +714,11 @@ tcpip_ipv6_output(void)
       }
 #endif /* UIP_ND6_SEND_NA */
 
+#if UIP_DS6_NEXTHOP_CACHE_NB
+      if(nbr->state == NBR_REACHABLE) {
+        uip_ds6_nexthop_cache_add(&UIP_IP_BUF->destipaddr, route, nbr);
+      }
+#endif /* UIP_DS6_NEXTHOP_CACHE_NB */
       tcpip_output(uip_ds6_nbr_get_ll(nbr));
 
 #if UIP_CONF_IPV6_QUEUE_PKT
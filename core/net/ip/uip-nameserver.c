@@ -127,8 +127,8 @@ uip_nameserver_update(const uip_ipaddr_t *nameserver, uint32_t lifetime)
    *          updated. Otherwise, new entries are added. */
   if(e != NULL) {
     if(lifetime == 0) {
-      memb_free(&dnsmemb, e);
       list_remove(dns, e);
+      memb_free(&dnsmemb, e);
     } else {
       e->added = clock_seconds();
       e->lifetime = lifetime;
@@ -0,0 +1,963 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \addtogroup mpl
+ * @{
+ */
+/**
+ * \file
+ *    Implementation of the MPL multicast engine (RFC 7731)
+ */
+
+#include "contiki.h"
+#include "contiki-lib.h"
+#include "contiki-net.h"
+#include "lib/trickle-timer.h"
+#include "net/ipv6/uip-icmp6.h"
+#include "net/ipv6/multicast/uip-mcast6.h"
+#include "net/ipv6/multicast/mpl.h"
+#include <string.h>
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+/*---------------------------------------------------------------------------*/
+/* Sequence Values and Serial Number Arithmetic (RFC 1982, SERIAL_BITS 8) */
+/*---------------------------------------------------------------------------*/
+#define SEQ_VAL_IS_LT(i1, i2) ((int8_t)((uint8_t)(i1) - (uint8_t)(i2)) < 0)
+#define SEQ_VAL_IS_GT(i1, i2) SEQ_VAL_IS_LT(i2, i1)
+/*---------------------------------------------------------------------------*/
+/* MPL Option */
+/*---------------------------------------------------------------------------*/
+struct mpl_hbho {
+  uint8_t type;
+  uint8_t len;
+  uint8_t flags;                /* S (2 bits), M, V, reserved */
+  uint8_t seq;
+  /* Followed by the Seed ID, unless S == 0 */
+};
+
+#define MPL_OPT_M_BIT            0x20
+#define MPL_OPT_V_BIT            0x10
+#define MPL_OPT_GET_S(h)         ((h)->flags >> 6)
+#define MPL_OPT_SEED_ID(h)       ((uint8_t *)(h) + sizeof(struct mpl_hbho))
+
+/* Our own datagrams: S=0, padded to 8 bytes with a 2-byte PadN */
+#define HBHO_LEN_ELIDED_SEED     2
+#define HBHO_TOTAL_LEN           8
+/*---------------------------------------------------------------------------*/
+/* MPL Control Message Seed Info */
+/*---------------------------------------------------------------------------*/
+struct mpl_seed_info {
+  uint8_t min_seqno;
+  uint8_t bm_len_s;             /* bm-len (6 bits), S (2 bits) */
+  /* Followed by the Seed ID and the buffered-mpl-messages bitmap */
+};
+
+#define SEED_INFO_GET_S(i)       ((i)->bm_len_s & 0x03)
+#define SEED_INFO_GET_BM_LEN(i)  ((i)->bm_len_s >> 2)
+#define SEED_INFO_BM_LEN_MAX     0x3F
+/*---------------------------------------------------------------------------*/
+/* Seed IDs
+ *
+ * S=0 (the Seed ID is the IPv6 source address) is stored as the equivalent
+ * 128-bit Seed ID (S=3), so that datagrams and control messages referring
+ * to the same seed with either form match the same seed set entry.
+ */
+/*---------------------------------------------------------------------------*/
+#define SEED_ID_S_ELIDED         0
+#define SEED_ID_S_128            3
+
+struct seed_id {
+  uint8_t s;
+  uint8_t id[16];
+};
+
+static const uint8_t seed_id_lens[4] = { 0, 2, 8, 16 };
+
+#define seed_id_len(s) (seed_id_lens[(s) & 0x03])
+/*---------------------------------------------------------------------------*/
+/* Seed Set and Buffered Messages */
+/*---------------------------------------------------------------------------*/
+struct seed {
+  struct seed *next;
+  struct seed_id id;
+  uint8_t min_seqno;            /* Lower bound of the sliding window */
+  uint8_t count;                /* Number of buffered messages */
+  uint8_t lifetime;             /* Minutes until this entry expires */
+  uint8_t listed;               /* Listed in the control message being parsed */
+  LIST_STRUCT(messages);        /* Buffered messages, by ascending seq */
+};
+
+struct message {
+  struct message *next;
+  struct seed *seed;
+  struct mmem data;             /* The datagram, starting at the IPv6 header */
+  struct trickle_timer tt;      /* Data message trickle timer */
+  uint8_t seq;
+  uint8_t e;                    /* Data trickle expirations */
+};
+
+#define MESSAGE_TTL(m) (((struct uip_ip_hdr *)MMEM_PTR(&(m)->data))->ttl)
+
+MEMB(seed_memb, struct seed, MPL_SEED_SET_SIZE);
+MEMB(message_memb, struct message, MPL_BUFFERED_MESSAGES);
+LIST(seed_set);
+
+#define LIFETIME_PERIOD          (60 * CLOCK_SECOND)
+static struct ctimer lifetime_timer;
+
+#if MPL_CONTROL_MESSAGE_TIMER_EXPIRATIONS
+static struct trickle_timer control_tt;
+static uint8_t control_e;
+#endif
+
+static uint8_t last_seq;
+/*---------------------------------------------------------------------------*/
+/* Maintain Stats */
+#if UIP_MCAST6_STATS
+static struct mpl_stats stats;
+
+#define MPL_STATS_ADD(x) stats.x++
+#define MPL_STATS_INIT() do { memset(&stats, 0, sizeof(stats)); } while(0)
+#else /* UIP_MCAST6_STATS */
+#define MPL_STATS_ADD(x)
+#define MPL_STATS_INIT()
+#endif
+/*---------------------------------------------------------------------------*/
+/* uIPv6 Pointers */
+/*---------------------------------------------------------------------------*/
+#define UIP_EXT_BUF       ((struct uip_ext_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+#define UIP_EXT_BUF_NEXT  ((uint8_t *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN + HBHO_TOTAL_LEN])
+#define UIP_EXT_OPT_FIRST ((struct mpl_hbho *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN + 2])
+#define UIP_IP_BUF        ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_ICMP_BUF      ((struct uip_icmp_hdr *)&uip_buf[uip_l2_l3_hdr_len])
+#define UIP_ICMP_PAYLOAD  ((unsigned char *)&uip_buf[uip_l2_l3_icmp_hdr_len])
+extern uint16_t uip_slen;
+
+#define MPL_DGRAM_OUT 0
+#define MPL_DGRAM_IN  1
+/*---------------------------------------------------------------------------*/
+static void icmp_input(void);
+
+UIP_ICMP6_HANDLER(mpl_icmp_handler, ICMP6_MPL,
+                  UIP_ICMP6_HANDLER_CODE_ANY, icmp_input);
+/*---------------------------------------------------------------------------*/
+#if DEBUG
+static void
+print_seed(const struct seed_id *id)
+{
+  uint8_t i;
+
+  for(i = 0; i < seed_id_len(id->s); i++) {
+    PRINTF("%02x", id->id[i]);
+  }
+}
+#define PRINT_SEED(id) print_seed(id)
+#else
+#define PRINT_SEED(id)
+#endif
+/*---------------------------------------------------------------------------*/
+/* All MPL Forwarders, link-local scope: FF02::FC */
+static void
+create_all_forwarders_mcast(uip_ipaddr_t *addr)
+{
+  uip_ip6addr(addr, 0xff02, 0, 0, 0, 0, 0, 0, 0x00fc);
+}
+/*---------------------------------------------------------------------------*/
+static int
+seed_id_cmp(const struct seed_id *a, const struct seed_id *b)
+{
+  return a->s == b->s && memcmp(a->id, b->id, seed_id_len(a->s)) == 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+seed_id_set(struct seed_id *id, uint8_t s, const uint8_t *buf,
+            const uip_ipaddr_t *src)
+{
+  memset(id, 0, sizeof(struct seed_id));
+  if(s == SEED_ID_S_ELIDED) {
+    id->s = SEED_ID_S_128;
+    memcpy(id->id, src, sizeof(uip_ipaddr_t));
+  } else {
+    id->s = s;
+    memcpy(id->id, buf, seed_id_len(s));
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct seed *
+seed_lookup(const struct seed_id *id)
+{
+  struct seed *s;
+
+  for(s = list_head(seed_set); s != NULL; s = list_item_next(s)) {
+    if(seed_id_cmp(&s->id, id)) {
+      return s;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct message *
+message_lookup(struct seed *s, uint8_t seq)
+{
+  struct message *m;
+
+  for(m = list_head(s->messages); m != NULL; m = list_item_next(m)) {
+    if(m->seq == seq) {
+      return m;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+message_free(struct message *m)
+{
+  trickle_timer_stop(&m->tt);
+  mmem_free(&m->data);
+  list_remove(m->seed->messages, m);
+  m->seed->count--;
+  memb_free(&message_memb, m);
+}
+/*---------------------------------------------------------------------------*/
+static void
+seed_free(struct seed *s)
+{
+  struct message *m;
+
+  while((m = list_head(s->messages)) != NULL) {
+    message_free(m);
+  }
+  list_remove(seed_set, s);
+  memb_free(&seed_memb, s);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Free the oldest message of the seed with the most buffered messages. The
+ * seed's window slides past it so that it will not be accepted again.
+ */
+static int
+buffer_reclaim(void)
+{
+  struct seed *s;
+  struct seed *largest = NULL;
+  struct message *m;
+
+  for(s = list_head(seed_set); s != NULL; s = list_item_next(s)) {
+    if(largest == NULL || s->count > largest->count) {
+      largest = s;
+    }
+  }
+
+  if(largest == NULL || largest->count == 0) {
+    return 0;
+  }
+
+  m = list_head(largest->messages);
+  PRINTF("MPL: Reclaim seq %u from seed ", m->seq);
+  PRINT_SEED(&largest->id);
+  PRINTF(", count was %u\n", largest->count);
+
+  largest->min_seqno = m->seq + 1;
+  message_free(m);
+  MPL_STATS_ADD(buff_reclaimed);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Allocate a seed set entry. If the set is full, the entry closest to
+ * expiry among those without buffered messages makes room for the new one.
+ */
+static struct seed *
+seed_allocate(const struct seed_id *id, uint8_t seq)
+{
+  struct seed *s;
+  struct seed *oldest = NULL;
+
+  s = memb_alloc(&seed_memb);
+  if(s == NULL) {
+    for(s = list_head(seed_set); s != NULL; s = list_item_next(s)) {
+      if(s->count == 0 &&
+         (oldest == NULL || s->lifetime < oldest->lifetime)) {
+        oldest = s;
+      }
+    }
+    if(oldest == NULL) {
+      return NULL;
+    }
+    PRINTF("MPL: Prune seed ");
+    PRINT_SEED(&oldest->id);
+    PRINTF("\n");
+    seed_free(oldest);
+    MPL_STATS_ADD(seeds_pruned);
+    s = memb_alloc(&seed_memb);
+  }
+
+  memset(s, 0, sizeof(struct seed));
+  LIST_STRUCT_INIT(s, messages);
+  memcpy(&s->id, id, sizeof(struct seed_id));
+  s->min_seqno = seq;
+  list_add(seed_set, s);
+  return s;
+}
+/*---------------------------------------------------------------------------*/
+static struct message *
+message_allocate(void)
+{
+  struct message *m;
+
+  while((m = memb_alloc(&message_memb)) == NULL) {
+    if(!buffer_reclaim()) {
+      return NULL;
+    }
+  }
+  memset(m, 0, sizeof(struct message));
+
+  while(mmem_alloc(&m->data, uip_len) == 0) {
+    if(!buffer_reclaim()) {
+      memb_free(&message_memb, m);
+      return NULL;
+    }
+  }
+  return m;
+}
+/*---------------------------------------------------------------------------*/
+static void
+message_insert(struct seed *s, struct message *m)
+{
+  struct message *prev = NULL;
+  struct message *iter;
+
+  for(iter = list_head(s->messages); iter != NULL && SEQ_VAL_IS_LT(iter->seq, m->seq);
+      iter = list_item_next(iter)) {
+    prev = iter;
+  }
+  list_insert(s->messages, prev, m);
+  m->seed = s;
+  s->count++;
+}
+/*---------------------------------------------------------------------------*/
+/* Data message trickle timer: forward the message if not suppressed */
+static void
+data_timer_expired(void *ptr, uint8_t suppress)
+{
+  struct message *m = ptr;
+
+  if(suppress == TRICKLE_TIMER_TX_OK && MESSAGE_TTL(m) > 0) {
+    PRINTF("MPL: Send seq %u from seed ", m->seq);
+    PRINT_SEED(&m->seed->id);
+    PRINTF("\n");
+    uip_len = m->data.size;
+    memcpy(UIP_IP_BUF, MMEM_PTR(&m->data), uip_len);
+
+    UIP_MCAST6_STATS_ADD(mcast_fwd);
+    tcpip_output(NULL);
+    uip_clear_buf();
+  }
+
+  m->e++;
+  if(m->e >= MPL_DATA_MESSAGE_TIMER_EXPIRATIONS) {
+    trickle_timer_stop(&m->tt);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* (Re)start a message's data trickle timer, e.g. for a neighbour missing it */
+static void
+data_timer_reset(struct message *m)
+{
+  m->e = 0;
+  if(trickle_timer_is_running(&m->tt)) {
+    trickle_timer_inconsistency(&m->tt);
+  } else {
+    trickle_timer_set(&m->tt, data_timer_expired, m);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if MPL_CONTROL_MESSAGE_TIMER_EXPIRATIONS
+static void
+icmp_output(void)
+{
+  struct seed *s;
+  struct message *m;
+  struct mpl_seed_info *info;
+  uint8_t *buffer;
+  uint16_t payload_len;
+  uint16_t max_len;
+  uint8_t id_len;
+  uint8_t bm_len;
+  uint8_t offset;
+
+  PRINTF("MPL: ICMPv6 Out\n");
+
+  payload_len = 0;
+  max_len = UIP_BUFSIZE - UIP_LLH_LEN - UIP_IPH_LEN - UIP_ICMPH_LEN;
+
+  for(s = list_head(seed_set); s != NULL; s = list_item_next(s)) {
+    id_len = seed_id_len(s->id.s);
+    bm_len = 0;
+    for(m = list_head(s->messages); m != NULL; m = list_item_next(m)) {
+      offset = m->seq - s->min_seqno;
+      if(offset / 8 + 1 > bm_len) {
+        bm_len = offset / 8 + 1;
+      }
+    }
+
+    if(bm_len > SEED_INFO_BM_LEN_MAX ||
+       payload_len + sizeof(struct mpl_seed_info) + id_len + bm_len > max_len) {
+      PRINTF("MPL: ICMPv6 Out, no room for seed ");
+      PRINT_SEED(&s->id);
+      PRINTF("\n");
+      continue;
+    }
+
+    info = (struct mpl_seed_info *)(UIP_ICMP_PAYLOAD + payload_len);
+    info->min_seqno = s->min_seqno;
+    info->bm_len_s = (bm_len << 2) | s->id.s;
+    buffer = (uint8_t *)info + sizeof(struct mpl_seed_info);
+    memcpy(buffer, s->id.id, id_len);
+    buffer += id_len;
+    memset(buffer, 0, bm_len);
+    for(m = list_head(s->messages); m != NULL; m = list_item_next(m)) {
+      offset = m->seq - s->min_seqno;
+      buffer[offset >> 3] |= 0x80 >> (offset & 0x07);
+    }
+
+    PRINTF("MPL: ICMPv6 Out - Seed ");
+    PRINT_SEED(&s->id);
+    PRINTF(" min %u, %u messages\n", s->min_seqno, s->count);
+
+    payload_len += sizeof(struct mpl_seed_info) + id_len + bm_len;
+  }
+
+  if(payload_len == 0) {
+    return;
+  }
+
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->tcflow = 0;
+  UIP_IP_BUF->flow = 0;
+  UIP_IP_BUF->proto = UIP_PROTO_ICMP6;
+  UIP_IP_BUF->ttl = MPL_IP_HOP_LIMIT;
+
+  create_all_forwarders_mcast(&UIP_IP_BUF->destipaddr);
+  uip_ds6_select_src(&UIP_IP_BUF->srcipaddr, &UIP_IP_BUF->destipaddr);
+
+  UIP_IP_BUF->len[0] = (UIP_ICMPH_LEN + payload_len) >> 8;
+  UIP_IP_BUF->len[1] = (UIP_ICMPH_LEN + payload_len) & 0xff;
+
+  UIP_ICMP_BUF->type = ICMP6_MPL;
+  UIP_ICMP_BUF->icode = MPL_ICMP_CODE;
+
+  UIP_ICMP_BUF->icmpchksum = 0;
+  UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
+
+  uip_len = UIP_IPH_LEN + UIP_ICMPH_LEN + payload_len;
+
+  tcpip_ipv6_output();
+  MPL_STATS_ADD(icmp_out);
+}
+/*---------------------------------------------------------------------------*/
+/* Control message trickle timer */
+static void
+control_timer_expired(void *ptr, uint8_t suppress)
+{
+  if(suppress == TRICKLE_TIMER_TX_OK &&
+     uip_ds6_get_link_local(ADDR_PREFERRED) != NULL) {
+    icmp_output();
+  }
+
+  control_e++;
+  if(control_e >= MPL_CONTROL_MESSAGE_TIMER_EXPIRATIONS) {
+    trickle_timer_stop(&control_tt);
+  }
+}
+#endif /* MPL_CONTROL_MESSAGE_TIMER_EXPIRATIONS */
+/*---------------------------------------------------------------------------*/
+static void
+control_timer_reset(void)
+{
+#if MPL_CONTROL_MESSAGE_TIMER_EXPIRATIONS
+  control_e = 0;
+  if(trickle_timer_is_running(&control_tt)) {
+    trickle_timer_inconsistency(&control_tt);
+  } else {
+    trickle_timer_set(&control_tt, control_timer_expired, NULL);
+  }
+#endif
+}
+/*---------------------------------------------------------------------------*/
+/* Seed set entry lifetimes, in minutes */
+static void
+lifetime_update(void *ptr)
+{
+  struct seed *s;
+  struct seed *next;
+
+  for(s = list_head(seed_set); s != NULL; s = next) {
+    next = list_item_next(s);
+    if(s->lifetime > 0) {
+      s->lifetime--;
+    }
+    if(s->lifetime == 0) {
+      PRINTF("MPL: Seed ");
+      PRINT_SEED(&s->id);
+      PRINTF(" expired\n");
+      seed_free(s);
+      MPL_STATS_ADD(seeds_pruned);
+    }
+  }
+
+  ctimer_reset(&lifetime_timer);
+}
+/*---------------------------------------------------------------------------*/
+/* Find the MPL Option in the Hop-by-Hop Options header */
+static struct mpl_hbho *
+hbho_lookup(void)
+{
+  uint8_t *opt;
+  uint8_t *end;
+
+  if(UIP_IP_BUF->proto != UIP_PROTO_HBHO ||
+     uip_len < UIP_IPH_LEN + ((UIP_EXT_BUF->len + 1) << 3)) {
+    return NULL;
+  }
+
+  opt = (uint8_t *)UIP_EXT_OPT_FIRST;
+  end = (uint8_t *)UIP_EXT_BUF + ((UIP_EXT_BUF->len + 1) << 3);
+  while(opt + 1 < end) {
+    if(*opt == UIP_EXT_HDR_OPT_PAD1) {
+      opt++;
+    } else if(*opt == UIP_EXT_HDR_OPT_MPL) {
+      return opt + opt[1] + 2 <= end ? (struct mpl_hbho *)opt : NULL;
+    } else {
+      opt += opt[1] + 2;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Processes an incoming or outgoing multicast message and determines
+ * whether it should be dropped or accepted
+ *
+ * \param in 1: Incoming packet, 0: Outgoing (we are the seed)
+ *
+ * \return 0: Drop, 1: Accept
+ */
+static uint8_t
+accept(uint8_t in)
+{
+  struct mpl_hbho *hbho;
+  struct seed_id id;
+  struct seed *s;
+  struct message *m;
+  uint8_t new_seed;
+
+#if UIP_CONF_IPV6_CHECKS
+  if(uip_is_addr_mcast_non_routable(&UIP_IP_BUF->destipaddr)) {
+    PRINTF("MPL: Mcast I/O, bad destination\n");
+    UIP_MCAST6_STATS_ADD(mcast_bad);
+    return UIP_MCAST6_DROP;
+  }
+  /*
+   * Abort transmission if the v6 src is unspecified. This may happen if the
+   * seed tries to TX while it's still performing DAD or waiting for a prefix
+   */
+  if(uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr)) {
+    PRINTF("MPL: Mcast I/O, bad source\n");
+    UIP_MCAST6_STATS_ADD(mcast_bad);
+    return UIP_MCAST6_DROP;
+  }
+#endif
+
+  hbho = hbho_lookup();
+  if(hbho == NULL) {
+    PRINTF("MPL: Mcast I/O, no MPL option\n");
+    UIP_MCAST6_STATS_ADD(mcast_bad);
+    return UIP_MCAST6_DROP;
+  }
+
+  if((hbho->flags & MPL_OPT_V_BIT) ||
+     hbho->len != HBHO_LEN_ELIDED_SEED + seed_id_len(MPL_OPT_GET_S(hbho))) {
+    PRINTF("MPL: Mcast I/O, bad option, L=%u, F=0x%02x\n",
+           hbho->len, hbho->flags);
+    UIP_MCAST6_STATS_ADD(mcast_bad);
+    return UIP_MCAST6_DROP;
+  }
+
+  if(in == MPL_DGRAM_IN) {
+    UIP_MCAST6_STATS_ADD(mcast_in_all);
+  }
+
+  seed_id_set(&id, MPL_OPT_GET_S(hbho), MPL_OPT_SEED_ID(hbho),
+              &UIP_IP_BUF->srcipaddr);
+
+  PRINTF("MPL: Seed ");
+  PRINT_SEED(&id);
+  PRINTF(" seq %u\n", hbho->seq);
+
+  new_seed = 0;
+  s = seed_lookup(&id);
+  if(s != NULL) {
+    if(SEQ_VAL_IS_LT(hbho->seq, s->min_seqno)) {
+      PRINTF("MPL: Too old (min %u)\n", s->min_seqno);
+      UIP_MCAST6_STATS_ADD(mcast_dropped);
+      return UIP_MCAST6_DROP;
+    }
+    m = message_lookup(s, hbho->seq);
+    if(m != NULL) {
+      PRINTF("MPL: Seen before\n");
+      trickle_timer_consistency(&m->tt);
+      UIP_MCAST6_STATS_ADD(mcast_dropped);
+      return UIP_MCAST6_DROP;
+    }
+  } else {
+    s = seed_allocate(&id, hbho->seq);
+    if(s == NULL) {
+      PRINTF("MPL: Failed to allocate seed\n");
+      UIP_MCAST6_STATS_ADD(mcast_dropped);
+      return UIP_MCAST6_DROP;
+    }
+    new_seed = 1;
+  }
+
+  m = message_allocate();
+  if(m != NULL && SEQ_VAL_IS_LT(hbho->seq, s->min_seqno)) {
+    /* Reclaiming slid this seed's window past the new message */
+    mmem_free(&m->data);
+    memb_free(&message_memb, m);
+    m = NULL;
+  }
+  if(m == NULL) {
+    PRINTF("MPL: Buffer allocation failed\n");
+    if(new_seed) {
+      seed_free(s);
+    }
+    UIP_MCAST6_STATS_ADD(mcast_dropped);
+    return UIP_MCAST6_DROP;
+  }
+
+  if(in == MPL_DGRAM_IN) {
+    UIP_MCAST6_STATS_ADD(mcast_in_unique);
+  }
+
+  m->seq = hbho->seq;
+  memcpy(MMEM_PTR(&m->data), UIP_IP_BUF, uip_len);
+  message_insert(s, m);
+  s->lifetime = MPL_SEED_SET_ENTRY_LIFETIME;
+
+  PRINTF("MPL: Buffered seq %u, %u messages for this seed\n",
+         m->seq, s->count);
+
+  /*
+   * Incoming messages have their TTL decremented before we forward them.
+   * If we are the seed, the caller transmits the message straight away and
+   * the data trickle timer takes care of further transmissions.
+   */
+  if(in == MPL_DGRAM_IN) {
+    MESSAGE_TTL(m)--;
+  }
+
+  trickle_timer_config(&m->tt, MPL_DATA_MESSAGE_IMIN, MPL_DATA_MESSAGE_IMAX,
+                       MPL_DATA_MESSAGE_K);
+#if MPL_PROACTIVE_FORWARDING
+  trickle_timer_set(&m->tt, data_timer_expired, m);
+#endif
+
+  control_timer_reset();
+
+  return UIP_MCAST6_ACCEPT;
+}
+/*---------------------------------------------------------------------------*/
+/* MPL ICMPv6 Input Handler: Control Messages */
+static void
+icmp_input(void)
+{
+  struct mpl_seed_info *info;
+  struct seed_id id;
+  struct seed *s;
+  struct message *m;
+  uip_ipaddr_t all_forwarders;
+  uint8_t *bitmap;
+  uint8_t *end;
+  uint8_t bm_len;
+  uint8_t seq;
+  uint8_t offset;
+  uint8_t inconsistency;
+  uint16_t i;
+
+  create_all_forwarders_mcast(&all_forwarders);
+
+#if UIP_CONF_IPV6_CHECKS
+  if(!uip_is_addr_linklocal(&UIP_IP_BUF->srcipaddr)) {
+    PRINTF("MPL: ICMPv6 In, bad source ");
+    PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
+    PRINTF("\n");
+    MPL_STATS_ADD(icmp_bad);
+    goto discard;
+  }
+
+  if(!uip_ipaddr_cmp(&UIP_IP_BUF->destipaddr, &all_forwarders)) {
+    PRINTF("MPL: ICMPv6 In, bad destination\n");
+    MPL_STATS_ADD(icmp_bad);
+    goto discard;
+  }
+
+  if(UIP_ICMP_BUF->icode != MPL_ICMP_CODE) {
+    PRINTF("MPL: ICMPv6 In, bad ICMP code\n");
+    MPL_STATS_ADD(icmp_bad);
+    goto discard;
+  }
+
+  if(UIP_IP_BUF->ttl != MPL_IP_HOP_LIMIT) {
+    PRINTF("MPL: ICMPv6 In, bad TTL\n");
+    MPL_STATS_ADD(icmp_bad);
+    goto discard;
+  }
+#endif
+
+  PRINTF("MPL: ICMPv6 In from ");
+  PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
+  PRINTF(" len %u\n", uip_len);
+
+  MPL_STATS_ADD(icmp_in);
+
+  for(s = list_head(seed_set); s != NULL; s = list_item_next(s)) {
+    s->listed = 0;
+  }
+
+  inconsistency = 0;
+  info = (struct mpl_seed_info *)UIP_ICMP_PAYLOAD;
+  end = (uint8_t *)UIP_IP_BUF + uip_len;
+  while((uint8_t *)info + sizeof(struct mpl_seed_info) <= end) {
+    bm_len = SEED_INFO_GET_BM_LEN(info);
+    bitmap = (uint8_t *)info + sizeof(struct mpl_seed_info) +
+      seed_id_len(SEED_INFO_GET_S(info));
+    if(bitmap + bm_len > end) {
+      PRINTF("MPL: ICMPv6 In, truncated Seed Info\n");
+      MPL_STATS_ADD(icmp_bad);
+      break;
+    }
+
+    seed_id_set(&id, SEED_INFO_GET_S(info),
+                (uint8_t *)info + sizeof(struct mpl_seed_info),
+                &UIP_IP_BUF->srcipaddr);
+
+    PRINTF("MPL: ICMPv6 In, Seed ");
+    PRINT_SEED(&id);
+    PRINTF(" min %u, bm-len %u\n", info->min_seqno, bm_len);
+
+    s = seed_lookup(&id);
+    if(s == NULL) {
+      /* They have messages from a seed unknown to us */
+      for(i = 0; i < bm_len; i++) {
+        if(bitmap[i]) {
+          PRINTF("MPL: Inconsistency - unknown seed\n");
+          inconsistency = 1;
+          break;
+        }
+      }
+    } else {
+      s->listed = 1;
+
+      /* They have new: listed messages inside our window that we lack */
+      for(i = 0; i < (uint16_t)bm_len * 8 && i < 0x100; i++) {
+        if(bitmap[i >> 3] & (0x80 >> (i & 0x07))) {
+          seq = info->min_seqno + i;
+          if(!SEQ_VAL_IS_LT(seq, s->min_seqno) &&
+             message_lookup(s, seq) == NULL) {
+            PRINTF("MPL: Inconsistency - they have %u\n", seq);
+            inconsistency = 1;
+          }
+        }
+      }
+
+      /* We have new: buffered messages inside their window they lack */
+      for(m = list_head(s->messages); m != NULL; m = list_item_next(m)) {
+        if(SEQ_VAL_IS_LT(m->seq, info->min_seqno)) {
+          continue;
+        }
+        offset = m->seq - info->min_seqno;
+        if(offset >= (uint16_t)bm_len * 8 ||
+           !(bitmap[offset >> 3] & (0x80 >> (offset & 0x07)))) {
+          PRINTF("MPL: Inconsistency - we have %u\n", m->seq);
+          data_timer_reset(m);
+          inconsistency = 1;
+        }
+      }
+    }
+
+    info = (struct mpl_seed_info *)(bitmap + bm_len);
+  }
+
+  /* We have new: seeds they did not list at all */
+  for(s = list_head(seed_set); s != NULL; s = list_item_next(s)) {
+    if(!s->listed && s->count > 0) {
+      PRINTF("MPL: Inconsistency - Seed ");
+      PRINT_SEED(&s->id);
+      PRINTF(" was not listed\n");
+      for(m = list_head(s->messages); m != NULL; m = list_item_next(m)) {
+        data_timer_reset(m);
+      }
+      inconsistency = 1;
+    }
+  }
+
+  if(inconsistency) {
+    control_timer_reset();
+  }
+#if MPL_CONTROL_MESSAGE_TIMER_EXPIRATIONS
+  else {
+    trickle_timer_consistency(&control_tt);
+  }
+#endif
+
+discard:
+  uip_clear_buf();
+}
+/*---------------------------------------------------------------------------*/
+static void
+out(void)
+{
+  struct mpl_hbho *hbho;
+  uint8_t *padn;
+
+  if(uip_len + HBHO_TOTAL_LEN > UIP_BUFSIZE) {
+    PRINTF("MPL: Multicast Out can not add HBHO. Packet too long\n");
+    goto drop;
+  }
+
+  /* Slide 'right' by HBHO_TOTAL_LEN bytes */
+  memmove(UIP_EXT_BUF_NEXT, UIP_EXT_BUF, uip_len - UIP_IPH_LEN);
+  memset(UIP_EXT_BUF, 0, HBHO_TOTAL_LEN);
+
+  UIP_EXT_BUF->next = UIP_IP_BUF->proto;
+  UIP_EXT_BUF->len = 0;
+
+  /* MPL Option with an elided Seed ID (S=0), followed by a 2-byte PadN */
+  hbho = UIP_EXT_OPT_FIRST;
+  hbho->type = UIP_EXT_HDR_OPT_MPL;
+  hbho->len = HBHO_LEN_ELIDED_SEED;
+  hbho->flags = MPL_OPT_M_BIT;
+  hbho->seq = ++last_seq;
+
+  padn = (uint8_t *)hbho + sizeof(struct mpl_hbho);
+  padn[0] = UIP_EXT_HDR_OPT_PADN;
+  padn[1] = 0;
+
+  uip_ext_len += HBHO_TOTAL_LEN;
+  uip_len += HBHO_TOTAL_LEN;
+
+  /* Update the proto and length field in the v6 header */
+  UIP_IP_BUF->proto = UIP_PROTO_HBHO;
+  UIP_IP_BUF->len[0] = ((uip_len - UIP_IPH_LEN) >> 8);
+  UIP_IP_BUF->len[1] = ((uip_len - UIP_IPH_LEN) & 0xff);
+
+  PRINTF("MPL: Multicast Out, seq %u\n", hbho->seq);
+
+  /*
+   * Buffer the message so that it is advertised in our control messages and
+   * retransmitted by the data trickle timer, then send it straight away. We
+   * then set uip_len = 0 to stop the core from re-sending it.
+   */
+  if(accept(MPL_DGRAM_OUT)) {
+    tcpip_output(NULL);
+    UIP_MCAST6_STATS_ADD(mcast_out);
+  }
+
+drop:
+  uip_slen = 0;
+  uip_clear_buf();
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+in(void)
+{
+  if(accept(MPL_DGRAM_IN) == UIP_MCAST6_DROP) {
+    return UIP_MCAST6_DROP;
+  }
+
+  if(!uip_ds6_is_my_maddr(&UIP_IP_BUF->destipaddr)) {
+    PRINTF("MPL: Not a group member. No further processing\n");
+    return UIP_MCAST6_DROP;
+  } else {
+    PRINTF("MPL: Ours. Deliver to upper layers\n");
+    UIP_MCAST6_STATS_ADD(mcast_in_ours);
+    return UIP_MCAST6_ACCEPT;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  uip_ipaddr_t all_forwarders;
+
+  PRINTF("MPL: RFC 7731 Multicast\n");
+
+  memb_init(&seed_memb);
+  memb_init(&message_memb);
+  list_init(seed_set);
+  mmem_init();
+
+  MPL_STATS_INIT();
+  UIP_MCAST6_STATS_INIT(&stats);
+
+  /* Register the ICMPv6 input handler */
+  uip_icmp6_register_input_handler(&mpl_icmp_handler);
+
+  /* Control messages are sent to, and received on, FF02::FC */
+  create_all_forwarders_mcast(&all_forwarders);
+  if(uip_ds6_maddr_add(&all_forwarders) == NULL) {
+    PRINTF("MPL: Failed to join the All MPL Forwarders group\n");
+  }
+
+#if MPL_CONTROL_MESSAGE_TIMER_EXPIRATIONS
+  trickle_timer_config(&control_tt, MPL_CONTROL_MESSAGE_IMIN,
+                       MPL_CONTROL_MESSAGE_IMAX, MPL_CONTROL_MESSAGE_K);
+#endif
+
+  ctimer_set(&lifetime_timer, LIFETIME_PERIOD, lifetime_update, NULL);
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief The MPL engine driver
+ */
+const struct uip_mcast6_driver mpl_driver = {
+  "MPL",
+  init,
+  out,
+  in,
+};
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \addtogroup uip6-multicast
+ * @{
+ */
+/**
+ * \defgroup mpl Multicast Protocol for Low-Power and Lossy Networks (MPL)
+ *
+ * IPv6 multicast according to RFC 7731, "Multicast Protocol for
+ * Low-Power and Lossy Networks (MPL)".
+ *
+ * Datagrams carry the MPL Option in a Hop-by-Hop Options header. Each
+ * forwarder keeps a seed set, with a sliding window of sequence numbers
+ * per seed, and a bounded set of buffered messages. Every buffered
+ * message has its own trickle timer, which drives proactive forwarding.
+ * A separate trickle timer drives MPL Control Messages, which summarise
+ * the buffered messages and trigger reactive retransmissions towards
+ * neighbours that have missed some of them.
+ *
+ * The Option is added to the datagram in place, as ROLL TM does; IPv6-in-IPv6
+ * encapsulation is not implemented, so only datagrams originating inside
+ * the MPL domain are supported. Outgoing datagrams use the IPv6 source
+ * address as the Seed ID (S=0). Incoming datagrams may use any Seed ID
+ * length.
+ * @{
+ */
+/**
+ * \file
+ *    Header file for the implementation of the MPL multicast engine
+ */
+
+#ifndef MPL_H_
+#define MPL_H_
+
+#include "contiki-conf.h"
+#include "net/ipv6/multicast/uip-mcast6-stats.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/* Protocol Constants */
+/*---------------------------------------------------------------------------*/
+#define MPL_ICMP_CODE                  0   /**< MPL ICMPv6 code field */
+#define MPL_IP_HOP_LIMIT            0xFF   /**< Hop limit for ICMP messages */
+/*---------------------------------------------------------------------------*/
+/* Configuration */
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Whether to forward new messages proactively
+ *
+ * When enabled, each new message starts its data trickle timer and is
+ * retransmitted up to MPL_DATA_MESSAGE_TIMER_EXPIRATIONS times. When
+ * disabled, messages are only retransmitted when a control message shows
+ * that a neighbour is missing them (reactive forwarding). Reactive-only
+ * forwarding requires MPL_CONTROL_MESSAGE_TIMER_EXPIRATIONS > 0.
+ */
+#ifdef MPL_CONF_PROACTIVE_FORWARDING
+#define MPL_PROACTIVE_FORWARDING MPL_CONF_PROACTIVE_FORWARDING
+#else
+#define MPL_PROACTIVE_FORWARDING 1
+#endif
+
+/**
+ * \brief Maximum number of seeds in the seed set
+ */
+#ifdef MPL_CONF_SEED_SET_SIZE
+#define MPL_SEED_SET_SIZE MPL_CONF_SEED_SET_SIZE
+#else
+#define MPL_SEED_SET_SIZE 2
+#endif
+
+/**
+ * \brief Maximum number of buffered messages, across all seeds
+ *
+ * Message contents are stored in the managed memory pool (mmem), so only the
+ * actual datagram length is used. When either the message pool or mmem is
+ * exhausted, the oldest message of the seed with the most buffered messages
+ * is reclaimed.
+ */
+#ifdef MPL_CONF_BUFFERED_MESSAGES
+#define MPL_BUFFERED_MESSAGES MPL_CONF_BUFFERED_MESSAGES
+#else
+#define MPL_BUFFERED_MESSAGES 6
+#endif
+
+/**
+ * \brief Minimum lifetime of a seed set entry, in minutes
+ *
+ * The entry is kept for this long after the last new message from the seed,
+ * so that old messages are not accepted again. Expired entries are pruned
+ * with their buffered messages.
+ */
+#ifdef MPL_CONF_SEED_SET_ENTRY_LIFETIME
+#define MPL_SEED_SET_ENTRY_LIFETIME MPL_CONF_SEED_SET_ENTRY_LIFETIME
+#else
+#define MPL_SEED_SET_ENTRY_LIFETIME 30
+#endif
+
+/** \brief Imin of the data message trickle timers, in clock ticks */
+#ifdef MPL_CONF_DATA_MESSAGE_IMIN
+#define MPL_DATA_MESSAGE_IMIN MPL_CONF_DATA_MESSAGE_IMIN
+#else
+#define MPL_DATA_MESSAGE_IMIN (CLOCK_SECOND / 4)
+#endif
+
+/** \brief Imax of the data message trickle timers, as a number of doublings */
+#ifdef MPL_CONF_DATA_MESSAGE_IMAX
+#define MPL_DATA_MESSAGE_IMAX MPL_CONF_DATA_MESSAGE_IMAX
+#else
+#define MPL_DATA_MESSAGE_IMAX 1
+#endif
+
+/** \brief Redundancy constant of the data message trickle timers */
+#ifdef MPL_CONF_DATA_MESSAGE_K
+#define MPL_DATA_MESSAGE_K MPL_CONF_DATA_MESSAGE_K
+#else
+#define MPL_DATA_MESSAGE_K 1
+#endif
+
+/** \brief Number of data trickle intervals before a message is no longer sent */
+#ifdef MPL_CONF_DATA_MESSAGE_TIMER_EXPIRATIONS
+#define MPL_DATA_MESSAGE_TIMER_EXPIRATIONS MPL_CONF_DATA_MESSAGE_TIMER_EXPIRATIONS
+#else
+#define MPL_DATA_MESSAGE_TIMER_EXPIRATIONS 3
+#endif
+
+/** \brief Imin of the control message trickle timer, in clock ticks */
+#ifdef MPL_CONF_CONTROL_MESSAGE_IMIN
+#define MPL_CONTROL_MESSAGE_IMIN MPL_CONF_CONTROL_MESSAGE_IMIN
+#else
+#define MPL_CONTROL_MESSAGE_IMIN CLOCK_SECOND
+#endif
+
+/** \brief Imax of the control message trickle timer, as a number of doublings */
+#ifdef MPL_CONF_CONTROL_MESSAGE_IMAX
+#define MPL_CONTROL_MESSAGE_IMAX MPL_CONF_CONTROL_MESSAGE_IMAX
+#else
+#define MPL_CONTROL_MESSAGE_IMAX 5
+#endif
+
+/** \brief Redundancy constant of the control message trickle timer */
+#ifdef MPL_CONF_CONTROL_MESSAGE_K
+#define MPL_CONTROL_MESSAGE_K MPL_CONF_CONTROL_MESSAGE_K
+#else
+#define MPL_CONTROL_MESSAGE_K 1
+#endif
+
+/**
+ * \brief Number of control trickle intervals after the last new message
+ *
+ * Set to 0 to disable control messages altogether.
+ */
+#ifdef MPL_CONF_CONTROL_MESSAGE_TIMER_EXPIRATIONS
+#define MPL_CONTROL_MESSAGE_TIMER_EXPIRATIONS MPL_CONF_CONTROL_MESSAGE_TIMER_EXPIRATIONS
+#else
+#define MPL_CONTROL_MESSAGE_TIMER_EXPIRATIONS 10
+#endif
+
+#if !MPL_PROACTIVE_FORWARDING && !MPL_CONTROL_MESSAGE_TIMER_EXPIRATIONS
+#error "MPL: Reactive forwarding requires control messages."
+#error "Check the values of MPL_CONF_PROACTIVE_FORWARDING and"
+#error "MPL_CONF_CONTROL_MESSAGE_TIMER_EXPIRATIONS in conf files."
+#endif
+/*---------------------------------------------------------------------------*/
+/* Stats datatype */
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief MPL-specific stats
+ *
+ * Extends the generic multicast stats in the engine_stats field
+ */
+struct mpl_stats {
+  /** Number of received ICMP datagrams */
+  UIP_MCAST6_STATS_DATATYPE icmp_in;
+
+  /** Number of ICMP datagrams sent */
+  UIP_MCAST6_STATS_DATATYPE icmp_out;
+
+  /** Number of malformed ICMP datagrams seen by us */
+  UIP_MCAST6_STATS_DATATYPE icmp_bad;
+
+  /** Number of buffered messages reclaimed to make room for new ones */
+  UIP_MCAST6_STATS_DATATYPE buff_reclaimed;
+
+  /** Number of seed set entries pruned */
+  UIP_MCAST6_STATS_DATATYPE seeds_pruned;
+};
+/*---------------------------------------------------------------------------*/
+#endif /* MPL_H_ */
+/*---------------------------------------------------------------------------*/
+/** @} */
+/** @} */
@@ -68,6 +68,7 @@
 #include "net/rime/rime.h"
 #include "net/ipv6/sicslowpan.h"
 #include "net/netstack.h"
+#include "net/link-stats.h"
 
 #include <stdio.h>
 
@@ -104,6 +105,13 @@ void uip_log(char *msg);
 #define SICSLOWPAN_MAX_MAC_TRANSMISSIONS 4
 #endif
 
+/* Number of flows whose compressed IPHC header is cached */
+#ifdef SICSLOWPAN_CONF_IPHC_CACHE_SIZE
+#define SICSLOWPAN_IPHC_CACHE_SIZE SICSLOWPAN_CONF_IPHC_CACHE_SIZE
+#else
+#define SICSLOWPAN_IPHC_CACHE_SIZE 0
+#endif
+
 #ifndef SICSLOWPAN_COMPRESSION
 #ifdef SICSLOWPAN_CONF_COMPRESSION
 #define SICSLOWPAN_COMPRESSION SICSLOWPAN_CONF_COMPRESSION
@@ -327,6 +335,42 @@ static struct sicslowpan_addr_context *context;
 /** pointer to the byte where to write next inline field. */
 static uint8_t *hc06_ptr;
 
+/** Cache of compressed headers of recent flows. Headers compressed with a
+ *  next header compressor are not cached. */
+#ifdef SICSLOWPAN_NH_COMPRESSOR
+#undef SICSLOWPAN_IPHC_CACHE_SIZE
+#define SICSLOWPAN_IPHC_CACHE_SIZE 0
+#endif /* SICSLOWPAN_NH_COMPRESSOR */
+
+#if SICSLOWPAN_IPHC_CACHE_SIZE > 0
+/* Largest IPHC + LOWPAN_UDP header: dispatch and encoding (2), context
+   identifiers (1), traffic class and flow label (4), next header (1), hop
+   limit (1), source and destination addresses (32) and UDP (7). */
+#define IPHC_CACHE_MAX_HDR_LEN 48
+
+struct iphc_cache_entry {
+  /* Flow key: all IPv6 header fields except the payload length, the UDP
+     ports and the link-layer destination */
+  uip_ipaddr_t destipaddr;
+  uip_ipaddr_t srcipaddr;
+  linkaddr_t link_destaddr;
+  uint8_t tcflow[4];
+  uint8_t proto;
+  uint8_t ttl;
+  uint8_t ports[4];
+  /* Compressed header template */
+  uint8_t used;
+  uint8_t hdr_len;
+  uint8_t uncomp_hdr_len;
+  /* Offset of the inline UDP checksum in the template, 0 if none */
+  uint8_t chksum_offset;
+  uint8_t hdr[IPHC_CACHE_MAX_HDR_LEN];
+};
+static struct iphc_cache_entry iphc_cache[SICSLOWPAN_IPHC_CACHE_SIZE];
+/* Next entry to replace */
+static uint8_t iphc_cache_next;
+#endif /* SICSLOWPAN_IPHC_CACHE_SIZE > 0 */
+
 /* Uncompression of linklocal */
 /*   0 -> 16 bytes from packet  */
 /*   1 -> 2 bytes from prefix - bunch of zeroes and 8 from packet */
@@ -394,6 +438,78 @@ addr_context_lookup_by_number(uint8_t number)
   return NULL;
 }
 /*--------------------------------------------------------------------*/
+#if SICSLOWPAN_IPHC_CACHE_SIZE > 0
+/** \brief Check if the packet in uip_buf belongs to a cached flow */
+static int
+iphc_cache_match(struct iphc_cache_entry *e, const linkaddr_t *link_destaddr)
+{
+  return e->used &&
+    uip_ipaddr_cmp(&e->destipaddr, &UIP_IP_BUF->destipaddr) &&
+    uip_ipaddr_cmp(&e->srcipaddr, &UIP_IP_BUF->srcipaddr) &&
+    memcmp(e->tcflow, &UIP_IP_BUF->vtc, 4) == 0 &&
+    e->proto == UIP_IP_BUF->proto &&
+    e->ttl == UIP_IP_BUF->ttl &&
+    linkaddr_cmp(&e->link_destaddr, link_destaddr) &&
+    (UIP_IP_BUF->proto != UIP_PROTO_UDP ||
+     memcmp(e->ports, &UIP_UDP_BUF->srcport, 4) == 0);
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Write the compressed header of a cached flow to packetbuf
+ * \return 1 if the packet matched a cached flow, 0 otherwise
+ */
+static int
+iphc_cache_apply(const linkaddr_t *link_destaddr)
+{
+  struct iphc_cache_entry *e;
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_IPHC_CACHE_SIZE; i++) {
+    e = &iphc_cache[i];
+    if(iphc_cache_match(e, link_destaddr)) {
+      memcpy(packetbuf_ptr, e->hdr, e->hdr_len);
+      /* The UDP checksum is the only field that varies within a flow */
+      if(e->chksum_offset > 0) {
+        memcpy(packetbuf_ptr + e->chksum_offset, &UIP_UDP_BUF->udpchksum, 2);
+      }
+      packetbuf_hdr_len = e->hdr_len;
+      uncomp_hdr_len = e->uncomp_hdr_len;
+      return 1;
+    }
+  }
+  return 0;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Remember the header just compressed to packetbuf */
+static void
+iphc_cache_store(const linkaddr_t *link_destaddr, uint8_t chksum_offset)
+{
+  struct iphc_cache_entry *e;
+
+  if(packetbuf_hdr_len > IPHC_CACHE_MAX_HDR_LEN) {
+    return;
+  }
+
+  e = &iphc_cache[iphc_cache_next];
+  iphc_cache_next = (iphc_cache_next + 1) % SICSLOWPAN_IPHC_CACHE_SIZE;
+
+  uip_ipaddr_copy(&e->destipaddr, &UIP_IP_BUF->destipaddr);
+  uip_ipaddr_copy(&e->srcipaddr, &UIP_IP_BUF->srcipaddr);
+  linkaddr_copy(&e->link_destaddr, link_destaddr);
+  memcpy(e->tcflow, &UIP_IP_BUF->vtc, 4);
+  e->proto = UIP_IP_BUF->proto;
+  e->ttl = UIP_IP_BUF->ttl;
+  if(UIP_IP_BUF->proto == UIP_PROTO_UDP) {
+    memcpy(e->ports, &UIP_UDP_BUF->srcport, 4);
+  }
+  e->hdr_len = packetbuf_hdr_len;
+  e->uncomp_hdr_len = uncomp_hdr_len;
+  e->chksum_offset = chksum_offset;
+  memcpy(e->hdr, packetbuf_ptr, packetbuf_hdr_len);
+  e->used = 1;
+}
+#endif /* SICSLOWPAN_IPHC_CACHE_SIZE > 0 */
+/*--------------------------------------------------------------------*/
 static uint8_t
 compress_addr_64(uint8_t bitpos, uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr)
 {
@@ -493,6 +609,10 @@ static void
 compress_hdr_hc06(linkaddr_t *link_destaddr)
 {
   uint8_t tmp, iphc0, iphc1;
+  struct sicslowpan_addr_context *src_context, *dest_context;
+#if SICSLOWPAN_IPHC_CACHE_SIZE > 0
+  uint8_t chksum_offset = 0;
+#endif /* SICSLOWPAN_IPHC_CACHE_SIZE > 0 */
 #if DEBUG
   { uint16_t ndx;
     PRINTF("before compression (%d): ", UIP_IP_BUF->len[1]);
@@ -504,6 +624,12 @@ compress_hdr_hc06(linkaddr_t *link_destaddr)
   }
 #endif
 
+#if SICSLOWPAN_IPHC_CACHE_SIZE > 0
+  if(iphc_cache_apply(link_destaddr)) {
+    return;
+  }
+#endif /* SICSLOWPAN_IPHC_CACHE_SIZE > 0 */
+
   hc06_ptr = packetbuf_ptr + 2;
   /*
    * As we copy some bit-length fields, in the IPHC encoding bytes,
@@ -524,10 +650,9 @@ compress_hdr_hc06(linkaddr_t *link_destaddr)
 
 
   /* check if dest context exists (for allocating third byte) */
-  /* TODO: fix this so that it remembers the looked up values for
-     avoiding two lookups - or set the lookup values immediately */
-  if(addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr) != NULL ||
-     addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr) != NULL) {
+  dest_context = addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr);
+  src_context = addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr);
+  if(dest_context != NULL || src_context != NULL) {
     /* set context flag and increase hc06_ptr */
     PRINTF("IPHC: compressing dest or src ipaddr - setting CID\n");
     iphc1 |= SICSLOWPAN_IPHC_CID;
@@ -623,8 +748,7 @@ compress_hdr_hc06(linkaddr_t *link_destaddr)
     PRINTF("IPHC: compressing unspecified - setting SAC\n");
     iphc1 |= SICSLOWPAN_IPHC_SAC;
     iphc1 |= SICSLOWPAN_IPHC_SAM_00;
-  } else if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr))
-     != NULL) {
+  } else if((context = src_context) != NULL) {
     /* elide the prefix - indicate by CID and set context + SAC */
     PRINTF("IPHC: compressing src with context - setting CID & SAC ctx: %d\n",
 	   context->number);
@@ -677,7 +801,7 @@ compress_hdr_hc06(linkaddr_t *link_destaddr)
     }
   } else {
     /* Address is unicast, try to compress */
-    if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr)) != NULL) {
+    if((context = dest_context) != NULL) {
       /* elide the prefix */
       iphc1 |= SICSLOWPAN_IPHC_DAC;
       PACKETBUF_IPHC_BUF[2] |= context->number;
@@ -746,6 +870,9 @@ compress_hdr_hc06(linkaddr_t *link_destaddr)
     }
     /* always inline the checksum  */
     if(1) {
+#if SICSLOWPAN_IPHC_CACHE_SIZE > 0
+      chksum_offset = hc06_ptr - packetbuf_ptr;
+#endif /* SICSLOWPAN_IPHC_CACHE_SIZE > 0 */
       memcpy(hc06_ptr, &UIP_UDP_BUF->udpchksum, 2);
       hc06_ptr += 2;
     }
@@ -763,6 +890,10 @@ compress_hdr_hc06(linkaddr_t *link_destaddr)
   PACKETBUF_IPHC_BUF[1] = iphc1;
 
   packetbuf_hdr_len = hc06_ptr - packetbuf_ptr;
+
+#if SICSLOWPAN_IPHC_CACHE_SIZE > 0
+  iphc_cache_store(link_destaddr, chksum_offset);
+#endif /* SICSLOWPAN_IPHC_CACHE_SIZE > 0 */
   return;
 }
 
@@ -1309,6 +1440,8 @@ compress_hdr_ipv6(linkaddr_t *link_destaddr)
 static void
 packet_sent(void *ptr, int status, int transmissions)
 {
+  link_stats_packet_sent(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), status,
+                         transmissions);
   uip_ds6_link_neighbor_callback(status, transmissions);
 
   if(callback != NULL) {
@@ -1612,6 +1745,7 @@ input(void)
   /* Save the RSSI of the incoming packet in case the upper layer will
      want to query us for it later. */
   last_rssi = (signed short)packetbuf_attr(PACKETBUF_ATTR_RSSI);
+  link_stats_input_callback(packetbuf_addr(PACKETBUF_ADDR_SENDER));
 #if SICSLOWPAN_CONF_FRAG
   /* if reassembly timed out, cancel it */
   if(timer_expired(&reass_timer)) {
@@ -1855,6 +1989,34 @@ input(void)
 }
 /** @} */
 
+#if ENERGEST_SUBSYSTEMS
+/*--------------------------------------------------------------------*/
+/* Charge the adaptation layer with the time spent in input and output */
+static uint8_t
+profiled_output(const uip_lladdr_t *localdest)
+{
+  uint8_t ret;
+
+  ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_SICSLOWPAN);
+  ret = output(localdest);
+  ENERGEST_SUBSYSTEM_LEAVE();
+  return ret;
+}
+/*--------------------------------------------------------------------*/
+static void
+profiled_input(void)
+{
+  ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_SICSLOWPAN);
+  input();
+  ENERGEST_SUBSYSTEM_LEAVE();
+}
+#define SICSLOWPAN_OUTPUT profiled_output
+#define SICSLOWPAN_INPUT  profiled_input
+#else /* ENERGEST_SUBSYSTEMS */
+#define SICSLOWPAN_OUTPUT output
+#define SICSLOWPAN_INPUT  input
+#endif /* ENERGEST_SUBSYSTEMS */
+
 /*--------------------------------------------------------------------*/
 /* \brief 6lowpan init function (called by the MAC layer)             */
 /*--------------------------------------------------------------------*/
@@ -1865,7 +2027,9 @@ sicslowpan_init(void)
    * Set out output function as the function to be called from uIP to
    * send a packet.
    */
-  tcpip_set_outputfunc(output);
+  tcpip_set_outputfunc(SICSLOWPAN_OUTPUT);
+
+  link_stats_init();
 
 #if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
 /* Preinitialize any address contexts for better header compression
@@ -1922,7 +2086,7 @@ sicslowpan_get_last_rssi(void)
 const struct network_driver sicslowpan_driver = {
   "sicslowpan",
   sicslowpan_init,
-  input
+  SICSLOWPAN_INPUT
 };
 /*--------------------------------------------------------------------*/
 /** @} */
@@ -42,6 +42,7 @@
 #include "net/ip/uip.h"
 
 #include "lib/list.h"
+#include "lib/dlist.h"
 #include "lib/memb.h"
 #include "net/nbr-table.h"
 
@@ -58,7 +59,7 @@ MEMB(neighborroutememb, struct uip_ds6_route_neighbor_route, UIP_DS6_ROUTE_NB);
 /* Each route is repressented by a uip_ds6_route_t structure and
    memory for each route is allocated from the routememb memory
    block. These routes are maintained on the routelist. */
-LIST(routelist);
+DLIST(routelist);
 MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
 
 /* Default routes are held on the defaultrouterlist and their
@@ -72,6 +73,21 @@ LIST(notificationlist);
 
 static int num_routes = 0;
 
+#if UIP_DS6_NEXTHOP_CACHE_NB
+/* The next-hop cache maps recently used destination addresses to the
+   neighbor they were last sent to. Entries are replaced round-robin
+   and the whole cache is flushed whenever the routing table, the
+   default router list, the prefix list or the neighbor cache changes
+   in a way that could alter the outcome of next-hop determination. */
+struct nexthop_cache_entry {
+  uip_ipaddr_t ipaddr;
+  uip_ds6_route_t *route;
+  uip_ds6_nbr_t *nbr;
+};
+static struct nexthop_cache_entry nexthop_cache[UIP_DS6_NEXTHOP_CACHE_NB];
+static uint8_t nexthop_cache_next;
+#endif /* UIP_DS6_NEXTHOP_CACHE_NB */
+
 #undef DEBUG
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
@@ -147,7 +163,7 @@ void
 uip_ds6_route_init(void)
 {
   memb_init(&routememb);
-  list_init(routelist);
+  dlist_init(routelist);
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 
@@ -157,6 +173,8 @@ uip_ds6_route_init(void)
 #if UIP_DS6_NOTIFICATIONS
   list_init(notificationlist);
 #endif
+
+  uip_ds6_nexthop_cache_flush();
 }
 /*---------------------------------------------------------------------------*/
 static uip_lladdr_t *
@@ -183,7 +201,7 @@ uip_ds6_route_nexthop(uip_ds6_route_t *route)
 uip_ds6_route_t *
 uip_ds6_route_head(void)
 {
-  return list_head(routelist);
+  return dlist_head(routelist);
 }
 /*---------------------------------------------------------------------------*/
 uip_ds6_route_t *
@@ -240,14 +258,14 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     PRINTF("uip-ds6-route: No route found\n");
   }
 
-  if(found_route != NULL && found_route != list_head(routelist)) {
+  if(found_route != NULL && found_route != dlist_head(routelist)) {
     /* If we found a route, we put it at the start of the routeslist
        list. The list is ordered by how recently we looked them up:
        the least recently used route will be at the end of the
        list - for fast lookups (assuming multiple packets to the same node). */
 
-    list_remove(routelist, found_route);
-    list_push(routelist, found_route);
+    dlist_remove(routelist, found_route);
+    dlist_push(routelist, found_route);
   }
 
   return found_route;
@@ -301,7 +319,7 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
          least recently used route is the first route on the list. */
       uip_ds6_route_t *oldest;
 
-      oldest = list_tail(routelist); /* uip_ds6_route_head(); */
+      oldest = dlist_tail(routelist); /* uip_ds6_route_head(); */
       PRINTF("uip_ds6_route_add: dropping route to ");
       PRINT6ADDR(&oldest->ipaddr);
       PRINTF("\n");
@@ -349,13 +367,15 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
     /* add new routes first - assuming that there is a reason to add this
        and that there is a packet coming soon. */
-    list_push(routelist, r);
+    dlist_init_item(r);
+    dlist_push(routelist, r);
 
     nbrr = memb_alloc(&neighborroutememb);
     if(nbrr == NULL) {
       /* This should not happen, as we explicitly deallocated one
          route table entry above. */
       PRINTF("uip_ds6_route_add: could not allocate neighbor route list entry\n");
+      dlist_remove(routelist, r);
       memb_free(&routememb, r);
       return NULL;
     }
@@ -375,6 +395,10 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
 
+  /* A new, possibly more specific, route may now cover destinations
+     that were cached as going through the default route. */
+  uip_ds6_nexthop_cache_flush();
+
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
 #endif
@@ -411,7 +435,8 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
     PRINTF("\n");
 
     /* Remove the route from the route list */
-    list_remove(routelist, route);
+    dlist_remove(routelist, route);
+    uip_ds6_nexthop_cache_flush();
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -430,9 +455,6 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
       PRINTF("uip_ds6_route_rm: removing neighbor too\n");
       nbr_table_remove(nbr_routes, route->neighbor_routes->route_list);
     }
-    memb_free(&routememb, route);
-    memb_free(&neighborroutememb, neighbor_route);
-
     num_routes--;
 
     PRINTF("uip_ds6_route_rm num %d\n", num_routes);
@@ -460,6 +482,8 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
     }
     ANNOTATE("#L %u 0\n", uip_ds6_route_nexthop(route)->u8[sizeof(uip_ipaddr_t) - 1]);
 #endif
+    memb_free(&routememb, route);
+    memb_free(&neighborroutememb, neighbor_route);
   }
 
 #if DEBUG != DEBUG_NONE
@@ -508,6 +532,59 @@ uip_ds6_route_rm_by_nexthop(uip_ipaddr_t *nexthop)
   rm_routelist(routes);
 }
 /*---------------------------------------------------------------------------*/
+#if UIP_DS6_NEXTHOP_CACHE_NB
+uip_ds6_nbr_t *
+uip_ds6_nexthop_cache_lookup(const uip_ipaddr_t *destipaddr)
+{
+  struct nexthop_cache_entry *e;
+
+  for(e = nexthop_cache; e < &nexthop_cache[UIP_DS6_NEXTHOP_CACHE_NB]; e++) {
+    if(e->nbr != NULL && uip_ipaddr_cmp(&e->ipaddr, destipaddr)) {
+      /* Only reachable neighbors may bypass neighbor unreachability
+         detection in tcpip_ipv6_output(). */
+      if(e->nbr->state != NBR_REACHABLE) {
+        return NULL;
+      }
+      /* Keep the route list in least recently used order, as
+         uip_ds6_route_lookup() would have done. */
+      if(e->route != NULL && e->route != dlist_head(routelist)) {
+        dlist_remove(routelist, e->route);
+        dlist_push(routelist, e->route);
+      }
+      return e->nbr;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_nexthop_cache_add(const uip_ipaddr_t *destipaddr,
+                          uip_ds6_route_t *route, uip_ds6_nbr_t *nbr)
+{
+  struct nexthop_cache_entry *e;
+
+  for(e = nexthop_cache; e < &nexthop_cache[UIP_DS6_NEXTHOP_CACHE_NB]; e++) {
+    if(e->nbr != NULL && uip_ipaddr_cmp(&e->ipaddr, destipaddr)) {
+      break;
+    }
+  }
+  if(e == &nexthop_cache[UIP_DS6_NEXTHOP_CACHE_NB]) {
+    e = &nexthop_cache[nexthop_cache_next];
+    nexthop_cache_next = (nexthop_cache_next + 1) % UIP_DS6_NEXTHOP_CACHE_NB;
+  }
+  uip_ipaddr_copy(&e->ipaddr, destipaddr);
+  e->route = route;
+  e->nbr = nbr;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_nexthop_cache_flush(void)
+{
+  memset(nexthop_cache, 0, sizeof(nexthop_cache));
+  nexthop_cache_next = 0;
+}
+#endif /* UIP_DS6_NEXTHOP_CACHE_NB */
+/*---------------------------------------------------------------------------*/
 uip_ds6_defrt_t *
 uip_ds6_defrt_add(uip_ipaddr_t *ipaddr, unsigned long interval)
 {
@@ -533,6 +610,7 @@ uip_ds6_defrt_add(uip_ipaddr_t *ipaddr, unsigned long interval)
     }
 
     list_push(defaultrouterlist, d);
+    uip_ds6_nexthop_cache_flush();
   }
 
   uip_ipaddr_copy(&d->ipaddr, ipaddr);
@@ -572,12 +650,13 @@ uip_ds6_defrt_rm(uip_ds6_defrt_t *defrt)
     if(d == defrt) {
       PRINTF("Removing default route\n");
       list_remove(defaultrouterlist, defrt);
-      memb_free(&defaultroutermemb, defrt);
+      uip_ds6_nexthop_cache_flush();
       ANNOTATE("#L %u 0\n", defrt->ipaddr.u8[sizeof(uip_ipaddr_t) - 1]);
 #if UIP_DS6_NOTIFICATIONS
       call_route_callback(UIP_DS6_NOTIFICATION_DEFRT_RM,
 			  &defrt->ipaddr, &defrt->ipaddr);
 #endif
+      memb_free(&defaultroutermemb, defrt);
       return;
     }
   }
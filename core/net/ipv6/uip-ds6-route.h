@@ -88,6 +88,18 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB UIP_CONF_MAX_ROUTES
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/* Next-hop cache. Holds the last few destinations that were resolved
+   to a reachable neighbor by tcpip_ipv6_output(), so that forwarded
+   packets to the same destination skip the route and neighbor table
+   scans. Set to 0 to disable. */
+#ifdef UIP_CONF_DS6_NEXTHOP_CACHE_NB
+#define UIP_DS6_NEXTHOP_CACHE_NB UIP_CONF_DS6_NEXTHOP_CACHE_NB
+#elif UIP_CONF_ROUTER
+#define UIP_DS6_NEXTHOP_CACHE_NB 4
+#else /* UIP_CONF_DS6_NEXTHOP_CACHE_NB */
+#define UIP_DS6_NEXTHOP_CACHE_NB 0
+#endif /* UIP_CONF_DS6_NEXTHOP_CACHE_NB */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -110,6 +122,7 @@ struct uip_ds6_route_neighbor_routes {
 /** \brief An entry in the routing table */
 typedef struct uip_ds6_route {
   struct uip_ds6_route *next;
+  struct uip_ds6_route *prev;
   /* Each route entry belongs to a specific neighbor. That neighbor
      holds a list of all routing entries that go through it. The
      routes field point to the uip_ds6_route_neighbor_routes that
@@ -165,5 +178,19 @@ uip_ds6_route_t *uip_ds6_route_next(uip_ds6_route_t *);
 
 /** @} */
 
+/** \name Next-hop cache basic routines */
+/** @{ */
+#if UIP_DS6_NEXTHOP_CACHE_NB
+struct uip_ds6_nbr;
+struct uip_ds6_nbr *uip_ds6_nexthop_cache_lookup(const uip_ipaddr_t *destipaddr);
+void uip_ds6_nexthop_cache_add(const uip_ipaddr_t *destipaddr,
+                               uip_ds6_route_t *route,
+                               struct uip_ds6_nbr *nbr);
+void uip_ds6_nexthop_cache_flush(void);
+#else /* UIP_DS6_NEXTHOP_CACHE_NB */
+#define uip_ds6_nexthop_cache_flush()
+#endif /* UIP_DS6_NEXTHOP_CACHE_NB */
+/** @} */
+
 #endif /* UIP_DS6_ROUTE_H */
 /** @} */
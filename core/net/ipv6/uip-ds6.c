@@ -240,6 +240,7 @@ uip_ds6_prefix_add(uip_ipaddr_t *ipaddr, uint8_t ipaddrlen,
     locprefix->isused = 1;
     uip_ipaddr_copy(&locprefix->ipaddr, ipaddr);
     locprefix->length = ipaddrlen;
+    uip_ds6_nexthop_cache_flush();
     locprefix->advertise = advertise;
     locprefix->l_a_reserved = flags;
     locprefix->vlifetime = vtime;
@@ -268,6 +269,7 @@ uip_ds6_prefix_add(uip_ipaddr_t *ipaddr, uint8_t ipaddrlen,
     locprefix->isused = 1;
     uip_ipaddr_copy(&locprefix->ipaddr, ipaddr);
     locprefix->length = ipaddrlen;
+    uip_ds6_nexthop_cache_flush();
     if(interval != 0) {
       stimer_set(&(locprefix->vlifetime), interval);
       locprefix->isinfinite = 0;
@@ -289,6 +291,7 @@ uip_ds6_prefix_rm(uip_ds6_prefix_t *prefix)
 {
   if(prefix != NULL) {
     prefix->isused = 0;
+    uip_ds6_nexthop_cache_flush();
   }
   return;
 }
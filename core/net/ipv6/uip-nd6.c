@@ -141,6 +141,16 @@ extract_lladdr_aligned(uip_lladdr_t *dest) {
     memcpy(dest, &nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET], UIP_LLADDR_LEN);
   }
 }
+/*------------------------------------------------------------------*/
+/* Set the link-layer address of a neighbor to the one in the llao */
+static void
+update_lladdr(uip_ds6_nbr_t *nbr)
+{
+  uip_lladdr_t lladdr_aligned;
+
+  extract_lladdr_aligned(&lladdr_aligned);
+  nbr_table_update_lladdr(ds6_neighbors, nbr, (linkaddr_t *)&lladdr_aligned);
+}
 #endif /* UIP_ND6_SEND_NA || UIP_ND6_SEND_RA || !UIP_CONF_ROUTER */
 /*------------------------------------------------------------------*/
 /* create a llao */ 
@@ -208,11 +218,12 @@ ns_input(void)
           uip_lladdr_t *lladdr = (uip_lladdr_t *)uip_ds6_nbr_get_ll(nbr);
           if(memcmp(&nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
               lladdr, UIP_LLADDR_LEN) != 0) {
-            memcpy(lladdr, &nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET], UIP_LLADDR_LEN);
+            update_lladdr(nbr);
             nbr->state = NBR_STALE;
           } else {
             if(nbr->state == NBR_INCOMPLETE) {
               nbr->state = NBR_STALE;
+              uip_ds6_nexthop_cache_flush();
             }
           }
         }
@@ -504,8 +515,9 @@ na_input(void)
       if(nd6_opt_llao == NULL) {
         goto discard;
       }
-      memcpy(lladdr, &nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
-	     UIP_LLADDR_LEN);
+      update_lladdr(nbr);
+      /* A resolved neighbor may now be preferred as default router. */
+      uip_ds6_nexthop_cache_flush();
       if(is_solicited) {
         nbr->state = NBR_REACHABLE;
         nbr->nscount = 0;
@@ -527,8 +539,7 @@ na_input(void)
         if(is_override || (!is_override && nd6_opt_llao != 0 && !is_llchange)
            || nd6_opt_llao == 0) {
           if(nd6_opt_llao != 0) {
-            memcpy(lladdr, &nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
-		   UIP_LLADDR_LEN);
+            update_lladdr(nbr);
           }
           if(is_solicited) {
             nbr->state = NBR_REACHABLE;
@@ -875,11 +886,11 @@ ra_input(void)
         uip_lladdr_t *lladdr = (uip_lladdr_t *)uip_ds6_nbr_get_ll(nbr);
         if(nbr->state == NBR_INCOMPLETE) {
           nbr->state = NBR_STALE;
+          uip_ds6_nexthop_cache_flush();
         }
         if(memcmp(&nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
 		  lladdr, UIP_LLADDR_LEN) != 0) {
-          memcpy(lladdr, &nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
-		 UIP_LLADDR_LEN);
+          update_lladdr(nbr);
           nbr->state = NBR_STALE;
         }
         nbr->isrouter = 1;
@@ -898,6 +898,13 @@ ext_hdr_options_process(void)
 #endif /* UIP_CONF_IPV6_RPL */
         uip_ext_opt_offset += (UIP_EXT_HDR_OPT_BUF->len) + 2;
         return 0;
+#if UIP_CONF_IPV6_MPL
+      case UIP_EXT_HDR_OPT_MPL:
+        /* Parsed by the MPL multicast engine, skip it here */
+        PRINTF("Processing MPL option\n");
+        uip_ext_opt_offset += (UIP_EXT_HDR_OPT_BUF->len) + 2;
+        break;
+#endif /* UIP_CONF_IPV6_MPL */
       default:
         /*
          * check the two highest order bits of the option
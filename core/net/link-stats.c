@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Per-neighbor link statistics
+ */
+
+#include "contiki.h"
+#include "net/link-stats.h"
+#include "net/nbr-table.h"
+#include "net/packetbuf.h"
+#include "net/mac/mac.h"
+#include "sys/cc.h"
+#include "sys/ctimer.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/* Weight of the previous ETX in the moving average, in percent */
+#ifdef LINK_STATS_CONF_ETX_ALPHA
+#define ETX_ALPHA LINK_STATS_CONF_ETX_ALPHA
+#else /* LINK_STATS_CONF_ETX_ALPHA */
+#define ETX_ALPHA 90
+#endif /* LINK_STATS_CONF_ETX_ALPHA */
+
+/* Weight of the previous RSSI in the moving average, in percent */
+#ifdef LINK_STATS_CONF_RSSI_ALPHA
+#define RSSI_ALPHA LINK_STATS_CONF_RSSI_ALPHA
+#else /* LINK_STATS_CONF_RSSI_ALPHA */
+#define RSSI_ALPHA 50
+#endif /* LINK_STATS_CONF_RSSI_ALPHA */
+
+/* ETX recorded for a packet that was never acknowledged */
+#define ETX_NOACK_PENALTY 10
+
+/* Number of recent transmissions needed for the ETX to be fresh */
+#ifdef LINK_STATS_CONF_FRESHNESS_TARGET
+#define FRESHNESS_TARGET LINK_STATS_CONF_FRESHNESS_TARGET
+#else /* LINK_STATS_CONF_FRESHNESS_TARGET */
+#define FRESHNESS_TARGET 4
+#endif /* LINK_STATS_CONF_FRESHNESS_TARGET */
+
+/* Freshness is halved this often, so that old transmissions count less */
+#ifdef LINK_STATS_CONF_FRESHNESS_HALF_LIFE
+#define FRESHNESS_HALF_LIFE LINK_STATS_CONF_FRESHNESS_HALF_LIFE
+#else /* LINK_STATS_CONF_FRESHNESS_HALF_LIFE */
+#define FRESHNESS_HALF_LIFE (20 * 60 * CLOCK_SECOND)
+#endif /* LINK_STATS_CONF_FRESHNESS_HALF_LIFE */
+
+/* A link is never fresh without a transmission for this long */
+#ifdef LINK_STATS_CONF_FRESHNESS_EXPIRATION_TIME
+#define FRESHNESS_EXPIRATION_TIME LINK_STATS_CONF_FRESHNESS_EXPIRATION_TIME
+#else /* LINK_STATS_CONF_FRESHNESS_EXPIRATION_TIME */
+#define FRESHNESS_EXPIRATION_TIME (10 * 60 * CLOCK_SECOND)
+#endif /* LINK_STATS_CONF_FRESHNESS_EXPIRATION_TIME */
+
+#define FRESHNESS_MAX 16
+
+NBR_TABLE(struct link_stats, link_stats);
+
+static struct ctimer periodic_timer;
+/*---------------------------------------------------------------------------*/
+static struct link_stats *
+get_or_add(const linkaddr_t *lladdr)
+{
+  struct link_stats *stats;
+
+  stats = nbr_table_get_from_lladdr(link_stats, lladdr);
+  if(stats == NULL) {
+    stats = nbr_table_add_lladdr(link_stats, lladdr);
+    if(stats != NULL) {
+      stats->etx = LINK_STATS_INIT_ETX;
+      stats->rssi = LINK_STATS_RSSI_UNKNOWN;
+    }
+  }
+  return stats;
+}
+/*---------------------------------------------------------------------------*/
+const struct link_stats *
+link_stats_from_lladdr(const linkaddr_t *lladdr)
+{
+  return nbr_table_get_from_lladdr(link_stats, lladdr);
+}
+/*---------------------------------------------------------------------------*/
+int
+link_stats_lock(const linkaddr_t *lladdr)
+{
+  struct link_stats *stats;
+
+  stats = get_or_add(lladdr);
+  return stats != NULL && nbr_table_lock(link_stats, stats);
+}
+/*---------------------------------------------------------------------------*/
+void
+link_stats_unlock(const linkaddr_t *lladdr)
+{
+  struct link_stats *stats;
+
+  stats = nbr_table_get_from_lladdr(link_stats, lladdr);
+  if(stats != NULL) {
+    nbr_table_unlock(link_stats, stats);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+link_stats_is_fresh(const struct link_stats *stats)
+{
+  return stats != NULL
+    && clock_time() - stats->last_tx_time < FRESHNESS_EXPIRATION_TIME
+    && stats->freshness >= FRESHNESS_TARGET;
+}
+/*---------------------------------------------------------------------------*/
+void
+link_stats_packet_sent(const linkaddr_t *lladdr, int status, int numtx)
+{
+  struct link_stats *stats;
+  uint16_t packet_etx;
+
+  if(status != MAC_TX_OK && status != MAC_TX_NOACK) {
+    /* Collisions and errors tell nothing about the link quality */
+    return;
+  }
+  if(linkaddr_cmp(lladdr, &linkaddr_null)) {
+    return;
+  }
+
+  stats = get_or_add(lladdr);
+  if(stats == NULL) {
+    return;
+  }
+  nbr_table_touch(link_stats, stats);
+
+  if(status == MAC_TX_OK) {
+    packet_etx = numtx * LINK_STATS_ETX_DIVISOR;
+    stats->ack_count++;
+  } else {
+    packet_etx = ETX_NOACK_PENALTY * LINK_STATS_ETX_DIVISOR;
+  }
+
+  if(stats->tx_count == 0) {
+    /* The first measurement replaces the initial guess */
+    stats->etx = packet_etx;
+  } else {
+    stats->etx = ((uint32_t)stats->etx * ETX_ALPHA +
+                  (uint32_t)packet_etx * (100 - ETX_ALPHA)) / 100;
+  }
+  stats->tx_count++;
+  stats->last_tx_time = clock_time();
+  stats->freshness = MIN(stats->freshness + numtx, FRESHNESS_MAX);
+
+  PRINTF("link-stats: %u etx %u.%02u after %u tx (status %d)\n",
+         lladdr->u8[LINKADDR_SIZE - 1],
+         stats->etx / LINK_STATS_ETX_DIVISOR,
+         (stats->etx % LINK_STATS_ETX_DIVISOR) * 100 / LINK_STATS_ETX_DIVISOR,
+         numtx, status);
+}
+/*---------------------------------------------------------------------------*/
+void
+link_stats_input_callback(const linkaddr_t *lladdr)
+{
+  struct link_stats *stats;
+  int16_t packet_rssi;
+
+  stats = nbr_table_get_from_lladdr(link_stats, lladdr);
+  if(stats == NULL) {
+    return;
+  }
+  nbr_table_touch(link_stats, stats);
+
+  packet_rssi = (int16_t)packetbuf_attr(PACKETBUF_ATTR_RSSI);
+  if(stats->rssi == LINK_STATS_RSSI_UNKNOWN) {
+    stats->rssi = packet_rssi;
+  } else {
+    stats->rssi = ((int32_t)stats->rssi * RSSI_ALPHA +
+                   (int32_t)packet_rssi * (100 - RSSI_ALPHA)) / 100;
+  }
+  stats->last_rx_time = clock_time();
+}
+/*---------------------------------------------------------------------------*/
+static void
+periodic(void *ptr)
+{
+  struct link_stats *stats;
+
+  for(stats = nbr_table_head(link_stats); stats != NULL;
+      stats = nbr_table_next(link_stats, stats)) {
+    stats->freshness >>= 1;
+  }
+  ctimer_reset(&periodic_timer);
+}
+/*---------------------------------------------------------------------------*/
+void
+link_stats_init(void)
+{
+  nbr_table_register(link_stats, NULL);
+  ctimer_set(&periodic_timer, FRESHNESS_HALF_LIFE, periodic, NULL);
+}
+/*---------------------------------------------------------------------------*/
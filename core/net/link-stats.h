@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Per-neighbor link statistics: ETX and RSSI moving averages,
+ *         transmission and acknowledgement counts, and a freshness
+ *         indicator telling how up-to-date the statistics are.
+ *
+ *         The statistics are updated from the MAC layer's sent callback
+ *         and from received packets, and are shared by all their users
+ *         (e.g. RPL objective functions, probing, and neighbor eviction).
+ *         Entries are created when transmitting to a neighbor; received
+ *         packets only update existing entries, so that frames from
+ *         unknown nodes cannot push out neighbors from the table.
+ */
+
+#ifndef LINK_STATS_H_
+#define LINK_STATS_H_
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+
+/* ETX fixed point divisor */
+#define LINK_STATS_ETX_DIVISOR                   128
+
+/* ETX assumed for a neighbor before its first transmission completes */
+#ifdef LINK_STATS_CONF_INIT_ETX
+#define LINK_STATS_INIT_ETX                      LINK_STATS_CONF_INIT_ETX
+#else /* LINK_STATS_CONF_INIT_ETX */
+#define LINK_STATS_INIT_ETX                      (2 * LINK_STATS_ETX_DIVISOR)
+#endif /* LINK_STATS_CONF_INIT_ETX */
+
+/* Value of the rssi field until a packet has been received */
+#define LINK_STATS_RSSI_UNKNOWN                  0x7fff
+
+/* Link statistics of a neighbor */
+struct link_stats {
+  clock_time_t last_tx_time; /* Last transmission with a known outcome */
+  clock_time_t last_rx_time; /* Last reception */
+  uint16_t etx;              /* ETX, with LINK_STATS_ETX_DIVISOR as divisor */
+  int16_t rssi;              /* RSSI moving average */
+  uint16_t tx_count;         /* Unicast packets sent with a known outcome */
+  uint16_t ack_count;        /* Unicast packets acknowledged */
+  uint8_t freshness;         /* How up-to-date the ETX is */
+};
+
+/**
+ * \brief     Returns the link statistics of a neighbor
+ * \return    The statistics, or NULL if nothing was ever sent to the
+ *            neighbor
+ */
+const struct link_stats *link_stats_from_lladdr(const linkaddr_t *lladdr);
+
+/**
+ * \brief     Keeps the statistics of a neighbor, creating them if needed,
+ *            until link_stats_unlock() is called
+ * \return    Non-zero if the neighbor could be locked
+ */
+int link_stats_lock(const linkaddr_t *lladdr);
+
+/**
+ * \brief     Allows the statistics of a neighbor to be evicted again
+ */
+void link_stats_unlock(const linkaddr_t *lladdr);
+
+/**
+ * \brief     Tells whether the ETX of a link is based on enough recent
+ *            transmissions to be trusted
+ */
+int link_stats_is_fresh(const struct link_stats *stats);
+
+/**
+ * \brief     Updates the statistics after a unicast transmission
+ * \param lladdr The receiver, broadcasts are ignored
+ * \param status The MAC_TX_ status
+ * \param numtx The number of transmissions done by the MAC layer
+ */
+void link_stats_packet_sent(const linkaddr_t *lladdr, int status, int numtx);
+
+/**
+ * \brief     Updates the statistics after a packet has been received
+ * \param lladdr The sender of the packet, whose RSSI is read from the
+ *            packetbuf
+ */
+void link_stats_input_callback(const linkaddr_t *lladdr);
+
+/**
+ * \brief     Initializes the link statistics module
+ */
+void link_stats_init(void);
+
+#endif /* LINK_STATS_H_ */
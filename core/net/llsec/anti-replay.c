@@ -79,8 +79,46 @@ anti_replay_init_info(struct anti_replay_info *info)
   info->last_broadcast_counter
       = info->last_unicast_counter
       = anti_replay_get_counter();
+#if ANTI_REPLAY_WINDOW_SIZE
+  /* We cannot tell which frames sent before the first one we received
+     from this sender were already seen, so treat them all as replays. */
+  info->broadcast_window = info->unicast_window = 0xffffffff;
+#endif /* ANTI_REPLAY_WINDOW_SIZE */
 }
 /*---------------------------------------------------------------------------*/
+#if ANTI_REPLAY_WINDOW_SIZE
+static int
+was_replayed(uint32_t received_counter, uint32_t *last_counter, uint32_t *window)
+{
+  uint32_t diff;
+
+  if(received_counter > *last_counter) {
+    /* slide the window */
+    diff = received_counter - *last_counter;
+    *window = diff < ANTI_REPLAY_WINDOW_SIZE ? (*window << diff) | 1 : 1;
+    *last_counter = received_counter;
+    return 0;
+  }
+
+  diff = *last_counter - received_counter;
+  if(diff >= ANTI_REPLAY_WINDOW_SIZE || (*window & ((uint32_t)1 << diff))) {
+    return 1;
+  }
+  *window |= (uint32_t)1 << diff;
+  return 0;
+}
+#else /* ANTI_REPLAY_WINDOW_SIZE */
+static int
+was_replayed(uint32_t received_counter, uint32_t *last_counter)
+{
+  if(received_counter <= *last_counter) {
+    return 1;
+  }
+  *last_counter = received_counter;
+  return 0;
+}
+#endif /* ANTI_REPLAY_WINDOW_SIZE */
+/*---------------------------------------------------------------------------*/
 int
 anti_replay_was_replayed(struct anti_replay_info *info)
 {
@@ -90,20 +128,20 @@ anti_replay_was_replayed(struct anti_replay_info *info)
   
   if(packetbuf_holds_broadcast()) {
     /* broadcast */
-    if(received_counter <= info->last_broadcast_counter) {
-      return 1;
-    } else {
-      info->last_broadcast_counter = received_counter;
-      return 0;
-    }
+#if ANTI_REPLAY_WINDOW_SIZE
+    return was_replayed(received_counter,
+        &info->last_broadcast_counter, &info->broadcast_window);
+#else /* ANTI_REPLAY_WINDOW_SIZE */
+    return was_replayed(received_counter, &info->last_broadcast_counter);
+#endif /* ANTI_REPLAY_WINDOW_SIZE */
   } else {
     /* unicast */
-    if(received_counter <= info->last_unicast_counter) {
-      return 1;
-    } else {
-      info->last_unicast_counter = received_counter;
-      return 0;
-    }
+#if ANTI_REPLAY_WINDOW_SIZE
+    return was_replayed(received_counter,
+        &info->last_unicast_counter, &info->unicast_window);
+#else /* ANTI_REPLAY_WINDOW_SIZE */
+    return was_replayed(received_counter, &info->last_unicast_counter);
+#endif /* ANTI_REPLAY_WINDOW_SIZE */
   }
 }
 /*---------------------------------------------------------------------------*/
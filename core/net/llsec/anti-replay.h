@@ -47,9 +47,31 @@
 
 #include "contiki.h"
 
+/*
+ * Number of frame counters below the highest one seen that are still
+ * accepted if they were not received before. Frames are often
+ * reordered by CSMA retransmissions, and with a window of zero any
+ * frame that arrives after a newer one is dropped as a replay. Must
+ * not exceed 32.
+ */
+#ifdef ANTI_REPLAY_CONF_WINDOW_SIZE
+#define ANTI_REPLAY_WINDOW_SIZE ANTI_REPLAY_CONF_WINDOW_SIZE
+#else /* ANTI_REPLAY_CONF_WINDOW_SIZE */
+#define ANTI_REPLAY_WINDOW_SIZE 32
+#endif /* ANTI_REPLAY_CONF_WINDOW_SIZE */
+
+#if ANTI_REPLAY_WINDOW_SIZE > 32
+#error "ANTI_REPLAY_CONF_WINDOW_SIZE must not exceed 32"
+#endif
+
 struct anti_replay_info {
   uint32_t last_broadcast_counter;
   uint32_t last_unicast_counter;
+#if ANTI_REPLAY_WINDOW_SIZE
+  /* Bit n is set if last_*_counter - n was received */
+  uint32_t broadcast_window;
+  uint32_t unicast_window;
+#endif /* ANTI_REPLAY_WINDOW_SIZE */
 };
 
 /**
@@ -110,6 +110,8 @@ aead(uint8_t hdrlen, int forward)
   mic = a + totlen;
   result = forward ? mic : generated_mic;
   
+  /* the AES-128 key may have been changed by another user, such as DTLS */
+  CCM_STAR.set_key(key);
   CCM_STAR.aead(nonce,
       m, m_len,
       a, a_len,
@@ -120,7 +122,7 @@ aead(uint8_t hdrlen, int forward)
     packetbuf_set_datalen(packetbuf_datalen() + LLSEC802154_MIC_LENGTH);
     return 1;
   } else {
-    return (memcmp(generated_mic, mic, LLSEC802154_MIC_LENGTH) == 0);
+    return !ccm_star_mic_cmp(generated_mic, mic, LLSEC802154_MIC_LENGTH);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         802.15.4 security implementation, which uses pairwise keys
+ *         for unicast frames and a group key for broadcast frames
+ */
+
+/**
+ * \addtogroup pairwisesec
+ * @{
+ */
+
+#include "net/llsec/pairwisesec/pairwisesec.h"
+#include "net/llsec/anti-replay.h"
+#include "net/llsec/llsec802154.h"
+#include "net/llsec/ccm-star-packetbuf.h"
+#include "net/mac/frame802154.h"
+#include "net/mac/framer-802154.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/nbr-table.h"
+#include "net/linkaddr.h"
+#include "lib/aes-128.h"
+#include "lib/ccm-star.h"
+#include <string.h>
+
+#define WITH_ENCRYPTION (LLSEC802154_SECURITY_LEVEL & (1 << 2))
+
+/*
+ * Set to derive the keys of links that no key was installed for from
+ * PAIRWISESEC_CONF_MASTER_KEY. Every node then holds the master key,
+ * so capturing any node reveals the keys of all links.
+ */
+#ifdef PAIRWISESEC_CONF_DERIVE_KEYS
+#define PAIRWISESEC_DERIVE_KEYS PAIRWISESEC_CONF_DERIVE_KEYS
+#else /* PAIRWISESEC_CONF_DERIVE_KEYS */
+#define PAIRWISESEC_DERIVE_KEYS 0
+#endif /* PAIRWISESEC_CONF_DERIVE_KEYS */
+
+#if PAIRWISESEC_DERIVE_KEYS
+/* Key from which pairwise keys are derived */
+#ifdef PAIRWISESEC_CONF_MASTER_KEY
+#define PAIRWISESEC_MASTER_KEY PAIRWISESEC_CONF_MASTER_KEY
+#else /* PAIRWISESEC_CONF_MASTER_KEY */
+#define PAIRWISESEC_MASTER_KEY { 0x00 , 0x01 , 0x02 , 0x03 , \
+                                 0x04 , 0x05 , 0x06 , 0x07 , \
+                                 0x08 , 0x09 , 0x0A , 0x0B , \
+                                 0x0C , 0x0D , 0x0E , 0x0F }
+#endif /* PAIRWISESEC_CONF_MASTER_KEY */
+#endif /* PAIRWISESEC_DERIVE_KEYS */
+
+/* Key for broadcast frames */
+#ifdef PAIRWISESEC_CONF_GROUP_KEY
+#define PAIRWISESEC_GROUP_KEY PAIRWISESEC_CONF_GROUP_KEY
+#else /* PAIRWISESEC_CONF_GROUP_KEY */
+#define PAIRWISESEC_GROUP_KEY { 0x10 , 0x11 , 0x12 , 0x13 , \
+                                0x14 , 0x15 , 0x16 , 0x17 , \
+                                0x18 , 0x19 , 0x1A , 0x1B , \
+                                0x1C , 0x1D , 0x1E , 0x1F }
+#endif /* PAIRWISESEC_CONF_GROUP_KEY */
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else /* DEBUG */
+#define PRINTF(...)
+#endif /* DEBUG */
+
+/* Per-neighbor key and anti-replay information */
+struct pairwise_info {
+  uint8_t key[AES_128_KEY_LENGTH];
+  struct anti_replay_info anti_replay_info;
+  uint8_t has_key;
+  uint8_t has_anti_replay_info;
+};
+
+#if PAIRWISESEC_DERIVE_KEYS
+static const uint8_t master_key[AES_128_KEY_LENGTH] = PAIRWISESEC_MASTER_KEY;
+#endif /* PAIRWISESEC_DERIVE_KEYS */
+static const uint8_t group_key[AES_128_KEY_LENGTH] = PAIRWISESEC_GROUP_KEY;
+NBR_TABLE(struct pairwise_info, pairwise_table);
+
+/*---------------------------------------------------------------------------*/
+#if PAIRWISESEC_DERIVE_KEYS
+/*
+ * Derives the key shared with addr as AES(master key, lower address |
+ * higher address). Both ends thus derive the same key.
+ */
+static void
+derive_key(const linkaddr_t *addr, uint8_t *key)
+{
+  const linkaddr_t *first;
+  const linkaddr_t *second;
+
+  if(memcmp(&linkaddr_node_addr, addr, LINKADDR_SIZE) < 0) {
+    first = &linkaddr_node_addr;
+    second = addr;
+  } else {
+    first = addr;
+    second = &linkaddr_node_addr;
+  }
+
+  memset(key, 0, AES_128_KEY_LENGTH);
+  memcpy(key, first, LINKADDR_SIZE);
+  memcpy(key + (AES_128_KEY_LENGTH / 2), second, LINKADDR_SIZE);
+  AES_128.set_key(master_key);
+  AES_128.encrypt(key);
+}
+#endif /* PAIRWISESEC_DERIVE_KEYS */
+/*---------------------------------------------------------------------------*/
+/*
+ * Sets the key for a frame to or from addr, which may be a neighbor.
+ * Returns 0 if there is no key for a unicast frame.
+ */
+static int
+set_key(const linkaddr_t *addr, struct pairwise_info *info, int broadcast)
+{
+#if PAIRWISESEC_DERIVE_KEYS
+  uint8_t key[AES_128_KEY_LENGTH];
+#endif /* PAIRWISESEC_DERIVE_KEYS */
+
+  if(broadcast) {
+    CCM_STAR.set_key(group_key);
+  } else if(info != NULL && info->has_key) {
+    CCM_STAR.set_key(info->key);
+  } else {
+#if PAIRWISESEC_DERIVE_KEYS
+    derive_key(addr, key);
+    CCM_STAR.set_key(key);
+#else /* PAIRWISESEC_DERIVE_KEYS */
+    PRINTF("pairwisesec: no key for this link\n");
+    return 0;
+#endif /* PAIRWISESEC_DERIVE_KEYS */
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+aead(uint8_t hdrlen, int forward)
+{
+  uint8_t totlen;
+  uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+  uint8_t *m;
+  uint8_t m_len;
+  uint8_t *a;
+  uint8_t a_len;
+  uint8_t *result;
+  uint8_t generated_mic[LLSEC802154_MIC_LENGTH];
+  uint8_t *mic;
+  
+  ccm_star_packetbuf_set_nonce(nonce, forward);
+  totlen = packetbuf_totlen();
+  a = packetbuf_hdrptr();
+#if WITH_ENCRYPTION
+  a_len = hdrlen;
+  m = a + a_len;
+  m_len = totlen - hdrlen;
+#else /* WITH_ENCRYPTION */
+  a_len = totlen;
+  m = NULL;
+  m_len = 0;
+#endif /* WITH_ENCRYPTION */
+  
+  mic = a + totlen;
+  result = forward ? mic : generated_mic;
+  
+  CCM_STAR.aead(nonce,
+      m, m_len,
+      a, a_len,
+      result, LLSEC802154_MIC_LENGTH,
+      forward);
+  
+  if(forward) {
+    packetbuf_set_datalen(packetbuf_datalen() + LLSEC802154_MIC_LENGTH);
+    return 1;
+  } else {
+    return !ccm_star_mic_cmp(generated_mic, mic, LLSEC802154_MIC_LENGTH);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Gets the neighbor table entry of addr, adding and locking it if needed */
+static struct pairwise_info *
+add_info(const linkaddr_t *addr)
+{
+  struct pairwise_info *info;
+
+  info = nbr_table_get_from_lladdr(pairwise_table, addr);
+  if(info != NULL) {
+    return info;
+  }
+
+  info = nbr_table_add_lladdr(pairwise_table, addr);
+  if(info == NULL) {
+    PRINTF("pairwisesec: could not get nbr_table_item\n");
+    return NULL;
+  }
+
+  /*
+   * As in noncoresec, locking avoids replay attacks due to removed
+   * neighbor table items.
+   */
+  if(!nbr_table_lock(pairwise_table, info)) {
+    nbr_table_remove(pairwise_table, info);
+    PRINTF("pairwisesec: could not lock\n");
+    return NULL;
+  }
+
+#if PAIRWISESEC_DERIVE_KEYS
+  derive_key(addr, info->key);
+  info->has_key = 1;
+#else /* PAIRWISESEC_DERIVE_KEYS */
+  info->has_key = 0;
+#endif /* PAIRWISESEC_DERIVE_KEYS */
+  info->has_anti_replay_info = 0;
+  return info;
+}
+/*---------------------------------------------------------------------------*/
+int
+pairwisesec_set_key(const linkaddr_t *addr, const uint8_t *key)
+{
+  struct pairwise_info *info;
+
+  info = add_info(addr);
+  if(info == NULL) {
+    return 0;
+  }
+  memcpy(info->key, key, AES_128_KEY_LENGTH);
+  info->has_key = 1;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_security_header(void)
+{
+  if(!packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL)) {
+    packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_DATAFRAME);
+    packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, LLSEC802154_SECURITY_LEVEL);
+    anti_replay_set_counter();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send(mac_callback_t sent, void *ptr)
+{
+  NETSTACK_MAC.send(sent, ptr);
+}
+/*---------------------------------------------------------------------------*/
+static int
+create(void)
+{
+  const linkaddr_t *receiver;
+  int result;
+  
+  add_security_header();
+  result = framer_802154.create();
+  if(result == FRAMER_FAILED) {
+    return result;
+  }
+
+  receiver = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  if(!set_key(receiver,
+      nbr_table_get_from_lladdr(pairwise_table, receiver),
+      packetbuf_holds_broadcast())) {
+    return FRAMER_FAILED;
+  }
+  aead(result, 1);
+  
+  return result;
+}
+/*---------------------------------------------------------------------------*/
+static int
+parse(void)
+{
+  int result;
+  const linkaddr_t *sender;
+  struct pairwise_info *info;
+  
+  result = framer_802154.parse();
+  if(result == FRAMER_FAILED) {
+    return result;
+  }
+  
+  if(packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL) != LLSEC802154_SECURITY_LEVEL) {
+    PRINTF("pairwisesec: received frame with wrong security level\n");
+    return FRAMER_FAILED;
+  }
+  sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  if(linkaddr_cmp(sender, &linkaddr_node_addr)) {
+    PRINTF("pairwisesec: frame from ourselves\n");
+    return FRAMER_FAILED;
+  }
+  
+  packetbuf_set_datalen(packetbuf_datalen() - LLSEC802154_MIC_LENGTH);
+  
+  /* Only authentic frames may allocate neighbor table entries */
+  info = nbr_table_get_from_lladdr(pairwise_table, sender);
+  if(!set_key(sender, info, packetbuf_holds_broadcast())) {
+    return FRAMER_FAILED;
+  }
+  if(!aead(result, 0)) {
+    PRINTF("pairwisesec: received unauthentic frame %"PRIu32"\n",
+        anti_replay_get_counter());
+    return FRAMER_FAILED;
+  }
+  
+  if(info == NULL) {
+    info = add_info(sender);
+    if(info == NULL) {
+      return FRAMER_FAILED;
+    }
+  }
+  
+  if(!info->has_anti_replay_info) {
+    anti_replay_init_info(&info->anti_replay_info);
+    info->has_anti_replay_info = 1;
+  } else if(anti_replay_was_replayed(&info->anti_replay_info)) {
+    PRINTF("pairwisesec: received replayed frame %"PRIu32"\n",
+        anti_replay_get_counter());
+    return FRAMER_FAILED;
+  }
+  
+  return result;
+}
+/*---------------------------------------------------------------------------*/
+static void
+input(void)
+{
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+static int
+length(void)
+{
+  add_security_header();
+  return framer_802154.length() + LLSEC802154_MIC_LENGTH;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  nbr_table_register(pairwise_table, NULL);
+}
+/*---------------------------------------------------------------------------*/
+const struct llsec_driver pairwisesec_driver = {
+  "pairwisesec",
+  init,
+  send,
+  input
+};
+/*---------------------------------------------------------------------------*/
+const struct framer pairwisesec_framer = {
+  length,
+  create,
+  parse
+};
+/*---------------------------------------------------------------------------*/
+
+/** @} */
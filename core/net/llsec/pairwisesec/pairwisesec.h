@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         802.15.4 security implementation, which uses pairwise keys
+ *         for unicast frames and a group key for broadcast frames
+ */
+
+/**
+ * \addtogroup llsec
+ * @{
+ */
+
+/**
+ * \defgroup pairwisesec LLSEC driver using pairwise keys (PAIRWISESEC)
+ *
+ * Unicast frames are secured with a key that is specific to the pair
+ * of sender and receiver. The key of each link must be installed on
+ * both ends with pairwisesec_set_key(); unicast frames to or from a
+ * neighbor without a key are dropped. A node thus only holds the keys
+ * of its own links, and capturing it does not reveal the keys of
+ * other links. Broadcast frames use a group key, which every node
+ * holds.
+ *
+ * As an explicit opt-in, PAIRWISESEC_CONF_DERIVE_KEYS derives the
+ * keys of links without an installed key from a master key and both
+ * link-layer addresses. Every node then holds the master key, so
+ * capturing any node reveals the keys of all links: this only keeps
+ * a leaked pairwise key from exposing other links.
+ *
+ * Keys and anti-replay state are kept in a neighbor table. With the
+ * software AES driver, set AES_128_CONF_KEY_CACHE_SIZE to the number
+ * of neighbors that are usually active so that switching between
+ * their keys does not redo the AES key expansion.
+ *
+ * @{
+ */
+
+#ifndef PAIRWISESEC_H_
+#define PAIRWISESEC_H_
+
+#include "net/llsec/llsec.h"
+#include "net/linkaddr.h"
+
+/**
+ * \brief         Installs the pairwise key to use with a neighbor
+ * \param addr    The link-layer address of the neighbor
+ * \param key     The 16-byte key
+ * \retval 0      <-> there was no room in the neighbor table
+ */
+int pairwisesec_set_key(const linkaddr_t *addr, const uint8_t *key);
+
+extern const struct llsec_driver pairwisesec_driver;
+extern const struct framer pairwisesec_framer;
+
+#endif /* PAIRWISESEC_H_ */
+
+/** @} */
+/** @} */
@@ -203,6 +203,14 @@ static int we_are_receiving_burst = 0;
    to a neighbor for which we have a phase lock. */
 #define MAX_PHASE_STROBE_TIME              RTIMER_ARCH_SECOND / 60
 
+/* CONTIKIMAC_STROBE_STATS counts the strobes needed for successful
+   unicast transmissions, reported by contikimac_debug_print(). */
+#ifdef CONTIKIMAC_CONF_STROBE_STATS
+#define CONTIKIMAC_STROBE_STATS CONTIKIMAC_CONF_STROBE_STATS
+#else
+#define CONTIKIMAC_STROBE_STATS 0
+#endif
+
 #ifdef CONTIKIMAC_CONF_SEND_SW_ACK
 #define CONTIKIMAC_SEND_SW_ACK CONTIKIMAC_CONF_SEND_SW_ACK
 #else
@@ -243,6 +251,11 @@ static struct compower_activity current_packet;
 
 #define DEFAULT_STREAM_TIME (4 * CYCLE_TIME)
 
+#if CONTIKIMAC_STROBE_STATS
+static unsigned long unicast_acked, unicast_strobes;
+static unsigned long phase_acked, phase_strobes, phase_missed;
+#endif /* CONTIKIMAC_STROBE_STATS */
+
 #if CONTIKIMAC_CONF_BROADCAST_RATE_LIMIT
 static struct timer broadcast_rate_timer;
 static int broadcast_rate_counter;
@@ -504,7 +517,9 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   rtimer_clock_t t0;
 #if WITH_PHASE_OPTIMIZATION
   rtimer_clock_t encounter_time = 0;
+  rtimer_clock_t phase_window = GUARD_TIME;
 #endif
+  rtimer_clock_t max_phase_strobe_time = MAX_PHASE_STROBE_TIME;
   int strobes;
   uint8_t got_strobe_ack = 0;
   uint8_t is_broadcast = 0;
@@ -573,12 +588,16 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
 #if WITH_PHASE_OPTIMIZATION
     ret = phase_wait(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
                      CYCLE_TIME, GUARD_TIME,
-                     mac_callback, mac_callback_ptr, buf_list);
+                     mac_callback, mac_callback_ptr, buf_list,
+                     &phase_window);
     if(ret == PHASE_DEFERRED) {
       return MAC_TX_DEFERRED;
     }
     if(ret != PHASE_UNKNOWN) {
       is_known_receiver = 1;
+      /* We started early by phase_window: strobe past the expected
+         wake-up by as much more */
+      max_phase_strobe_time += 2 * (phase_window - (GUARD_TIME));
     }
 #endif /* WITH_PHASE_OPTIMIZATION */ 
   }
@@ -669,7 +688,7 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
     watchdog_periodic();
 
     if(!is_broadcast && (is_receiver_awake || is_known_receiver) &&
-       !RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + MAX_PHASE_STROBE_TIME)) {
+       !RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + max_phase_strobe_time)) {
       PRINTF("miss to %d\n", packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[0]);
       break;
     }
@@ -771,6 +790,22 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
     ret = MAC_TX_OK;
   }
 
+#if CONTIKIMAC_STROBE_STATS
+  if(!is_broadcast && !is_receiver_awake) {
+    if(got_strobe_ack) {
+      /* The strobe that got the ACK was not counted by the loop */
+      unicast_acked++;
+      unicast_strobes += strobes + 1;
+      if(is_known_receiver) {
+        phase_acked++;
+        phase_strobes += strobes + 1;
+      }
+    } else if(is_known_receiver && collisions == 0) {
+      phase_missed++;
+    }
+  }
+#endif /* CONTIKIMAC_STROBE_STATS */
+
 #if WITH_PHASE_OPTIMIZATION
   if(is_known_receiver && got_strobe_ack) {
     PRINTF("no miss %d wake-ups %d\n",
@@ -813,7 +848,7 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
   /* Do not send during reception of a burst */
   if(we_are_receiving_burst) {
     /* Prepare the packetbuf for callback */
-    queuebuf_to_packetbuf(buf_list->buf);
+    queuebuf_attach_to_packetbuf(buf_list->buf);
     /* Return COLLISION so the MAC may try again later */
     mac_call_sent_callback(sent, ptr, MAC_TX_COLLISION, 1);
     return;
@@ -823,7 +858,7 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
   curr = buf_list;
   do {
     next = list_item_next(curr);
-    queuebuf_to_packetbuf(curr->buf);
+    queuebuf_attach_to_packetbuf(curr->buf);
     if(!packetbuf_attr(PACKETBUF_ATTR_IS_CREATED_AND_SECURED)) {
       /* create and secure this frame */
       if(next != NULL) {
@@ -849,7 +884,7 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
     next = list_item_next(curr);
 
     /* Prepare the packetbuf */
-    queuebuf_to_packetbuf(curr->buf);
+    queuebuf_attach_to_packetbuf(curr->buf);
 
     pending = packetbuf_attr(PACKETBUF_ATTR_PENDING);
 
@@ -1051,6 +1086,18 @@ const struct rdc_driver contikimac_driver = {
 uint16_t
 contikimac_debug_print(void)
 {
+#if CONTIKIMAC_STROBE_STATS
+  printf("contikimac: %lu unicasts acked after %lu strobes",
+         unicast_acked, unicast_strobes);
+  printf(", phase-locked %lu acked after %lu strobes, %lu missed\n",
+         phase_acked, phase_strobes, phase_missed);
+#if WITH_PHASE_OPTIMIZATION
+  phase_print_stats();
+#endif /* WITH_PHASE_OPTIMIZATION */
+  /* Average number of strobes per acked unicast */
+  return unicast_acked ? unicast_strobes / unicast_acked : 0;
+#else /* CONTIKIMAC_STROBE_STATS */
   return 0;
+#endif /* CONTIKIMAC_STROBE_STATS */
 }
 /*---------------------------------------------------------------------------*/
@@ -46,4 +46,8 @@
 
 extern const struct rdc_driver contikimac_driver;
 
+/* Print strobe and phase-lock statistics; returns the average number of
+   strobes per acknowledged unicast transmission */
+uint16_t contikimac_debug_print(void);
+
 #endif /* CONTIKIMAC_H */
@@ -42,13 +42,16 @@
 #include "net/queuebuf.h"
 
 #include "sys/ctimer.h"
+#include "sys/defer.h"
 #include "sys/clock.h"
+#include "sys/energest.h"
 
 #include "lib/random.h"
 
 #include "net/netstack.h"
 
 #include "lib/list.h"
+#include "lib/dlist.h"
 #include "lib/memb.h"
 
 #include <string.h>
@@ -91,44 +94,66 @@ struct qbuf_metadata {
   uint8_t max_transmissions;
 };
 
-/* Every neighbor has its own packet queue */
+/* Every neighbor has its own packet queue. The packets themselves are
+   allocated from a pool shared by all neighbors. */
 struct neighbor_queue {
   struct neighbor_queue *next;
+  struct neighbor_queue *prev;
   linkaddr_t addr;
-  struct ctimer transmit_timer;
+  /* Earliest time of the next transmission (backoff) */
+  struct timer backoff_timer;
   uint8_t transmissions;
   uint8_t collisions, deferrals;
-  LIST_STRUCT(queued_packet_list);
+  /* Set while the RDC layer holds the head of the queue */
+  uint8_t in_flight;
+  DLIST_STRUCT(queued_packet_list);
 };
 
-/* The maximum number of co-existing neighbor queues */
+#define MAX_QUEUED_PACKETS QUEUEBUF_NUM
+
+/* The maximum number of co-existing neighbor queues. Each queue is a
+   struct neighbor_queue in neighbor_memb, about 26 bytes of RAM on a
+   16-bit MCU with 8-byte link-layer addresses. */
 #ifdef CSMA_CONF_MAX_NEIGHBOR_QUEUES
 #define CSMA_MAX_NEIGHBOR_QUEUES CSMA_CONF_MAX_NEIGHBOR_QUEUES
 #else
-#define CSMA_MAX_NEIGHBOR_QUEUES 2
+#define CSMA_MAX_NEIGHBOR_QUEUES 4
 #endif /* CSMA_CONF_MAX_NEIGHBOR_QUEUES */
 
-/* The maximum number of pending packet per neighbor */
+/* The maximum number of pending packet per neighbor. By default one
+   neighbor may use the whole packet pool, as 6LoWPAN queues all
+   fragments of a datagram to the same neighbor at once. Setting it to
+   e.g. MAX_QUEUED_PACKETS / CSMA_MAX_NEIGHBOR_QUEUES keeps a busy
+   neighbor from starving the others, but then datagrams sent in more
+   fragments than that are dropped. */
 #ifdef CSMA_CONF_MAX_PACKET_PER_NEIGHBOR
 #define CSMA_MAX_PACKET_PER_NEIGHBOR CSMA_CONF_MAX_PACKET_PER_NEIGHBOR
 #else
 #define CSMA_MAX_PACKET_PER_NEIGHBOR MAX_QUEUED_PACKETS
 #endif /* CSMA_CONF_MAX_PACKET_PER_NEIGHBOR */
 
-#define MAX_QUEUED_PACKETS QUEUEBUF_NUM
 MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
 MEMB(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
-LIST(neighbor_list);
+DLIST(neighbor_list);
+
+/* Neighbor queues are served round-robin by a single transmit timer, so
+   that a neighbor in backoff does not hold up the others */
+static struct ctimer transmit_timer;
+/* Runs transmit_next() when a neighbor is ready now */
+static struct defer transmit_now;
+static struct neighbor_queue *last_served;
+
+struct csma_stats csma_stats;
 
 static void packet_sent(void *ptr, int status, int num_transmissions);
-static void transmit_packet_list(void *ptr);
+static void transmit_next(void *ptr);
 
 /*---------------------------------------------------------------------------*/
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
 {
-  struct neighbor_queue *n = list_head(neighbor_list);
+  struct neighbor_queue *n = dlist_head(neighbor_list);
   while(n != NULL) {
     if(linkaddr_cmp(&n->addr, addr)) {
       return n;
@@ -155,19 +180,105 @@ default_timebase(void)
   return time;
 }
 /*---------------------------------------------------------------------------*/
+/* Check whether a neighbor has a packet that can be transmitted now */
+static int
+is_ready(struct neighbor_queue *n)
+{
+  return !n->in_flight && dlist_head(n->queued_packet_list) != NULL &&
+    timer_expired(&n->backoff_timer);
+}
+/*---------------------------------------------------------------------------*/
+/* Set the transmit timer to the earliest backoff expiration among the
+   neighbors that have packets waiting, or transmit right after the
+   current call chain if a neighbor is ready now */
 static void
-transmit_packet_list(void *ptr)
+schedule_transmission(void)
 {
-  struct neighbor_queue *n = ptr;
-  if(n) {
-    struct rdc_buf_list *q = list_head(n->queued_packet_list);
-    if(q != NULL) {
-      PRINTF("csma: preparing number %d %p, queue len %d\n", n->transmissions, q,
-          list_length(n->queued_packet_list));
-      /* Send packets in the neighbor's list */
-      NETSTACK_RDC.send_list(packet_sent, n, q);
+  struct neighbor_queue *n;
+  clock_time_t remaining;
+  clock_time_t next = 0;
+  int found = 0;
+
+  for(n = dlist_head(neighbor_list); n != NULL; n = list_item_next(n)) {
+    if(!n->in_flight && dlist_head(n->queued_packet_list) != NULL) {
+      remaining = timer_expired(&n->backoff_timer) ?
+        0 : timer_remaining(&n->backoff_timer);
+      if(!found || remaining < next) {
+        next = remaining;
+        found = 1;
+      }
     }
   }
+
+  if(found && next == 0) {
+    ctimer_stop(&transmit_timer);
+    defer_post(&transmit_now);
+  } else if(found) {
+    defer_cancel(&transmit_now);
+    ctimer_set(&transmit_timer, next, transmit_next, NULL);
+  } else {
+    defer_cancel(&transmit_now);
+    ctimer_stop(&transmit_timer);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Pick the next neighbor to serve, starting after the last one served */
+static struct neighbor_queue *
+next_ready_neighbor(void)
+{
+  struct neighbor_queue *start;
+  struct neighbor_queue *n;
+
+  start = last_served != NULL ? list_item_next(last_served) : NULL;
+  if(start == NULL) {
+    start = dlist_head(neighbor_list);
+  }
+  n = start;
+  while(n != NULL) {
+    if(is_ready(n)) {
+      return n;
+    }
+    n = list_item_next(n);
+    if(n == NULL) {
+      n = dlist_head(neighbor_list);
+    }
+    if(n == start) {
+      break;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+transmit_next(void *ptr)
+{
+  struct neighbor_queue *n;
+  struct rdc_buf_list *q;
+
+  ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_MAC);
+  n = next_ready_neighbor();
+  if(n != NULL) {
+    q = dlist_head(n->queued_packet_list);
+    PRINTF("csma: preparing number %d %p, queue len %d\n", n->transmissions, q,
+        dlist_length(n->queued_packet_list));
+    last_served = n;
+    n->in_flight = 1;
+    /* Send packets in the neighbor's list */
+    NETSTACK_RDC.send_list(packet_sent, n, q);
+  }
+  /* Serve the other neighbors, if any is ready, on the next round */
+  schedule_transmission();
+  ENERGEST_SUBSYSTEM_LEAVE();
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_neighbor(struct neighbor_queue *n)
+{
+  if(last_served == n) {
+    last_served = NULL;
+  }
+  dlist_remove(neighbor_list, n);
+  memb_free(&neighbor_memb, n);
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -177,26 +288,24 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p, int status)
 
   if(p != NULL) {
     /* Remove packet from list and deallocate */
-    list_remove(n->queued_packet_list, p);
+    dlist_remove(n->queued_packet_list, p);
 
     queuebuf_free(p->buf);
     memb_free(&metadata_memb, p->ptr);
     memb_free(&packet_memb, p);
     PRINTF("csma: free_queued_packet, queue length %d, free packets %d\n",
-           list_length(n->queued_packet_list), memb_numfree(&packet_memb));
-    if(list_head(n->queued_packet_list) != NULL) {
+           dlist_length(n->queued_packet_list), memb_numfree(&packet_memb));
+    if(dlist_head(n->queued_packet_list) != NULL) {
       /* There is a next packet. We reset current tx information */
       n->transmissions = 0;
       n->collisions = 0;
       n->deferrals = 0;
       /* Set a timer for next transmissions */
       tx_delay = (status == MAC_TX_OK) ? 0 : default_timebase();
-      ctimer_set(&n->transmit_timer, tx_delay, transmit_packet_list, n);
+      timer_set(&n->backoff_timer, tx_delay);
     } else {
       /* This was the last packet in the queue, we free the neighbor */
-      ctimer_stop(&n->transmit_timer);
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+      free_neighbor(n);
     }
   }
 }
@@ -218,6 +327,10 @@ packet_sent(void *ptr, int status, int num_transmissions)
   if(n == NULL) {
     return;
   }
+  ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_MAC);
+  if(status != MAC_TX_DEFERRED) {
+    n->in_flight = 0;
+  }
   switch(status) {
   case MAC_TX_OK:
   case MAC_TX_NOACK:
@@ -232,7 +345,7 @@ packet_sent(void *ptr, int status, int num_transmissions)
   }
 
   /* Find out what packet this callback refers to */
-  for(q = list_head(n->queued_packet_list);
+  for(q = dlist_head(n->queued_packet_list);
       q != NULL; q = list_item_next(q)) {
     if(queuebuf_attr(q->buf, PACKETBUF_ATTR_MAC_SEQNO) ==
        packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO)) {
@@ -287,14 +400,14 @@ packet_sent(void *ptr, int status, int num_transmissions)
 
         if(n->transmissions < metadata->max_transmissions) {
           PRINTF("csma: retransmitting with time %lu %p\n", time, q);
-          ctimer_set(&n->transmit_timer, time,
-                     transmit_packet_list, n);
+          timer_set(&n->backoff_timer, time);
           /* This is needed to correctly attribute energy that we spent
              transmitting this packet. */
           queuebuf_update_attr_from_packetbuf(q->buf);
         } else {
           PRINTF("csma: drop with status %d after %d transmissions, %d collisions\n",
                  status, n->transmissions, n->collisions);
+          csma_stats.drop_retransmissions++;
           free_packet(n, q, status);
           mac_call_sent_callback(sent, cptr, status, num_tx);
         }
@@ -313,6 +426,10 @@ packet_sent(void *ptr, int status, int num_transmissions)
   } else {
     PRINTF("csma: seqno %d not found\n", packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO));
   }
+  /* Packet_sent may be called from within the RDC layer: defer the next
+     transmission to the transmit timer */
+  schedule_transmission();
+  ENERGEST_SUBSYSTEM_LEAVE();
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -324,6 +441,7 @@ send_packet(mac_callback_t sent, void *ptr)
   static uint16_t seqno;
   const linkaddr_t *addr = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
 
+  ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_MAC);
   if(!initialized) {
     initialized = 1;
     /* Initialize the sequence number to a random value as per 802.15.4. */
@@ -348,18 +466,22 @@ send_packet(mac_callback_t sent, void *ptr)
       n->transmissions = 0;
       n->collisions = 0;
       n->deferrals = 0;
+      n->in_flight = 0;
+      timer_set(&n->backoff_timer, 0);
       /* Init packet list for this neighbor */
-      LIST_STRUCT_INIT(n, queued_packet_list);
+      DLIST_STRUCT_INIT(n, queued_packet_list);
       /* Add neighbor to the list */
-      list_add(neighbor_list, n);
+      dlist_init_item(n);
+      dlist_add(neighbor_list, n);
     }
   }
 
   if(n != NULL) {
     /* Add packet to the neighbor's queue */
-    if(list_length(n->queued_packet_list) < CSMA_MAX_PACKET_PER_NEIGHBOR) {
+    if(dlist_length(n->queued_packet_list) < CSMA_MAX_PACKET_PER_NEIGHBOR) {
       q = memb_alloc(&packet_memb);
       if(q != NULL) {
+        dlist_init_item(q);
         q->ptr = memb_alloc(&metadata_memb);
         if(q->ptr != NULL) {
           q->buf = queuebuf_new_from_packetbuf();
@@ -378,46 +500,56 @@ send_packet(mac_callback_t sent, void *ptr)
 #if PACKETBUF_WITH_PACKET_TYPE
             if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
                PACKETBUF_ATTR_PACKET_TYPE_ACK) {
-              list_push(n->queued_packet_list, q);
+              dlist_push(n->queued_packet_list, q);
             } else
 #endif
             {
-              list_add(n->queued_packet_list, q);
+              dlist_add(n->queued_packet_list, q);
             }
 
             PRINTF("csma: send_packet, queue length %d, free packets %d\n",
-                   list_length(n->queued_packet_list), memb_numfree(&packet_memb));
+                   dlist_length(n->queued_packet_list), memb_numfree(&packet_memb));
             /* If q is the first packet in the neighbor's queue, send asap */
-            if(list_head(n->queued_packet_list) == q) {
-              ctimer_set(&n->transmit_timer, 0, transmit_packet_list, n);
+            if(dlist_head(n->queued_packet_list) == q) {
+              schedule_transmission();
             }
+            ENERGEST_SUBSYSTEM_LEAVE();
             return;
           }
           memb_free(&metadata_memb, q->ptr);
           PRINTF("csma: could not allocate queuebuf, dropping packet\n");
+          csma_stats.drop_no_queuebuf++;
+        } else {
+          csma_stats.drop_no_packet++;
         }
         memb_free(&packet_memb, q);
         PRINTF("csma: could not allocate queuebuf, dropping packet\n");
+      } else {
+        csma_stats.drop_no_packet++;
       }
       /* The packet allocation failed. Remove and free neighbor entry if empty. */
-      if(list_length(n->queued_packet_list) == 0) {
-        list_remove(neighbor_list, n);
-        memb_free(&neighbor_memb, n);
+      if(dlist_length(n->queued_packet_list) == 0) {
+        free_neighbor(n);
       }
     } else {
       PRINTF("csma: Neighbor queue full\n");
+      csma_stats.drop_queue_full++;
     }
     PRINTF("csma: could not allocate packet, dropping packet\n");
   } else {
     PRINTF("csma: could not allocate neighbor, dropping packet\n");
+    csma_stats.drop_no_neighbor++;
   }
   mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
+  ENERGEST_SUBSYSTEM_LEAVE();
 }
 /*---------------------------------------------------------------------------*/
 static void
 input_packet(void)
 {
+  ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_MAC);
   NETSTACK_LLSEC.input();
+  ENERGEST_SUBSYSTEM_LEAVE();
 }
 /*---------------------------------------------------------------------------*/
 static int
@@ -447,6 +579,7 @@ init(void)
   memb_init(&packet_memb);
   memb_init(&metadata_memb);
   memb_init(&neighbor_memb);
+  defer_set(&transmit_now, transmit_next, NULL);
 }
 /*---------------------------------------------------------------------------*/
 const struct mac_driver csma_driver = {
@@ -44,6 +44,22 @@
 #include "net/mac/mac.h"
 #include "dev/radio.h"
 
+/* Packets dropped by CSMA, by reason */
+struct csma_stats {
+  /* No free neighbor queue (CSMA_CONF_MAX_NEIGHBOR_QUEUES) */
+  unsigned long drop_no_neighbor;
+  /* Neighbor queue full (CSMA_CONF_MAX_PACKET_PER_NEIGHBOR) */
+  unsigned long drop_queue_full;
+  /* Shared packet pool exhausted */
+  unsigned long drop_no_packet;
+  /* No queuebuf available */
+  unsigned long drop_no_queuebuf;
+  /* Maximum number of transmissions reached */
+  unsigned long drop_retransmissions;
+};
+
+extern struct csma_stats csma_stats;
+
 extern const struct mac_driver csma_driver;
 
 const struct mac_driver *csma_init(const struct mac_driver *r);
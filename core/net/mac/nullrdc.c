@@ -111,10 +111,15 @@
 
 /*---------------------------------------------------------------------------*/
 static int
-send_one_packet(mac_callback_t sent, void *ptr)
+create_frame(struct queuebuf *q)
 {
-  int ret;
-  int last_sent_ok = 0;
+#if QUEUEBUF_ZERO_COPY
+  /* A queued frame is created in place on the first attempt and is
+     retransmitted as is */
+  if(packetbuf_attr(PACKETBUF_ATTR_IS_CREATED_AND_SECURED)) {
+    return 1;
+  }
+#endif /* QUEUEBUF_ZERO_COPY */
 
   packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
 #if NULLRDC_802154_AUTOACK || NULLRDC_802154_AUTOACK_HW
@@ -122,6 +127,24 @@ send_one_packet(mac_callback_t sent, void *ptr)
 #endif /* NULLRDC_802154_AUTOACK || NULLRDC_802154_AUTOACK_HW */
 
   if(NETSTACK_FRAMER.create() < 0) {
+    return 0;
+  }
+#if QUEUEBUF_ZERO_COPY
+  if(q != NULL) {
+    packetbuf_set_attr(PACKETBUF_ATTR_IS_CREATED_AND_SECURED, 1);
+    queuebuf_update_from_packetbuf(q);
+  }
+#endif /* QUEUEBUF_ZERO_COPY */
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+send_one_packet(mac_callback_t sent, void *ptr, struct queuebuf *q)
+{
+  int ret;
+  int last_sent_ok = 0;
+
+  if(!create_frame(q)) {
     /* Failed to allocate space for headers */
     PRINTF("nullrdc: send failed, too large header\n");
     ret = MAC_TX_ERR_FATAL;
@@ -237,7 +260,7 @@ send_one_packet(mac_callback_t sent, void *ptr)
 static void
 send_packet(mac_callback_t sent, void *ptr)
 {
-  send_one_packet(sent, ptr);
+  send_one_packet(sent, ptr, NULL);
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -249,8 +272,8 @@ send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
     struct rdc_buf_list *next = buf_list->next;
     int last_sent_ok;
 
-    queuebuf_to_packetbuf(buf_list->buf);
-    last_sent_ok = send_one_packet(sent, ptr);
+    queuebuf_attach_to_packetbuf(buf_list->buf);
+    last_sent_ok = send_one_packet(sent, ptr, buf_list->buf);
 
     /* If packet transmission was not successful, we should back off and let
      * upper layers retransmit, rather than potentially sending out-of-order
@@ -44,18 +44,66 @@
 #include "net/queuebuf.h"
 #include "net/nbr-table.h"
 
-#if PHASE_CONF_DRIFT_CORRECT
+#include <stdlib.h>
+#include <string.h>
+
+/* Track each neighbor's phase drift and send when the drift-corrected
+   wake-up is due. With the default PHASE_HISTORY, this takes 20 more
+   bytes per neighbor than a single wake-up time on 16-bit platforms. */
+#ifdef PHASE_CONF_DRIFT_CORRECT
 #define PHASE_DRIFT_CORRECT PHASE_CONF_DRIFT_CORRECT
 #else
-#define PHASE_DRIFT_CORRECT 0
+#define PHASE_DRIFT_CORRECT 1
 #endif
 
-struct phase {
+/* Number of wake-up observations per neighbor used to estimate drift,
+   at least 2. Each one takes 4 bytes on 16-bit platforms; with more
+   than 2, the jitter is estimated over several intervals. */
+#ifdef PHASE_CONF_HISTORY
+#define PHASE_HISTORY PHASE_CONF_HISTORY
+#else
+#define PHASE_HISTORY 3
+#endif
+
+/* Observations further apart than this are not used for the drift
+   estimate; the history restarts instead. Must be well below the
+   clock_time_t wrap-around time. */
+#ifdef PHASE_CONF_MAX_INTERVAL
+#define PHASE_MAX_INTERVAL PHASE_CONF_MAX_INTERVAL
+#else
+#define PHASE_MAX_INTERVAL (CLOCK_SECOND * 120)
+#endif
+
+/* Set to 1 to count wake-up hits and misses per neighbor, 4 bytes per
+   neighbor */
+#ifdef PHASE_CONF_STATS
+#define PHASE_STATS PHASE_CONF_STATS
+#else
+#define PHASE_STATS 0
+#endif
+
+#if PHASE_DRIFT_CORRECT
+struct phase_observation {
   rtimer_clock_t time;
+  clock_time_t seen;
+};
+#endif /* PHASE_DRIFT_CORRECT */
+
+struct phase {
 #if PHASE_DRIFT_CORRECT
-  rtimer_clock_t drift;
-#endif
+  struct phase_observation obs[PHASE_HISTORY];
+  int32_t drift;        /* Phase drift, 1/256 rtimer ticks per cycle */
+  uint32_t jitter;      /* Largest deviation from the drift, same unit */
+  uint8_t newest;
+  uint8_t count;
+#else /* PHASE_DRIFT_CORRECT */
+  rtimer_clock_t time;
+#endif /* PHASE_DRIFT_CORRECT */
   uint8_t noacks;
+#if PHASE_STATS
+  uint16_t hits;
+  uint16_t misses;
+#endif /* PHASE_STATS */
   struct timer noacks_timer;
 };
 
@@ -74,12 +122,17 @@ struct phase_queueitem {
 
 #define MAX_NOACKS_TIME       CLOCK_SECOND * 30
 
+/* Each consecutive missed wake-up doubles the window, up to this many times */
+#define MAX_NOACKS_WIDENING   3
+
 MEMB(queued_packets_memb, struct phase_queueitem, PHASE_QUEUESIZE);
 NBR_TABLE(struct phase, nbr_phase);
 
 #define DEBUG 0
-#if DEBUG
+#if DEBUG || PHASE_STATS
 #include <stdio.h>
+#endif
+#if DEBUG
 #define PRINTF(...) printf(__VA_ARGS__)
 #define PRINTDEBUG(...) printf(__VA_ARGS__)
 #else
@@ -87,6 +140,85 @@ NBR_TABLE(struct phase, nbr_phase);
 #define PRINTDEBUG(...)
 #endif
 /*---------------------------------------------------------------------------*/
+#if PHASE_DRIFT_CORRECT
+static void
+add_observation(struct phase *e, rtimer_clock_t time)
+{
+  clock_time_t now = clock_time();
+
+  if(e->count > 0 && now - e->obs[e->newest].seen > PHASE_MAX_INTERVAL) {
+    /* Too long since the last observation to tell how many cycles have
+       elapsed: start over. */
+    e->count = 0;
+  }
+  e->newest = (e->newest + 1) % PHASE_HISTORY;
+  e->obs[e->newest].time = time;
+  e->obs[e->newest].seen = now;
+  if(e->count < PHASE_HISTORY) {
+    e->count++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Number of wake-up cycles in a clock_time() interval, rounded */
+static uint32_t
+cycles(clock_time_t interval, rtimer_clock_t cycle_time)
+{
+  return ((uint32_t)interval * (RTIMER_ARCH_SECOND / cycle_time) +
+          CLOCK_SECOND / 2) / CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Fit a line through the phase shifts between consecutive observations:
+ * the drift is the total shift over the total number of elapsed cycles,
+ * the jitter is the largest per-cycle deviation of any interval from it.
+ */
+static void
+estimate_drift(struct phase *e, rtimer_clock_t cycle_time)
+{
+  struct phase_observation *older, *newer;
+  int32_t shift[PHASE_HISTORY - 1];
+  uint32_t n[PHASE_HISTORY - 1];
+  int32_t total_shift = 0;
+  uint32_t total_n = 0;
+  uint32_t deviation;
+  uint8_t i, intervals = 0;
+
+  e->drift = 0;
+  e->jitter = 0;
+
+  for(i = 1; i < e->count; i++) {
+    newer = &e->obs[(e->newest + PHASE_HISTORY - i + 1) % PHASE_HISTORY];
+    older = &e->obs[(e->newest + PHASE_HISTORY - i) % PHASE_HISTORY];
+    n[intervals] = cycles(newer->seen - older->seen, cycle_time);
+    if(n[intervals] == 0) {
+      continue;
+    }
+    /* The shift is only known modulo the cycle time, which is exact as
+       long as the rtimer did not wrap or the cycle time divides its
+       range; keep it within half a cycle either way. */
+    shift[intervals] = (rtimer_clock_t)(newer->time - older->time) % cycle_time;
+    if(shift[intervals] > cycle_time / 2) {
+      shift[intervals] -= cycle_time;
+    }
+    total_shift += shift[intervals];
+    total_n += n[intervals];
+    intervals++;
+  }
+
+  if(intervals == 0) {
+    return;
+  }
+
+  e->drift = total_shift * 256 / (int32_t)total_n;
+  for(i = 0; i < intervals; i++) {
+    deviation = (uint32_t)labs(shift[i] * 256 - e->drift * (int32_t)n[i]) / n[i];
+    if(deviation > e->jitter) {
+      e->jitter = deviation;
+    }
+  }
+}
+#endif /* PHASE_DRIFT_CORRECT */
+/*---------------------------------------------------------------------------*/
 void
 phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
              int mac_status)
@@ -98,15 +230,22 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
   if(e != NULL) {
     if(mac_status == MAC_TX_OK) {
 #if PHASE_DRIFT_CORRECT
-      e->drift = time-e->time;
-#endif
+      add_observation(e, time);
+#else
       e->time = time;
+#endif
+#if PHASE_STATS
+      e->hits++;
+#endif
     }
     /* If the neighbor didn't reply to us, it may have switched
        phase (rebooted). We try a number of transmissions to it
        before we drop it from the phase list. */
     if(mac_status == MAC_TX_NOACK) {
       PRINTF("phase noacks %d to %d.%d\n", e->noacks, neighbor->u8[0], neighbor->u8[1]);
+#if PHASE_STATS
+      e->misses++;
+#endif
       e->noacks++;
       if(e->noacks == 1) {
         timer_set(&e->noacks_timer, MAX_NOACKS_TIME);
@@ -124,11 +263,12 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
     if(mac_status == MAC_TX_OK && e == NULL) {
       e = nbr_table_add_lladdr(nbr_phase, neighbor);
       if(e) {
-        e->time = time;
+        memset(e, 0, sizeof(struct phase));
 #if PHASE_DRIFT_CORRECT
-      e->drift = 0;
+        add_observation(e, time);
+#else
+        e->time = time;
 #endif
-      e->noacks = 0;
       }
     }
   }
@@ -154,7 +294,8 @@ phase_status_t
 phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
            rtimer_clock_t guard_time,
            mac_callback_t mac_callback, void *mac_callback_ptr,
-           struct rdc_buf_list *buf_list)
+           struct rdc_buf_list *buf_list,
+           rtimer_clock_t *window)
 {
   struct phase *e;
   //  const linkaddr_t *neighbor = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
@@ -166,35 +307,54 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
   if(e != NULL) {
     rtimer_clock_t wait, now, expected, sync;
     clock_time_t ctimewait;
-    
+    uint32_t uncertainty;
+
     /* We expect phases to happen every CYCLE_TIME time
        units. The next expected phase is at time e->time +
        CYCLE_TIME. To compute a relative offset, we subtract
        with clock_time(). Because we are only interested in turning
        on the radio within the CYCLE_TIME period, we compute the
        waiting time with modulo CYCLE_TIME. */
-    
-    /*      printf("neighbor phase 0x%02x (cycle 0x%02x)\n", e->time & (cycle_time - 1),
-            cycle_time);*/
-
-    /*      if(e->noacks > 0) {
-            printf("additional wait %d\n", additional_wait);
-            }*/
-    
-    now = RTIMER_NOW();
 
-    sync = (e == NULL) ? now : e->time;
+    now = RTIMER_NOW();
+    uncertainty = 0;
 
 #if PHASE_DRIFT_CORRECT
     {
-      int32_t s;
-      if(e->drift > cycle_time) {
-        s = e->drift % cycle_time / (e->drift / cycle_time);  /* drift per cycle */
-        s = s * (now - sync) / cycle_time;                    /* estimated drift to now */
-        sync += s;                                            /* add it in */
+      clock_time_t age;
+      uint32_t n;
+
+      sync = e->obs[e->newest].time;
+      age = clock_time() - e->obs[e->newest].seen;
+      if(age > PHASE_MAX_INTERVAL) {
+        age = PHASE_MAX_INTERVAL;
       }
+      n = cycles(age, cycle_time);
+
+      /* Move the last observed phase by the drift accumulated since,
+         and widen the window by how far off the fit might be by now. */
+      estimate_drift(e, cycle_time);
+      sync += (rtimer_clock_t)(e->drift * (int32_t)n / 256);
+      uncertainty = e->jitter * n / 256;
+    }
+#else /* PHASE_DRIFT_CORRECT */
+    sync = e->time;
+#endif /* PHASE_DRIFT_CORRECT */
+
+    uncertainty += guard_time;
+    if(e->noacks > 0) {
+      /* We missed the neighbor's last wake-up(s): look wider */
+      uncertainty <<= e->noacks < MAX_NOACKS_WIDENING ?
+        e->noacks : MAX_NOACKS_WIDENING;
+    }
+    if(uncertainty >= cycle_time / 2) {
+      /* The phase is too uncertain to be of any use */
+      return PHASE_UNKNOWN;
+    }
+    guard_time = (rtimer_clock_t)uncertainty;
+    if(window != NULL) {
+      *window = guard_time;
     }
-#endif
 
     /* Check if cycle_time is a power of two */
     if(!(cycle_time & (cycle_time - 1))) {
@@ -244,6 +404,28 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
 }
 /*---------------------------------------------------------------------------*/
 void
+phase_print_stats(void)
+{
+#if PHASE_STATS
+  struct phase *e;
+  linkaddr_t *addr;
+
+  for(e = nbr_table_head(nbr_phase); e != NULL;
+      e = nbr_table_next(nbr_phase, e)) {
+    addr = nbr_table_get_lladdr(nbr_phase, e);
+    printf("phase: %02x%02x hits %u misses %u noacks %u",
+           addr->u8[LINKADDR_SIZE - 2], addr->u8[LINKADDR_SIZE - 1],
+           e->hits, e->misses, e->noacks);
+#if PHASE_DRIFT_CORRECT
+    printf(" drift %ld/256 jitter %lu/256 (%u obs)",
+           (long)e->drift, (unsigned long)e->jitter, e->count);
+#endif
+    printf("\n");
+  }
+#endif /* PHASE_STATS */
+}
+/*---------------------------------------------------------------------------*/
+void
 phase_init(void)
 {
   memb_init(&queued_packets_memb);
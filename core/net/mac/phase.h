@@ -55,12 +55,21 @@ typedef enum {
 
 
 void phase_init(void);
+/*
+ * Wait for the expected wake-up of a neighbor, or defer the transmission.
+ * wait_before is the minimum time before the expected wake-up at which to
+ * start transmitting. It is widened according to the confidence in the
+ * neighbor's phase, and the actual value used is returned in *window: the
+ * caller should strobe for correspondingly longer.
+ */
 phase_status_t phase_wait(const linkaddr_t *neighbor,
                           rtimer_clock_t cycle_time, rtimer_clock_t wait_before,
                           mac_callback_t mac_callback, void *mac_callback_ptr,
-                          struct rdc_buf_list *buf_list);
+                          struct rdc_buf_list *buf_list,
+                          rtimer_clock_t *window);
 void phase_update(const linkaddr_t *neighbor,
                   rtimer_clock_t time, int mac_status);
 void phase_remove(const linkaddr_t *neighbor);
+void phase_print_stats(void);
 
 #endif /* PHASE_H */
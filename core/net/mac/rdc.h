@@ -57,6 +57,7 @@
 /* List of packets to be sent by RDC layer */
 struct rdc_buf_list {
   struct rdc_buf_list *next;
+  struct rdc_buf_list *prev;
   struct queuebuf *buf;
   void *ptr;
 };
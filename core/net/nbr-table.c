@@ -69,11 +69,50 @@ static uint8_t locked_map[NBR_TABLE_MAX_NEIGHBORS];
 static struct nbr_table *all_tables[MAX_NUM_TABLES];
 /* The current number of tables */
 static unsigned num_tables;
+#if NBR_TABLE_WITH_ACCESS_TIME
+/* For each neighbor, the last time (in seconds) it was added or touched */
+static unsigned long last_access[NBR_TABLE_MAX_NEIGHBORS];
+#endif /* NBR_TABLE_WITH_ACCESS_TIME */
+
+struct nbr_table_stats nbr_table_stats;
 
 /* The neighbor address table */
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_WITH_HASH
+/* Open-addressing (linear probing) index from link-layer address to
+ * neighbor index. The number of buckets is a power of two at least twice
+ * the number of neighbors, so that probe sequences remain short. */
+#if NBR_TABLE_MAX_NEIGHBORS <= 4
+#define NBR_HASH_SIZE 8
+#elif NBR_TABLE_MAX_NEIGHBORS <= 8
+#define NBR_HASH_SIZE 16
+#elif NBR_TABLE_MAX_NEIGHBORS <= 16
+#define NBR_HASH_SIZE 32
+#elif NBR_TABLE_MAX_NEIGHBORS <= 32
+#define NBR_HASH_SIZE 64
+#elif NBR_TABLE_MAX_NEIGHBORS <= 64
+#define NBR_HASH_SIZE 128
+#elif NBR_TABLE_MAX_NEIGHBORS <= 128
+#define NBR_HASH_SIZE 256
+#elif NBR_TABLE_MAX_NEIGHBORS <= 256
+#define NBR_HASH_SIZE 512
+#elif NBR_TABLE_MAX_NEIGHBORS <= 512
+#define NBR_HASH_SIZE 1024
+#else
+#error "NBR_TABLE_WITH_HASH supports at most 512 neighbors"
+#endif
+
+/* Each bucket holds the neighbor index plus one, zero meaning empty */
+#if NBR_TABLE_MAX_NEIGHBORS < 255
+typedef uint8_t nbr_hash_slot_t;
+#else
+typedef uint16_t nbr_hash_slot_t;
+#endif
+static nbr_hash_slot_t nbr_hash[NBR_HASH_SIZE];
+#endif /* NBR_TABLE_WITH_HASH */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -117,16 +156,91 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
   return key_from_index(index_from_item(table, item));
 }
 /*---------------------------------------------------------------------------*/
+#if NBR_TABLE_WITH_HASH
+/* Get the first hash bucket to probe for a link-layer address */
+static unsigned
+hash_from_lladdr(const linkaddr_t *lladdr)
+{
+  unsigned h = 0;
+  int i;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = (h * 31) + lladdr->u8[i];
+  }
+  h ^= h >> 7;
+  return h & (NBR_HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+/* Insert a neighbor in the hash index. The key address must be set. */
+static void
+hash_insert(int index)
+{
+  unsigned i = hash_from_lladdr(&key_from_index(index)->lladdr);
+  while(nbr_hash[i] != 0) {
+    i = (i + 1) & (NBR_HASH_SIZE - 1);
+  }
+  nbr_hash[i] = index + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a neighbor from the hash index. The key address must still be set.
+ * Entries following the removed one in its probe sequence are shifted back,
+ * so that lookups never need tombstones. */
+static void
+hash_remove(int index)
+{
+  unsigned i, j, k;
+
+  i = hash_from_lladdr(&key_from_index(index)->lladdr);
+  while(nbr_hash[i] != index + 1) {
+    if(nbr_hash[i] == 0) {
+      /* Not indexed */
+      return;
+    }
+    i = (i + 1) & (NBR_HASH_SIZE - 1);
+  }
+
+  nbr_hash[i] = 0;
+  j = i;
+  while(1) {
+    j = (j + 1) & (NBR_HASH_SIZE - 1);
+    if(nbr_hash[j] == 0) {
+      return;
+    }
+    k = hash_from_lladdr(&key_from_index(nbr_hash[j] - 1)->lladdr);
+    /* Leave the entry in place if its home bucket lies cyclically in (i, j] */
+    if(i <= j ? (i < k && k <= j) : (i < k || k <= j)) {
+      continue;
+    }
+    nbr_hash[i] = nbr_hash[j];
+    nbr_hash[j] = 0;
+    i = j;
+  }
+}
+#endif /* NBR_TABLE_WITH_HASH */
+/*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const linkaddr_t *lladdr)
 {
+#if NBR_TABLE_WITH_HASH
+  unsigned i;
+#else /* NBR_TABLE_WITH_HASH */
   nbr_table_key_t *key;
+#endif /* NBR_TABLE_WITH_HASH */
   /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
    * Only one such entry is possible at a time, indexed by linkaddr_null. */
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_WITH_HASH
+  i = hash_from_lladdr(lladdr);
+  while(nbr_hash[i] != 0) {
+    if(linkaddr_cmp(lladdr, &key_from_index(nbr_hash[i] - 1)->lladdr)) {
+      return nbr_hash[i] - 1;
+    }
+    i = (i + 1) & (NBR_HASH_SIZE - 1);
+  }
+  return -1;
+#else /* NBR_TABLE_WITH_HASH */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -135,6 +249,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
     key = list_item_next(key);
   }
   return -1;
+#endif /* NBR_TABLE_WITH_HASH */
 }
 /*---------------------------------------------------------------------------*/
 /* Get bit from "used" or "locked" bitmap */
@@ -169,12 +284,31 @@ nbr_set_bit(uint8_t *bitmap, nbr_table_t *table, nbr_table_item_t *item, int val
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+/* Count the number of tables that use a neighbor */
+static int
+used_count_from_index(int index)
+{
+  int used = used_map[index];
+  int used_count = 0;
+  while(used != 0) {
+    if((used & 1) == 1) {
+      used_count++;
+    }
+    used >>= 1;
+  }
+  return used_count;
+}
+/*---------------------------------------------------------------------------*/
 static nbr_table_key_t *
 nbr_table_allocate(void)
 {
   nbr_table_key_t *key;
-  int least_used_count = 0;
-  nbr_table_key_t *least_used_key = NULL;
+  int least_cost = 0;
+  nbr_table_key_t *least_cost_key = NULL;
+  unsigned long idle = 0;
+#if NBR_TABLE_WITH_ACCESS_TIME
+  unsigned long now;
+#endif /* NBR_TABLE_WITH_ACCESS_TIME */
 
   key = memb_alloc(&neighbor_addr_mem);
   if(key != NULL) {
@@ -182,9 +316,12 @@ nbr_table_allocate(void)
   } else { /* No more space, try to free a neighbor.
             * The replacement policy is the following: remove neighbor that is:
             * (1) not locked
-            * (2) used by fewest tables
+            * (2) of lowest eviction cost according to NBR_TABLE_POLICY
             * (3) oldest (the list is ordered by insertion time)
             * */
+#if NBR_TABLE_WITH_ACCESS_TIME
+    now = clock_seconds();
+#endif /* NBR_TABLE_WITH_ACCESS_TIME */
     /* Get item from first key */
     key = list_head(nbr_table_keys);
     while(key != NULL) {
@@ -192,28 +329,27 @@ nbr_table_allocate(void)
       int locked = locked_map[item_index];
       /* Never delete a locked item */
       if(!locked) {
-        int used = used_map[item_index];
-        int used_count = 0;
-        /* Count how many tables are using this item */
-        while(used != 0) {
-          if((used & 1) == 1) {
-            used_count++;
-          }
-          used >>= 1;
-        }
-        /* Find least used item */
-        if(least_used_key == NULL || used_count < least_used_count) {
-          least_used_key = key;
-          least_used_count = used_count;
-          if(used_count == 0) { /* We won't find any least used item */
+#if NBR_TABLE_WITH_ACCESS_TIME
+        idle = now - last_access[item_index];
+#endif /* NBR_TABLE_WITH_ACCESS_TIME */
+        int cost = NBR_TABLE_POLICY.eviction_cost(&key->lladdr,
+                                                  used_count_from_index(item_index),
+                                                  idle);
+        /* Find the item that is cheapest to evict */
+        if(cost != NBR_TABLE_POLICY_KEEP &&
+           (least_cost_key == NULL || cost < least_cost)) {
+          least_cost_key = key;
+          least_cost = cost;
+          if(cost == 0) { /* We won't find any cheaper item */
             break;
           }
         }
       }
       key = list_item_next(key);
     }
-    if(least_used_key == NULL) {
-      /* We haven't found any unlocked item, allocation fails */
+    if(least_cost_key == NULL) {
+      /* We haven't found any removable item, allocation fails */
+      nbr_table_stats.failures++;
       return NULL;
     } else {
       /* Reuse least used item */
@@ -221,18 +357,23 @@ nbr_table_allocate(void)
       for(i = 0; i<MAX_NUM_TABLES; i++) {
         if(all_tables[i] != NULL && all_tables[i]->callback != NULL) {
           /* Call table callback for each table that uses this item */
-          nbr_table_item_t *removed_item = item_from_key(all_tables[i], least_used_key);
+          nbr_table_item_t *removed_item = item_from_key(all_tables[i], least_cost_key);
           if(nbr_get_bit(used_map, all_tables[i], removed_item) == 1) {
             all_tables[i]->callback(removed_item);
           }
         }
       }
       /* Empty used map */
-      used_map[index_from_key(least_used_key)] = 0;
+      used_map[index_from_key(least_cost_key)] = 0;
+#if NBR_TABLE_WITH_HASH
+      /* Remove evicted address from the hash index */
+      hash_remove(index_from_key(least_cost_key));
+#endif /* NBR_TABLE_WITH_HASH */
       /* Remove neighbor from list */
-      list_remove(nbr_table_keys, least_used_key);
+      list_remove(nbr_table_keys, least_cost_key);
+      nbr_table_stats.evictions++;
       /* Return associated key */
-      return least_used_key;
+      return least_cost_key;
     }
   }
 }
@@ -318,8 +459,18 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+    nbr_table_stats.adds++;
+
+#if NBR_TABLE_WITH_HASH
+    /* Index the new address */
+    hash_insert(index);
+#endif /* NBR_TABLE_WITH_HASH */
   }
 
+#if NBR_TABLE_WITH_ACCESS_TIME
+  last_access[index] = clock_seconds();
+#endif /* NBR_TABLE_WITH_ACCESS_TIME */
+
   /* Get item in the current table */
   item = item_from_index(table, index);
 
@@ -334,9 +485,25 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
 void *
 nbr_table_get_from_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
 {
-  void *item = item_from_index(table, index_from_lladdr(lladdr));
-  return nbr_get_bit(used_map, table, item) ? item : NULL;
+  int index = index_from_lladdr(lladdr);
+  void *item = item_from_index(table, index);
+  if(!nbr_get_bit(used_map, table, item)) {
+    return NULL;
+  }
+  return item;
+}
+/*---------------------------------------------------------------------------*/
+#if NBR_TABLE_WITH_ACCESS_TIME
+/* Record that a neighbor is in use */
+void
+nbr_table_touch(nbr_table_t *table, const nbr_table_item_t *item)
+{
+  int index = index_from_item(table, item);
+  if(index != -1) {
+    last_access[index] = clock_seconds();
+  }
 }
+#endif /* NBR_TABLE_WITH_ACCESS_TIME */
 /*---------------------------------------------------------------------------*/
 /* Removes a neighbor from the current table (unset "used" bit) */
 int
@@ -377,6 +544,75 @@ nbr_table_get_lladdr(nbr_table_t *table, const void *item)
   return key != NULL ? &key->lladdr : NULL;
 }
 /*---------------------------------------------------------------------------*/
+/* Change the link-layer address of a neighbor, in all tables. The address
+ * must not be changed through nbr_table_get_lladdr(), as the neighbor
+ * would then no longer be found. Returns 0 if the neighbor is not in the
+ * table, or if another neighbor already has the new address. */
+int
+nbr_table_update_lladdr(nbr_table_t *table, const nbr_table_item_t *item,
+                        const linkaddr_t *lladdr)
+{
+  int index = index_from_item(table, item);
+  int other;
+
+  if(index == -1 || !nbr_get_bit(used_map, table, (nbr_table_item_t *)item)) {
+    return 0;
+  }
+  if(lladdr == NULL) {
+    lladdr = &linkaddr_null;
+  }
+  other = index_from_lladdr(lladdr);
+  if(other != -1) {
+    return other == index;
+  }
+
+#if NBR_TABLE_WITH_HASH
+  hash_remove(index);
+#endif /* NBR_TABLE_WITH_HASH */
+  linkaddr_copy(&key_from_index(index)->lladdr, lladdr);
+#if NBR_TABLE_WITH_HASH
+  hash_insert(index);
+#endif /* NBR_TABLE_WITH_HASH */
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Number of neighbors currently in the table */
+int
+nbr_table_num_neighbors(void)
+{
+  return list_length(nbr_table_keys);
+}
+/*---------------------------------------------------------------------------*/
+/* Default policy: evict the neighbor used by the fewest tables */
+static int
+default_eviction_cost(const linkaddr_t *lladdr, int used_count,
+                      unsigned long idle)
+{
+  return used_count;
+}
+const struct nbr_table_policy nbr_table_policy_default = {
+  "default",
+  default_eviction_cost
+};
+/*---------------------------------------------------------------------------*/
+#if NBR_TABLE_WITH_ACCESS_TIME
+/* LRU policy: evict the neighbor that has not been added or touched for
+ * the longest time. Neighbors that no table uses any longer go first. */
+static int
+lru_eviction_cost(const linkaddr_t *lladdr, int used_count,
+                  unsigned long idle)
+{
+  if(used_count == 0 || idle >= NBR_TABLE_POLICY_MAX_COST) {
+    return 0;
+  }
+  return NBR_TABLE_POLICY_MAX_COST - (int)idle;
+}
+const struct nbr_table_policy nbr_table_policy_lru = {
+  "lru",
+  lru_eviction_cost
+};
+#endif /* NBR_TABLE_WITH_ACCESS_TIME */
+/*---------------------------------------------------------------------------*/
 #if DEBUG
 static void
 handle_periodic_timer(void *ptr)
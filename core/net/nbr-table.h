@@ -46,6 +46,14 @@
 #define NBR_TABLE_MAX_NEIGHBORS 8
 #endif /* NBR_TABLE_CONF_MAX_NEIGHBORS */
 
+/* Index neighbors by link-layer address with a hash table rather than
+ * scanning the neighbor list on every lookup */
+#ifdef NBR_TABLE_CONF_WITH_HASH
+#define NBR_TABLE_WITH_HASH NBR_TABLE_CONF_WITH_HASH
+#else /* NBR_TABLE_CONF_WITH_HASH */
+#define NBR_TABLE_WITH_HASH 1
+#endif /* NBR_TABLE_CONF_WITH_HASH */
+
 /* An item in a neighbor table */
 typedef void nbr_table_item_t;
 
@@ -75,6 +83,60 @@ typedef struct nbr_table {
 /** \brief Declaration of non-static neighbor tables */
 #define NBR_TABLE_DECLARE(name) extern nbr_table_t *name
 
+/** \brief Eviction cost of a neighbor that must not be evicted */
+#define NBR_TABLE_POLICY_KEEP     -1
+/** \brief Highest eviction cost a policy should return */
+#define NBR_TABLE_POLICY_MAX_COST 0x7fff
+
+/**
+ * \brief A neighbor eviction policy, used when a neighbor is added to a
+ * full table. Locked neighbors are never evicted. Among the others, the
+ * neighbor with the lowest eviction cost is evicted, the oldest one on ties.
+ */
+struct nbr_table_policy {
+  char *name;
+  /** Eviction cost of a neighbor, used by used_count tables and last added
+      or touched idle seconds ago, or NBR_TABLE_POLICY_KEEP. idle is 0
+      unless NBR_TABLE_WITH_ACCESS_TIME is set. */
+  int (* eviction_cost)(const linkaddr_t *lladdr, int used_count,
+                        unsigned long idle);
+};
+
+/* The eviction policy, selected at build time */
+#ifdef NBR_TABLE_CONF_POLICY
+#define NBR_TABLE_POLICY NBR_TABLE_CONF_POLICY
+#else /* NBR_TABLE_CONF_POLICY */
+#define NBR_TABLE_POLICY nbr_table_policy_default
+#endif /* NBR_TABLE_CONF_POLICY */
+
+extern const struct nbr_table_policy NBR_TABLE_POLICY;
+extern const struct nbr_table_policy nbr_table_policy_default;
+extern const struct nbr_table_policy nbr_table_policy_lru;
+
+/* Keep the time at which each neighbor was last added or touched with
+ * nbr_table_touch(). Selecting the LRU policy turns this on. Other
+ * policies that use the idle time must set NBR_TABLE_CONF_WITH_ACCESS_TIME. */
+#define NBR_TABLE_ACCESS_TIME_nbr_table_policy_lru 1
+#define NBR_TABLE_CAT(a, b) a##b
+#define NBR_TABLE_XCAT(a, b) NBR_TABLE_CAT(a, b)
+#ifdef NBR_TABLE_CONF_WITH_ACCESS_TIME
+#define NBR_TABLE_WITH_ACCESS_TIME NBR_TABLE_CONF_WITH_ACCESS_TIME
+#else /* NBR_TABLE_CONF_WITH_ACCESS_TIME */
+#define NBR_TABLE_WITH_ACCESS_TIME \
+  NBR_TABLE_XCAT(NBR_TABLE_ACCESS_TIME_, NBR_TABLE_POLICY)
+#endif /* NBR_TABLE_CONF_WITH_ACCESS_TIME */
+
+/** \brief Neighbor table statistics */
+struct nbr_table_stats {
+  /** Number of neighbors added */
+  unsigned long adds;
+  /** Number of neighbors evicted to make room for another one */
+  unsigned long evictions;
+  /** Number of additions that failed because no neighbor could be evicted */
+  unsigned long failures;
+};
+extern struct nbr_table_stats nbr_table_stats;
+
 /** \name Neighbor tables: register and loop through table elements */
 /** @{ */
 int nbr_table_register(nbr_table_t *table, nbr_table_callback *callback);
@@ -86,6 +148,11 @@ nbr_table_item_t *nbr_table_next(nbr_table_t *table, nbr_table_item_t *item);
 /** @{ */
 nbr_table_item_t *nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr);
 nbr_table_item_t *nbr_table_get_from_lladdr(nbr_table_t *table, const linkaddr_t *lladdr);
+#if NBR_TABLE_WITH_ACCESS_TIME
+void nbr_table_touch(nbr_table_t *table, const nbr_table_item_t *item);
+#else /* NBR_TABLE_WITH_ACCESS_TIME */
+#define nbr_table_touch(table, item)
+#endif /* NBR_TABLE_WITH_ACCESS_TIME */
 /** @} */
 
 /** \name Neighbor tables: set flags (unused, locked, unlocked) */
@@ -98,6 +165,12 @@ int nbr_table_unlock(nbr_table_t *table, nbr_table_item_t *item);
 /** \name Neighbor tables: address manipulation */
 /** @{ */
 linkaddr_t *nbr_table_get_lladdr(nbr_table_t *table, const nbr_table_item_t *item);
+int nbr_table_update_lladdr(nbr_table_t *table, const nbr_table_item_t *item, const linkaddr_t *lladdr);
+/** @} */
+
+/** \name Neighbor tables: statistics */
+/** @{ */
+int nbr_table_num_neighbors(void);
 /** @} */
 
 #endif /* NBR_TABLE_H_ */
@@ -64,6 +64,10 @@ static uint8_t *packetbuf = (uint8_t *)packetbuf_aligned;
 
 static uint8_t *packetbufptr;
 
+/* Owner of the external buffer set with packetbuf_attach(), if any */
+static packetbuf_release_t release;
+static void *release_ptr;
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -72,10 +76,24 @@ static uint8_t *packetbufptr;
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+static void
+detach(void)
+{
+  packetbuf_release_t r;
+
+  if(release != NULL) {
+    r = release;
+    release = NULL;
+    packetbuf = (uint8_t *)packetbuf_aligned;
+    r(release_ptr);
+  }
+}
 /*---------------------------------------------------------------------------*/
 void
 packetbuf_clear(void)
 {
+  detach();
   buflen = bufptr = 0;
   hdrptr = PACKETBUF_HDR_SIZE;
 
@@ -102,6 +120,20 @@ packetbuf_copyfrom(const void *from, uint16_t len)
 }
 /*---------------------------------------------------------------------------*/
 void
+packetbuf_attach(uint8_t *buf, uint8_t hdrlen, uint16_t datalen,
+                 packetbuf_release_t r, void *ptr)
+{
+  detach();
+  packetbuf = buf;
+  packetbufptr = &packetbuf[PACKETBUF_HDR_SIZE];
+  hdrptr = PACKETBUF_HDR_SIZE - hdrlen;
+  bufptr = 0;
+  buflen = datalen;
+  release = r;
+  release_ptr = ptr;
+}
+/*---------------------------------------------------------------------------*/
+void
 packetbuf_compact(void)
 {
   int i, len;
@@ -216,6 +216,31 @@ void packetbuf_compact(void);
  */
 int packetbuf_copyfrom(const void *from, uint16_t len);
 
+typedef void (* packetbuf_release_t)(void *ptr);
+
+/**
+ * \brief      Make the packetbuf use an external buffer instead of its own
+ * \param buf  The external buffer, aligned like the packetbuf and of
+ *             (PACKETBUF_HDR_SIZE + PACKETBUF_SIZE) bytes
+ * \param hdrlen The length of the header, which ends at
+ *             buf + PACKETBUF_HDR_SIZE
+ * \param datalen The length of the data, which starts at
+ *             buf + PACKETBUF_HDR_SIZE
+ * \param release Called with ptr when the packetbuf stops using buf
+ * \param ptr  The argument to release
+ *
+ *             This function lets the packetbuf adopt a buffer that
+ *             already holds a packet, such as a queued packet, so
+ *             that it can be transmitted without copying it. Further
+ *             headers are prepended in the headroom of buf. The
+ *             packetbuf uses buf until the next call to
+ *             packetbuf_clear(), packetbuf_copyfrom() or
+ *             packetbuf_attach(). The attributes are not affected.
+ *
+ */
+void packetbuf_attach(uint8_t *buf, uint8_t hdrlen, uint16_t datalen,
+                      packetbuf_release_t release, void *ptr);
+
 /**
  * \brief      Copy the entire packetbuf to an external buffer
  * \param to   A pointer to the buffer to which the data is to be copied
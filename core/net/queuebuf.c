@@ -72,14 +72,33 @@ struct queuebuf {
 
 /* The actual queuebuf data */
 struct queuebuf_data {
+#if QUEUEBUF_ZERO_COPY
+  /* Laid out like the packetbuf: headroom, then the packet. The
+     first hdrlen bytes of the packet are in the headroom. */
+  uint32_t aligned[(PACKETBUF_HDR_SIZE + PACKETBUF_SIZE + 3) / 4];
+  uint8_t hdrlen;
+  /* References by the queuebuf and by the packetbuf */
+  uint8_t refs;
+#else /* QUEUEBUF_ZERO_COPY */
   uint8_t data[PACKETBUF_SIZE];
+#endif /* QUEUEBUF_ZERO_COPY */
   uint16_t len;
   struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
   struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
 };
 
+#if QUEUEBUF_ZERO_COPY
+#define STORAGE(d) ((uint8_t *)(d)->aligned)
+#define DATA(d) (STORAGE(d) + PACKETBUF_HDR_SIZE - (d)->hdrlen)
+/* One more, for a freed packet that the packetbuf still uses */
+#define QUEUEBUFRAM_SLOTS (QUEUEBUFRAM_NUM + 1)
+#else /* QUEUEBUF_ZERO_COPY */
+#define DATA(d) ((d)->data)
+#define QUEUEBUFRAM_SLOTS QUEUEBUFRAM_NUM
+#endif /* QUEUEBUF_ZERO_COPY */
+
 MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM);
-MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
+MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_SLOTS);
 
 #if WITH_SWAP
 
@@ -275,6 +294,26 @@ queuebuf_load_to_ram(struct queuebuf *b)
   return b->ram_ptr;
 }
 #endif /* WITH_SWAP */
+#if QUEUEBUF_ZERO_COPY
+/*---------------------------------------------------------------------------*/
+static void
+release(void *ptr)
+{
+  struct queuebuf_data *d = ptr;
+
+  if(--d->refs == 0) {
+    memb_free(&buframmem, d);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_attached(struct queuebuf_data *d)
+{
+  uint8_t *hdr = packetbuf_hdrptr();
+
+  return hdr >= STORAGE(d) && hdr < STORAGE(d) + sizeof(d->aligned);
+}
+#endif /* QUEUEBUF_ZERO_COPY */
 /*---------------------------------------------------------------------------*/
 void
 queuebuf_init(void)
@@ -339,7 +378,11 @@ queuebuf_new_from_packetbuf(void)
     buframptr = buf->ram_ptr;
 #endif
 
-    buframptr->len = packetbuf_copyto(buframptr->data);
+#if QUEUEBUF_ZERO_COPY
+    buframptr->refs = 1;
+    buframptr->hdrlen = 0;
+#endif /* QUEUEBUF_ZERO_COPY */
+    buframptr->len = packetbuf_copyto(DATA(buframptr));
     packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
 
 #if WITH_SWAP
@@ -383,7 +426,17 @@ queuebuf_update_from_packetbuf(struct queuebuf *buf)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
   packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
-  buframptr->len = packetbuf_copyto(buframptr->data);
+#if QUEUEBUF_ZERO_COPY
+  if(is_attached(buframptr)) {
+    /* The packet is in place; only keep what was prepended to it */
+    packetbuf_compact();
+    buframptr->hdrlen = packetbuf_hdrlen();
+    buframptr->len = packetbuf_totlen();
+    return;
+  }
+  buframptr->hdrlen = 0;
+#endif /* QUEUEBUF_ZERO_COPY */
+  buframptr->len = packetbuf_copyto(DATA(buframptr));
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
     queuebuf_flush_tmpdata();
@@ -401,6 +454,8 @@ queuebuf_free(struct queuebuf *buf)
     } else {
       queuebuf_remove_from_file(buf->swap_id);
     }
+#elif QUEUEBUF_ZERO_COPY
+    release(buf->ram_ptr);
 #else
     memb_free(&buframmem, buf->ram_ptr);
 #endif
@@ -420,17 +475,34 @@ queuebuf_to_packetbuf(struct queuebuf *b)
 {
   if(memb_inmemb(&bufmem, b)) {
     struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
-    packetbuf_copyfrom(buframptr->data, buframptr->len);
+    packetbuf_copyfrom(DATA(buframptr), buframptr->len);
     packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+queuebuf_attach_to_packetbuf(struct queuebuf *b)
+{
+#if QUEUEBUF_ZERO_COPY
+  struct queuebuf_data *d;
+
+  if(memb_inmemb(&bufmem, b)) {
+    d = b->ram_ptr;
+    d->refs++;
+    packetbuf_attach(STORAGE(d), d->hdrlen, d->len - d->hdrlen, release, d);
+    packetbuf_attr_copyfrom(d->attrs, d->addrs);
+  }
+#else /* QUEUEBUF_ZERO_COPY */
+  queuebuf_to_packetbuf(b);
+#endif /* QUEUEBUF_ZERO_COPY */
+}
+/*---------------------------------------------------------------------------*/
 void *
 queuebuf_dataptr(struct queuebuf *b)
 {
   if(memb_inmemb(&bufmem, b)) {
     struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
-    return buframptr->data;
+    return DATA(buframptr);
   }
   return NULL;
 }
@@ -79,6 +79,20 @@
   #define WITH_SWAP 0
 #endif /* QUEUEBUFRAM_CONF_NUM */
 
+/* With QUEUEBUF_CONF_ZERO_COPY, queued packets can be transmitted
+   from their queuebuf without being copied into the packetbuf, see
+   queuebuf_attach_to_packetbuf(). Each queuebuf then reserves
+   PACKETBUF_HDR_SIZE bytes of headroom for the link-layer header. */
+#ifdef QUEUEBUF_CONF_ZERO_COPY
+#define QUEUEBUF_ZERO_COPY QUEUEBUF_CONF_ZERO_COPY
+#else /* QUEUEBUF_CONF_ZERO_COPY */
+#define QUEUEBUF_ZERO_COPY 0
+#endif /* QUEUEBUF_CONF_ZERO_COPY */
+
+#if QUEUEBUF_ZERO_COPY && WITH_SWAP
+#error "QUEUEBUF_CONF_ZERO_COPY cannot be used with swapping"
+#endif
+
 #ifdef QUEUEBUF_CONF_DEBUG
 #define QUEUEBUF_DEBUG QUEUEBUF_CONF_DEBUG
 #else /* QUEUEBUF_CONF_DEBUG */
@@ -99,6 +113,15 @@ void queuebuf_update_attr_from_packetbuf(struct queuebuf *b);
 void queuebuf_update_from_packetbuf(struct queuebuf *b);
 
 void queuebuf_to_packetbuf(struct queuebuf *b);
+
+/* Like queuebuf_to_packetbuf(), but with QUEUEBUF_CONF_ZERO_COPY the
+   packetbuf uses the storage of the queuebuf instead of a copy. The
+   packet data must then not be modified; headers prepended with
+   packetbuf_hdralloc() go to the headroom of the queuebuf and are
+   kept by queuebuf_update_from_packetbuf() without copying. The
+   storage stays valid until both the queuebuf is freed and the
+   packetbuf is cleared. */
+void queuebuf_attach_to_packetbuf(struct queuebuf *b);
 void queuebuf_free(struct queuebuf *b);
 
 void *queuebuf_dataptr(struct queuebuf *b);
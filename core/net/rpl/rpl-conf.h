@@ -146,6 +146,40 @@
   #define RPL_DAO_SPECIFY_DAG RPL_CONF_DAO_SPECIFY_DAG
 #endif /* RPL_CONF_DAO_SPECIFY_DAG */
 
+/*
+ * DAO aggregation. When enabled, a node does not forward the DAOs of
+ * its children one by one. It queues their targets for
+ * RPL_DAO_AGGREGATION_DELAY and sends them to its preferred parent as
+ * a single DAO carrying multiple Target options. Its own periodic DAO
+ * also picks up whatever is queued. This bounds the number of DAOs a
+ * route repair in a large subtree pushes towards the root.
+ */
+#ifdef RPL_CONF_DAO_AGGREGATION
+#define RPL_DAO_AGGREGATION         RPL_CONF_DAO_AGGREGATION
+#else
+#define RPL_DAO_AGGREGATION         1
+#endif /* RPL_CONF_DAO_AGGREGATION */
+
+/*
+ * How long a queued target may wait for others to join it.
+ */
+#ifdef RPL_CONF_DAO_AGGREGATION_DELAY
+#define RPL_DAO_AGGREGATION_DELAY   RPL_CONF_DAO_AGGREGATION_DELAY
+#else
+#define RPL_DAO_AGGREGATION_DELAY   CLOCK_SECOND
+#endif /* RPL_CONF_DAO_AGGREGATION_DELAY */
+
+/*
+ * Maximum number of targets in an aggregated DAO. A full queue is
+ * sent without waiting for the delay to expire. Each target costs 26
+ * bytes in the DAO.
+ */
+#ifdef RPL_CONF_DAO_AGGREGATION_MAX_TARGETS
+#define RPL_DAO_AGGREGATION_MAX_TARGETS RPL_CONF_DAO_AGGREGATION_MAX_TARGETS
+#else
+#define RPL_DAO_AGGREGATION_MAX_TARGETS 8
+#endif /* RPL_CONF_DAO_AGGREGATION_MAX_TARGETS */
+
 /*
  * The DIO interval (n) represents 2^n ms.
  *
@@ -254,15 +288,6 @@
 #define RPL_PROBING_INTERVAL (120 * CLOCK_SECOND)
 #endif
 
-/*
- * RPL probing expiration time.
- * */
-#ifdef RPL_CONF_PROBING_EXPIRATION_TIME
-#define RPL_PROBING_EXPIRATION_TIME RPL_CONF_PROBING_EXPIRATION_TIME
-#else
-#define RPL_PROBING_EXPIRATION_TIME (10 * 60 * CLOCK_SECOND)
-#endif
-
 /*
  * Function used to select the next parent to be probed.
  * */
@@ -296,4 +321,60 @@
     + random_rand() % (RPL_PROBING_INTERVAL))
 #endif
 
+/*
+ * RPL fast join. When enabled, a node that has no route upwards (at
+ * boot or after a local repair) multicasts a DIS right away instead
+ * of waiting for the periodic DIS or for its neighbors' Trickle
+ * timers. Attached neighbors answer with a unicast DIO after a random
+ * delay within RPL_FAST_JOIN_REPLY_WINDOW. To keep a dense
+ * neighborhood from answering all at once, each of them replies with
+ * a probability chosen so that about RPL_FAST_JOIN_RESPONDERS
+ * neighbors answer. The first DAO is sent as soon as a parent is
+ * selected.
+ * */
+#ifdef RPL_CONF_WITH_FAST_JOIN
+#define RPL_WITH_FAST_JOIN RPL_CONF_WITH_FAST_JOIN
+#else
+#define RPL_WITH_FAST_JOIN 0
+#endif
+
+/*
+ * Delay before the first DIS, and the number of DIS attempts. The
+ * interval between attempts doubles every time.
+ * */
+#ifdef RPL_CONF_FAST_JOIN_DIS_INTERVAL
+#define RPL_FAST_JOIN_DIS_INTERVAL RPL_CONF_FAST_JOIN_DIS_INTERVAL
+#else
+#define RPL_FAST_JOIN_DIS_INTERVAL (CLOCK_SECOND / 2)
+#endif
+
+#ifdef RPL_CONF_FAST_JOIN_DIS_ATTEMPTS
+#define RPL_FAST_JOIN_DIS_ATTEMPTS RPL_CONF_FAST_JOIN_DIS_ATTEMPTS
+#else
+#define RPL_FAST_JOIN_DIS_ATTEMPTS 5
+#endif
+
+#ifdef RPL_CONF_FAST_JOIN_REPLY_WINDOW
+#define RPL_FAST_JOIN_REPLY_WINDOW RPL_CONF_FAST_JOIN_REPLY_WINDOW
+#else
+#define RPL_FAST_JOIN_REPLY_WINDOW (CLOCK_SECOND / 2)
+#endif
+
+#ifdef RPL_CONF_FAST_JOIN_RESPONDERS
+#define RPL_FAST_JOIN_RESPONDERS RPL_CONF_FAST_JOIN_RESPONDERS
+#else
+#define RPL_FAST_JOIN_RESPONDERS 3
+#endif
+
+/*
+ * Join-time instrumentation. When enabled, the time at which each
+ * stage of joining the network is first reached is recorded, see
+ * rpl_join_stage_time().
+ * */
+#ifdef RPL_CONF_WITH_JOIN_STATS
+#define RPL_WITH_JOIN_STATS RPL_CONF_WITH_JOIN_STATS
+#else
+#define RPL_WITH_JOIN_STATS 0
+#endif
+
 #endif /* RPL_CONF_H */
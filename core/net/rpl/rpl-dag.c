@@ -64,6 +64,8 @@
 extern rpl_of_t RPL_OF;
 static rpl_of_t * const objective_functions[] = {&RPL_OF};
 
+static rpl_parent_t *select_parent(rpl_dag_t *dag, rpl_parent_t *changed);
+
 /*---------------------------------------------------------------------------*/
 /* RPL definitions. */
 
@@ -94,13 +96,15 @@ rpl_print_neighbor_list()
 
     printf("RPL: rank %u dioint %u, %u nbr(s)\n", curr_rank, curr_dio_interval, uip_ds6_nbr_num());
     while(p != NULL) {
-      uip_ds6_nbr_t *nbr = rpl_get_nbr(p);
-      printf("RPL: nbr %3u %5u, %5u => %5u %c (last tx %u min ago)\n",
+      const struct link_stats *stats = rpl_get_parent_link_stats(p);
+      printf("RPL: nbr %3u %5u, %5u => %5u %c%c (last tx %u min ago)\n",
           nbr_table_get_lladdr(rpl_parents, p)->u8[7],
-          p->rank, nbr ? nbr->link_metric : 0,
+          p->rank, rpl_get_parent_link_metric(p),
           default_instance->of->calculate_rank(p, 0),
           p == default_instance->current_dag->preferred_parent ? '*' : ' ',
-          (unsigned)((now - p->last_tx_time) / (60 * CLOCK_SECOND)));
+          link_stats_is_fresh(stats) ? 'f' : ' ',
+          stats != NULL ?
+          (unsigned)((now - stats->last_tx_time) / (60 * CLOCK_SECOND)) : 0);
       p = nbr_table_next(rpl_parents, p);
     }
     printf("RPL: end of list\n");
@@ -149,17 +153,30 @@ rpl_get_parent_rank(uip_lladdr_t *addr)
   }
 }
 /*---------------------------------------------------------------------------*/
+const struct link_stats *
+rpl_get_parent_link_stats(rpl_parent_t *p)
+{
+  return link_stats_from_lladdr(nbr_table_get_lladdr(rpl_parents, p));
+}
+/*---------------------------------------------------------------------------*/
 uint16_t
-rpl_get_parent_link_metric(const uip_lladdr_t *addr)
+rpl_get_parent_link_metric(rpl_parent_t *p)
 {
-  uip_ds6_nbr_t *nbr;
-  nbr = nbr_table_get_from_lladdr(ds6_neighbors, (const linkaddr_t *)addr);
-  
-  if(nbr != NULL) {
-    return nbr->link_metric;
-  } else {
-    return 0;
+  const struct link_stats *stats = rpl_get_parent_link_stats(p);
+  uint32_t metric;
+
+  if(stats == NULL || stats->tx_count == 0) {
+    /* Nothing measured yet */
+    return RPL_INIT_LINK_METRIC * RPL_DAG_MC_ETX_DIVISOR;
   }
+  metric = (uint32_t)stats->etx * RPL_DAG_MC_ETX_DIVISOR / LINK_STATS_ETX_DIVISOR;
+  return metric > 0xffff ? 0xffff : metric;
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_parent_is_fresh(rpl_parent_t *p)
+{
+  return link_stats_is_fresh(rpl_get_parent_link_stats(p));
 }
 /*---------------------------------------------------------------------------*/
 uip_ipaddr_t *
@@ -192,6 +209,9 @@ rpl_set_preferred_parent(rpl_dag_t *dag, rpl_parent_t *p)
     nbr_table_unlock(rpl_parents, dag->preferred_parent);
     nbr_table_lock(rpl_parents, p);
     dag->preferred_parent = p;
+    if(p != NULL) {
+      rpl_join_stage_reached(RPL_JOIN_STAGE_PARENT_SELECTED);
+    }
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -485,6 +505,7 @@ rpl_set_default_route(rpl_instance_t *instance, uip_ipaddr_t *from)
     if(instance->def_route == NULL) {
       return 0;
     }
+    rpl_join_stage_reached(RPL_JOIN_STAGE_DEFAULT_ROUTE);
   } else {
     PRINTF("RPL: Removing default route\n");
     if(instance->def_route != NULL) {
@@ -629,17 +650,11 @@ rpl_add_parent(rpl_dag_t *dag, rpl_dio_t *dio, uip_ipaddr_t *addr)
     if(p == NULL) {
       PRINTF("RPL: rpl_add_parent p NULL\n");
     } else {
-      uip_ds6_nbr_t *nbr;
-      nbr = rpl_get_nbr(p);
-
+      /* Keep the link statistics the OF relies on while p is a parent */
+      link_stats_lock((linkaddr_t *)lladdr);
       p->dag = dag;
       p->rank = dio->rank;
       p->dtsn = dio->dtsn;
-      
-      /* Check whether we have a neighbor that has not gotten a link metric yet */
-      if(nbr != NULL && nbr->link_metric == 0) {
-	nbr->link_metric = RPL_INIT_LINK_METRIC * RPL_DAG_MC_ETX_DIVISOR;
-      }
 #if RPL_DAG_MC != RPL_DAG_MC_NONE
       memcpy(&p->mc, &dio->mc, sizeof(p->mc));
 #endif /* RPL_DAG_MC != RPL_DAG_MC_NONE */
@@ -702,7 +717,7 @@ rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
 
   best_dag = instance->current_dag;
   if(best_dag->rank != ROOT_RANK(instance)) {
-    if(rpl_select_parent(p->dag) != NULL) {
+    if(select_parent(p->dag, p) != NULL) {
       if(p->dag != best_dag) {
         best_dag = instance->of->best_dag(best_dag, p->dag);
       }
@@ -785,10 +800,25 @@ rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
 }
 /*---------------------------------------------------------------------------*/
 static rpl_parent_t *
-best_parent(rpl_dag_t *dag)
+best_parent(rpl_dag_t *dag, rpl_parent_t *changed)
 {
   rpl_parent_t *p, *best;
 
+  best = dag->preferred_parent;
+  if(changed != NULL && changed != best && best != NULL &&
+     best->dag == dag && best->rank != INFINITE_RANK) {
+    /*
+     * Every other candidate lost against the preferred parent when it was
+     * last evaluated, so only the parent that changed can overtake it.
+     * This keeps the cost of a DIO constant in dense neighborhoods.
+     */
+    if(changed->dag != dag || changed->rank == INFINITE_RANK) {
+      return best;
+    }
+    return dag->instance->of->best_parent(best, changed);
+  }
+
+  /* The preferred parent changed, or there is none: rescan all candidates. */
   best = NULL;
 
   p = nbr_table_head(rpl_parents);
@@ -806,10 +836,10 @@ best_parent(rpl_dag_t *dag)
   return best;
 }
 /*---------------------------------------------------------------------------*/
-rpl_parent_t *
-rpl_select_parent(rpl_dag_t *dag)
+static rpl_parent_t *
+select_parent(rpl_dag_t *dag, rpl_parent_t *changed)
 {
-  rpl_parent_t *best = best_parent(dag);
+  rpl_parent_t *best = best_parent(dag, changed);
 
   if(best != NULL) {
     rpl_set_preferred_parent(dag, best);
@@ -821,6 +851,12 @@ rpl_select_parent(rpl_dag_t *dag)
   return best;
 }
 /*---------------------------------------------------------------------------*/
+rpl_parent_t *
+rpl_select_parent(rpl_dag_t *dag)
+{
+  return select_parent(dag, NULL);
+}
+/*---------------------------------------------------------------------------*/
 void
 rpl_remove_parent(rpl_parent_t *parent)
 {
@@ -830,6 +866,7 @@ rpl_remove_parent(rpl_parent_t *parent)
 
   rpl_nullify_parent(parent);
 
+  link_stats_unlock(nbr_table_get_lladdr(rpl_parents, parent));
   nbr_table_remove(rpl_parents, parent);
 }
 /*---------------------------------------------------------------------------*/
@@ -886,6 +923,7 @@ rpl_move_parent(rpl_dag_t *dag_src, rpl_dag_t *dag_dst, rpl_parent_t *parent)
   PRINTF("\n");
 
   parent->dag = dag_dst;
+  parent->flags &= ~RPL_PARENT_FLAG_PATH_COST_VALID;
 }
 /*---------------------------------------------------------------------------*/
 rpl_dag_t *
@@ -1018,7 +1056,11 @@ rpl_join_instance(uip_ipaddr_t *from, rpl_dio_t *dio)
   rpl_set_default_route(instance, from);
 
   if(instance->mop != RPL_MOP_NO_DOWNWARD_ROUTES) {
+#if RPL_WITH_FAST_JOIN
+    rpl_schedule_dao_immediately(instance);
+#else /* RPL_WITH_FAST_JOIN */
     rpl_schedule_dao(instance);
+#endif /* RPL_WITH_FAST_JOIN */
   } else {
     PRINTF("RPL: The DIO does not meet the prerequisites for sending a DAO\n");
   }
@@ -1061,6 +1103,7 @@ rpl_add_dag(uip_ipaddr_t *from, rpl_dio_t *dio)
     }
   }
   p->rank = dio->rank;
+  p->flags &= ~RPL_PARENT_FLAG_PATH_COST_VALID;
 
   /* Determine the objective function by using the
      objective code point of the DIO. */
@@ -1162,6 +1205,9 @@ rpl_local_repair(rpl_instance_t *instance)
   }
 
   rpl_reset_dio_timer(instance);
+#if RPL_WITH_FAST_JOIN
+  rpl_schedule_fast_join();
+#endif /* RPL_WITH_FAST_JOIN */
 
   RPL_STAT(rpl_stats.local_repairs++);
 }
@@ -1379,15 +1425,16 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
   }
   p->rank = dio->rank;
 
-  /* Parent info has been updated, trigger rank recalculation */
-  p->flags |= RPL_PARENT_FLAG_UPDATED;
+  /* Parent info has been updated. It is processed right away below, so
+     there is no need to flag it for the periodic rank recalculation. */
+  p->flags &= ~(RPL_PARENT_FLAG_UPDATED | RPL_PARENT_FLAG_PATH_COST_VALID);
 
   PRINTF("RPL: preferred DAG ");
   PRINT6ADDR(&instance->current_dag->dag_id);
   PRINTF(", rank %u, min_rank %u, ",
 	 instance->current_dag->rank, instance->current_dag->min_rank);
   PRINTF("parent rank %u, parent etx %u, link metric %u, instance etx %u\n",
-	 p->rank, -1/*p->mc.obj.etx*/, rpl_get_nbr(p)->link_metric, instance->mc.obj.etx);
+	 p->rank, -1/*p->mc.obj.etx*/, rpl_get_parent_link_metric(p), instance->mc.obj.etx);
 
   /* We have allocated a candidate parent; process the DIO further. */
 
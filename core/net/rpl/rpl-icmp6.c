@@ -53,6 +53,7 @@
 #include "net/rpl/rpl-private.h"
 #include "net/packetbuf.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
+#include "sys/energest.h"
 
 #include <limits.h>
 #include <string.h>
@@ -92,6 +93,22 @@ extern rpl_of_t RPL_OF;
 #if RPL_CONF_MULTICAST
 static uip_mcast6_route_t *mcast_group;
 #endif
+
+#if RPL_DAO_AGGREGATION
+/* Targets waiting to be sent upwards in a single DAO. */
+struct dao_target {
+  uip_ipaddr_t prefix;
+  uint8_t prefixlen;
+  uint8_t lifetime;
+};
+static struct dao_target dao_targets[RPL_DAO_AGGREGATION_MAX_TARGETS];
+static uint8_t dao_target_count;
+static rpl_instance_t *dao_target_instance;
+
+static int dao_queue_has_room(rpl_instance_t *, int);
+static int dao_queue_target(rpl_instance_t *, uip_ipaddr_t *, uint8_t, uint8_t);
+static void dao_unqueue_target(uip_ipaddr_t *, uint8_t);
+#endif /* RPL_DAO_AGGREGATION */
 /*---------------------------------------------------------------------------*/
 /* Initialise RPL ICMPv6 message handlers */
 UIP_ICMP6_HANDLER(dis_handler, ICMP6_RPL, RPL_CODE_DIS, dis_input);
@@ -153,6 +170,7 @@ dis_input(void)
   rpl_instance_t *instance;
   rpl_instance_t *end;
 
+  ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_RPL);
   /* DAG Information Solicitation */
   PRINTF("RPL: Received a DIS from ");
   PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
@@ -166,6 +184,13 @@ dis_input(void)
 	PRINTF("RPL: LEAF ONLY Multicast DIS will NOT reset DIO timer\n");
 #else /* !RPL_LEAF_ONLY */
       if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
+#if RPL_WITH_FAST_JOIN
+        if(instance->current_dag->rank != INFINITE_RANK) {
+          PRINTF("RPL: Multicast DIS => delayed unicast DIO\n");
+          rpl_schedule_dio_reply(instance, &UIP_IP_BUF->srcipaddr);
+          continue;
+        }
+#endif /* RPL_WITH_FAST_JOIN */
         PRINTF("RPL: Multicast DIS => reset DIO timer\n");
         rpl_reset_dio_timer(instance);
       } else {
@@ -176,6 +201,7 @@ dis_input(void)
     }
   }
   uip_clear_buf();
+  ENERGEST_SUBSYSTEM_LEAVE();
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -220,6 +246,7 @@ dio_input(void)
   uip_ipaddr_t from;
   uip_ds6_nbr_t *nbr;
 
+  ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_RPL);
   memset(&dio, 0, sizeof(dio));
 
   /* Set default values in case the DIO configuration option is missing. */
@@ -239,6 +266,8 @@ dio_input(void)
   PRINT6ADDR(&from);
   PRINTF("\n");
 
+  rpl_join_stage_reached(RPL_JOIN_STAGE_FIRST_DIO);
+
   if((nbr = uip_ds6_nbr_lookup(&from)) == NULL) {
     if((nbr = uip_ds6_nbr_add(&from, (uip_lladdr_t *)
                               packetbuf_addr(PACKETBUF_ADDR_SENDER),
@@ -421,6 +450,7 @@ dio_input(void)
 
  discard:
   uip_clear_buf();
+  ENERGEST_SUBSYSTEM_LEAVE();
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -577,6 +607,167 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
 #endif /* RPL_LEAF_ONLY */
 }
 /*---------------------------------------------------------------------------*/
+static int
+dao_input_target(rpl_instance_t *instance, uip_ipaddr_t *dao_sender_addr,
+                 int learned_from, uip_ipaddr_t *prefix, uint8_t prefixlen,
+                 uint8_t lifetime)
+{
+  rpl_dag_t *dag;
+  uip_ds6_route_t *rep;
+  uip_ds6_nbr_t *nbr;
+
+  dag = instance->current_dag;
+
+  PRINTF("RPL: DAO lifetime: %u, prefix length: %u prefix: ",
+          (unsigned)lifetime, (unsigned)prefixlen);
+  PRINT6ADDR(prefix);
+  PRINTF("\n");
+
+#if RPL_CONF_MULTICAST
+  if(uip_is_addr_mcast_global(prefix)) {
+    mcast_group = uip_mcast6_route_add(prefix);
+    if(mcast_group) {
+      mcast_group->dag = dag;
+      mcast_group->lifetime = RPL_LIFETIME(instance, lifetime);
+    }
+    return learned_from == RPL_ROUTE_FROM_UNICAST_DAO;
+  }
+#endif
+
+  rep = uip_ds6_route_lookup(prefix);
+
+  if(lifetime == RPL_ZERO_LIFETIME) {
+    PRINTF("RPL: No-Path DAO received\n");
+    /* No-Path DAO received; invoke the route purging routine. */
+    if(rep != NULL &&
+       rep->state.nopath_received == 0 &&
+       rep->length == prefixlen &&
+       uip_ds6_route_nexthop(rep) != NULL &&
+       uip_ipaddr_cmp(uip_ds6_route_nexthop(rep), dao_sender_addr)) {
+      PRINTF("RPL: Setting expiration timer for prefix ");
+      PRINT6ADDR(prefix);
+      PRINTF("\n");
+      rep->state.nopath_received = 1;
+      rep->state.lifetime = DAO_EXPIRATION_TIMEOUT;
+
+      /* We forward the incoming no-path DAO to our parent, if we have
+         one. */
+      return 1;
+    }
+    return 0;
+  }
+
+  PRINTF("RPL: adding DAO route\n");
+
+  if((nbr = uip_ds6_nbr_lookup(dao_sender_addr)) == NULL) {
+    if((nbr = uip_ds6_nbr_add(dao_sender_addr,
+                              (uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                              0, NBR_REACHABLE)) != NULL) {
+      /* set reachable timer */
+      stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
+      PRINTF("RPL: Neighbor added to neighbor cache ");
+      PRINT6ADDR(dao_sender_addr);
+      PRINTF(", ");
+      PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
+      PRINTF("\n");
+    } else {
+      PRINTF("RPL: Out of Memory, dropping DAO from ");
+      PRINT6ADDR(dao_sender_addr);
+      PRINTF(", ");
+      PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
+      PRINTF("\n");
+      return 0;
+    }
+  } else {
+    PRINTF("RPL: Neighbor already in neighbor cache\n");
+  }
+
+  rep = rpl_add_route(dag, prefix, prefixlen, dao_sender_addr);
+  if(rep == NULL) {
+    RPL_STAT(rpl_stats.mem_overflows++);
+    PRINTF("RPL: Could not add a route after receiving a DAO\n");
+    return 0;
+  }
+
+  rep->state.lifetime = RPL_LIFETIME(instance, lifetime);
+  rep->state.learned_from = learned_from;
+  rep->state.nopath_received = 0;
+
+  return learned_from == RPL_ROUTE_FROM_UNICAST_DAO;
+}
+/*---------------------------------------------------------------------------*/
+#if RPL_DAO_AGGREGATION
+/* Count the Target options found in buffer[start..end). */
+static int
+dao_count_targets(unsigned char *buffer, int start, int end)
+{
+  int targets;
+  int len;
+  int i;
+
+  targets = 0;
+  for(i = start; i < end; i += len) {
+    len = buffer[i] == RPL_OPTION_PAD1 ? 1 : 2 + buffer[i + 1];
+    targets += buffer[i] == RPL_OPTION_TARGET;
+  }
+  return targets;
+}
+#endif /* RPL_DAO_AGGREGATION */
+/*---------------------------------------------------------------------------*/
+/*
+ * Process the Target options found in buffer[start..end). They all
+ * share the lifetime of the Transit option that follows them.
+ * Returns the number of targets that should be propagated upwards.
+ * Unless the DAO is to be relayed as is, these targets are queued for
+ * aggregation.
+ */
+static int
+dao_input_targets(rpl_instance_t *instance, uip_ipaddr_t *dao_sender_addr,
+                  int learned_from, unsigned char *buffer, int start, int end,
+                  uint8_t lifetime, int relay)
+{
+  uip_ipaddr_t prefix;
+  uint8_t prefixlen;
+  int forward;
+  int len;
+  int i;
+
+  forward = 0;
+  for(i = start; i < end; i += len) {
+    if(buffer[i] == RPL_OPTION_PAD1) {
+      len = 1;
+      continue;
+    }
+    len = 2 + buffer[i + 1];
+    if(buffer[i] != RPL_OPTION_TARGET) {
+      continue;
+    }
+
+    prefixlen = buffer[i + 3];
+    if(prefixlen > sizeof(prefix) * CHAR_BIT ||
+       len < 4 + (prefixlen + 7) / CHAR_BIT) {
+      PRINTF("RPL: Ignoring a malformed DAO target\n");
+      continue;
+    }
+    memset(&prefix, 0, sizeof(prefix));
+    memcpy(&prefix, buffer + i + 4, (prefixlen + 7) / CHAR_BIT);
+
+    if(dao_input_target(instance, dao_sender_addr, learned_from,
+                        &prefix, prefixlen, lifetime)) {
+#if RPL_DAO_AGGREGATION
+      if(relay) {
+        /* A queued copy would be sent after the relayed one. */
+        dao_unqueue_target(&prefix, prefixlen);
+      } else if(instance->current_dag->preferred_parent != NULL) {
+        dao_queue_target(instance, &prefix, prefixlen, lifetime);
+      }
+#endif /* RPL_DAO_AGGREGATION */
+      forward++;
+    }
+  }
+  return forward;
+}
+/*---------------------------------------------------------------------------*/
 static void
 dao_input(void)
 {
@@ -587,24 +778,23 @@ dao_input(void)
   uint16_t sequence;
   uint8_t instance_id;
   uint8_t lifetime;
-  uint8_t prefixlen;
   uint8_t flags;
   uint8_t subopt_type;
   /*
   uint8_t pathcontrol;
   uint8_t pathsequence;
   */
-  uip_ipaddr_t prefix;
-  uip_ds6_route_t *rep;
   uint8_t buffer_length;
   int pos;
   int len;
   int i;
+  int targets_start;
+  int forward;
+  int relay;
   int learned_from;
   rpl_parent_t *parent;
-  uip_ds6_nbr_t *nbr;
 
-  prefixlen = 0;
+  ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_RPL);
   parent = NULL;
 
   uip_ipaddr_copy(&dao_sender_addr, &UIP_IP_BUF->srcipaddr);
@@ -659,7 +849,7 @@ dao_input(void)
       PRINTF("RPL: Loop detected when receiving a unicast DAO from a node with a lower rank! (%u < %u)\n",
           DAG_RANK(parent->rank, instance), DAG_RANK(dag->rank, instance));
       parent->rank = INFINITE_RANK;
-      parent->flags |= RPL_PARENT_FLAG_UPDATED;
+      RPL_PARENT_UPDATED(parent);
       goto discard;
     }
 
@@ -667,12 +857,30 @@ dao_input(void)
     if(parent != NULL && parent == dag->preferred_parent) {
       PRINTF("RPL: Loop detected when receiving a unicast DAO from our parent\n");
       parent->rank = INFINITE_RANK;
-      parent->flags |= RPL_PARENT_FLAG_UPDATED;
+      RPL_PARENT_UPDATED(parent);
       goto discard;
     }
   }
 
-  /* Check if there are any RPL options present. */
+  /*
+   * A DAO may carry several groups of Target options, each followed
+   * by the Transit option that applies to the whole group. Targets
+   * that are not followed by a Transit option get the default
+   * lifetime.
+   */
+  forward = 0;
+#if RPL_DAO_AGGREGATION
+  /*
+   * Either all targets go into the queue or the DAO is relayed as is,
+   * so that no target is sent upwards twice. The queue cannot be
+   * flushed here: that would overwrite the DAO we are parsing.
+   */
+  relay = !dao_queue_has_room(instance,
+                              dao_count_targets(buffer, pos, buffer_length));
+#else /* RPL_DAO_AGGREGATION */
+  relay = 1;
+#endif /* RPL_DAO_AGGREGATION */
+  targets_start = pos;
   for(i = pos; i < buffer_length; i += len) {
     subopt_type = buffer[i];
     if(subopt_type == RPL_OPTION_PAD1) {
@@ -682,114 +890,25 @@ dao_input(void)
       len = 2 + buffer[i + 1];
     }
 
-    switch(subopt_type) {
-    case RPL_OPTION_TARGET:
-      /* Handle the target option. */
-      prefixlen = buffer[i + 3];
-      memset(&prefix, 0, sizeof(prefix));
-      memcpy(&prefix, buffer + i + 4, (prefixlen + 7) / CHAR_BIT);
-      break;
-    case RPL_OPTION_TRANSIT:
+    if(subopt_type == RPL_OPTION_TRANSIT) {
       /* The path sequence and control are ignored. */
       /*      pathcontrol = buffer[i + 3];
               pathsequence = buffer[i + 4];*/
       lifetime = buffer[i + 5];
       /* The parent address is also ignored. */
-      break;
+      forward += dao_input_targets(instance, &dao_sender_addr, learned_from,
+                                   buffer, targets_start, i, lifetime, relay);
+      targets_start = i + len;
     }
   }
-
-  PRINTF("RPL: DAO lifetime: %u, prefix length: %u prefix: ",
-          (unsigned)lifetime, (unsigned)prefixlen);
-  PRINT6ADDR(&prefix);
-  PRINTF("\n");
-
-#if RPL_CONF_MULTICAST
-  if(uip_is_addr_mcast_global(&prefix)) {
-    mcast_group = uip_mcast6_route_add(&prefix);
-    if(mcast_group) {
-      mcast_group->dag = dag;
-      mcast_group->lifetime = RPL_LIFETIME(instance, lifetime);
-    }
-    goto fwd_dao;
-  }
-#endif
-
-  rep = uip_ds6_route_lookup(&prefix);
-
-  if(lifetime == RPL_ZERO_LIFETIME) {
-    PRINTF("RPL: No-Path DAO received\n");
-    /* No-Path DAO received; invoke the route purging routine. */
-    if(rep != NULL &&
-       rep->state.nopath_received == 0 &&
-       rep->length == prefixlen &&
-       uip_ds6_route_nexthop(rep) != NULL &&
-       uip_ipaddr_cmp(uip_ds6_route_nexthop(rep), &dao_sender_addr)) {
-      PRINTF("RPL: Setting expiration timer for prefix ");
-      PRINT6ADDR(&prefix);
-      PRINTF("\n");
-      rep->state.nopath_received = 1;
-      rep->state.lifetime = DAO_EXPIRATION_TIMEOUT;
-
-      /* We forward the incoming no-path DAO to our parent, if we have
-         one. */
-      if(dag->preferred_parent != NULL &&
-         rpl_get_parent_ipaddr(dag->preferred_parent) != NULL) {
-        PRINTF("RPL: Forwarding no-path DAO to parent ");
-        PRINT6ADDR(rpl_get_parent_ipaddr(dag->preferred_parent));
-        PRINTF("\n");
-        uip_icmp6_send(rpl_get_parent_ipaddr(dag->preferred_parent),
-                       ICMP6_RPL, RPL_CODE_DAO, buffer_length);
-      }
-      if(flags & RPL_DAO_K_FLAG) {
-        dao_ack_output(instance, &dao_sender_addr, sequence);
-      }
-    }
-    goto discard;
-  }
-
-  PRINTF("RPL: adding DAO route\n");
-
-  if((nbr = uip_ds6_nbr_lookup(&dao_sender_addr)) == NULL) {
-    if((nbr = uip_ds6_nbr_add(&dao_sender_addr,
-                              (uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER),
-                              0, NBR_REACHABLE)) != NULL) {
-      /* set reachable timer */
-      stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
-      PRINTF("RPL: Neighbor added to neighbor cache ");
-      PRINT6ADDR(&dao_sender_addr);
-      PRINTF(", ");
-      PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
-      PRINTF("\n");
-    } else {
-      PRINTF("RPL: Out of Memory, dropping DAO from ");
-      PRINT6ADDR(&dao_sender_addr);
-      PRINTF(", ");
-      PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
-      PRINTF("\n");
-      goto discard;
-    }
-  } else {
-    PRINTF("RPL: Neighbor already in neighbor cache\n");
+  if(targets_start < buffer_length) {
+    forward += dao_input_targets(instance, &dao_sender_addr, learned_from,
+                                 buffer, targets_start, buffer_length,
+                                 instance->default_lifetime, relay);
   }
 
-  rep = rpl_add_route(dag, &prefix, prefixlen, &dao_sender_addr);
-  if(rep == NULL) {
-    RPL_STAT(rpl_stats.mem_overflows++);
-    PRINTF("RPL: Could not add a route after receiving a DAO\n");
-    goto discard;
-  }
-
-  rep->state.lifetime = RPL_LIFETIME(instance, lifetime);
-  rep->state.learned_from = learned_from;
-  rep->state.nopath_received = 0;
-
-#if RPL_CONF_MULTICAST
-fwd_dao:
-#endif
-
-  if(learned_from == RPL_ROUTE_FROM_UNICAST_DAO) {
-    if(dag->preferred_parent != NULL &&
+  if(forward > 0) {
+    if(relay && dag->preferred_parent != NULL &&
        rpl_get_parent_ipaddr(dag->preferred_parent) != NULL) {
       PRINTF("RPL: Forwarding DAO to parent ");
       PRINT6ADDR(rpl_get_parent_ipaddr(dag->preferred_parent));
@@ -804,6 +923,61 @@ fwd_dao:
 
  discard:
   uip_clear_buf();
+  ENERGEST_SUBSYSTEM_LEAVE();
+}
+/*---------------------------------------------------------------------------*/
+static int
+dao_header(unsigned char *buffer, rpl_instance_t *instance, rpl_dag_t *dag)
+{
+  int pos;
+
+  RPL_LOLLIPOP_INCREMENT(dao_sequence);
+  pos = 0;
+
+  buffer[pos++] = instance->instance_id;
+  buffer[pos] = 0;
+#if RPL_DAO_SPECIFY_DAG
+  buffer[pos] |= RPL_DAO_D_FLAG;
+#endif /* RPL_DAO_SPECIFY_DAG */
+#if RPL_CONF_DAO_ACK
+  buffer[pos] |= RPL_DAO_K_FLAG;
+#endif /* RPL_CONF_DAO_ACK */
+  ++pos;
+  buffer[pos++] = 0; /* reserved */
+  buffer[pos++] = dao_sequence;
+#if RPL_DAO_SPECIFY_DAG
+  memcpy(buffer + pos, &dag->dag_id, sizeof(dag->dag_id));
+  pos+=sizeof(dag->dag_id);
+#endif /* RPL_DAO_SPECIFY_DAG */
+
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static int
+dao_target_option(unsigned char *buffer, int pos,
+                  uip_ipaddr_t *prefix, uint8_t prefixlen)
+{
+  buffer[pos++] = RPL_OPTION_TARGET;
+  buffer[pos++] = 2 + ((prefixlen + 7) / CHAR_BIT);
+  buffer[pos++] = 0; /* reserved */
+  buffer[pos++] = prefixlen;
+  memcpy(buffer + pos, prefix, (prefixlen + 7) / CHAR_BIT);
+  pos += ((prefixlen + 7) / CHAR_BIT);
+
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static int
+dao_transit_option(unsigned char *buffer, int pos, uint8_t lifetime)
+{
+  buffer[pos++] = RPL_OPTION_TRANSIT;
+  buffer[pos++] = 4;
+  buffer[pos++] = 0; /* flags - ignored */
+  buffer[pos++] = 0; /* path control - ignored */
+  buffer[pos++] = 0; /* path seq - ignored */
+  buffer[pos++] = lifetime;
+
+  return pos;
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -817,6 +991,19 @@ dao_output(rpl_parent_t *parent, uint8_t lifetime)
     return;
   }
 
+#if RPL_DAO_AGGREGATION
+  /* Our own target towards the preferred parent takes along whatever
+     our children have queued. */
+  if(parent != NULL && parent->dag != NULL &&
+     parent->dag->instance != NULL &&
+     parent == parent->dag->instance->current_dag->preferred_parent) {
+    dao_output_aggregate(parent->dag->instance, &prefix,
+                         sizeof(prefix) * CHAR_BIT, lifetime);
+    dao_output_flush();
+    return;
+  }
+#endif /* RPL_DAO_AGGREGATION */
+
   /* Sending a DAO with own prefix as target */
   dao_output_target(parent, &prefix, lifetime);
 }
@@ -827,7 +1014,6 @@ dao_output_target(rpl_parent_t *parent, uip_ipaddr_t *prefix, uint8_t lifetime)
   rpl_dag_t *dag;
   rpl_instance_t *instance;
   unsigned char *buffer;
-  uint8_t prefixlen;
   int pos;
 
   /* Destination Advertisement Object */
@@ -864,41 +1050,13 @@ dao_output_target(rpl_parent_t *parent, uip_ipaddr_t *prefix, uint8_t lifetime)
 
   buffer = UIP_ICMP_PAYLOAD;
 
-  RPL_LOLLIPOP_INCREMENT(dao_sequence);
-  pos = 0;
-
-  buffer[pos++] = instance->instance_id;
-  buffer[pos] = 0;
-#if RPL_DAO_SPECIFY_DAG
-  buffer[pos] |= RPL_DAO_D_FLAG;
-#endif /* RPL_DAO_SPECIFY_DAG */
-#if RPL_CONF_DAO_ACK
-  buffer[pos] |= RPL_DAO_K_FLAG;
-#endif /* RPL_CONF_DAO_ACK */
-  ++pos;
-  buffer[pos++] = 0; /* reserved */
-  buffer[pos++] = dao_sequence;
-#if RPL_DAO_SPECIFY_DAG
-  memcpy(buffer + pos, &dag->dag_id, sizeof(dag->dag_id));
-  pos+=sizeof(dag->dag_id);
-#endif /* RPL_DAO_SPECIFY_DAG */
+  pos = dao_header(buffer, instance, dag);
 
   /* create target subopt */
-  prefixlen = sizeof(*prefix) * CHAR_BIT;
-  buffer[pos++] = RPL_OPTION_TARGET;
-  buffer[pos++] = 2 + ((prefixlen + 7) / CHAR_BIT);
-  buffer[pos++] = 0; /* reserved */
-  buffer[pos++] = prefixlen;
-  memcpy(buffer + pos, prefix, (prefixlen + 7) / CHAR_BIT);
-  pos += ((prefixlen + 7) / CHAR_BIT);
+  pos = dao_target_option(buffer, pos, prefix, sizeof(*prefix) * CHAR_BIT);
 
   /* Create a transit information sub-option. */
-  buffer[pos++] = RPL_OPTION_TRANSIT;
-  buffer[pos++] = 4;
-  buffer[pos++] = 0; /* flags - ignored */
-  buffer[pos++] = 0; /* path control - ignored */
-  buffer[pos++] = 0; /* path seq - ignored */
-  buffer[pos++] = lifetime;
+  pos = dao_transit_option(buffer, pos, lifetime);
 
   PRINTF("RPL: Sending DAO with prefix ");
   PRINT6ADDR(prefix);
@@ -911,6 +1069,155 @@ dao_output_target(rpl_parent_t *parent, uip_ipaddr_t *prefix, uint8_t lifetime)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_DAO_AGGREGATION
+/*
+ * Check whether the queue can take the given number of new targets.
+ * If not, it is due to be flushed as soon as possible.
+ */
+static int
+dao_queue_has_room(rpl_instance_t *instance, int targets)
+{
+  if((dao_target_count > 0 && dao_target_instance != instance) ||
+     dao_target_count + targets > RPL_DAO_AGGREGATION_MAX_TARGETS) {
+    rpl_schedule_dao_aggregation(0);
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Queue a target without sending anything. Returns 0 if the queue is
+ * full or holds targets of another instance; it is then due to be
+ * flushed as soon as possible.
+ */
+static int
+dao_queue_target(rpl_instance_t *instance, uip_ipaddr_t *prefix,
+                 uint8_t prefixlen, uint8_t lifetime)
+{
+  struct dao_target *t;
+  int i;
+
+  if(dao_target_count == 0) {
+    dao_target_instance = instance;
+  } else if(dao_target_instance != instance) {
+    rpl_schedule_dao_aggregation(0);
+    return 0;
+  }
+
+  /* A newer advertisement for a queued target replaces it; this is
+     also how a No-Path cancels a pending route. */
+  for(i = 0; i < dao_target_count; i++) {
+    t = &dao_targets[i];
+    if(t->prefixlen == prefixlen && uip_ipaddr_cmp(&t->prefix, prefix)) {
+      t->lifetime = lifetime;
+      return 1;
+    }
+  }
+
+  if(dao_target_count == RPL_DAO_AGGREGATION_MAX_TARGETS) {
+    rpl_schedule_dao_aggregation(0);
+    return 0;
+  }
+
+  t = &dao_targets[dao_target_count++];
+  uip_ipaddr_copy(&t->prefix, prefix);
+  t->prefixlen = prefixlen;
+  t->lifetime = lifetime;
+
+  rpl_schedule_dao_aggregation(RPL_DAO_AGGREGATION_DELAY);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a queued target, if there is one. */
+static void
+dao_unqueue_target(uip_ipaddr_t *prefix, uint8_t prefixlen)
+{
+  struct dao_target *t;
+  int i;
+
+  for(i = 0; i < dao_target_count; i++) {
+    t = &dao_targets[i];
+    if(t->prefixlen == prefixlen && uip_ipaddr_cmp(&t->prefix, prefix)) {
+      *t = dao_targets[--dao_target_count];
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+dao_output_aggregate(rpl_instance_t *instance, uip_ipaddr_t *prefix,
+                     uint8_t prefixlen, uint8_t lifetime)
+{
+  if(!dao_queue_target(instance, prefix, prefixlen, lifetime)) {
+    dao_output_flush();
+    dao_queue_target(instance, prefix, prefixlen, lifetime);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+dao_output_flush(void)
+{
+  rpl_instance_t *instance;
+  rpl_parent_t *parent;
+  rpl_dag_t *dag;
+  unsigned char *buffer;
+  uint8_t lifetime;
+  int pos;
+  int i;
+  int j;
+
+  if(dao_target_count == 0) {
+    return;
+  }
+
+  instance = dao_target_instance;
+  dag = instance->current_dag;
+  parent = (instance->used && dag != NULL) ? dag->preferred_parent : NULL;
+  if(rpl_get_mode() == RPL_MODE_FEATHER || parent == NULL ||
+     rpl_get_parent_ipaddr(parent) == NULL) {
+    PRINTF("RPL: No DAO parent, dropping %u queued targets\n",
+           dao_target_count);
+    dao_target_count = 0;
+    return;
+  }
+#ifdef RPL_DEBUG_DAO_OUTPUT
+  RPL_DEBUG_DAO_OUTPUT(parent);
+#endif
+
+  buffer = UIP_ICMP_PAYLOAD;
+  pos = dao_header(buffer, instance, dag);
+
+  /* Group the targets by lifetime so that each group needs a single
+     Transit option. */
+  for(i = 0; i < dao_target_count; i++) {
+    lifetime = dao_targets[i].lifetime;
+    for(j = 0; j < i; j++) {
+      if(dao_targets[j].lifetime == lifetime) {
+        break;
+      }
+    }
+    if(j < i) {
+      /* Already sent with an earlier group. */
+      continue;
+    }
+    for(j = i; j < dao_target_count; j++) {
+      if(dao_targets[j].lifetime == lifetime) {
+        pos = dao_target_option(buffer, pos, &dao_targets[j].prefix,
+                                dao_targets[j].prefixlen);
+      }
+    }
+    pos = dao_transit_option(buffer, pos, lifetime);
+  }
+
+  PRINTF("RPL: Sending aggregated DAO with %u targets to ", dao_target_count);
+  PRINT6ADDR(rpl_get_parent_ipaddr(parent));
+  PRINTF("\n");
+
+  dao_target_count = 0;
+  uip_icmp6_send(rpl_get_parent_ipaddr(parent), ICMP6_RPL, RPL_CODE_DAO, pos);
+}
+#endif /* RPL_DAO_AGGREGATION */
+/*---------------------------------------------------------------------------*/
 static void
 dao_ack_input(void)
 {
@@ -929,7 +1236,10 @@ dao_ack_input(void)
   PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
   PRINTF("\n");
 #endif /* DEBUG */
+  ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_RPL);
+  rpl_join_stage_reached(RPL_JOIN_STAGE_DAO_ACK);
   uip_clear_buf();
+  ENERGEST_SUBSYSTEM_LEAVE();
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         RPL-aware neighbor table eviction policies.
+ *
+ *         Select one with e.g.
+ *         #define NBR_TABLE_CONF_POLICY rpl_nbr_policy_protect
+ */
+
+/**
+ * \addtogroup uip6
+ * @{
+ */
+
+#include "net/rpl/rpl-private.h"
+#include "net/nbr-table.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+/* Cost range left to neighbors that are not usable RPL parents */
+#define NON_PARENT_MAX_COST 16
+
+/*---------------------------------------------------------------------------*/
+/* Return the RPL parent of a neighbor if it could be selected as preferred
+ * parent in its DAG, i.e. it belongs to the current DAG of its instance and
+ * advertises a lower rank than ours. */
+static rpl_parent_t *
+usable_parent(const linkaddr_t *lladdr)
+{
+  rpl_parent_t *p;
+  rpl_instance_t *instance;
+
+  p = nbr_table_get_from_lladdr(rpl_parents, lladdr);
+  if(p == NULL || p->dag == NULL || p->rank == INFINITE_RANK) {
+    return NULL;
+  }
+  instance = p->dag->instance;
+  if(instance == NULL || instance->current_dag != p->dag) {
+    return NULL;
+  }
+  if(DAG_RANK(p->rank, instance) >= DAG_RANK(p->dag->rank, instance)) {
+    return NULL;
+  }
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+/* Least ETX-useful: evict non-parents first, then the usable parent with the
+ * worst link metric. */
+static int
+etx_eviction_cost(const linkaddr_t *lladdr, int used_count,
+                  unsigned long idle)
+{
+  rpl_parent_t *p;
+  uint16_t link_metric;
+
+  p = usable_parent(lladdr);
+  if(p == NULL) {
+    return used_count < NON_PARENT_MAX_COST ? used_count : NON_PARENT_MAX_COST - 1;
+  }
+
+  link_metric = rpl_get_parent_link_metric(p);
+  if(link_metric > NBR_TABLE_POLICY_MAX_COST - NON_PARENT_MAX_COST) {
+    link_metric = NBR_TABLE_POLICY_MAX_COST - NON_PARENT_MAX_COST;
+  }
+  return NBR_TABLE_POLICY_MAX_COST - link_metric;
+}
+const struct nbr_table_policy rpl_nbr_policy_etx = {
+  "rpl-etx",
+  etx_eviction_cost
+};
+/*---------------------------------------------------------------------------*/
+/* Protect parents and children: the preferred parent and the next hops of
+ * downward routes (children) are already locked in the neighbor table. In
+ * addition, keep every usable backup parent, so that a newly heard DIO from
+ * a worse node cannot push out a parent candidate. Other neighbors are
+ * evicted as with the default policy. */
+static int
+protect_eviction_cost(const linkaddr_t *lladdr, int used_count,
+                      unsigned long idle)
+{
+  if(usable_parent(lladdr) != NULL) {
+    return NBR_TABLE_POLICY_KEEP;
+  }
+  return used_count;
+}
+const struct nbr_table_policy rpl_nbr_policy_protect = {
+  "rpl-protect",
+  protect_eviction_cost
+};
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -122,34 +122,48 @@ best_dag(rpl_dag_t *d1, rpl_dag_t *d2)
   }
 }
 
+/* Marks a cached cost of a parent that has no neighbor entry. */
+#define NO_NEIGHBOR_COST 0xffff
+
+/* The cost of a parent is cached until its rank or link metric changes. */
+static rpl_rank_t
+parent_cost(rpl_parent_t *p)
+{
+  uip_ds6_nbr_t *nbr;
+
+  if(!(p->flags & RPL_PARENT_FLAG_PATH_COST_VALID)) {
+    nbr = rpl_get_nbr(p);
+    if(nbr == NULL) {
+      p->path_cost = NO_NEIGHBOR_COST;
+    } else {
+      p->path_cost = DAG_RANK(p->rank, p->dag->instance) * RPL_MIN_HOPRANKINC +
+        rpl_get_parent_link_metric(p);
+    }
+    p->flags |= RPL_PARENT_FLAG_PATH_COST_VALID;
+  }
+  return p->path_cost;
+}
+
 static rpl_parent_t *
 best_parent(rpl_parent_t *p1, rpl_parent_t *p2)
 {
   rpl_rank_t r1, r2;
   rpl_dag_t *dag;  
-  uip_ds6_nbr_t *nbr1, *nbr2;
-  nbr1 = rpl_get_nbr(p1);
-  nbr2 = rpl_get_nbr(p2);
 
   dag = (rpl_dag_t *)p1->dag; /* Both parents must be in the same DAG. */
 
-  if(nbr1 == NULL || nbr2 == NULL) {
+  r1 = parent_cost(p1);
+  r2 = parent_cost(p2);
+  if(r1 == NO_NEIGHBOR_COST || r2 == NO_NEIGHBOR_COST) {
     return dag->preferred_parent;
   }
 
   PRINTF("RPL: Comparing parent ");
   PRINT6ADDR(rpl_get_parent_ipaddr(p1));
-  PRINTF(" (confidence %d, rank %d) with parent ",
-        nbr1->link_metric, p1->rank);
+  PRINTF(" (cost %u, rank %d) with parent ", r1, p1->rank);
   PRINT6ADDR(rpl_get_parent_ipaddr(p2));
-  PRINTF(" (confidence %d, rank %d)\n",
-        nbr2->link_metric, p2->rank);
-
+  PRINTF(" (cost %u, rank %d)\n", r2, p2->rank);
 
-  r1 = DAG_RANK(p1->rank, p1->dag->instance) * RPL_MIN_HOPRANKINC  +
-    nbr1->link_metric;
-  r2 = DAG_RANK(p2->rank, p1->dag->instance) * RPL_MIN_HOPRANKINC  +
-    nbr2->link_metric;
   /* Compare two parents by looking both and their rank and at the ETX
      for that parent. We choose the parent that has the most
      favourable combination. */
@@ -270,6 +270,11 @@ void dio_output(rpl_instance_t *, uip_ipaddr_t *uc_addr);
 void dao_output(rpl_parent_t *, uint8_t lifetime);
 void dao_output_target(rpl_parent_t *, uip_ipaddr_t *, uint8_t lifetime);
 void dao_ack_output(rpl_instance_t *, uip_ipaddr_t *, uint8_t);
+#if RPL_DAO_AGGREGATION
+void dao_output_aggregate(rpl_instance_t *, uip_ipaddr_t *, uint8_t prefixlen,
+                          uint8_t lifetime);
+void dao_output_flush(void);
+#endif /* RPL_DAO_AGGREGATION */
 void rpl_icmp6_register_handlers(void);
 
 /* RPL logic functions. */
@@ -294,6 +299,12 @@ void rpl_nullify_parent(rpl_parent_t *);
 void rpl_remove_parent(rpl_parent_t *);
 void rpl_move_parent(rpl_dag_t *dag_src, rpl_dag_t *dag_dst, rpl_parent_t *parent);
 rpl_parent_t *rpl_select_parent(rpl_dag_t *dag);
+
+/* Flags a parent whose rank or link metric changed for rank recalculation,
+   and drops the path cost that the OF has cached for it. */
+#define RPL_PARENT_UPDATED(p) \
+  ((p)->flags = ((p)->flags & ~RPL_PARENT_FLAG_PATH_COST_VALID) | \
+   RPL_PARENT_FLAG_UPDATED)
 rpl_dag_t *rpl_select_dag(rpl_instance_t *instance,rpl_parent_t *parent);
 void rpl_recalculate_ranks(void);
 
@@ -311,7 +322,14 @@ rpl_of_t *rpl_find_of(rpl_ocp_t);
 void rpl_schedule_dao(rpl_instance_t *);
 void rpl_schedule_dao_immediately(rpl_instance_t *);
 void rpl_cancel_dao(rpl_instance_t *instance);
+#if RPL_DAO_AGGREGATION
+void rpl_schedule_dao_aggregation(clock_time_t delay);
+#endif /* RPL_DAO_AGGREGATION */
 void rpl_schedule_probing(rpl_instance_t *instance);
+#if RPL_WITH_FAST_JOIN
+void rpl_schedule_fast_join(void);
+void rpl_schedule_dio_reply(rpl_instance_t *instance, uip_ipaddr_t *addr);
+#endif /* RPL_WITH_FAST_JOIN */
 
 void rpl_reset_dio_timer(rpl_instance_t *);
 void rpl_reset_periodic_timer(void);
@@ -46,12 +46,23 @@
 #include "net/ipv6/multicast/uip-mcast6.h"
 #include "lib/random.h"
 #include "sys/ctimer.h"
+#include "sys/energest.h"
 
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
 
 /*---------------------------------------------------------------------------*/
 static struct ctimer periodic_timer;
+#if RPL_DAO_AGGREGATION
+static struct ctimer dao_aggregation_timer;
+#endif /* RPL_DAO_AGGREGATION */
+#if RPL_WITH_FAST_JOIN
+static struct ctimer fast_join_timer;
+static uint8_t fast_join_attempts;
+static struct ctimer dio_reply_timer;
+static rpl_instance_t *dio_reply_instance;
+static uip_ipaddr_t dio_reply_addr;
+#endif /* RPL_WITH_FAST_JOIN */
 
 static void handle_periodic_timer(void *ptr);
 static void new_dio_interval(rpl_instance_t *instance);
@@ -66,6 +77,7 @@ static uint8_t dio_send_ok;
 static void
 handle_periodic_timer(void *ptr)
 {
+  ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_RPL);
   rpl_purge_dags();
   rpl_purge_routes();
   rpl_recalculate_ranks();
@@ -79,6 +91,7 @@ handle_periodic_timer(void *ptr)
   }
 #endif
   ctimer_reset(&periodic_timer);
+  ENERGEST_SUBSYSTEM_LEAVE();
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -133,6 +146,7 @@ handle_dio_timer(void *ptr)
 
   instance = (rpl_instance_t *)ptr;
 
+  ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_RPL);
   PRINTF("RPL: DIO Timer triggered\n");
   if(!dio_send_ok) {
     if(uip_ds6_get_link_local(ADDR_PREFERRED) != NULL) {
@@ -140,6 +154,7 @@ handle_dio_timer(void *ptr)
     } else {
       PRINTF("RPL: Postponing DIO transmission since link local address is not ok\n");
       ctimer_set(&instance->dio_timer, CLOCK_SECOND, &handle_dio_timer, instance);
+      ENERGEST_SUBSYSTEM_LEAVE();
       return;
     }
   }
@@ -171,6 +186,7 @@ handle_dio_timer(void *ptr)
 #if DEBUG
   rpl_print_neighbor_list();
 #endif
+  ENERGEST_SUBSYSTEM_LEAVE();
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -222,6 +238,20 @@ set_dao_lifetime_timer(rpl_instance_t *instance)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_CONF_MULTICAST
+static void
+dao_output_mcast(rpl_instance_t *instance, uip_ipaddr_t *group)
+{
+#if RPL_DAO_AGGREGATION
+  dao_output_aggregate(instance, group, sizeof(*group) * 8,
+                       RPL_MCAST_LIFETIME);
+#else /* RPL_DAO_AGGREGATION */
+  dao_output_target(instance->current_dag->preferred_parent, group,
+                    RPL_MCAST_LIFETIME);
+#endif /* RPL_DAO_AGGREGATION */
+}
+#endif /* RPL_CONF_MULTICAST */
+/*---------------------------------------------------------------------------*/
 static void
 handle_dao_timer(void *ptr)
 {
@@ -239,11 +269,11 @@ handle_dao_timer(void *ptr)
     return;
   }
 
+  ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_RPL);
+
   /* Send the DAO to the DAO parent set -- the preferred parent in our case. */
   if(instance->current_dag->preferred_parent != NULL) {
     PRINTF("RPL: handle_dao_timer - sending DAO\n");
-    /* Set the route lifetime to the default value. */
-    dao_output(instance->current_dag->preferred_parent, instance->default_lifetime);
 
 #if RPL_CONF_MULTICAST
     /* Send DAOs for multicast prefixes only if the instance is in MOP 3 */
@@ -252,8 +282,7 @@ handle_dao_timer(void *ptr)
       for(i = 0; i < UIP_DS6_MADDR_NB; i++) {
         if(uip_ds6_if.maddr_list[i].isused
             && uip_is_addr_mcast_global(&uip_ds6_if.maddr_list[i].ipaddr)) {
-          dao_output_target(instance->current_dag->preferred_parent,
-              &uip_ds6_if.maddr_list[i].ipaddr, RPL_MCAST_LIFETIME);
+          dao_output_mcast(instance, &uip_ds6_if.maddr_list[i].ipaddr);
         }
       }
 
@@ -262,13 +291,16 @@ handle_dao_timer(void *ptr)
       while(mcast_route != NULL) {
         /* Don't send if it's also our own address, done that already */
         if(uip_ds6_maddr_lookup(&mcast_route->group) == NULL) {
-          dao_output_target(instance->current_dag->preferred_parent,
-                     &mcast_route->group, RPL_MCAST_LIFETIME);
+          dao_output_mcast(instance, &mcast_route->group);
         }
         mcast_route = list_item_next(mcast_route);
       }
     }
 #endif
+
+    /* Set the route lifetime to the default value. With aggregation,
+       this also sends the multicast targets queued above. */
+    dao_output(instance->current_dag->preferred_parent, instance->default_lifetime);
   } else {
     PRINTF("RPL: No suitable DAO parent\n");
   }
@@ -278,6 +310,7 @@ handle_dao_timer(void *ptr)
   if(etimer_expired(&instance->dao_lifetime_timer.etimer)) {
     set_dao_lifetime_timer(instance);
   }
+  ENERGEST_SUBSYSTEM_LEAVE();
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -328,24 +361,143 @@ rpl_cancel_dao(rpl_instance_t *instance)
   ctimer_stop(&instance->dao_lifetime_timer);
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_DAO_AGGREGATION
+static void
+handle_dao_aggregation_timer(void *ptr)
+{
+  dao_output_flush();
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_schedule_dao_aggregation(clock_time_t delay)
+{
+  /* The window opens with the first queued target; later targets
+     join it rather than pushing it back. A zero delay asks for the
+     queue to be sent as soon as possible. */
+  if(delay == 0 || etimer_expired(&dao_aggregation_timer.etimer)) {
+    PRINTF("RPL: Scheduling DAO aggregation timer %u ticks in the future\n",
+           (unsigned)delay);
+    ctimer_set(&dao_aggregation_timer, delay,
+               handle_dao_aggregation_timer, NULL);
+  }
+}
+#endif /* RPL_DAO_AGGREGATION */
+/*---------------------------------------------------------------------------*/
+#if RPL_WITH_FAST_JOIN
+static int
+has_upward_route(void)
+{
+  rpl_dag_t *dag;
+
+  dag = rpl_get_any_dag();
+  return dag != NULL &&
+    (dag->preferred_parent != NULL || dag->rank == ROOT_RANK(dag->instance));
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_fast_join_timer(void *ptr)
+{
+  if(has_upward_route()) {
+    return;
+  }
+
+  if(!dio_send_ok && uip_ds6_get_link_local(ADDR_PREFERRED) == NULL) {
+    PRINTF("RPL: Postpone fast join DIS\n");
+    ctimer_set(&fast_join_timer, RPL_FAST_JOIN_DIS_INTERVAL,
+               handle_fast_join_timer, NULL);
+    return;
+  }
+
+  PRINTF("RPL: Fast join, sending DIS %u/%u\n",
+         fast_join_attempts + 1, RPL_FAST_JOIN_DIS_ATTEMPTS);
+  dis_output(NULL);
+
+  /* Back off exponentially; the periodic DIS takes over once all
+     attempts have been made. */
+  if(++fast_join_attempts < RPL_FAST_JOIN_DIS_ATTEMPTS) {
+    ctimer_set(&fast_join_timer,
+               RPL_FAST_JOIN_DIS_INTERVAL << fast_join_attempts,
+               handle_fast_join_timer, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_schedule_fast_join(void)
+{
+  clock_time_t delay;
+
+  fast_join_attempts = 0;
+  /* Desynchronize nodes that boot or lose their parent together. */
+  delay = RPL_FAST_JOIN_DIS_INTERVAL / 2 +
+    random_rand() % (RPL_FAST_JOIN_DIS_INTERVAL / 2 + 1);
+  ctimer_set(&fast_join_timer, delay, handle_fast_join_timer, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_dio_reply_timer(void *ptr)
+{
+  if(dio_reply_instance != NULL && dio_reply_instance->used &&
+     dio_reply_instance->current_dag->rank != INFINITE_RANK) {
+    PRINTF("RPL: Fast join, unicast DIO to ");
+    PRINT6ADDR(&dio_reply_addr);
+    PRINTF("\n");
+    dio_output(dio_reply_instance, &dio_reply_addr);
+  }
+  dio_reply_instance = NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_schedule_dio_reply(rpl_instance_t *instance, uip_ipaddr_t *addr)
+{
+  int neighbors;
+
+  if(dio_reply_instance != NULL) {
+    if(dio_reply_instance == instance &&
+       uip_ipaddr_cmp(&dio_reply_addr, addr)) {
+      /* A retransmitted DIS; the pending reply answers it. */
+      return;
+    }
+    /* Busy answering someone else; let Trickle answer both. */
+    rpl_reset_dio_timer(instance);
+    return;
+  }
+
+  /* Randomized suppression: the node soliciting DIOs probably has
+     about as many neighbors as we do. Reply with a probability that
+     makes about RPL_FAST_JOIN_RESPONDERS of them answer. */
+  neighbors = uip_ds6_nbr_num();
+  if(neighbors > RPL_FAST_JOIN_RESPONDERS &&
+     random_rand() % neighbors >= RPL_FAST_JOIN_RESPONDERS) {
+    PRINTF("RPL: Fast join, suppressing DIO reply\n");
+    return;
+  }
+
+  dio_reply_instance = instance;
+  uip_ipaddr_copy(&dio_reply_addr, addr);
+  ctimer_set(&dio_reply_timer,
+             random_rand() % (RPL_FAST_JOIN_REPLY_WINDOW + 1),
+             handle_dio_reply_timer, NULL);
+}
+#endif /* RPL_WITH_FAST_JOIN */
+/*---------------------------------------------------------------------------*/
 #if RPL_WITH_PROBING
 static rpl_parent_t *
 get_probing_target(rpl_dag_t *dag)
 {
-  /* Returns the next probing target. The current implementation probes the current
-   * preferred parent if we have not updated its link for RPL_PROBING_EXPIRATION_TIME.
-   * Otherwise, it picks at random between:
-   * (1) selecting the best parent not updated for RPL_PROBING_EXPIRATION_TIME
-   * (2) selecting the least recently updated parent
+  /* Returns the next probing target. Only parents whose link statistics
+   * are not fresh are probed, as regular traffic keeps the other links
+   * up-to-date. The current implementation probes the current preferred
+   * parent if needed. Otherwise, it picks at random between:
+   * (1) selecting the best non-fresh parent
+   * (2) selecting the least recently updated non-fresh parent
    */
 
   rpl_parent_t *p;
   rpl_parent_t *probing_target = NULL;
   rpl_rank_t probing_target_rank = INFINITE_RANK;
-  /* min_last_tx is the clock time RPL_PROBING_EXPIRATION_TIME in the past */
-  clock_time_t min_last_tx = clock_time();
-  min_last_tx = min_last_tx > 2 * RPL_PROBING_EXPIRATION_TIME
-      ? min_last_tx - RPL_PROBING_EXPIRATION_TIME : 1;
+  clock_time_t probing_target_age = 0;
+  clock_time_t now = clock_time();
+  const struct link_stats *stats;
 
   if(dag == NULL ||
       dag->instance == NULL ||
@@ -354,15 +506,15 @@ get_probing_target(rpl_dag_t *dag)
   }
 
   /* Our preferred parent needs probing */
-  if(dag->preferred_parent->last_tx_time < min_last_tx) {
+  if(!rpl_parent_is_fresh(dag->preferred_parent)) {
     probing_target = dag->preferred_parent;
   }
 
-  /* With 50% probability: probe best parent not updated for RPL_PROBING_EXPIRATION_TIME */
+  /* With 50% probability: probe the best non-fresh parent */
   if(probing_target == NULL && (random_rand() % 2) == 0) {
     p = nbr_table_head(rpl_parents);
     while(p != NULL) {
-      if(p->dag == dag && p->last_tx_time < min_last_tx) {
+      if(p->dag == dag && !rpl_parent_is_fresh(p)) {
         /* p is in our dag and needs probing */
         rpl_rank_t p_rank = dag->instance->of->calculate_rank(p, 0);
         if(probing_target == NULL
@@ -375,14 +527,18 @@ get_probing_target(rpl_dag_t *dag)
     }
   }
 
-  /* The default probing target is the least recently updated parent */
+  /* Otherwise, probe the least recently updated non-fresh parent */
   if(probing_target == NULL) {
     p = nbr_table_head(rpl_parents);
     while(p != NULL) {
-      if(p->dag == dag) {
-        if(probing_target == NULL
-            || p->last_tx_time < probing_target->last_tx_time) {
+      if(p->dag == dag && !rpl_parent_is_fresh(p)) {
+        stats = rpl_get_parent_link_stats(p);
+        /* parents that were never sent to are the oldest */
+        clock_time_t age = stats != NULL ?
+          now - stats->last_tx_time : (clock_time_t)-1;
+        if(probing_target == NULL || age > probing_target_age) {
           probing_target = p;
+          probing_target_age = age;
         }
       }
       p = nbr_table_next(rpl_parents, p);
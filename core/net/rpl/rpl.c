@@ -60,6 +60,11 @@ rpl_stats_t rpl_stats;
 #endif
 
 static enum rpl_mode mode = RPL_MODE_MESH;
+
+#if RPL_WITH_JOIN_STATS
+static clock_time_t join_times[RPL_JOIN_STAGES];
+static uint8_t join_stages_reached;
+#endif /* RPL_WITH_JOIN_STATS */
 /*---------------------------------------------------------------------------*/
 enum rpl_mode
 rpl_get_mode(void)
@@ -266,10 +271,9 @@ rpl_link_neighbor_callback(const linkaddr_t *addr, int status, int numtx)
       if(parent != NULL) {
         /* Trigger DAG rank recalculation. */
         PRINTF("RPL: rpl_link_neighbor_callback triggering update\n");
-        parent->flags |= RPL_PARENT_FLAG_UPDATED;
+        RPL_PARENT_UPDATED(parent);
         if(instance->of->neighbor_link_callback != NULL) {
           instance->of->neighbor_link_callback(parent, status, numtx);
-          parent->last_tx_time = clock_time();
         }
       }
     }
@@ -293,7 +297,7 @@ rpl_ipv6_neighbor_callback(uip_ds6_nbr_t *nbr)
         p->rank = INFINITE_RANK;
         /* Trigger DAG rank recalculation. */
         PRINTF("RPL: rpl_ipv6_neighbor_callback infinite rank\n");
-        p->flags |= RPL_PARENT_FLAG_UPDATED;
+        RPL_PARENT_UPDATED(p);
       }
     }
   }
@@ -327,6 +331,28 @@ rpl_purge_dags(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_WITH_JOIN_STATS
+void
+rpl_join_stage_reached(enum rpl_join_stage stage)
+{
+  if(stage < RPL_JOIN_STAGES && !(join_stages_reached & (1 << stage))) {
+    join_stages_reached |= 1 << stage;
+    join_times[stage] = clock_time();
+    PRINTF("RPL: Join stage %u reached at %lu ticks\n",
+           (unsigned)stage, (unsigned long)join_times[stage]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+rpl_join_stage_time(enum rpl_join_stage stage)
+{
+  if(stage < RPL_JOIN_STAGES && (join_stages_reached & (1 << stage))) {
+    return join_times[stage];
+  }
+  return 0;
+}
+#endif /* RPL_WITH_JOIN_STATS */
+/*---------------------------------------------------------------------------*/
 void
 rpl_init(void)
 {
@@ -347,6 +373,10 @@ rpl_init(void)
 #endif
 
   RPL_OF.reset(NULL);
+
+#if RPL_WITH_FAST_JOIN
+  rpl_schedule_fast_join();
+#endif /* RPL_WITH_FAST_JOIN */
 }
 /*---------------------------------------------------------------------------*/
 
@@ -43,6 +43,7 @@
 #include "lib/list.h"
 #include "net/ip/uip.h"
 #include "net/ipv6/uip-ds6.h"
+#include "net/link-stats.h"
 #include "sys/ctimer.h"
 
 /*---------------------------------------------------------------------------*/
@@ -105,7 +106,7 @@ struct rpl_instance;
 struct rpl_dag;
 /*---------------------------------------------------------------------------*/
 #define RPL_PARENT_FLAG_UPDATED           0x1
-#define RPL_PARENT_FLAG_LINK_METRIC_VALID 0x2
+#define RPL_PARENT_FLAG_PATH_COST_VALID   0x4
 
 struct rpl_parent {
   struct rpl_dag *dag;
@@ -113,7 +114,7 @@ struct rpl_parent {
   rpl_metric_container_t mc;
 #endif /* RPL_DAG_MC != RPL_DAG_MC_NONE */
   rpl_rank_t rank;
-  clock_time_t last_tx_time;
+  uint16_t path_cost; /* cached by the OF, see RPL_PARENT_FLAG_PATH_COST_VALID */
   uint8_t dtsn;
   uint8_t flags;
 };
@@ -252,7 +253,9 @@ uint8_t rpl_invert_header(void);
 uip_ipaddr_t *rpl_get_parent_ipaddr(rpl_parent_t *nbr);
 rpl_parent_t *rpl_get_parent(uip_lladdr_t *addr);
 rpl_rank_t rpl_get_parent_rank(uip_lladdr_t *addr);
-uint16_t rpl_get_parent_link_metric(const uip_lladdr_t *addr);
+uint16_t rpl_get_parent_link_metric(rpl_parent_t *p);
+const struct link_stats *rpl_get_parent_link_stats(rpl_parent_t *p);
+int rpl_parent_is_fresh(rpl_parent_t *p);
 void rpl_dag_init(void);
 uip_ds6_nbr_t *rpl_get_nbr(rpl_parent_t *parent);
 void rpl_print_neighbor_list();
@@ -260,6 +263,10 @@ void rpl_print_neighbor_list();
 /* Per-parent RPL information */
 NBR_TABLE_DECLARE(rpl_parents);
 
+/* RPL-aware neighbor table eviction policies, see NBR_TABLE_CONF_POLICY */
+extern const struct nbr_table_policy rpl_nbr_policy_etx;
+extern const struct nbr_table_policy rpl_nbr_policy_protect;
+
 /**
  * RPL modes
  *
@@ -292,4 +299,40 @@ enum rpl_mode rpl_set_mode(enum rpl_mode mode);
 enum rpl_mode rpl_get_mode(void);
 
 /*---------------------------------------------------------------------------*/
+/**
+ * Stages of joining the network, in the order a node normally
+ * reaches them.
+ */
+enum rpl_join_stage {
+  RPL_JOIN_STAGE_FIRST_DIO,       /* A DIO was received */
+  RPL_JOIN_STAGE_PARENT_SELECTED, /* A preferred parent was selected */
+  RPL_JOIN_STAGE_DEFAULT_ROUTE,   /* A default route was installed */
+  RPL_JOIN_STAGE_DAO_ACK,         /* A DAO was acknowledged by the parent */
+  RPL_JOIN_STAGE_REGISTERED,      /* The application registered with its
+                                     server, e.g. the LWM2M RD */
+  RPL_JOIN_STAGES
+};
+
+#if RPL_WITH_JOIN_STATS
+/**
+ * Record that a join stage has been reached. Only the first time
+ * each stage is reached after boot is recorded.
+ *
+ * \param stage The stage reached
+ */
+void rpl_join_stage_reached(enum rpl_join_stage stage);
+
+/**
+ * Get the time at which a join stage was first reached
+ *
+ * \param stage The stage
+ * \retval The clock_time() at which the stage was reached, or 0 if
+ *         it has not been reached yet
+ */
+clock_time_t rpl_join_stage_time(enum rpl_join_stage stage);
+#else /* RPL_WITH_JOIN_STATS */
+#define rpl_join_stage_reached(stage)
+#define rpl_join_stage_time(stage) 0
+#endif /* RPL_WITH_JOIN_STATS */
+
 #endif /* RPL_H */
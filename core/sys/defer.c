@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Deferred calls
+ */
+
+/**
+ * \addtogroup defer
+ * @{
+ */
+
+#include "sys/defer.h"
+#include "lib/list.h"
+
+#if (DEFER_QUEUE_SIZE & (DEFER_QUEUE_SIZE - 1)) != 0 || \
+    DEFER_QUEUE_SIZE > 128
+#error DEFER_CONF_QUEUE_SIZE must be a power of two, at most 128
+#endif
+
+/* All deferred calls, for when the queue has overflowed */
+LIST(defer_list);
+
+/*
+ * Posted calls. The queue is written only by defer_post() and read
+ * only by the poll handler, each side moving its own index. When the
+ * queue is full, or when a defer_post() call interrupts another one,
+ * the call is not queued and the poll handler instead looks for
+ * pending calls on the list of all deferred calls.
+ */
+static struct defer *queue[DEFER_QUEUE_SIZE];
+static volatile unsigned char put, get;
+static volatile unsigned char busy, scan;
+
+PROCESS(defer_process, "Deferred calls");
+/*---------------------------------------------------------------------------*/
+static void
+run(struct defer *d)
+{
+  if(d->pending) {
+    d->pending = 0;
+    d->f(d->ptr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_posted(void)
+{
+  struct defer *d;
+  unsigned char end;
+
+  /* Calls posted by the deferred calls themselves wait for the next
+     round. */
+  end = put;
+  while(get != end) {
+    d = queue[get & (DEFER_QUEUE_SIZE - 1)];
+    get++;
+    run(d);
+  }
+
+  if(scan) {
+    scan = 0;
+    for(d = list_head(defer_list); d != NULL; d = d->next) {
+      run(d);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(defer_process, ev, data)
+{
+  PROCESS_POLLHANDLER(run_posted());
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+defer_set(struct defer *d, void (*f)(void *), void *ptr)
+{
+  if(!process_is_running(&defer_process)) {
+    list_init(defer_list);
+    put = get = 0;
+    busy = scan = 0;
+    process_start(&defer_process, NULL);
+  }
+  d->f = f;
+  d->ptr = ptr;
+  d->pending = 0;
+  list_add(defer_list, d);
+}
+/*---------------------------------------------------------------------------*/
+int
+defer_post(struct defer *d)
+{
+  if(d->pending) {
+    return 0;
+  }
+  if(busy) {
+    /* Interrupted another defer_post() call */
+    scan = 1;
+  } else {
+    /* Claim the queue before looking at it, so that a call that
+       interrupts this one cannot take the slot found here. */
+    busy = 1;
+    if((unsigned char)(put - get) >= DEFER_QUEUE_SIZE) {
+      scan = 1;
+    } else {
+      queue[put & (DEFER_QUEUE_SIZE - 1)] = d;
+      put++;
+    }
+    busy = 0;
+  }
+  d->pending = 1;
+  process_poll(&defer_process);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+defer_cancel(struct defer *d)
+{
+  d->pending = 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+defer_pending(struct defer *d)
+{
+  return d->pending;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
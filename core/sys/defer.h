@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for deferred calls
+ */
+
+/**
+ * \addtogroup sys
+ * @{
+ */
+
+/**
+ * \defgroup defer Deferred calls
+ * @{
+ *
+ * A deferred call runs a C function soon, outside of the current
+ * context, without going through a timer. It lets interrupt handlers
+ * hand work to the main loop, and lets the network stack postpone
+ * work to after the current call chain, without using an etimer
+ * slot the way ctimer_set() with a zero delay does.
+ *
+ * Deferred calls are run by the poll handler of a process, so they
+ * are run before any queued event. Posting a call that is already
+ * pending has no effect.
+ *
+ */
+
+#ifndef DEFER_H_
+#define DEFER_H_
+
+#include "sys/process.h"
+
+/* Number of posted calls remembered between two runs. Must be a power
+   of two, at most 128. When more calls are posted, the pending ones
+   are found by looking at all deferred calls. */
+#ifdef DEFER_CONF_QUEUE_SIZE
+#define DEFER_QUEUE_SIZE DEFER_CONF_QUEUE_SIZE
+#else
+#define DEFER_QUEUE_SIZE 8
+#endif
+
+struct defer {
+  struct defer *next;
+  void (*f)(void *);
+  void *ptr;
+  volatile unsigned char pending;
+};
+
+/**
+ * \brief      Set up a deferred call.
+ * \param d    A pointer to the deferred call.
+ * \param f    The function to be called.
+ * \param ptr  An opaque pointer that will be supplied as an argument to the function.
+ *
+ *             This function sets up a deferred call. It must be
+ *             called before defer_post(), and not from an interrupt
+ *             handler. The deferred call must stay allocated for as
+ *             long as the system runs.
+ */
+void defer_set(struct defer *d, void (*f)(void *), void *ptr);
+
+/**
+ * \brief      Post a deferred call.
+ * \param d    A pointer to the deferred call.
+ * \return     Non-zero if the call was posted, zero if it was already pending.
+ *
+ *             This function makes the function of a deferred call
+ *             run once, as soon as the process scheduler gets to
+ *             it. It is safe to call this function from an interrupt
+ *             handler.
+ */
+int defer_post(struct defer *d);
+
+/**
+ * \brief      Cancel a posted deferred call.
+ * \param d    A pointer to the deferred call.
+ */
+void defer_cancel(struct defer *d);
+
+/**
+ * \brief      Check if a deferred call is pending.
+ * \param d    A pointer to the deferred call.
+ * \return     Non-zero if the call has been posted but has not run yet.
+ */
+int defer_pending(struct defer *d);
+
+#endif /* DEFER_H_ */
+/** @} */
+/** @} */
@@ -39,6 +39,7 @@
 
 #include "sys/energest.h"
 #include "contiki-conf.h"
+#include <stddef.h>
 
 #if ENERGEST_CONF_ON
 
@@ -119,3 +120,116 @@ void energest_init(void) {}
 unsigned long energest_type_time(int type) { return 0; }
 void energest_flush(void) {}
 #endif /* ENERGEST_CONF_ON */
+
+/*---------------------------------------------------------------------------*/
+static const char *const subsystem_names[ENERGEST_SUBSYSTEM_MAX] = {
+  "other", "mac", "sicslowpan", "rpl", "coap", "lwm2m", "app"
+};
+/*---------------------------------------------------------------------------*/
+const char *
+energest_subsystem_name(int subsystem)
+{
+  if(subsystem < 0 || subsystem >= ENERGEST_SUBSYSTEM_MAX) {
+    return NULL;
+  }
+  return subsystem_names[subsystem];
+}
+/*---------------------------------------------------------------------------*/
+#if ENERGEST_SUBSYSTEMS
+
+#ifdef ENERGEST_CONF_SUBSYSTEM_DEPTH
+#define SUBSYSTEM_DEPTH ENERGEST_CONF_SUBSYSTEM_DEPTH
+#else /* ENERGEST_CONF_SUBSYSTEM_DEPTH */
+#define SUBSYSTEM_DEPTH 4
+#endif /* ENERGEST_CONF_SUBSYSTEM_DEPTH */
+
+static unsigned long subsystem_cpu[ENERGEST_SUBSYSTEM_MAX];
+static unsigned long subsystem_radio[ENERGEST_SUBSYSTEM_MAX];
+
+/* Sections deeper than SUBSYSTEM_DEPTH are charged to the innermost
+   subsystem that fit on the stack. */
+static unsigned char subsystem_stack[SUBSYSTEM_DEPTH];
+static unsigned char subsystem_depth;
+static rtimer_clock_t subsystem_since;
+#if ENERGEST_CONF_ON
+static unsigned long subsystem_radio_since;
+#endif /* ENERGEST_CONF_ON */
+
+/*---------------------------------------------------------------------------*/
+/* Charge the time since the last marker to the current subsystem */
+static void
+subsystem_charge(void)
+{
+  rtimer_clock_t now;
+  int current;
+#if ENERGEST_CONF_ON
+  unsigned long radio;
+#endif /* ENERGEST_CONF_ON */
+
+  now = RTIMER_NOW();
+  if(subsystem_depth == 0) {
+    current = ENERGEST_SUBSYSTEM_OTHER;
+  } else {
+    current = subsystem_stack[(subsystem_depth < SUBSYSTEM_DEPTH ?
+                               subsystem_depth : SUBSYSTEM_DEPTH) - 1];
+    /* Outside of any section the CPU is mostly asleep, so there is
+       nothing to charge the "other" subsystem with. */
+    subsystem_cpu[current] += (rtimer_clock_t)(now - subsystem_since);
+  }
+  subsystem_since = now;
+
+#if ENERGEST_CONF_ON
+  radio = energest_type_time(ENERGEST_TYPE_TRANSMIT) +
+    energest_type_time(ENERGEST_TYPE_LISTEN);
+  subsystem_radio[current] += radio - subsystem_radio_since;
+  subsystem_radio_since = radio;
+#endif /* ENERGEST_CONF_ON */
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_subsystem_enter(int subsystem)
+{
+  subsystem_charge();
+  if(subsystem_depth < SUBSYSTEM_DEPTH) {
+    subsystem_stack[subsystem_depth] = subsystem;
+  }
+  if(subsystem_depth < 0xff) {
+    subsystem_depth++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_subsystem_leave(void)
+{
+  subsystem_charge();
+  if(subsystem_depth > 0) {
+    subsystem_depth--;
+  }
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+energest_subsystem_cpu(int subsystem)
+{
+  if(subsystem < 0 || subsystem >= ENERGEST_SUBSYSTEM_MAX) {
+    return 0;
+  }
+  return subsystem_cpu[subsystem];
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+energest_subsystem_radio(int subsystem)
+{
+  if(subsystem < 0 || subsystem >= ENERGEST_SUBSYSTEM_MAX) {
+    return 0;
+  }
+#if ENERGEST_CONF_ON
+  /* Bring the radio time of the current subsystem up to date */
+  subsystem_charge();
+#endif /* ENERGEST_CONF_ON */
+  return subsystem_radio[subsystem];
+}
+/*---------------------------------------------------------------------------*/
+#else /* ENERGEST_SUBSYSTEMS */
+unsigned long energest_subsystem_cpu(int subsystem) { return 0; }
+unsigned long energest_subsystem_radio(int subsystem) { return 0; }
+#endif /* ENERGEST_SUBSYSTEMS */
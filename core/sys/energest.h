@@ -152,4 +152,47 @@ extern energest_t energest_leveldevice_current_leveltime[ENERGEST_CONF_LEVELDEVI
 #define ENERGEST_SWITCH(type_off, type_on) do { } while(0)
 #endif /* ENERGEST_CONF_ON */
 
+/*
+ * Per-subsystem attribution. Code between ENERGEST_SUBSYSTEM_ENTER()
+ * and ENERGEST_SUBSYSTEM_LEAVE() is charged with the CPU time spent
+ * in it and with the radio-on time (transmit plus listen) that passed
+ * meanwhile. Sections nest; time is charged to the innermost
+ * subsystem only. Radio-on time outside of any section is charged to
+ * ENERGEST_SUBSYSTEM_OTHER. The markers must not be used from
+ * interrupt context.
+ */
+#ifdef ENERGEST_CONF_SUBSYSTEMS
+#define ENERGEST_SUBSYSTEMS ENERGEST_CONF_SUBSYSTEMS
+#else /* ENERGEST_CONF_SUBSYSTEMS */
+#define ENERGEST_SUBSYSTEMS 0
+#endif /* ENERGEST_CONF_SUBSYSTEMS */
+
+enum energest_subsystem {
+  ENERGEST_SUBSYSTEM_OTHER,
+  ENERGEST_SUBSYSTEM_MAC,
+  ENERGEST_SUBSYSTEM_SICSLOWPAN,
+  ENERGEST_SUBSYSTEM_RPL,
+  ENERGEST_SUBSYSTEM_COAP,
+  ENERGEST_SUBSYSTEM_LWM2M,
+  ENERGEST_SUBSYSTEM_APP,
+
+  ENERGEST_SUBSYSTEM_MAX
+};
+
+/* Total CPU and radio-on time charged to a subsystem, in rtimer ticks */
+unsigned long energest_subsystem_cpu(int subsystem);
+unsigned long energest_subsystem_radio(int subsystem);
+const char *energest_subsystem_name(int subsystem);
+
+#if ENERGEST_SUBSYSTEMS
+void energest_subsystem_enter(int subsystem);
+void energest_subsystem_leave(void);
+
+#define ENERGEST_SUBSYSTEM_ENTER(subsystem) energest_subsystem_enter(subsystem)
+#define ENERGEST_SUBSYSTEM_LEAVE() energest_subsystem_leave()
+#else /* ENERGEST_SUBSYSTEMS */
+#define ENERGEST_SUBSYSTEM_ENTER(subsystem) do { } while(0)
+#define ENERGEST_SUBSYSTEM_LEAVE() do { } while(0)
+#endif /* ENERGEST_SUBSYSTEMS */
+
 #endif /* ENERGEST_H_ */
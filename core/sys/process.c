@@ -44,9 +44,11 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "sys/process.h"
 #include "sys/arg.h"
+#include "sys/rtimer.h"
 
 /*
  * Pointer to the currently running process structure.
@@ -65,13 +67,70 @@ struct event_data {
   struct process *p;
 };
 
-static process_num_events_t nevents, fevent;
+/*
+ * One FIFO of events per priority. The queues are served in order of
+ * priority, so that a burst of events does not hold back timer events.
+ */
+struct event_queue {
+  struct event_data *events;
+  process_num_events_t size, nevents, fevent;
+};
+
+#if PROCESS_CONF_NUMEVENTS_HIGH > 0
+#define PROCESS_PRIORITIES 2
+static struct event_data high_events[PROCESS_CONF_NUMEVENTS_HIGH];
+#else
+#define PROCESS_PRIORITIES 1
+#endif
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
 
+static struct event_queue queues[PROCESS_PRIORITIES] = {
+#if PROCESS_PRIORITIES > 1
+  { high_events, PROCESS_CONF_NUMEVENTS_HIGH },
+#endif
+  { events, PROCESS_CONF_NUMEVENTS },
+};
+
+/* Total number of queued events */
+static process_num_events_t nevents;
+
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
+unsigned long process_droppedevents;
+unsigned long process_spilledevents;
+unsigned long process_pollscans;
 #endif
 
+#if PROCESS_CONF_PROFILE
+/* Dispatches that take this many rtimer ticks or more are logged */
+#ifdef PROCESS_CONF_PROFILE_THRESHOLD
+#define PROFILE_THRESHOLD PROCESS_CONF_PROFILE_THRESHOLD
+#else
+#define PROFILE_THRESHOLD (RTIMER_SECOND / 100)
+#endif
+
+struct process_profile process_profile_events[PROCESS_CONF_PROFILE_EVENTS + 1];
+
+/* Time spent in synchronous dispatches made by the current one */
+static rtimer_clock_t profile_nested;
+#endif /* PROCESS_CONF_PROFILE */
+
+/*
+ * Processes waiting for their poll handler to be called. process_poll()
+ * may be called from interrupt handlers, so the queue is written only
+ * by process_poll() and read only by do_poll(), each side moving its
+ * own index. When the queue is full, or when a process_poll() call
+ * interrupts another one, the request is not queued and do_poll()
+ * instead scans all processes for their needspoll flag.
+ */
+#if (PROCESS_CONF_NUMPOLLS & (PROCESS_CONF_NUMPOLLS - 1)) != 0 || \
+    PROCESS_CONF_NUMPOLLS > 128
+#error PROCESS_CONF_NUMPOLLS must be a power of two, at most 128
+#endif
+static struct process *polls[PROCESS_CONF_NUMPOLLS];
+static volatile unsigned char poll_put, poll_get;
+static volatile unsigned char poll_busy, poll_scan;
+
 static volatile unsigned char poll_requested;
 
 #define PROCESS_STATE_NONE        0
@@ -112,6 +171,7 @@ process_start(struct process *p, process_data_t data)
   p->next = process_list;
   process_list = p;
   p->state = PROCESS_STATE_RUNNING;
+  p->needspoll = 0;
   PT_INIT(&p->pt);
 
   PRINTF("process: starting '%s'\n", PROCESS_NAME_STRING(p));
@@ -171,10 +231,61 @@ exit_process(struct process *p, struct process *fromprocess)
   process_current = old_current;
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_PROFILE
+static void
+profile_add(struct process_profile *profile, rtimer_clock_t t, lc_t lc)
+{
+  profile->count++;
+  profile->total += t;
+  if(t > profile->max) {
+    profile->max = t;
+    profile->max_lc = lc;
+  }
+  if(t >= PROFILE_THRESHOLD) {
+    profile->overruns++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+profile_dispatch(struct process *p, process_event_t ev, rtimer_clock_t t,
+                 lc_t lc)
+{
+  unsigned i;
+
+  i = (process_event_t)(ev - PROCESS_EVENT_NONE);
+  if(ev < PROCESS_EVENT_NONE || i >= PROCESS_CONF_PROFILE_EVENTS) {
+    i = PROCESS_CONF_PROFILE_EVENTS;
+  }
+  profile_add(&p->profile, t, lc);
+  profile_add(&process_profile_events[i], t, lc);
+
+  if(t >= PROFILE_THRESHOLD) {
+    printf("process: '%s' ran for %u ticks on event 0x%02x, resumed at %lu, yielded at %lu\n",
+           PROCESS_NAME_STRING(p), (unsigned)t, ev,
+           (unsigned long)lc, (unsigned long)p->pt.lc);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+process_profile_reset(void)
+{
+  struct process *p;
+
+  memset(process_profile_events, 0, sizeof(process_profile_events));
+  for(p = process_list; p != NULL; p = p->next) {
+    memset(&p->profile, 0, sizeof(p->profile));
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* PROCESS_CONF_PROFILE */
 static void
 call_process(struct process *p, process_event_t ev, process_data_t data)
 {
   int ret;
+#if PROCESS_CONF_PROFILE
+  rtimer_clock_t start, elapsed, outer;
+  lc_t lc;
+#endif /* PROCESS_CONF_PROFILE */
 
 #if DEBUG
   if(p->state == PROCESS_STATE_CALLED) {
@@ -187,7 +298,18 @@ call_process(struct process *p, process_event_t ev, process_data_t data)
     PRINTF("process: calling process '%s' with event %d\n", PROCESS_NAME_STRING(p), ev);
     process_current = p;
     p->state = PROCESS_STATE_CALLED;
+#if PROCESS_CONF_PROFILE
+    lc = p->pt.lc;
+    outer = profile_nested;
+    profile_nested = 0;
+    start = RTIMER_NOW();
+#endif /* PROCESS_CONF_PROFILE */
     ret = p->thread(&p->pt, ev, data);
+#if PROCESS_CONF_PROFILE
+    elapsed = (rtimer_clock_t)(RTIMER_NOW() - start);
+    profile_dispatch(p, ev, (rtimer_clock_t)(elapsed - profile_nested), lc);
+    profile_nested = outer + elapsed;
+#endif /* PROCESS_CONF_PROFILE */
     if(ret == PT_EXITED ||
        ret == PT_ENDED ||
        ev == PROCESS_EVENT_EXIT) {
@@ -207,12 +329,26 @@ process_exit(struct process *p)
 void
 process_init(void)
 {
+  int i;
+
   lastevent = PROCESS_EVENT_MAX;
 
-  nevents = fevent = 0;
+  for(i = 0; i < PROCESS_PRIORITIES; i++) {
+    queues[i].nevents = queues[i].fevent = 0;
+  }
+  nevents = 0;
+  poll_put = poll_get = 0;
+  poll_scan = 0;
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
+  process_droppedevents = 0;
+  process_spilledevents = 0;
+  process_pollscans = 0;
 #endif /* PROCESS_CONF_STATS */
+#if PROCESS_CONF_PROFILE
+  memset(process_profile_events, 0, sizeof(process_profile_events));
+  profile_nested = 0;
+#endif /* PROCESS_CONF_PROFILE */
 
   process_current = process_list = NULL;
 }
@@ -222,17 +358,44 @@ process_init(void)
  */
 /*---------------------------------------------------------------------------*/
 static void
+poll_process(struct process *p)
+{
+  p->needspoll = 0;
+  if(process_is_running(p)) {
+    p->state = PROCESS_STATE_RUNNING;
+    call_process(p, PROCESS_EVENT_POLL, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
 do_poll(void)
 {
   struct process *p;
+  unsigned char end;
 
   poll_requested = 0;
-  /* Call the processes that needs to be polled. */
-  for(p = process_list; p != NULL; p = p->next) {
+
+  /* Call the processes that needs to be polled. Requests made by the
+     poll handlers themselves wait for the next round. */
+  end = poll_put;
+  while(poll_get != end) {
+    p = polls[poll_get & (PROCESS_CONF_NUMPOLLS - 1)];
+    poll_get++;
     if(p->needspoll) {
-      p->state = PROCESS_STATE_RUNNING;
-      p->needspoll = 0;
-      call_process(p, PROCESS_EVENT_POLL, NULL);
+      poll_process(p);
+    }
+  }
+
+  /* Some requests could not be queued: look at every process. */
+  if(poll_scan) {
+    poll_scan = 0;
+#if PROCESS_CONF_STATS
+    process_pollscans++;
+#endif /* PROCESS_CONF_STATS */
+    for(p = process_list; p != NULL; p = p->next) {
+      if(p->needspoll) {
+        poll_process(p);
+      }
     }
   }
 }
@@ -249,6 +412,7 @@ do_event(void)
   static process_data_t data;
   static struct process *receiver;
   static struct process *p;
+  struct event_queue *q;
   
   /*
    * If there are any events in the queue, take the first one and walk
@@ -259,16 +423,20 @@ do_event(void)
    */
 
   if(nevents > 0) {
+
+    /* There are events that we should deliver. Take the first one
+       from the highest priority queue that holds any. */
+    for(q = queues; q->nevents == 0; q++);
+
+    ev = q->events[q->fevent].ev;
     
-    /* There are events that we should deliver. */
-    ev = events[fevent].ev;
-    
-    data = events[fevent].data;
-    receiver = events[fevent].p;
+    data = q->events[q->fevent].data;
+    receiver = q->events[q->fevent].p;
 
     /* Since we have seen the new event, we move pointer upwards
        and decrease the number of events. */
-    fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    q->fevent = (q->fevent + 1) % q->size;
+    --q->nevents;
     --nevents;
 
     /* If this is a broadcast event, we deliver it to all events, in
@@ -319,9 +487,11 @@ process_nevents(void)
 }
 /*---------------------------------------------------------------------------*/
 int
-process_post(struct process *p, process_event_t ev, process_data_t data)
+process_post_prio(struct process *p, process_event_t ev,
+                  process_data_t data, unsigned char prio)
 {
   static process_num_events_t snum;
+  struct event_queue *q;
 
   if(PROCESS_CURRENT() == NULL) {
     PRINTF("process_post: NULL process posts event %d to process '%s', nevents %d\n",
@@ -331,8 +501,23 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   PROCESS_NAME_STRING(PROCESS_CURRENT()), ev,
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
+
+  if(prio >= PROCESS_PRIORITIES) {
+    prio = PROCESS_PRIORITIES - 1;
+  }
+
+  /* An event that does not fit in the queue of its priority goes to
+     the next lower priority queue that has room. */
+  for(q = &queues[prio]; q < &queues[PROCESS_PRIORITIES]; q++) {
+    if(q->nevents < q->size) {
+      break;
+    }
+  }
   
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+  if(q == &queues[PROCESS_PRIORITIES]) {
+#if PROCESS_CONF_STATS
+    process_droppedevents++;
+#endif /* PROCESS_CONF_STATS */
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, PROCESS_NAME_STRING(process_current));
@@ -342,11 +527,18 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 #endif /* DEBUG */
     return PROCESS_ERR_FULL;
   }
+
+#if PROCESS_CONF_STATS
+  if(q != &queues[prio]) {
+    process_spilledevents++;
+  }
+#endif /* PROCESS_CONF_STATS */
   
-  snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
+  snum = (process_num_events_t)(q->fevent + q->nevents) % q->size;
+  q->events[snum].ev = ev;
+  q->events[snum].data = data;
+  q->events[snum].p = p;
+  ++q->nevents;
   ++nevents;
 
 #if PROCESS_CONF_STATS
@@ -358,6 +550,14 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
   return PROCESS_ERR_OK;
 }
 /*---------------------------------------------------------------------------*/
+int
+process_post(struct process *p, process_event_t ev, process_data_t data)
+{
+  return process_post_prio(p, ev, data,
+                           ev == PROCESS_EVENT_TIMER ?
+                           PROCESS_PRIO_HIGH : PROCESS_PRIO_NORMAL);
+}
+/*---------------------------------------------------------------------------*/
 void
 process_post_synch(struct process *p, process_event_t ev, process_data_t data)
 {
@@ -373,6 +573,25 @@ process_poll(struct process *p)
   if(p != NULL) {
     if(p->state == PROCESS_STATE_RUNNING ||
        p->state == PROCESS_STATE_CALLED) {
+      if(p->needspoll) {
+        /* Already waiting for its poll handler to be called */
+        return;
+      }
+      if(poll_busy) {
+        /* Interrupted another process_poll() call */
+        poll_scan = 1;
+      } else {
+        /* Claim the queue before looking at it, so that a call that
+           interrupts this one cannot take the slot found here. */
+        poll_busy = 1;
+        if((unsigned char)(poll_put - poll_get) >= PROCESS_CONF_NUMPOLLS) {
+          poll_scan = 1;
+        } else {
+          polls[poll_put & (PROCESS_CONF_NUMPOLLS - 1)] = p;
+          poll_put++;
+        }
+        poll_busy = 0;
+      }
       p->needspoll = 1;
       poll_requested = 1;
     }
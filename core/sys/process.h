@@ -88,6 +88,33 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/* Size of the separate queue for high priority events, such as timer
+   events. Set to 0 to queue all events in a single FIFO. */
+#ifndef PROCESS_CONF_NUMEVENTS_HIGH
+#define PROCESS_CONF_NUMEVENTS_HIGH 8
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+
+/* Number of poll requests remembered between two runs of the poll
+   handlers. Must be a power of two, at most 128. */
+#ifndef PROCESS_CONF_NUMPOLLS
+#define PROCESS_CONF_NUMPOLLS 8
+#endif /* PROCESS_CONF_NUMPOLLS */
+
+/* Number of event numbers, counted from PROCESS_EVENT_NONE, whose
+   dispatch times are kept apart when PROCESS_CONF_PROFILE is set. The
+   times of all other events are added up in one more entry. */
+#ifndef PROCESS_CONF_PROFILE_EVENTS
+#define PROCESS_CONF_PROFILE_EVENTS 16
+#endif /* PROCESS_CONF_PROFILE_EVENTS */
+
+/**
+ * \name Event priorities
+ * @{
+ */
+#define PROCESS_PRIO_HIGH     0
+#define PROCESS_PRIO_NORMAL   1
+/* @} */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -312,6 +339,21 @@ static PT_THREAD(process_thread_##name(struct pt *process_pt,	\
 
 /** @} */
 
+#if PROCESS_CONF_PROFILE
+/*
+ * Time spent in the protothreads of a process, or on one type of
+ * event, in rtimer ticks. The time of a synchronous event posted from
+ * a protothread is counted for the receiving process only.
+ */
+struct process_profile {
+  unsigned long count, total, max;
+  /* Dispatches that took PROCESS_CONF_PROFILE_THRESHOLD ticks or more */
+  unsigned long overruns;
+  /* Where the protothread was resumed for the longest dispatch */
+  lc_t max_lc;
+};
+#endif /* PROCESS_CONF_PROFILE */
+
 struct process {
   struct process *next;
 #if PROCESS_CONF_NO_PROCESS_NAMES
@@ -323,6 +365,9 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+#if PROCESS_CONF_PROFILE
+  struct process_profile profile;
+#endif /* PROCESS_CONF_PROFILE */
 };
 
 /**
@@ -364,6 +409,33 @@ CCIF void process_start(struct process *p, process_data_t data);
  */
 CCIF int process_post(struct process *p, process_event_t ev, process_data_t data);
 
+/**
+ * Post an asynchronous event with a given priority.
+ *
+ * Events are delivered in FIFO order within each priority, and
+ * PROCESS_PRIO_HIGH events are delivered before any PROCESS_PRIO_NORMAL
+ * event. process_post() posts timer events with PROCESS_PRIO_HIGH and
+ * all other events with PROCESS_PRIO_NORMAL. A high priority event
+ * that does not fit in its own queue is queued as a normal priority
+ * event.
+ *
+ * \param p The process to which the event should be posted, or
+ * PROCESS_BROADCAST if the event should be posted to all processes.
+ *
+ * \param ev The event to be posted.
+ *
+ * \param data The auxiliary data to be sent with the event
+ *
+ * \param prio The priority of the event.
+ *
+ * \retval PROCESS_ERR_OK The event could be posted.
+ *
+ * \retval PROCESS_ERR_FULL The event queue was full and the event could
+ * not be posted.
+ */
+CCIF int process_post_prio(struct process *p, process_event_t ev,
+                           process_data_t data, unsigned char prio);
+
 /**
  * Post a synchronous event to a process.
  *
@@ -523,6 +595,29 @@ int process_nevents(void);
 
 CCIF extern struct process *process_list;
 
+#if PROCESS_CONF_STATS
+/* Largest number of events queued at once */
+extern process_num_events_t process_maxevents;
+/* Events dropped because the event queue was full */
+extern unsigned long process_droppedevents;
+/* High priority events queued as normal priority events */
+extern unsigned long process_spilledevents;
+/* Times the poll handlers fell back to scanning all processes */
+extern unsigned long process_pollscans;
+#endif /* PROCESS_CONF_STATS */
+
+#if PROCESS_CONF_PROFILE
+/* Dispatch times per event: entry i is for event PROCESS_EVENT_NONE + i
+   and the last entry for all other events */
+extern struct process_profile
+process_profile_events[PROCESS_CONF_PROFILE_EVENTS + 1];
+
+/**
+ * Clear the dispatch times of all running processes and all events.
+ */
+void process_profile_reset(void);
+#endif /* PROCESS_CONF_PROFILE */
+
 #define PROCESS_LIST() process_list
 
 #endif /* PROCESS_H_ */
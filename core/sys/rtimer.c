@@ -54,12 +54,59 @@
 #define PRINTF(...)
 #endif
 
+/* A task that runs more than RTIMER_LATE_THRESHOLD ticks after its
+   deadline is counted as late in the statistics. */
+#ifdef RTIMER_CONF_LATE_THRESHOLD
+#define RTIMER_LATE_THRESHOLD RTIMER_CONF_LATE_THRESHOLD
+#else
+#define RTIMER_LATE_THRESHOLD (RTIMER_ARCH_SECOND / 1000)
+#endif
+
+/* Pending tasks, sorted by deadline: the head of the queue is the task
+   the hardware timer is programmed for. */
 static struct rtimer *next_rtimer;
 
+/* The task and time last handed to rtimer_arch_schedule() */
+static struct rtimer *scheduled_rtimer;
+static rtimer_clock_t scheduled_time;
+
+#if RTIMER_STATS
+struct rtimer_stats rtimer_stats;
+#endif /* RTIMER_STATS */
+
+/*---------------------------------------------------------------------------*/
+static void
+schedule_head(void)
+{
+  /* Only reprogram the hardware timer when the head of the queue has
+     changed since it was last programmed. */
+  if(next_rtimer != NULL &&
+     (next_rtimer != scheduled_rtimer || next_rtimer->time != scheduled_time)) {
+    scheduled_rtimer = next_rtimer;
+    scheduled_time = next_rtimer->time;
+    rtimer_arch_schedule(scheduled_time);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_rtimer(struct rtimer *rtimer)
+{
+  struct rtimer **r;
+
+  for(r = &next_rtimer; *r != NULL; r = &(*r)->next) {
+    if(*r == rtimer) {
+      *r = rtimer->next;
+      break;
+    }
+  }
+  rtimer->next = NULL;
+}
 /*---------------------------------------------------------------------------*/
 void
 rtimer_init(void)
 {
+  next_rtimer = NULL;
+  scheduled_rtimer = NULL;
   rtimer_arch_init();
 }
 /*---------------------------------------------------------------------------*/
@@ -68,40 +115,90 @@ rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
 	   rtimer_clock_t duration,
 	   rtimer_callback_t func, void *ptr)
 {
-  int first = 0;
+  struct rtimer **r;
+  int s;
 
   PRINTF("rtimer_set time %d\n", time);
 
-  if(next_rtimer == NULL) {
-    first = 1;
-  }
+  s = RTIMER_ARCH_DISABLE_IRQ();
+
+  /* Setting a pending task again moves it to its new deadline */
+  remove_rtimer(rtimer);
 
   rtimer->func = func;
   rtimer->ptr = ptr;
-
   rtimer->time = time;
-  next_rtimer = rtimer;
 
-  if(first == 1) {
-    rtimer_arch_schedule(time);
-  }
+  /* Tasks with the same deadline run in the order they were set */
+  for(r = &next_rtimer;
+      *r != NULL && !RTIMER_CLOCK_LT(time, (*r)->time);
+      r = &(*r)->next);
+  rtimer->next = *r;
+  *r = rtimer;
+
+  schedule_head();
+
+  RTIMER_ARCH_RESTORE_IRQ(s);
   return RTIMER_OK;
 }
 /*---------------------------------------------------------------------------*/
 void
+rtimer_cancel(struct rtimer *rtimer)
+{
+  int s;
+
+  s = RTIMER_ARCH_DISABLE_IRQ();
+  remove_rtimer(rtimer);
+  schedule_head();
+  RTIMER_ARCH_RESTORE_IRQ(s);
+}
+/*---------------------------------------------------------------------------*/
+void
 rtimer_run_next(void)
 {
-  struct rtimer *t;
-  if(next_rtimer == NULL) {
-    return;
-  }
-  t = next_rtimer;
-  next_rtimer = NULL;
-  t->func(t, t->ptr);
-  if(next_rtimer != NULL) {
-    rtimer_arch_schedule(next_rtimer->time);
+  struct rtimer *t, *fired;
+  rtimer_clock_t now, fired_time;
+  int s;
+
+  s = RTIMER_ARCH_DISABLE_IRQ();
+
+  /* The task the hardware timer fired for runs even if the
+     architecture fires a tick early; the tasks after it, including a
+     task that sets itself again, only run once their deadline has
+     passed. */
+  fired = scheduled_rtimer;
+  fired_time = scheduled_time;
+  scheduled_rtimer = NULL;
+
+  while(next_rtimer != NULL) {
+    t = next_rtimer;
+    now = RTIMER_NOW();
+
+    if((t != fired || t->time != fired_time) &&
+       RTIMER_CLOCK_LT(now, t->time)) {
+      break;
+    }
+    fired = NULL;
+
+#if RTIMER_STATS
+    rtimer_stats.fired++;
+    if(RTIMER_CLOCK_LT(t->time + RTIMER_LATE_THRESHOLD, now)) {
+      rtimer_stats.late++;
+      if((rtimer_clock_t)(now - t->time) > rtimer_stats.max_lateness) {
+        rtimer_stats.max_lateness = now - t->time;
+      }
+    }
+#endif /* RTIMER_STATS */
+
+    next_rtimer = t->next;
+    t->next = NULL;
+    RTIMER_ARCH_RESTORE_IRQ(s);
+    t->func(t, t->ptr);
+    s = RTIMER_ARCH_DISABLE_IRQ();
   }
-  return;
+
+  schedule_head();
+  RTIMER_ARCH_RESTORE_IRQ(s);
 }
 /*---------------------------------------------------------------------------*/
 
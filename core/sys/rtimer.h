@@ -62,6 +62,25 @@ typedef unsigned short rtimer_clock_t;
 
 #include "rtimer-arch.h"
 
+/*
+ * The queue of pending tasks is changed by rtimer_set() and
+ * rtimer_cancel(), and by rtimer_run_next() from the rtimer
+ * interrupt. An architecture keeps the rtimer interrupt from running
+ * while the queue is changed by defining RTIMER_ARCH_DISABLE_IRQ(),
+ * which returns the state to give back to RTIMER_ARCH_RESTORE_IRQ().
+ * An architecture whose rtimer tasks never preempt other code defines
+ * them as no-ops.
+ */
+#ifndef RTIMER_ARCH_DISABLE_IRQ
+#error "rtimer-arch.h must define RTIMER_ARCH_DISABLE_IRQ() and RTIMER_ARCH_RESTORE_IRQ()"
+#endif /* RTIMER_ARCH_DISABLE_IRQ */
+
+#ifdef RTIMER_CONF_STATS
+#define RTIMER_STATS RTIMER_CONF_STATS
+#else
+#define RTIMER_STATS 0
+#endif
+
 /**
  * \brief      Initialize the real-time scheduler.
  *
@@ -82,11 +101,29 @@ typedef void (* rtimer_callback_t)(struct rtimer *t, void *ptr);
  *             support module for the real-time module.
  */
 struct rtimer {
+  struct rtimer *next;
   rtimer_clock_t time;
   rtimer_callback_t func;
   void *ptr;
 };
 
+#if RTIMER_STATS
+/**
+ * \brief      Statistics of the real-time scheduler
+ */
+struct rtimer_stats {
+  /** Number of tasks executed */
+  unsigned long fired;
+  /** Number of tasks executed later than RTIMER_CONF_LATE_THRESHOLD
+      ticks after their deadline */
+  unsigned long late;
+  /** Largest delay seen between a deadline and its task running */
+  rtimer_clock_t max_lateness;
+};
+
+extern struct rtimer_stats rtimer_stats;
+#endif /* RTIMER_STATS */
+
 enum {
   RTIMER_OK,
   RTIMER_ERR_FULL,
@@ -101,21 +138,36 @@ enum {
  * \param duration Unused argument.
  * \param func A function to be called when the task is executed.
  * \param ptr An opaque pointer that will be supplied as an argument to the callback function.
- * \return     Non-zero (true) if the task could be scheduled, zero
- *             (false) if the task could not be scheduled.
+ * \return     RTIMER_OK if the task was scheduled.
  *
  *             This function schedules a real-time task at a specified
- *             time in the future.
+ *             time in the future. Any number of tasks can be pending
+ *             at once; they run in the order of their deadlines.
+ *             Setting a task that is already pending moves it to the
+ *             new time.
  *
  */
 int rtimer_set(struct rtimer *task, rtimer_clock_t time,
 	       rtimer_clock_t duration, rtimer_callback_t func, void *ptr);
 
+/**
+ * \brief      Remove a pending real-time task
+ * \param task The task to remove
+ *
+ *             This function removes a task that was scheduled with
+ *             rtimer_set() before it runs. Cancelling a task that is
+ *             not pending has no effect.
+ *
+ */
+void rtimer_cancel(struct rtimer *task);
+
 /**
  * \brief      Execute the next real-time task and schedule the next task, if any
  *
  *             This function is called by the architecture dependent
  *             code to execute and schedule the next real-time task.
+ *             Tasks whose deadlines have passed by the time the first
+ *             one returns are executed in the same call.
  *
  */
 void rtimer_run_next(void);
@@ -39,4 +39,8 @@
 
 #define rtimer_arch_now() clock_time()
 
+/* Rtimers are never run from an interrupt here */
+#define RTIMER_ARCH_DISABLE_IRQ() 0
+#define RTIMER_ARCH_RESTORE_IRQ(s) (void)(s)
+
 #endif /* RTIMER_ARCH_H_ */
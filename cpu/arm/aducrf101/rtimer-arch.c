@@ -111,6 +111,21 @@ rtimer_arch_now(void)
   /* This is atomic because the FREEZE bit is set in T2CON. */
   return _timer2_val();
 }
+int
+rtimer_arch_disable_irq(void)
+{
+  int enabled = !__get_PRIMASK();
+
+  __disable_irq();
+  return enabled;
+}
+void
+rtimer_arch_restore_irq(int enabled)
+{
+  if(enabled) {
+    __enable_irq();
+  }
+}
 void
 rtimer_arch_schedule(rtimer_clock_t t)
 {
@@ -42,6 +42,12 @@
 
 #define RTIMER_ARCH_SECOND (32768)
 
+/* Defined before sys/rtimer.h looks for them */
+int rtimer_arch_disable_irq(void);
+void rtimer_arch_restore_irq(int enabled);
+#define RTIMER_ARCH_DISABLE_IRQ() rtimer_arch_disable_irq()
+#define RTIMER_ARCH_RESTORE_IRQ(s) rtimer_arch_restore_irq(s)
+
 #include "sys/rtimer.h"
 
 #endif /* __RTIMER_ARCH_H__ */
@@ -8,6 +8,13 @@
 #ifndef RTIMER_ARCH_H_
 #define RTIMER_ARCH_H_
 
+/* Defined before sys/rtimer.h looks for them. The state is the CPSR
+   returned by disableIRQ(). */
+#define RTIMER_ARCH_DISABLE_IRQ() disableIRQ()
+#define RTIMER_ARCH_RESTORE_IRQ(s) restoreIRQ(s)
+unsigned disableIRQ(void);
+unsigned restoreIRQ(unsigned oldCPSR);
+
 #include "sys/rtimer.h"
 
 #define RTIMER_ARCH_TIMER_ID AT91C_ID_TC1
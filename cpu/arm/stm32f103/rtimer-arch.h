@@ -8,6 +8,18 @@
 #ifndef RTIMER_ARCH_H_
 #define RTIMER_ARCH_H_
 
+/* Defined before sys/rtimer.h looks for them. PRIMASK is read back
+   so that a caller that already runs with interrupts off keeps them
+   off. */
+#include "cortexm3_macro.h"
+#define RTIMER_ARCH_DISABLE_IRQ() \
+  (__READ_PRIMASK() ? 0 : (__SETPRIMASK(), 1))
+#define RTIMER_ARCH_RESTORE_IRQ(s) do { \
+    if(s) { \
+      __RESETPRIMASK(); \
+    } \
+  } while(0)
+
 #include "sys/rtimer.h"
 
 #define RTIMER_ARCH_SECOND (MCK/1024)
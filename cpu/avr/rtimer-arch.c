@@ -194,6 +194,21 @@ rtimer_arch_init(void)
 #endif /* RTIMER_ARCH_PRESCALER */
 }
 /*---------------------------------------------------------------------------*/
+int
+rtimer_arch_disable_irq(void)
+{
+  uint8_t sreg = SREG;
+
+  cli();
+  return sreg;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_restore_irq(int sreg)
+{
+  SREG = sreg;
+}
+/*---------------------------------------------------------------------------*/
 void
 rtimer_arch_schedule(rtimer_clock_t t)
 {
@@ -68,4 +68,10 @@
 #endif
 
 void rtimer_arch_sleep(rtimer_clock_t howlong);
+
+/* The state kept by RTIMER_ARCH_DISABLE_IRQ() is SREG */
+int rtimer_arch_disable_irq(void);
+void rtimer_arch_restore_irq(int sreg);
+#define RTIMER_ARCH_DISABLE_IRQ() rtimer_arch_disable_irq()
+#define RTIMER_ARCH_RESTORE_IRQ(s) rtimer_arch_restore_irq(s)
 #endif /* RTIMER_ARCH_H_ */
@@ -89,6 +89,21 @@ rtimer_arch_init(void)
   PRINTF("done\n");
 }
 /*---------------------------------------------------------------------------*/
+int
+rtimer_arch_disable_irq(void)
+{
+  int ea = EA;
+
+  EA = 0;
+  return ea;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_restore_irq(int ea)
+{
+  EA = ea;
+}
+/*---------------------------------------------------------------------------*/
 void
 rtimer_arch_schedule(rtimer_clock_t t)
 {
@@ -59,4 +59,10 @@
 
 void cc2430_timer_1_ISR(void) __interrupt(T1_VECTOR);
 
+/* The state kept by RTIMER_ARCH_DISABLE_IRQ() is the old value of EA */
+int rtimer_arch_disable_irq(void);
+void rtimer_arch_restore_irq(int ea);
+#define RTIMER_ARCH_DISABLE_IRQ() rtimer_arch_disable_irq()
+#define RTIMER_ARCH_RESTORE_IRQ(s) rtimer_arch_restore_irq(s)
+
 #endif /* RTIMER_ARCH_H_ */
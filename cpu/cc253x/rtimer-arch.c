@@ -81,6 +81,21 @@ rtimer_arch_init(void)
   T1IE = 1;
 }
 /*---------------------------------------------------------------------------*/
+int
+rtimer_arch_disable_irq(void)
+{
+  int ea = EA;
+
+  EA = 0;
+  return ea;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_restore_irq(int ea)
+{
+  EA = ea;
+}
+/*---------------------------------------------------------------------------*/
 void
 rtimer_arch_schedule(rtimer_clock_t t)
 {
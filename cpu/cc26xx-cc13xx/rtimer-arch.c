@@ -56,6 +56,28 @@ rtimer_arch_init(void)
   return;
 }
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief Masks interrupts while sys/rtimer.h changes its task queue
+ * \return Non-zero if interrupts were enabled before the call
+ */
+int
+rtimer_arch_disable_irq(void)
+{
+  return !ti_lib_int_master_disable();
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Undoes rtimer_arch_disable_irq()
+ * \param enabled The value returned by rtimer_arch_disable_irq()
+ */
+void
+rtimer_arch_restore_irq(int enabled)
+{
+  if(enabled) {
+    ti_lib_int_master_enable();
+  }
+}
+/*---------------------------------------------------------------------------*/
 /**
  * \brief Schedules an rtimer task to be triggered at time t
  * \param t The time when the task will need executed.
@@ -94,6 +94,20 @@ rtimer_arch_init(void)
 	enable_irq(CRM);
 }
 
+int
+rtimer_arch_disable_irq(void)
+{
+	int intenable = ITC->INTENABLE;
+	ITC->INTENABLE = 0;
+	return intenable;
+}
+
+void
+rtimer_arch_restore_irq(int intenable)
+{
+	ITC->INTENABLE = intenable;
+}
+
 void
 rtimer_arch_schedule(rtimer_clock_t t)
 {
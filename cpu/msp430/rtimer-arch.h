@@ -40,6 +40,10 @@
 #ifndef RTIMER_ARCH_H_
 #define RTIMER_ARCH_H_
 
+/* Defined before sys/rtimer.h looks for them */
+#define RTIMER_ARCH_DISABLE_IRQ() splhigh()
+#define RTIMER_ARCH_RESTORE_IRQ(s) splx(s)
+
 #include "sys/rtimer.h"
 
 #ifdef RTIMER_CONF_SECOND
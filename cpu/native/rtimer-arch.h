@@ -41,9 +41,16 @@
 #define RTIMER_ARCH_H_
 
 #include "contiki-conf.h"
+#include "sys/clock.h"
 
 #define RTIMER_ARCH_SECOND CLOCK_CONF_SECOND
 
 #define rtimer_arch_now() clock_time()
 
+/* The rtimer interrupt is the SIGALRM signal */
+int rtimer_arch_disable_irq(void);
+void rtimer_arch_restore_irq(int enabled);
+#define RTIMER_ARCH_DISABLE_IRQ() rtimer_arch_disable_irq()
+#define RTIMER_ARCH_RESTORE_IRQ(s) rtimer_arch_restore_irq(s)
+
 #endif /* RTIMER_ARCH_H_ */
@@ -56,6 +56,7 @@
  */
 
 #include <pic32_timer.h>
+#include <pic32_irq.h>
 
 #include "contiki.h"
 
@@ -98,6 +99,24 @@ rtimer_arch_now(void)
   return TMR2;
 }
 /*---------------------------------------------------------------------------*/
+int
+rtimer_arch_disable_irq(void)
+{
+  uint32_t status;
+
+  /* di returns the old Status register, whose bit 0 is IE */
+  asm volatile("di %0" : "=r"(status));
+  return status & 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_restore_irq(int enabled)
+{
+  if(enabled) {
+    ASM_EN_INT;
+  }
+}
+/*---------------------------------------------------------------------------*/
 void
 rtimer_arch_schedule(rtimer_clock_t t)
 {
@@ -56,6 +56,11 @@
 
 rtimer_clock_t rtimer_arch_now(void);
 
+int rtimer_arch_disable_irq(void);
+void rtimer_arch_restore_irq(int enabled);
+#define RTIMER_ARCH_DISABLE_IRQ() rtimer_arch_disable_irq()
+#define RTIMER_ARCH_RESTORE_IRQ(s) rtimer_arch_restore_irq(s)
+
 #define RTIMER_ARCH_SECOND 312500
 
 #endif /* RTIMER_ARCH_H_ */
@@ -45,4 +45,8 @@
 
 /* void rtimer_isr(void) __interrupt(T1_VECTOR); */
 
+/* There is no rtimer interrupt yet, so there is nothing to mask */
+#define RTIMER_ARCH_DISABLE_IRQ() 0
+#define RTIMER_ARCH_RESTORE_IRQ(s) (void)(s)
+
 #endif /* __RTIMER_ARCH_H__ */
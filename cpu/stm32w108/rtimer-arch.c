@@ -53,7 +53,6 @@
 #define PRINTF(...)
 #endif
 
-static uint16_t saved_TIM1CFG;
 static uint32_t time_msb = 0;   /* Most significant bits of the current time. */
 
 /* time of the next rtimer event. Initially is set to the max
@@ -119,16 +118,19 @@ rtimer_arch_init(void)
 
 }
 /*---------------------------------------------------------------------------*/
-void
+int
 rtimer_arch_disable_irq(void)
 {
-  ATOMIC(saved_TIM1CFG = INT_TIM1CFG; INT_TIM1CFG = 0;)
+  int tim1cfg;
+
+  ATOMIC(tim1cfg = INT_TIM1CFG; INT_TIM1CFG = 0;)
+  return tim1cfg;
 }
 /*---------------------------------------------------------------------------*/
 void
-rtimer_arch_enable_irq(void)
+rtimer_arch_restore_irq(int tim1cfg)
 {
-  INT_TIM1CFG = saved_TIM1CFG;
+  INT_TIM1CFG = tim1cfg;
 }
 /*---------------------------------------------------------------------------*/
 rtimer_clock_t
@@ -89,9 +89,13 @@
 
 rtimer_clock_t rtimer_arch_now(void);
 
-void rtimer_arch_disable_irq(void);
+/* Only the TIM1 interrupt is masked; the state is its old INT_TIM1CFG */
+int rtimer_arch_disable_irq(void);
 
-void rtimer_arch_enable_irq(void);
+void rtimer_arch_restore_irq(int tim1cfg);
+
+#define RTIMER_ARCH_DISABLE_IRQ() rtimer_arch_disable_irq()
+#define RTIMER_ARCH_RESTORE_IRQ(s) rtimer_arch_restore_irq(s)
 
 #endif /* RTIMER_ARCH_H_ */
 /** @} */
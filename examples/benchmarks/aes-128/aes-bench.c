@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Throughput benchmark of the software AES-128 driver and of
+ *         CCM* on outgoing and incoming frames.
+ *
+ *         Build with "make TARGET=native T_TABLE=1" for the T-table
+ *         backend and without T_TABLE for the byte-oriented one (run
+ *         "make clean" in between). KEY_CACHE=2 lets the alternating
+ *         key test hit the key schedule cache.
+ */
+
+#include "contiki.h"
+#include "lib/aes-128.h"
+#include "lib/ccm-star.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BLOCKS     1000000UL
+#define FRAMES     100000UL
+#define FRAME_LEN  100
+#define HDR_LEN    16
+#define MIC_LEN    8
+
+static const uint8_t key1[AES_128_KEY_LENGTH] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t key2[AES_128_KEY_LENGTH] = {
+  0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+  0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf
+};
+
+/* FIPS-197, Appendix C.1 */
+static const uint8_t plaintext[AES_128_BLOCK_SIZE] = {
+  0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+  0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+static const uint8_t ciphertext[AES_128_BLOCK_SIZE] = {
+  0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+  0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+/*---------------------------------------------------------------------------*/
+static unsigned long
+bytes_per_second(clock_time_t elapsed, unsigned long bytes)
+{
+  if(elapsed == 0) {
+    elapsed = 1;
+  }
+  return (unsigned long)(((unsigned long long)bytes * CLOCK_SECOND) / elapsed);
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_known_answer(void)
+{
+  uint8_t block[AES_128_BLOCK_SIZE];
+
+  /* Switch keys back and forth to exercise the key schedule cache */
+  AES_128.set_key(key1);
+  AES_128.set_key(key2);
+  AES_128.set_key(key1);
+  memcpy(block, plaintext, AES_128_BLOCK_SIZE);
+  AES_128.encrypt(block);
+  return memcmp(block, ciphertext, AES_128_BLOCK_SIZE) == 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_benchmark(void)
+{
+  uint8_t block[AES_128_BLOCK_SIZE];
+  uint8_t frame[FRAME_LEN + MIC_LEN];
+  uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+  uint8_t mic[MIC_LEN];
+  clock_time_t start;
+  unsigned long i;
+
+  printf("aes-bench: T-table %d, key cache %d\n",
+         AES_128_WITH_T_TABLE, AES_128_KEY_CACHE_SIZE);
+  printf("aes-bench: FIPS-197 known answer %s\n",
+         check_known_answer() ? "ok" : "FAILED");
+
+  memset(block, 0, sizeof(block));
+  AES_128.set_key(key1);
+  start = clock_time();
+  for(i = 0; i < BLOCKS; i++) {
+    AES_128.encrypt(block);
+  }
+  printf("aes-bench: encrypt: %lu bytes/s\n",
+         bytes_per_second(clock_time() - start, BLOCKS * AES_128_BLOCK_SIZE));
+
+  start = clock_time();
+  for(i = 0; i < BLOCKS; i++) {
+    AES_128.set_key((i & 1) ? key2 : key1);
+    AES_128.encrypt(block);
+  }
+  printf("aes-bench: alternating keys: %lu bytes/s\n",
+         bytes_per_second(clock_time() - start, BLOCKS * AES_128_BLOCK_SIZE));
+
+  memset(frame, 0x5a, sizeof(frame));
+  memset(nonce, 0xa5, sizeof(nonce));
+  start = clock_time();
+  for(i = 0; i < FRAMES; i++) {
+    CCM_STAR.set_key(key1);
+    nonce[12] = i;
+    CCM_STAR.aead(nonce,
+        frame + HDR_LEN, FRAME_LEN - HDR_LEN,
+        frame, HDR_LEN,
+        frame + FRAME_LEN, MIC_LEN,
+        1);
+  }
+  printf("aes-bench: CCM* %d byte frames, outgoing: %lu bytes/s\n", FRAME_LEN,
+         bytes_per_second(clock_time() - start, FRAMES * FRAME_LEN));
+
+  start = clock_time();
+  for(i = 0; i < FRAMES; i++) {
+    CCM_STAR.set_key(key1);
+    nonce[12] = i;
+    CCM_STAR.aead(nonce,
+        frame + HDR_LEN, FRAME_LEN - HDR_LEN,
+        frame, HDR_LEN,
+        mic, MIC_LEN,
+        0);
+    if(!ccm_star_mic_cmp(mic, frame + FRAME_LEN, MIC_LEN)) {
+      frame[HDR_LEN]++;
+    }
+  }
+  printf("aes-bench: CCM* %d byte frames, incoming: %lu bytes/s\n", FRAME_LEN,
+         bytes_per_second(clock_time() - start, FRAMES * FRAME_LEN));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(aes_bench_process, "AES-128 benchmark");
+AUTOSTART_PROCESSES(&aes_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(aes_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  run_benchmark();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of deferred calls.
+ *
+ *         Compares the cost of running a callback right after the
+ *         current call chain with a zero delay ctimer and with a
+ *         deferred call, and checks that calls posted while the queue
+ *         is full still run, also when defer_post() is called from a
+ *         signal handler that interrupts another defer_post() call.
+ */
+
+#include "contiki.h"
+#include "sys/defer.h"
+#include <stdio.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#define CALLS    200000UL
+#define BURST    (3 * DEFER_QUEUE_SIZE)
+#define ROUNDS   500000UL
+
+PROCESS(defer_bench_process, "Defer benchmark");
+AUTOSTART_PROCESSES(&defer_bench_process);
+
+static struct ctimer ct;
+static struct defer chain;
+static struct defer burst[BURST];
+static unsigned long calls;
+static unsigned burst_calls[BURST];
+
+/* Posted from the benchmark (the first half) and from a signal handler
+   standing in for an interrupt handler (the second half) */
+static struct defer nested[2 * DEFER_QUEUE_SIZE];
+static volatile unsigned long interrupts;
+
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns_per_op(clock_time_t elapsed, unsigned long ops)
+{
+  return (unsigned long)(((unsigned long long)elapsed * 1000000000ULL)
+                         / CLOCK_SECOND / ops);
+}
+/*---------------------------------------------------------------------------*/
+static void
+ctimer_callback(void *ptr)
+{
+  if(++calls < CALLS) {
+    ctimer_set(&ct, 0, ctimer_callback, NULL);
+  } else {
+    process_post(&defer_bench_process, PROCESS_EVENT_CONTINUE, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+defer_callback(void *ptr)
+{
+  if(++calls < CALLS) {
+    defer_post(&chain);
+  } else {
+    process_post(&defer_bench_process, PROCESS_EVENT_CONTINUE, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+burst_callback(void *ptr)
+{
+  burst_calls[(struct defer *)ptr - burst]++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+nested_callback(void *ptr)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+interrupt(int sig)
+{
+  defer_post(&nested[DEFER_QUEUE_SIZE + interrupts % DEFER_QUEUE_SIZE]);
+  interrupts++;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(defer_bench_process, ev, data)
+{
+  static clock_time_t start;
+  static unsigned i, ran, twice;
+  static unsigned long round, lost;
+  static sigset_t mask;
+  static void (*handler)(int);
+  struct itimerval it;
+
+  PROCESS_BEGIN();
+
+  calls = 0;
+  start = clock_time();
+  ctimer_set(&ct, 0, ctimer_callback, NULL);
+  PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_CONTINUE);
+  printf("defer-bench: ctimer: %lu ns/call\n",
+         ns_per_op(clock_time() - start, CALLS));
+
+  defer_set(&chain, defer_callback, NULL);
+  calls = 0;
+  start = clock_time();
+  defer_post(&chain);
+  PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_CONTINUE);
+  printf("defer-bench: defer: %lu ns/call\n",
+         ns_per_op(clock_time() - start, CALLS));
+
+  /* More calls than the queue holds, each posted twice */
+  for(i = 0; i < BURST; i++) {
+    defer_set(&burst[i], burst_callback, &burst[i]);
+  }
+  for(i = 0; i < BURST; i++) {
+    defer_post(&burst[i]);
+    defer_post(&burst[i]);
+  }
+  PROCESS_PAUSE();
+  ran = twice = 0;
+  for(i = 0; i < BURST; i++) {
+    ran += burst_calls[i] > 0;
+    twice += burst_calls[i] > 1;
+  }
+  printf("defer-bench: burst of %u: %u ran, %u ran twice\n",
+         BURST, ran, twice);
+
+  /* Calls posted while the queue fills up, interrupted by calls posted
+     from a signal handler. After each round the posted calls are run
+     with the signal blocked: any call that is still pending then has
+     been lost. */
+  for(i = 0; i < 2 * DEFER_QUEUE_SIZE; i++) {
+    defer_set(&nested[i], nested_callback, NULL);
+  }
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGALRM);
+  handler = signal(SIGALRM, interrupt);
+  it.it_interval.tv_sec = it.it_value.tv_sec = 0;
+  it.it_interval.tv_usec = it.it_value.tv_usec = 5;
+  setitimer(ITIMER_REAL, &it, NULL);
+  lost = 0;
+  for(round = 0; round < ROUNDS; round++) {
+    for(i = 0; i < DEFER_QUEUE_SIZE; i++) {
+      defer_post(&nested[i]);
+    }
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    /* Only the deferred calls have anything to do: run them right here */
+    PROCESS_CONTEXT_BEGIN(PROCESS_CURRENT());
+    process_run();
+    PROCESS_CONTEXT_END(PROCESS_CURRENT());
+    for(i = 0; i < 2 * DEFER_QUEUE_SIZE; i++) {
+      if(defer_pending(&nested[i])) {
+        lost++;
+        defer_cancel(&nested[i]);
+      }
+    }
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
+  }
+  it.it_interval.tv_usec = it.it_value.tv_usec = 0;
+  setitimer(ITIMER_REAL, &it, NULL);
+  signal(SIGALRM, handler);
+  printf("defer-bench: nested posts: %lu interrupts, %lu lost\n",
+         interrupts, lost);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
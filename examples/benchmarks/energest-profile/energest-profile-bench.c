@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the energest subsystem markers and profile.
+ *
+ *         Measures the cost of an enter/leave marker pair, then runs
+ *         a load that spends about 20% of each interval in the "app"
+ *         subsystem and 5% in "coap" sections nested inside it, and
+ *         prints the resulting profile. Build with e.g.
+ *         "make TARGET=native SUBSYSTEMS=0" (run "make clean" in
+ *         between).
+ */
+
+#include "contiki.h"
+#include "energest-profile.h"
+#include "rest-engine.h"
+#include <stdio.h>
+
+#define OPS        1000000UL
+#define INTERVALS  4
+
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns_per_op(clock_time_t elapsed, unsigned long ops)
+{
+  return (unsigned long)(((unsigned long long)elapsed * 1000000000ULL)
+                         / CLOCK_SECOND / ops);
+}
+/*---------------------------------------------------------------------------*/
+static void
+busy_wait(clock_time_t duration)
+{
+  clock_time_t start;
+
+  start = clock_time();
+  while(clock_time() - start < duration);
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_profile(int subsystem)
+{
+  const struct energest_profile *p;
+  int i;
+
+  p = energest_profile_get(subsystem);
+  printf("energest-profile-bench: %-10s cpu %lu ms last %u/1024 histogram",
+         energest_subsystem_name(subsystem), p->cpu, p->last_cpu);
+  for(i = 0; i < ENERGEST_PROFILE_BUCKETS; i++) {
+    printf(" %u", p->cpu_histogram[i]);
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(energest_profile_bench_process, "Energest profile benchmark");
+AUTOSTART_PROCESSES(&energest_profile_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(energest_profile_bench_process, ev, data)
+{
+  static struct etimer et;
+  static clock_time_t start;
+  unsigned long i;
+
+  PROCESS_BEGIN();
+
+  rest_init_engine();
+  energest_profile_coap_init();
+  energest_profile_lwm2m_init();
+
+  start = clock_time();
+  for(i = 0; i < OPS; i++) {
+    ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_APP);
+    ENERGEST_SUBSYSTEM_LEAVE();
+  }
+  printf("energest-profile-bench: enter/leave %lu ns/op\n",
+         ns_per_op(clock_time() - start, OPS));
+
+  energest_profile_start(CLOCK_SECOND);
+  while(energest_profile_intervals() < INTERVALS) {
+    ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_APP);
+    busy_wait(CLOCK_SECOND / 50);
+    ENERGEST_SUBSYSTEM_ENTER(ENERGEST_SUBSYSTEM_COAP);
+    busy_wait(CLOCK_SECOND / 200);
+    ENERGEST_SUBSYSTEM_LEAVE();
+    ENERGEST_SUBSYSTEM_LEAVE();
+    etimer_set(&et, CLOCK_SECOND / 10 - CLOCK_SECOND / 40);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+  energest_profile_stop();
+
+  for(i = 0; i < ENERGEST_SUBSYSTEM_MAX; i++) {
+    print_profile(i);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the event timer list with many concurrent timers.
+ *
+ *         Measures the cost of an etimer_process poll while no timer
+ *         expires, of (re)setting a timer, and of dispatching a burst of
+ *         timers that all expire together. Build with e.g.
+ *         "make TARGET=native TIMERS=1000" (run "make clean" in between).
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include <stdio.h>
+
+#ifdef ETIMER_BENCH_TIMERS
+#define TIMERS ETIMER_BENCH_TIMERS
+#else
+#define TIMERS 100
+#endif
+
+#define POLLS      100000UL
+#define RESETS     100000UL
+#define BURSTS     (100000UL / TIMERS)
+
+static struct etimer timers[TIMERS];
+
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns_per_op(clock_time_t elapsed, unsigned long ops)
+{
+  return (unsigned long)(((unsigned long long)elapsed * 1000000000ULL)
+                         / CLOCK_SECOND / ops);
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+far_interval(void)
+{
+  return CLOCK_SECOND * 60 + random_rand() % (CLOCK_SECOND * 60);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(etimer_bench_process, "Event timer benchmark");
+AUTOSTART_PROCESSES(&etimer_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_bench_process, ev, data)
+{
+  static clock_time_t start;
+  static unsigned long i, fired;
+  static int n;
+
+  PROCESS_BEGIN();
+
+  /* Polls of the event timer process while no timer expires */
+  for(n = 0; n < TIMERS; n++) {
+    etimer_set(&timers[n], far_interval());
+  }
+  start = clock_time();
+  for(i = 0; i < POLLS; i++) {
+    etimer_request_poll();
+    PROCESS_PAUSE();
+  }
+  printf("etimer-bench: %d timers: idle %lu ns/tick\n",
+         TIMERS, ns_per_op(clock_time() - start, POLLS));
+
+  /* Setting timers while the others are pending */
+  start = clock_time();
+  for(i = 0; i < RESETS; i++) {
+    etimer_set(&timers[random_rand() % TIMERS], far_interval());
+  }
+  printf("etimer-bench: %d timers: set %lu ns/op\n",
+         TIMERS, ns_per_op(clock_time() - start, RESETS));
+
+  /* Bursts of timers all expiring at once */
+  fired = 0;
+  start = clock_time();
+  for(i = 0; i < BURSTS; i++) {
+    for(n = 0; n < TIMERS; n++) {
+      etimer_set(&timers[n], 0);
+    }
+    for(n = 0; n < TIMERS; n++) {
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+      fired++;
+    }
+  }
+  printf("etimer-bench: %d timers: burst %lu ns/expiry (%lu fired)\n",
+         TIMERS, ns_per_op(clock_time() - start, fired), fired);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
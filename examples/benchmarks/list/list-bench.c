@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of singly and doubly linked lists.
+ *
+ *         Measures a FIFO queue (add at the tail, pop from the head),
+ *         as used for packet and transaction queues, and moving a
+ *         random element to the head, as done for recently used
+ *         routes. Build with e.g. "make TARGET=native ELEMENTS=256"
+ *         (run "make clean" in between).
+ */
+
+#include "contiki.h"
+#include "lib/list.h"
+#include "lib/dlist.h"
+#include "lib/random.h"
+#include <stdio.h>
+
+#ifdef LIST_BENCH_ELEMENTS
+#define ELEMENTS LIST_BENCH_ELEMENTS
+#else
+#define ELEMENTS 8
+#endif
+
+#define OPS        1000000UL
+
+struct element {
+  struct element *next;
+  struct element *prev;
+  int value;
+};
+
+static struct element elements[ELEMENTS];
+
+LIST(slist);
+DLIST(dlist);
+
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns_per_op(clock_time_t elapsed, unsigned long ops)
+{
+  return (unsigned long)(((unsigned long long)elapsed * 1000000000ULL)
+                         / CLOCK_SECOND / ops);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(list_bench_process, "List benchmark");
+AUTOSTART_PROCESSES(&list_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(list_bench_process, ev, data)
+{
+  static clock_time_t start;
+  unsigned long i;
+  struct element *e;
+  int n;
+
+  PROCESS_BEGIN();
+
+  /* FIFO queue operations */
+  list_init(slist);
+  for(n = 0; n < ELEMENTS - 1; n++) {
+    list_add(slist, &elements[n]);
+  }
+  start = clock_time();
+  for(i = 0; i < OPS; i++) {
+    list_add(slist, &elements[(i + ELEMENTS - 1) % ELEMENTS]);
+    list_pop(slist);
+  }
+  printf("list-bench: %d elements: list queue %lu ns/op\n",
+         ELEMENTS, ns_per_op(clock_time() - start, OPS));
+
+  dlist_init(dlist);
+  for(n = 0; n < ELEMENTS; n++) {
+    dlist_init_item(&elements[n]);
+  }
+  for(n = 0; n < ELEMENTS - 1; n++) {
+    dlist_add(dlist, &elements[n]);
+  }
+  start = clock_time();
+  for(i = 0; i < OPS; i++) {
+    dlist_add(dlist, &elements[(i + ELEMENTS - 1) % ELEMENTS]);
+    dlist_pop(dlist);
+  }
+  printf("list-bench: %d elements: dlist queue %lu ns/op\n",
+         ELEMENTS, ns_per_op(clock_time() - start, OPS));
+
+  /* Moving a random element to the head */
+  list_init(slist);
+  for(n = 0; n < ELEMENTS; n++) {
+    list_add(slist, &elements[n]);
+  }
+  start = clock_time();
+  for(i = 0; i < OPS; i++) {
+    e = &elements[random_rand() % ELEMENTS];
+    list_remove(slist, e);
+    list_push(slist, e);
+  }
+  printf("list-bench: %d elements: list move to head %lu ns/op (%d on list)\n",
+         ELEMENTS, ns_per_op(clock_time() - start, OPS), list_length(slist));
+
+  dlist_init(dlist);
+  for(n = 0; n < ELEMENTS; n++) {
+    dlist_init_item(&elements[n]);
+  }
+  for(n = 0; n < ELEMENTS; n++) {
+    dlist_add(dlist, &elements[n]);
+  }
+  start = clock_time();
+  for(i = 0; i < OPS; i++) {
+    e = &elements[random_rand() % ELEMENTS];
+    dlist_remove(dlist, e);
+    dlist_push(dlist, e);
+  }
+  printf("list-bench: %d elements: dlist move to head %lu ns/op (%d on list)\n",
+         ELEMENTS, ns_per_op(clock_time() - start, OPS), dlist_length(dlist));
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the memory block allocator.
+ *
+ *         Measures memb_alloc() and memb_free() when filling and
+ *         emptying a pool, and when blocks are freed and allocated at
+ *         random while the pool is nearly full, as packet buffers and
+ *         neighbor entries are. Build with e.g.
+ *         "make TARGET=native BLOCKS=512" (run "make clean" in between).
+ */
+
+#include "contiki.h"
+#include "lib/memb.h"
+#include "lib/random.h"
+#include <stdio.h>
+
+#ifdef MEMB_BENCH_BLOCKS
+#define BLOCKS MEMB_BENCH_BLOCKS
+#else
+#define BLOCKS 64
+#endif
+
+#define ROUNDS     (1000000UL / BLOCKS)
+#define CHURNS     1000000UL
+
+struct block {
+  struct block *next;
+  uint8_t data[30];
+};
+
+MEMB(blocks, struct block, BLOCKS);
+static struct block *allocated[BLOCKS];
+
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns_per_op(clock_time_t elapsed, unsigned long ops)
+{
+  return (unsigned long)(((unsigned long long)elapsed * 1000000000ULL)
+                         / CLOCK_SECOND / ops);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(memb_bench_process, "Memory block benchmark");
+AUTOSTART_PROCESSES(&memb_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(memb_bench_process, ev, data)
+{
+  static clock_time_t start;
+  unsigned long i, failed;
+  int n;
+
+  PROCESS_BEGIN();
+
+  memb_init(&blocks);
+
+  /* Filling and emptying the pool */
+  failed = 0;
+  start = clock_time();
+  for(i = 0; i < ROUNDS; i++) {
+    for(n = 0; n < BLOCKS; n++) {
+      allocated[n] = memb_alloc(&blocks);
+    }
+    for(n = 0; n < BLOCKS; n++) {
+      if(memb_free(&blocks, allocated[n]) != 0) {
+        failed++;
+      }
+    }
+  }
+  printf("memb-bench: %d blocks: fill %lu ns/alloc+free (%lu failed)\n",
+         BLOCKS, ns_per_op(clock_time() - start, ROUNDS * BLOCKS), failed);
+
+  /* Random churn with all blocks but one in use */
+  for(n = 0; n < BLOCKS - 1; n++) {
+    allocated[n] = memb_alloc(&blocks);
+  }
+  failed = 0;
+  start = clock_time();
+  for(i = 0; i < CHURNS; i++) {
+    n = random_rand() % (BLOCKS - 1);
+    memb_free(&blocks, allocated[n]);
+    allocated[n] = memb_alloc(&blocks);
+    if(allocated[n] == NULL) {
+      failed++;
+    }
+  }
+  printf("memb-bench: %d blocks: churn %lu ns/alloc+free (%lu failed, %d free)\n",
+         BLOCKS, ns_per_op(clock_time() - start, CHURNS), failed,
+         memb_numfree(&blocks));
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the managed memory allocator.
+ *
+ *         Blocks of random sizes are allocated and freed at random
+ *         while the memory stays well filled. Every block holds a
+ *         pattern that is checked before it is freed, so that blocks
+ *         moved by compaction are verified too. Build with e.g.
+ *         "make TARGET=native SIZE_CLASSES=1" (run "make clean" in
+ *         between).
+ */
+
+#include "contiki.h"
+#include "lib/mmem.h"
+#include "lib/random.h"
+#include <stdio.h>
+#include <string.h>
+
+#define HANDLES    48
+#define MAX_SIZE   160
+#define OPS        1000000UL
+
+static struct mmem handles[HANDLES];
+static unsigned char used[HANDLES];
+
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns_per_op(clock_time_t elapsed, unsigned long ops)
+{
+  return (unsigned long)(((unsigned long long)elapsed * 1000000000ULL)
+                         / CLOCK_SECOND / ops);
+}
+/*---------------------------------------------------------------------------*/
+static int
+check(int n)
+{
+  unsigned char *p;
+  unsigned int i;
+
+  p = (unsigned char *)MMEM_PTR(&handles[n]);
+  for(i = 0; i < handles[n].size; i++) {
+    if(p[i] != (unsigned char)n) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(mmem_bench_process, "Managed memory benchmark");
+AUTOSTART_PROCESSES(&mmem_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mmem_bench_process, ev, data)
+{
+  static clock_time_t start;
+  unsigned long i, allocs, frees, failed, corrupt;
+  int n;
+
+  PROCESS_BEGIN();
+
+  mmem_init();
+
+  allocs = frees = failed = corrupt = 0;
+  start = clock_time();
+  for(i = 0; i < OPS; i++) {
+    n = random_rand() % HANDLES;
+    if(used[n]) {
+      if(!check(n)) {
+        corrupt++;
+      }
+      mmem_free(&handles[n]);
+      used[n] = 0;
+      frees++;
+    } else if(mmem_alloc(&handles[n], 1 + random_rand() % MAX_SIZE)) {
+      memset(MMEM_PTR(&handles[n]), n, handles[n].size);
+      used[n] = 1;
+      allocs++;
+    } else {
+      failed++;
+    }
+  }
+  printf("mmem-bench: %lu ns/op, %lu allocs, %lu frees, %lu failed, %lu corrupt\n",
+         ns_per_op(clock_time() - start, OPS), allocs, frees, failed, corrupt);
+  printf("mmem-bench: moved %lu bytes in total, at most %u at once\n",
+         mmem_stats.moved, mmem_stats.max_moved);
+#if MMEM_SIZE_CLASSES
+  printf("mmem-bench: %u compactions, %u bytes in freed blocks, %u bytes unrequested\n",
+         mmem_stats.compactions, mmem_stats.listed, mmem_stats.internal);
+#endif /* MMEM_SIZE_CLASSES */
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of neighbor table lookups by link-layer address.
+ *
+ *         Build with e.g. "make TARGET=native NEIGHBORS=64" and compare
+ *         with "make TARGET=native NEIGHBORS=64 WITH_HASH=0" (run
+ *         "make clean" in between).
+ */
+
+#include "contiki.h"
+#include "net/nbr-table.h"
+#include "lib/random.h"
+#include <stdio.h>
+#include <string.h>
+
+#define LOOKUPS    1000000UL
+#define EVICTIONS  100000UL
+
+struct bench_entry {
+  uint16_t value;
+};
+NBR_TABLE(struct bench_entry, bench_table);
+
+static linkaddr_t addrs[NBR_TABLE_MAX_NEIGHBORS];
+
+/*---------------------------------------------------------------------------*/
+static void
+make_addr(linkaddr_t *addr)
+{
+  int i;
+  /* Typical EUI-64: constant vendor prefix, varying low-order bytes */
+  memset(addr, 0, sizeof(linkaddr_t));
+  addr->u8[0] = 0x00;
+  addr->u8[1] = 0x12;
+  for(i = LINKADDR_SIZE / 2; i < LINKADDR_SIZE; i++) {
+    addr->u8[i] = random_rand() & 0xff;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns_per_op(clock_time_t elapsed, unsigned long ops)
+{
+  return (unsigned long)(((unsigned long long)elapsed * 1000000000ULL)
+                         / CLOCK_SECOND / ops);
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_benchmark(void)
+{
+  struct bench_entry *e;
+  linkaddr_t miss;
+  clock_time_t start;
+  unsigned long i, found;
+  int n;
+
+  nbr_table_register(bench_table, NULL);
+
+  /* Fill the table */
+  for(n = 0; n < NBR_TABLE_MAX_NEIGHBORS; n++) {
+    make_addr(&addrs[n]);
+    e = nbr_table_add_lladdr(bench_table, &addrs[n]);
+    if(e == NULL) {
+      printf("nbr-table-bench: could only add %d neighbors\n", n);
+      break;
+    }
+    e->value = n;
+  }
+
+  /* Lookups of present neighbors */
+  found = 0;
+  start = clock_time();
+  for(i = 0; i < LOOKUPS; i++) {
+    e = nbr_table_get_from_lladdr(bench_table, &addrs[i % n]);
+    if(e != NULL && e->value == i % n) {
+      found++;
+    }
+  }
+  printf("nbr-table-bench: %d neighbors, hash %d: hit %lu ns/lookup (%lu/%lu found)\n",
+         n, NBR_TABLE_WITH_HASH, ns_per_op(clock_time() - start, LOOKUPS),
+         found, LOOKUPS);
+
+  /* Lookups of unknown neighbors */
+  make_addr(&miss);
+  miss.u8[1] = 0x13;
+  start = clock_time();
+  for(i = 0; i < LOOKUPS; i++) {
+    miss.u8[LINKADDR_SIZE - 1] = i & 0xff;
+    e = nbr_table_get_from_lladdr(bench_table, &miss);
+  }
+  printf("nbr-table-bench: %d neighbors, hash %d: miss %lu ns/lookup\n",
+         n, NBR_TABLE_WITH_HASH, ns_per_op(clock_time() - start, LOOKUPS));
+
+  /* Insertions into a full table, each evicting an old neighbor */
+  start = clock_time();
+  for(i = 0; i < EVICTIONS; i++) {
+    make_addr(&miss);
+    nbr_table_add_lladdr(bench_table, &miss);
+  }
+  printf("nbr-table-bench: %d neighbors, hash %d: evict+add %lu ns/op\n",
+         n, NBR_TABLE_WITH_HASH, ns_per_op(clock_time() - start, EVICTIONS));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(nbr_table_bench_process, "Neighbor table benchmark");
+AUTOSTART_PROCESSES(&nbr_table_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(nbr_table_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  run_benchmark();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
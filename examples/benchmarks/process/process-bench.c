@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Stress test of the process event queue and poll handling.
+ *
+ *         Measures the cost of polling a process while other
+ *         processes are running, and the latency of timer events
+ *         while another process keeps the event queue full. The
+ *         latency is counted in events delivered to the loaded
+ *         process between the expiration of the timer and the
+ *         delivery of its event. Build with e.g.
+ *         "make TARGET=native IDLE=100 HIGH=0" (run "make clean" in
+ *         between). process_poll() is also called from a signal
+ *         handler, to check that no poll request is lost when it
+ *         interrupts another process_poll() call. With PROFILE=1 the dispatch times are profiled
+ *         and a deliberately slow handler is run, which the process
+ *         kernel should report.
+ */
+
+#include "contiki.h"
+#include <stdio.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#ifdef PROCESS_BENCH_IDLE
+#define IDLE PROCESS_BENCH_IDLE
+#else
+#define IDLE 10
+#endif
+
+#define POLLS      100000UL
+#define SAMPLES    10000UL
+/* The load stops for a while once a timer event has waited this long */
+#define STARVED    1000UL
+#define ROUNDS     500000UL
+
+/* Latency histogram: bucket i counts latencies up to limits[i] */
+static const unsigned limits[] = { 0, 1, 2, 4, 8, 16, 32, 64 };
+#define BUCKETS (sizeof(limits) / sizeof(limits[0]) + 1)
+static unsigned long histogram[BUCKETS];
+
+static unsigned long polled;
+static unsigned long loaded, mark;
+static unsigned char loading;
+
+#if IDLE > 0
+static struct process idle[IDLE];
+#endif
+
+/* Polled from the benchmark (the first half) and from a signal
+   handler standing in for an interrupt handler (the second half) */
+static struct process targets[2 * PROCESS_CONF_NUMPOLLS];
+static volatile unsigned long interrupts;
+
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns_per_op(clock_time_t elapsed, unsigned long ops)
+{
+  return (unsigned long)(((unsigned long long)elapsed * 1000000000ULL)
+                         / CLOCK_SECOND / ops);
+}
+/*---------------------------------------------------------------------------*/
+#if IDLE > 0
+static
+PT_THREAD(idle_thread(struct pt *pt, process_event_t ev, process_data_t data))
+{
+  PT_BEGIN(pt);
+  while(1) {
+    PT_YIELD(pt);
+  }
+  PT_END(pt);
+}
+#endif
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(target_thread(struct pt *pt, process_event_t ev, process_data_t data))
+{
+  PT_BEGIN(pt);
+  while(1) {
+    PT_YIELD(pt);
+  }
+  PT_END(pt);
+}
+/*---------------------------------------------------------------------------*/
+static void
+interrupt(int sig)
+{
+  process_poll(&targets[PROCESS_CONF_NUMPOLLS +
+                        interrupts % PROCESS_CONF_NUMPOLLS]);
+  interrupts++;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(process_bench_process, "Process benchmark");
+PROCESS(pollee_process, "Polled process");
+PROCESS(load_process, "Event load");
+#if PROCESS_CONF_PROFILE
+PROCESS(slow_process, "Slow handler");
+#endif /* PROCESS_CONF_PROFILE */
+AUTOSTART_PROCESSES(&process_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(pollee_process, ev, data)
+{
+  PROCESS_POLLHANDLER(polled++);
+
+  PROCESS_BEGIN();
+  PROCESS_WAIT_UNTIL(0);
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(load_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_CONTINUE);
+    loaded++;
+    if(loading && loaded - mark < STARVED) {
+      /* Two events for every one handled keep the queue full */
+      process_post(PROCESS_CURRENT(), PROCESS_EVENT_CONTINUE, NULL);
+      process_post(PROCESS_CURRENT(), PROCESS_EVENT_CONTINUE, NULL);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_PROFILE
+PROCESS_THREAD(slow_process, ev, data)
+{
+  clock_time_t start;
+
+  PROCESS_BEGIN();
+
+  PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_CONTINUE);
+  /* Block the scheduler for about 50 ms */
+  start = clock_time();
+  while(clock_time() - start < CLOCK_SECOND / 20);
+
+  PROCESS_END();
+}
+#endif /* PROCESS_CONF_PROFILE */
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(process_bench_process, ev, data)
+{
+  static struct etimer et;
+  static clock_time_t start;
+  static unsigned long i, latency, max, starved, lost;
+  static unsigned b;
+  static sigset_t mask;
+  static void (*handler)(int);
+  struct itimerval it;
+  int j;
+
+  PROCESS_BEGIN();
+
+#if IDLE > 0
+  for(i = 0; i < IDLE; i++) {
+#if !PROCESS_CONF_NO_PROCESS_NAMES
+    idle[i].name = "Idle";
+#endif
+    idle[i].thread = idle_thread;
+    process_start(&idle[i], NULL);
+  }
+#endif
+  process_start(&pollee_process, NULL);
+  process_start(&load_process, NULL);
+
+  /* Poll requests served while other processes are running */
+  start = clock_time();
+  for(i = 0; i < POLLS; i++) {
+    process_poll(&pollee_process);
+    PROCESS_PAUSE();
+  }
+  printf("process-bench: %d idle: poll %lu ns/op (%lu polled)\n",
+         IDLE, ns_per_op(clock_time() - start, POLLS), polled);
+
+  /* Poll requests made while the poll queue fills up, interrupted by
+     poll requests from a signal handler. After each round the queued
+     requests are served with the signal blocked: any process that
+     is still waiting then has lost its request. */
+  for(j = 0; j < 2 * PROCESS_CONF_NUMPOLLS; j++) {
+#if !PROCESS_CONF_NO_PROCESS_NAMES
+    targets[j].name = "Target";
+#endif
+    targets[j].thread = target_thread;
+    process_start(&targets[j], NULL);
+  }
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGALRM);
+  handler = signal(SIGALRM, interrupt);
+  it.it_interval.tv_sec = it.it_value.tv_sec = 0;
+  it.it_interval.tv_usec = it.it_value.tv_usec = 20;
+  setitimer(ITIMER_REAL, &it, NULL);
+  lost = 0;
+  for(i = 0; i < ROUNDS; i++) {
+    for(j = 0; j < PROCESS_CONF_NUMPOLLS; j++) {
+      process_poll(&targets[j]);
+    }
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    /* Only the targets have anything to do: serve them right here */
+    PROCESS_CONTEXT_BEGIN(PROCESS_CURRENT());
+    process_run();
+    PROCESS_CONTEXT_END(PROCESS_CURRENT());
+    for(j = 0; j < 2 * PROCESS_CONF_NUMPOLLS; j++) {
+      if(targets[j].needspoll) {
+        lost++;
+        targets[j].needspoll = 0;
+      }
+    }
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
+  }
+  it.it_interval.tv_usec = it.it_value.tv_usec = 0;
+  setitimer(ITIMER_REAL, &it, NULL);
+  signal(SIGALRM, handler);
+  printf("process-bench: nested polls: %lu interrupts, %lu lost\n",
+         interrupts, lost);
+
+  /* Timer event latency while the event queue is kept full */
+  loading = 1;
+  max = starved = 0;
+  for(i = 0; i < SAMPLES; i++) {
+    while(process_post(&load_process, PROCESS_EVENT_CONTINUE, NULL) ==
+          PROCESS_ERR_OK);
+    mark = loaded;
+    etimer_set(&et, 0);
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+    latency = loaded - mark;
+    for(b = 0; b < BUCKETS - 1 && latency > limits[b]; b++);
+    histogram[b]++;
+    if(latency > max) {
+      max = latency;
+    }
+    if(latency >= STARVED) {
+      starved++;
+    }
+  }
+  loading = 0;
+
+  printf("process-bench: timer latency in events, max %lu, starved %lu\n",
+         max, starved);
+  for(b = 0; b < BUCKETS; b++) {
+    if(b < BUCKETS - 1) {
+      printf("process-bench:   <= %3u: %lu\n", limits[b], histogram[b]);
+    } else {
+      printf("process-bench:   >  %3u: %lu\n", limits[b - 1], histogram[b]);
+    }
+  }
+#if PROCESS_CONF_STATS
+  printf("process-bench: max queued %u, dropped %lu, spilled %lu, poll scans %lu\n",
+         process_maxevents, process_droppedevents, process_spilledevents,
+         process_pollscans);
+#endif /* PROCESS_CONF_STATS */
+#if PROCESS_CONF_PROFILE
+  process_start(&slow_process, NULL);
+  process_post_synch(&slow_process, PROCESS_EVENT_CONTINUE, NULL);
+  printf("process-bench: '%s' %lu dispatches, %lu over, max %lu ticks\n",
+         PROCESS_NAME_STRING(&slow_process), slow_process.profile.count,
+         slow_process.profile.overruns, slow_process.profile.max);
+  printf("process-bench: '%s' %lu dispatches, %lu over, max %lu ticks\n",
+         PROCESS_NAME_STRING(&process_bench_process),
+         process_bench_process.profile.count,
+         process_bench_process.profile.overruns,
+         process_bench_process.profile.max);
+  printf("process-bench: '%s' %lu dispatches, %lu over, max %lu ticks\n",
+         PROCESS_NAME_STRING(&pollee_process), pollee_process.profile.count,
+         pollee_process.profile.overruns, pollee_process.profile.max);
+#endif /* PROCESS_CONF_PROFILE */
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
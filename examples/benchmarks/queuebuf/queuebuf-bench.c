@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of queued packet transmission.
+ *
+ *         Queues a packet and prepares it for transmission a number
+ *         of times the way nullrdc does: the packet is brought back
+ *         into the packetbuf, a link-layer header is prepended and
+ *         the frame is read out as a radio driver would. With
+ *         QUEUEBUF_CONF_ZERO_COPY the header is only created on the
+ *         first attempt and the packet is never copied back. Build
+ *         with e.g. "make TARGET=native ZERO_COPY=1" (run "make
+ *         clean" in between).
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include <stdio.h>
+#include <string.h>
+
+#define PACKETS     2000000UL
+#define ATTEMPTS    4
+#define PAYLOAD_LEN 100
+#define HDR_LEN     21
+
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns_per_op(clock_time_t elapsed, unsigned long ops)
+{
+  return (unsigned long)(((unsigned long long)elapsed * 1000000000ULL)
+                         / CLOCK_SECOND / ops);
+}
+/*---------------------------------------------------------------------------*/
+static void
+create_frame(struct queuebuf *q)
+{
+#if QUEUEBUF_ZERO_COPY
+  if(packetbuf_attr(PACKETBUF_ATTR_IS_CREATED_AND_SECURED)) {
+    return;
+  }
+#endif /* QUEUEBUF_ZERO_COPY */
+  packetbuf_hdralloc(HDR_LEN);
+  memset(packetbuf_hdrptr(), 0x41, HDR_LEN);
+#if QUEUEBUF_ZERO_COPY
+  packetbuf_set_attr(PACKETBUF_ATTR_IS_CREATED_AND_SECURED, 1);
+  queuebuf_update_from_packetbuf(q);
+#endif /* QUEUEBUF_ZERO_COPY */
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+transmit(void)
+{
+  static uint8_t fifo[PACKETBUF_SIZE + PACKETBUF_HDR_SIZE];
+  uint16_t len;
+
+  /* Load the frame into the radio the way a driver's prepare() does */
+  len = packetbuf_totlen();
+  memcpy(fifo, packetbuf_hdrptr(), len);
+  return fifo[0] + fifo[HDR_LEN] + fifo[len - 1] + len;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(queuebuf_bench_process, "Queuebuf benchmark");
+AUTOSTART_PROCESSES(&queuebuf_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(queuebuf_bench_process, ev, data)
+{
+  static clock_time_t start;
+  static uint8_t payload[PAYLOAD_LEN];
+  static unsigned long sum;
+  struct queuebuf *q;
+  unsigned long i;
+  int attempt;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < PAYLOAD_LEN; i++) {
+    payload[i] = i;
+  }
+
+  sum = 0;
+  start = clock_time();
+  for(i = 0; i < PACKETS; i++) {
+    packetbuf_copyfrom(payload, PAYLOAD_LEN);
+    q = queuebuf_new_from_packetbuf();
+    if(q == NULL) {
+      printf("queuebuf-bench: out of queuebufs\n");
+      break;
+    }
+    for(attempt = 0; attempt < ATTEMPTS; attempt++) {
+      queuebuf_attach_to_packetbuf(q);
+      create_frame(q);
+      sum += transmit();
+    }
+    queuebuf_free(q);
+  }
+  printf("queuebuf-bench: %d attempts: %lu ns/packet (checksum %lu, %d free)\n",
+         ATTEMPTS, ns_per_op(clock_time() - start, PACKETS), sum,
+         queuebuf_numfree());
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Test of the queue of pending real-time tasks.
+ *
+ *         Sets tasks out of order, moves one and cancels one, and
+ *         checks that the rest run in deadline order. Then keeps a
+ *         task re-arming itself from the rtimer interrupt every tick
+ *         while the main loop sets and cancels another task as fast
+ *         as it can, and checks that the periodic task neither stops
+ *         nor runs before its deadline.
+ */
+
+#include "contiki.h"
+#include <stdio.h>
+
+#define TASKS    4
+#define PERIODIC 2000UL
+
+static struct rtimer tasks[TASKS];
+static char order[TASKS + 1];
+static volatile unsigned ran;
+
+static struct rtimer periodic_task, other_task;
+static volatile unsigned long periodic;
+
+PROCESS(rtimer_bench_process, "Rtimer test");
+AUTOSTART_PROCESSES(&rtimer_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+task_callback(struct rtimer *t, void *ptr)
+{
+  order[ran++] = 'A' + (t - tasks);
+}
+/*---------------------------------------------------------------------------*/
+static void
+periodic_callback(struct rtimer *t, void *ptr)
+{
+  if(++periodic < PERIODIC) {
+    rtimer_set(t, RTIMER_TIME(t) + 1, 1, periodic_callback, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+other_callback(struct rtimer *t, void *ptr)
+{
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(rtimer_bench_process, ev, data)
+{
+  static struct etimer et;
+  static unsigned long ops;
+  rtimer_clock_t now;
+  clock_time_t start;
+
+  PROCESS_BEGIN();
+
+  /* A at +30, B at +10, C at +20 moved to +5, D at +40 cancelled */
+  now = RTIMER_NOW();
+  rtimer_set(&tasks[0], now + RTIMER_SECOND * 30 / 1000, 1, task_callback, NULL);
+  rtimer_set(&tasks[1], now + RTIMER_SECOND * 10 / 1000, 1, task_callback, NULL);
+  rtimer_set(&tasks[2], now + RTIMER_SECOND * 20 / 1000, 1, task_callback, NULL);
+  rtimer_set(&tasks[3], now + RTIMER_SECOND * 40 / 1000, 1, task_callback, NULL);
+  rtimer_set(&tasks[2], now + RTIMER_SECOND * 5 / 1000, 1, task_callback, NULL);
+  rtimer_cancel(&tasks[3]);
+  etimer_set(&et, CLOCK_SECOND / 10);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  printf("rtimer-bench: order %s, expected CBA\n", order);
+
+  /* Set and cancel a task while the periodic task re-arms itself */
+  ops = 0;
+  start = clock_time();
+  rtimer_set(&periodic_task, RTIMER_NOW() + 1, 1, periodic_callback, NULL);
+  while(periodic < PERIODIC &&
+        clock_time() - start < CLOCK_SECOND * 2 * PERIODIC / RTIMER_SECOND) {
+    rtimer_set(&other_task, RTIMER_NOW() + RTIMER_SECOND, 1,
+               other_callback, NULL);
+    rtimer_cancel(&other_task);
+    ops++;
+  }
+  printf("rtimer-bench: periodic task ran %lu of %lu times in %lu ms (expected %lu) during %lu set/cancel\n",
+         periodic, PERIODIC,
+         (unsigned long)(clock_time() - start) * 1000 / CLOCK_SECOND,
+         PERIODIC * 1000 / RTIMER_SECOND, ops);
+#if RTIMER_STATS
+  printf("rtimer-bench: %lu fired, %lu late, max lateness %u\n",
+         rtimer_stats.fired, rtimer_stats.late,
+         (unsigned)rtimer_stats.max_lateness);
+#endif /* RTIMER_STATS */
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of 6LoWPAN IPHC header compression on output.
+ *
+ *         Build with "make TARGET=native IPHC_CACHE=4" to enable the
+ *         IPHC flow cache, and without IPHC_CACHE to compare (run
+ *         "make clean" in between).
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "net/packetbuf.h"
+#include <stdio.h>
+#include <string.h>
+
+#define PACKETS      1000000UL
+#define PAYLOAD_LEN  32
+#define FLOWS        8
+
+#define UIP_IP_BUF   ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF  ((struct uip_udp_hdr *)&uip_buf[UIP_LLIPH_LEN])
+
+static uip_lladdr_t dest_lladdr;
+static uint8_t reference[PACKETBUF_SIZE];
+static int reference_len;
+
+/*---------------------------------------------------------------------------*/
+/* Build a CoAP-like UDP packet for the given flow in uip_buf */
+static void
+make_packet(uint8_t flow, uint8_t seq)
+{
+  uint8_t *payload;
+  int i;
+
+  memset(uip_buf, 0, UIP_LLH_LEN + UIP_IPUDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xaaaa, 0, 0, 0, 0x0212, 0x7401, 1, 0x0101);
+  uip_ip6addr(&UIP_IP_BUF->destipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 1 + flow);
+  UIP_UDP_BUF->srcport = UIP_HTONS(5683);
+  UIP_UDP_BUF->destport = UIP_HTONS(5683 + flow);
+  UIP_UDP_BUF->udplen = UIP_HTONS(UIP_UDPH_LEN + PAYLOAD_LEN);
+  payload = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
+  for(i = 0; i < PAYLOAD_LEN; i++) {
+    payload[i] = seq + i;
+  }
+  uip_len = UIP_IPUDPH_LEN + PAYLOAD_LEN;
+  UIP_IP_BUF->len[0] = 0;
+  UIP_IP_BUF->len[1] = uip_len - UIP_IPH_LEN;
+  UIP_UDP_BUF->udpchksum = ~(uip_udpchksum());
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns_per_packet(clock_time_t elapsed, unsigned long packets)
+{
+  return (unsigned long)(((unsigned long long)elapsed * 1000000000ULL)
+                         / CLOCK_SECOND / packets);
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_benchmark(void)
+{
+  clock_time_t start;
+  unsigned long i;
+
+  memset(&dest_lladdr, 0, sizeof(dest_lladdr));
+  dest_lladdr.addr[7] = 1;
+
+  /* Check that a repeated flow compresses to the same bytes */
+  make_packet(0, 0);
+  tcpip_output(&dest_lladdr);
+  reference_len = packetbuf_datalen();
+  memcpy(reference, packetbuf_dataptr(), reference_len);
+  make_packet(1, 0);
+  tcpip_output(&dest_lladdr);
+  make_packet(0, 0);
+  tcpip_output(&dest_lladdr);
+  printf("iphc-bench: repeated flow check %s (%d bytes)\n",
+         reference_len == packetbuf_datalen() &&
+         memcmp(reference, packetbuf_dataptr(), reference_len) == 0 ?
+         "ok" : "FAILED", reference_len);
+
+  start = clock_time();
+  for(i = 0; i < PACKETS; i++) {
+    make_packet(0, i);
+    tcpip_output(&dest_lladdr);
+  }
+  printf("iphc-bench: cache %d, 1 flow: %lu ns/packet\n",
+         SICSLOWPAN_CONF_IPHC_CACHE_SIZE, ns_per_packet(clock_time() - start, PACKETS));
+
+  start = clock_time();
+  for(i = 0; i < PACKETS; i++) {
+    make_packet(i % FLOWS, i);
+    tcpip_output(&dest_lladdr);
+  }
+  printf("iphc-bench: cache %d, %d flows: %lu ns/packet\n",
+         SICSLOWPAN_CONF_IPHC_CACHE_SIZE, FLOWS,
+         ns_per_packet(clock_time() - start, PACKETS));
+
+  start = clock_time();
+  for(i = 0; i < PACKETS; i++) {
+    make_packet(0, i);
+  }
+  printf("iphc-bench: packet construction only: %lu ns/packet\n",
+         ns_per_packet(clock_time() - start, PACKETS));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(iphc_bench_process, "IPHC benchmark");
+AUTOSTART_PROCESSES(&iphc_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(iphc_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  run_benchmark();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Loopback test of the CoAP DTLS layer between two native
+ *         processes, which exchange datagrams over host UDP sockets:
+ *
+ *         ./dtls-loopback.native server
+ *         ./dtls-loopback.native client [loss percentage]
+ *
+ *         The client opens several sessions in a row and sends a few
+ *         messages over each, which the server echoes. The first session
+ *         needs a full handshake, the others are resumed. For each
+ *         session, the client reports how many datagrams it sent and
+ *         received until the first echo arrived. The client exits with
+ *         status 0 if all echoes came back.
+ *
+ *         With a loss percentage, the client drops that share of the
+ *         datagrams it sends and receives, and repeats unanswered
+ *         messages like CoAP would repeat a confirmable message.
+ *
+ *         Randoms come from /dev/urandom through COAP_CONF_DTLS_RANDOM.
+ */
+
+#include "contiki.h"
+#include "er-coap-dtls.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define SERVER_PORT    20220
+#define CLIENT_PORT    20221
+#define SESSIONS       4
+#define MESSAGES       3
+#define RESEND_INTERVAL CLOCK_SECOND
+#define TIMEOUT        (20 * CLOCK_SECOND)
+
+static const uint8_t identity[] = "Client_identity";
+static const uint8_t key[] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+
+extern int contiki_argc;
+extern char **contiki_argv;
+
+static int fd = -1;
+static int is_server;
+static int loss;
+static uip_ipaddr_t peer_addr;
+static uint16_t peer_port;
+static uint8_t buf[1280];
+static int buf_len;
+static unsigned datagrams_sent;
+static unsigned datagrams_received;
+
+PROCESS(dtls_loopback_process, "DTLS loopback");
+AUTOSTART_PROCESSES(&dtls_loopback_process);
+
+/*---------------------------------------------------------------------------*/
+void
+dtls_loopback_random(uint8_t *p, uint8_t len)
+{
+  int urandom;
+
+  urandom = open("/dev/urandom", O_RDONLY);
+  if(urandom < 0 || read(urandom, p, len) != len) {
+    perror("/dev/urandom");
+    exit(1);
+  }
+  close(urandom);
+}
+/*---------------------------------------------------------------------------*/
+static void
+output(const uip_ipaddr_t *addr, uint16_t port, const uint8_t *data,
+       uint16_t len)
+{
+  struct sockaddr_in sin;
+
+  datagrams_sent++;
+  if(loss && rand() % 100 < loss) {
+    return;
+  }
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  /* the port is in network byte order already */
+  sin.sin_port = port;
+  sendto(fd, data, len, 0, (struct sockaddr *)&sin, sizeof(sin));
+}
+/*---------------------------------------------------------------------------*/
+static int
+set_fd(fd_set *rset, fd_set *wset)
+{
+  FD_SET(fd, rset);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_fd(fd_set *rset, fd_set *wset)
+{
+  if(FD_ISSET(fd, rset) && buf_len == 0) {
+    buf_len = recv(fd, buf, sizeof(buf), 0);
+    if(buf_len > 0 && loss && rand() % 100 < loss) {
+      buf_len = 0;
+    } else if(buf_len > 0) {
+      datagrams_received++;
+      process_poll(&dtls_loopback_process);
+    } else {
+      buf_len = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const struct select_callback socket_callback = { set_fd, handle_fd };
+/*---------------------------------------------------------------------------*/
+static void
+open_socket(uint16_t port)
+{
+  struct sockaddr_in sin;
+
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sin.sin_port = htons(port);
+  if(fd < 0 || bind(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+    perror("dtls-loopback");
+    exit(1);
+  }
+  select_set_callback(fd, &socket_callback);
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the length of the received application data */
+static uint16_t
+receive(void)
+{
+  uint16_t len;
+
+  len = coap_dtls_input(&peer_addr, peer_port, buf, buf_len);
+  if(len) {
+    buf[len] = '\0';
+  }
+  buf_len = 0;
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_stats(void)
+{
+  printf("handshakes: %u full, %u abbreviated, %u failed; "
+         "%u flights, %u retransmissions, %u hello verify requests, "
+         "%u records dropped\n",
+         coap_dtls_stats.full_handshakes,
+         coap_dtls_stats.abbreviated_handshakes,
+         coap_dtls_stats.failed_handshakes,
+         coap_dtls_stats.flights_sent,
+         coap_dtls_stats.retransmissions,
+         coap_dtls_stats.hello_verify_requests,
+         coap_dtls_stats.records_dropped);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(dtls_loopback_process, ev, data)
+{
+  static struct etimer et;
+  static struct etimer resend_timer;
+  static int session;
+  static int message;
+  static int failures;
+  static clock_time_t start;
+  static char text[32];
+  uint16_t len;
+
+  PROCESS_BEGIN();
+
+  is_server = contiki_argc > 1 && !strcmp(contiki_argv[1], "server");
+  if(!is_server && contiki_argc > 2) {
+    loss = atoi(contiki_argv[2]);
+  }
+  srand(getpid());
+
+  /* both processes are "::1", they are told apart by their port */
+  uip_ip6addr(&peer_addr, 0, 0, 0, 0, 0, 0, 0, 1);
+  peer_port = UIP_HTONS(is_server ? CLIENT_PORT : SERVER_PORT);
+  open_socket(is_server ? SERVER_PORT : CLIENT_PORT);
+
+  coap_dtls_init(output);
+  coap_dtls_set_psk(identity, sizeof(identity) - 1, key, sizeof(key));
+
+  if(is_server) {
+    printf("Server listening on port %u\n", SERVER_PORT);
+    while(1) {
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+      len = receive();
+      if(len) {
+        printf("Echoing '%s'\n", (char *)buf);
+        coap_dtls_send(&peer_addr, peer_port, buf, len);
+      }
+      if(!coap_dtls_is_connected(&peer_addr, peer_port)) {
+        print_stats();
+      }
+    }
+  }
+
+  failures = 0;
+  for(session = 0; session < SESSIONS; session++) {
+    datagrams_sent = 0;
+    datagrams_received = 0;
+    start = clock_time();
+    for(message = 0; message < MESSAGES; message++) {
+      snprintf(text, sizeof(text), "session %d message %d", session, message);
+      coap_dtls_send(&peer_addr, peer_port, (uint8_t *)text, strlen(text));
+
+      etimer_set(&et, TIMEOUT);
+      etimer_set(&resend_timer, RESEND_INTERVAL);
+      while(1) {
+        PROCESS_WAIT_EVENT();
+        if(etimer_expired(&et)) {
+          printf("FAIL: no echo for '%s'\n", text);
+          failures++;
+          break;
+        }
+        if(ev == PROCESS_EVENT_TIMER && data == &resend_timer) {
+          coap_dtls_send(&peer_addr, peer_port, (uint8_t *)text, strlen(text));
+          etimer_reset(&resend_timer);
+        } else if(ev == PROCESS_EVENT_POLL
+                  && receive() && !strcmp((char *)buf, text)) {
+          break;
+        }
+      }
+      etimer_stop(&resend_timer);
+
+      if(message == 0) {
+        printf("Session %d: first echo after %u ms, "
+               "%u datagrams sent, %u received\n",
+               session, (unsigned)(clock_time() - start),
+               datagrams_sent, datagrams_received);
+      }
+    }
+    coap_dtls_close(&peer_addr, peer_port);
+  }
+
+  print_stats();
+  if(failures) {
+    printf("FAIL\n");
+    exit(1);
+  }
+  printf("PASS\n");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
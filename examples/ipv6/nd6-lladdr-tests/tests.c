@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Testing link-layer address changes learnt by neighbor discovery
+ *
+ *         A neighbor announces a new link-layer address in an NS, and an
+ *         incomplete neighbor is resolved by an NA. Afterwards, the
+ *         neighbor must be found by its new address only, and adding the
+ *         new address to another table must not create a second entry.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/tcpip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-icmp6.h"
+#include "net/ipv6/uip-nd6.h"
+#include "net/nbr-table.h"
+#include "net/packetbuf.h"
+#include <stdio.h>
+#include <string.h>
+
+#define UIP_IP_BUF       ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_ICMP_BUF     ((struct uip_icmp_hdr *)&uip_buf[uip_l2_l3_hdr_len])
+#define UIP_ICMP_PAYLOAD ((unsigned char *)&uip_buf[uip_l2_l3_icmp_hdr_len])
+
+static const uip_lladdr_t old_lladdr = {{ 0x00 , 0x12 , 0x74 , 0x01 ,
+                                          0x00 , 0x01 , 0x01 , 0x01 }};
+static const uip_lladdr_t new_lladdr = {{ 0x00 , 0x12 , 0x74 , 0x02 ,
+                                          0x00 , 0x02 , 0x02 , 0x02 }};
+static const uip_lladdr_t resolved_lladdr = {{ 0x00 , 0x12 , 0x74 , 0x03 ,
+                                               0x00 , 0x03 , 0x03 , 0x03 }};
+
+struct test_entry {
+  uint8_t value;
+};
+NBR_TABLE(struct test_entry, test_table);
+
+/*---------------------------------------------------------------------------*/
+static void
+result(int success)
+{
+  printf(success ? "Success\n" : "Failure\n");
+}
+/*---------------------------------------------------------------------------*/
+/* Drops the NAs and NSs sent in reply */
+static uint8_t
+output(const uip_lladdr_t *lladdr)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Passes an ND message, with the target address and an LLAO of the given
+   type, from src to this node */
+static void
+input(const uip_ipaddr_t *src, uint8_t type, uint8_t flags,
+      uint8_t llao_type, const uip_lladdr_t *lladdr)
+{
+  unsigned char *buffer;
+  int len;
+
+  packetbuf_clear();
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, (const linkaddr_t *)lladdr);
+
+  len = 4 + sizeof(uip_ipaddr_t) + UIP_ND6_OPT_LLAO_LEN;
+  uip_ext_len = 0;
+  memset(UIP_IP_BUF, 0, UIP_IPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->proto = UIP_PROTO_ICMP6;
+  UIP_IP_BUF->ttl = UIP_ND6_HOP_LIMIT;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, src);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &uip_ds6_get_link_local(-1)->ipaddr);
+  UIP_IP_BUF->len[0] = (UIP_ICMPH_LEN + len) >> 8;
+  UIP_IP_BUF->len[1] = (UIP_ICMPH_LEN + len) & 0xff;
+  UIP_ICMP_BUF->type = type;
+  UIP_ICMP_BUF->icode = 0;
+  UIP_ICMP_BUF->icmpchksum = 0;
+
+  buffer = UIP_ICMP_PAYLOAD;
+  memset(buffer, 0, len);
+  buffer[0] = flags;
+  /* The target is this node for an NS, the sender for an NA */
+  memcpy(buffer + 4, type == ICMP6_NS ?
+         &uip_ds6_get_link_local(-1)->ipaddr : src, sizeof(uip_ipaddr_t));
+  buffer += 4 + sizeof(uip_ipaddr_t);
+  buffer[UIP_ND6_OPT_TYPE_OFFSET] = llao_type;
+  buffer[UIP_ND6_OPT_LEN_OFFSET] = UIP_ND6_OPT_LLAO_LEN >> 3;
+  memcpy(buffer + UIP_ND6_OPT_DATA_OFFSET, lladdr, UIP_LLADDR_LEN);
+
+  uip_len = UIP_IPH_LEN + UIP_ICMPH_LEN + len;
+  UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
+
+  uip_input();
+  uip_clear_buf();
+}
+/*---------------------------------------------------------------------------*/
+/* Checks that a neighbor is only found by its new link-layer address */
+static int
+moved(uip_ds6_nbr_t *nbr, const uip_lladdr_t *from, const uip_lladdr_t *to)
+{
+  int neighbors;
+
+  if(uip_ds6_nbr_ll_lookup(to) != nbr ||
+     (from != NULL && uip_ds6_nbr_ll_lookup(from) != NULL)) {
+    return 0;
+  }
+  /* The new address must map to the entry of the neighbor */
+  neighbors = nbr_table_num_neighbors();
+  if(nbr_table_add_lladdr(test_table, (const linkaddr_t *)to) == NULL) {
+    return 0;
+  }
+  return nbr_table_num_neighbors() == neighbors;
+}
+/*---------------------------------------------------------------------------*/
+static void
+test_ns_lladdr_change(void)
+{
+  uip_ipaddr_t ipaddr;
+  uip_ds6_nbr_t *nbr;
+
+  printf("Testing link-layer address change in an NS ... ");
+
+  uip_ip6addr(&ipaddr, 0xfe80, 0, 0, 0, 0x0212, 0x7401, 0x0001, 0x0101);
+  nbr = uip_ds6_nbr_add(&ipaddr, &old_lladdr, 0, NBR_REACHABLE);
+  input(&ipaddr, ICMP6_NS, 0, UIP_ND6_OPT_SLLAO, &new_lladdr);
+
+  result(nbr != NULL && uip_ds6_nbr_lookup(&ipaddr) == nbr &&
+         moved(nbr, &old_lladdr, &new_lladdr));
+}
+/*---------------------------------------------------------------------------*/
+static void
+test_na_resolution(void)
+{
+  uip_ipaddr_t ipaddr;
+  uip_ds6_nbr_t *nbr;
+
+  printf("Testing resolution of an incomplete neighbor by an NA ... ");
+
+  uip_ip6addr(&ipaddr, 0xfe80, 0, 0, 0, 0x0212, 0x7403, 0x0003, 0x0303);
+  nbr = uip_ds6_nbr_add(&ipaddr, NULL, 0, NBR_INCOMPLETE);
+  input(&ipaddr, ICMP6_NA, UIP_ND6_NA_FLAG_SOLICITED, UIP_ND6_OPT_TLLAO,
+        &resolved_lladdr);
+
+  result(nbr != NULL && nbr->state == NBR_REACHABLE &&
+         moved(nbr, NULL, &resolved_lladdr));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(nd6_lladdr_tests_process, "ND link-layer address tests process");
+AUTOSTART_PROCESSES(&nd6_lladdr_tests_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(nd6_lladdr_tests_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  nbr_table_register(test_table, NULL);
+  tcpip_set_outputfunc(output);
+
+  test_ns_lladdr_change();
+  test_na_resolution();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
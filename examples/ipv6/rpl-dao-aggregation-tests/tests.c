@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Testing DAO aggregation in storing mode
+ *
+ *         The node joins a DAG from a DIO of its parent and then
+ *         receives DAOs from a child while the aggregation queue is
+ *         partly full. Every target must be sent to the parent exactly
+ *         once, either in the relayed DAO or in the aggregate.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/tcpip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-icmp6.h"
+#include "net/rpl/rpl-private.h"
+#include "net/packetbuf.h"
+#include <stdio.h>
+#include <string.h>
+
+#define UIP_IP_BUF       ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_ICMP_BUF     ((struct uip_icmp_hdr *)&uip_buf[uip_l2_l3_hdr_len])
+#define UIP_ICMP_PAYLOAD ((unsigned char *)&uip_buf[uip_l2_l3_icmp_hdr_len])
+
+/* Target n is fd00::<n + 1>/128 */
+#define TARGETS (RPL_DAO_AGGREGATION_MAX_TARGETS + 2)
+#define QUEUED  (RPL_DAO_AGGREGATION_MAX_TARGETS - 2)
+
+static const uip_lladdr_t parent_lladdr = {{ 0x00 , 0x12 , 0x74 , 0x01 ,
+                                             0x00 , 0x01 , 0x01 , 0x01 }};
+static const uip_lladdr_t child_lladdr = {{ 0x00 , 0x12 , 0x74 , 0x03 ,
+                                            0x00 , 0x03 , 0x03 , 0x03 }};
+static uip_ipaddr_t parent_ipaddr;
+static uip_ipaddr_t child_ipaddr;
+static uip_ipaddr_t dag_id;
+
+/* How often each target was sent to the parent */
+static int sent[TARGETS];
+static int daos;
+
+/*---------------------------------------------------------------------------*/
+static void
+result(int success)
+{
+  printf(success ? "Success\n" : "Failure\n");
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_target(uip_ipaddr_t *target, int n)
+{
+  uip_ip6addr(target, 0xfd00, 0, 0, 0, 0, 0, 0, n + 1);
+}
+/*---------------------------------------------------------------------------*/
+/* Counts the targets of the DAOs this node sends */
+static uint8_t
+output(const uip_lladdr_t *lladdr)
+{
+  unsigned char *buffer;
+  uip_ipaddr_t target;
+  uip_ipaddr_t expected;
+  int len;
+  int i;
+  int n;
+
+  if(UIP_IP_BUF->proto != UIP_PROTO_ICMP6 ||
+     UIP_ICMP_BUF->type != ICMP6_RPL || UIP_ICMP_BUF->icode != RPL_CODE_DAO) {
+    return 0;
+  }
+  daos++;
+
+  buffer = UIP_ICMP_PAYLOAD;
+  /* Instance, flags, reserved, sequence, DODAGID if the D flag is set */
+  i = (buffer[1] & 0x40) ? 4 + 16 : 4;
+  for(; i < uip_len - uip_l3_icmp_hdr_len; i += len) {
+    len = buffer[i] == RPL_OPTION_PAD1 ? 1 : 2 + buffer[i + 1];
+    if(buffer[i] != RPL_OPTION_TARGET || buffer[i + 3] != 128) {
+      continue;
+    }
+    memcpy(&target, buffer + i + 4, sizeof(target));
+    for(n = 0; n < TARGETS; n++) {
+      set_target(&expected, n);
+      if(uip_ipaddr_cmp(&expected, &target)) {
+        sent[n]++;
+      }
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Passes the RPL message in buffer[0..len) from src to this node */
+static void
+input(const uip_ipaddr_t *src, const uip_lladdr_t *lladdr,
+      uint8_t code, const unsigned char *buffer, int len)
+{
+  packetbuf_clear();
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, (const linkaddr_t *)lladdr);
+
+  uip_ext_len = 0;
+  memset(UIP_IP_BUF, 0, UIP_IPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->proto = UIP_PROTO_ICMP6;
+  UIP_IP_BUF->ttl = 64;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, src);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &uip_ds6_get_link_local(-1)->ipaddr);
+  UIP_IP_BUF->len[0] = (UIP_ICMPH_LEN + len) >> 8;
+  UIP_IP_BUF->len[1] = (UIP_ICMPH_LEN + len) & 0xff;
+  UIP_ICMP_BUF->type = ICMP6_RPL;
+  UIP_ICMP_BUF->icode = code;
+  UIP_ICMP_BUF->icmpchksum = 0;
+  memcpy(UIP_ICMP_PAYLOAD, buffer, len);
+  uip_len = UIP_IPH_LEN + UIP_ICMPH_LEN + len;
+  UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
+
+  uip_input();
+  uip_clear_buf();
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_dio(void)
+{
+  unsigned char buffer[24];
+
+  memset(buffer, 0, sizeof(buffer));
+  buffer[0] = RPL_DEFAULT_INSTANCE;
+  buffer[1] = 1; /* version */
+  buffer[2] = RPL_MIN_HOPRANKINC >> 8;
+  buffer[3] = RPL_MIN_HOPRANKINC & 0xff;
+  /* Grounded, mode of operation */
+  buffer[4] = 0x80 | (RPL_MOP_STORING_NO_MULTICAST << 3);
+  memcpy(buffer + 8, &dag_id, sizeof(dag_id));
+  input(&parent_ipaddr, &parent_lladdr, RPL_CODE_DIO, buffer, sizeof(buffer));
+}
+/*---------------------------------------------------------------------------*/
+/* Passes a DAO from the child with targets first..last */
+static void
+input_dao(int first, int last)
+{
+  unsigned char buffer[4 + TARGETS * 20 + 6];
+  uip_ipaddr_t target;
+  int pos;
+  int n;
+
+  pos = 0;
+  buffer[pos++] = RPL_DEFAULT_INSTANCE;
+  buffer[pos++] = 0; /* flags */
+  buffer[pos++] = 0; /* reserved */
+  buffer[pos++] = 1; /* sequence */
+  for(n = first; n <= last; n++) {
+    set_target(&target, n);
+    buffer[pos++] = RPL_OPTION_TARGET;
+    buffer[pos++] = 2 + sizeof(target);
+    buffer[pos++] = 0; /* reserved */
+    buffer[pos++] = 128;
+    memcpy(buffer + pos, &target, sizeof(target));
+    pos += sizeof(target);
+  }
+  buffer[pos++] = RPL_OPTION_TRANSIT;
+  buffer[pos++] = 4;
+  buffer[pos++] = 0; /* flags */
+  buffer[pos++] = 0; /* path control */
+  buffer[pos++] = 0; /* path sequence */
+  buffer[pos++] = RPL_DEFAULT_LIFETIME;
+  input(&child_ipaddr, &child_lladdr, RPL_CODE_DAO, buffer, pos);
+}
+/*---------------------------------------------------------------------------*/
+static void
+test_partly_full_queue(void)
+{
+  int success;
+  int n;
+
+  printf("Testing DAO to a partly full aggregation queue ... ");
+
+  /* Queued, not sent yet */
+  input_dao(0, QUEUED - 1);
+  success = daos == 0;
+
+  /*
+   * Target QUEUED - 1 is queued already, but the new targets do not
+   * fit next to the queued ones, so this DAO is relayed as is
+   */
+  input_dao(QUEUED - 1, TARGETS - 1);
+  success = success && daos == 1;
+
+  /* The aggregate must only hold the targets that were not relayed */
+  dao_output_flush();
+  success = success && daos == 2;
+  for(n = 0; n < TARGETS; n++) {
+    success = success && sent[n] == 1;
+  }
+  result(success);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(rpl_dao_aggregation_tests_process, "DAO aggregation tests process");
+AUTOSTART_PROCESSES(&rpl_dao_aggregation_tests_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(rpl_dao_aggregation_tests_process, ev, data)
+{
+  rpl_instance_t *instance;
+  uip_ipaddr_t addr;
+
+  PROCESS_BEGIN();
+
+  uip_ip6addr(&dag_id, 0xfd00, 0, 0, 0, 0x0212, 0x7401, 0x0001, 0x0101);
+  uip_ip6addr(&parent_ipaddr, 0xfe80, 0, 0, 0, 0x0212, 0x7401, 0x0001, 0x0101);
+  uip_ip6addr(&child_ipaddr, 0xfe80, 0, 0, 0, 0x0212, 0x7403, 0x0003, 0x0303);
+  uip_ip6addr(&addr, 0xfd00, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(&addr, &uip_lladdr);
+  uip_ds6_addr_add(&addr, 0, ADDR_AUTOCONF);
+  uip_ds6_nbr_add(&child_ipaddr, &child_lladdr, 0, NBR_REACHABLE);
+
+  input_dio();
+  instance = rpl_get_instance(RPL_DEFAULT_INSTANCE);
+  if(instance == NULL || instance->current_dag->preferred_parent == NULL) {
+    printf("Could not join the DAG\n");
+    PROCESS_EXIT();
+  }
+  tcpip_set_outputfunc(output);
+
+  test_partly_full_queue();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -73,6 +73,7 @@ test_sec_lvl_6()
   uint8_t oracle[LLSEC802154_MIC_LENGTH] = { 0x4F , 0xDE , 0x52 , 0x90 ,
                                              0x61 , 0xF9 , 0xC6 , 0xF1 };
   uint8_t nonce[13];
+  uint8_t mic[LLSEC802154_MIC_LENGTH];
   frame802154_frame_counter_t counter;
   
   printf("Testing verification ... ");
@@ -122,6 +123,116 @@ test_sec_lvl_6()
   } else {
     printf("Failure\n");
   }
+  
+  printf("Testing forged MIC ... ");
+  memcpy(mic, oracle, LLSEC802154_MIC_LENGTH);
+  mic[LLSEC802154_MIC_LENGTH - 1] ^= 0x01;
+  if(!ccm_star_mic_cmp(((uint8_t *) packetbuf_hdrptr()) + 30, oracle, LLSEC802154_MIC_LENGTH)
+      && ccm_star_mic_cmp(((uint8_t *) packetbuf_hdrptr()) + 30, mic, LLSEC802154_MIC_LENGTH)) {
+    printf("Success\n");
+  } else {
+    printf("Failure\n");
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Test vector C.2.2 from IEEE 802.15.4-2006 (data frame, ENC only) */
+static void
+test_sec_lvl_4()
+{
+  uint8_t key[16] = { 0xC0 , 0xC1 , 0xC2 , 0xC3 ,
+                      0xC4 , 0xC5 , 0xC6 , 0xC7 ,
+                      0xC8 , 0xC9 , 0xCA , 0xCB ,
+                      0xCC , 0xCD , 0xCE , 0xCF };
+  linkaddr_t source_address = {{ 0xAC , 0xDE , 0x48 , 0x00 ,
+                                 0x00 , 0x00 , 0x00 , 0x01 }};
+  uint8_t data[30] = { 0x69 , 0xDC , 0x84 , 0x21 , 0x43 ,
+                       /* Destination Address */
+                       0x02 , 0x00 , 0x00 , 0x00 , 0x00 , 0x48 , 0xDE , 0xAC ,
+                       /* Source Address */
+                       0x01 , 0x00 , 0x00 , 0x00 , 0x00 , 0x48 , 0xDE , 0xAC ,
+                       /* Security Level */
+                       0x04 ,
+                       /* Frame Counter */
+                       0x05 , 0x00 , 0x00 , 0x00 ,
+                       /* Payload */
+                       0x61 , 0x62 , 0x63 , 0x64 };
+  uint8_t oracle[4] = { 0xD4 , 0x3E , 0x02 , 0x2B };
+  uint8_t nonce[13];
+  frame802154_frame_counter_t counter;
+  
+  printf("Testing encryption without MIC ... ");
+  
+  linkaddr_copy(&linkaddr_node_addr, &source_address);
+  packetbuf_clear();
+  packetbuf_set_datalen(30);
+  memcpy(packetbuf_hdrptr(), data, 30);
+  counter.u32 = 5;
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_0_1, counter.u16[0]);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_2_3, counter.u16[1]);
+  packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, 4);
+  packetbuf_hdrreduce(26);
+  
+  CCM_STAR.set_key(key);
+  ccm_star_packetbuf_set_nonce(nonce, 1);
+  CCM_STAR.aead(nonce,
+      packetbuf_dataptr(), packetbuf_datalen(),
+      packetbuf_hdrptr(), packetbuf_hdrlen(),
+      NULL, 0,
+      1);
+  
+  if(memcmp(packetbuf_dataptr(), oracle, 4) == 0) {
+    printf("Success\n");
+  } else {
+    printf("Failure\n");
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Packet vector #1 from RFC 3610 (multi-block payload) */
+static void
+test_multi_block()
+{
+  uint8_t key[16] = { 0xC0 , 0xC1 , 0xC2 , 0xC3 ,
+                      0xC4 , 0xC5 , 0xC6 , 0xC7 ,
+                      0xC8 , 0xC9 , 0xCA , 0xCB ,
+                      0xCC , 0xCD , 0xCE , 0xCF };
+  uint8_t nonce[13] = { 0x00 , 0x00 , 0x00 , 0x03 , 0x02 , 0x01 , 0x00 ,
+                        0xA0 , 0xA1 , 0xA2 , 0xA3 , 0xA4 , 0xA5 };
+  uint8_t oracle[31] = { 0x58 , 0x8C , 0x97 , 0x9A , 0x61 , 0xC6 , 0x63 , 0xD2 ,
+                         0xF0 , 0x66 , 0xD0 , 0xC2 , 0xC0 , 0xF9 , 0x89 , 0x80 ,
+                         0x6D , 0x5F , 0x6B , 0x61 , 0xDA , 0xC3 , 0x84 ,
+                         /* MIC */
+                         0x17 , 0xE8 , 0xD1 , 0x2C , 0xFD , 0xF9 , 0x26 , 0xE0 };
+  uint8_t data[31];
+  uint8_t mic[8];
+  uint8_t i;
+  
+  printf("Testing multi-block encryption ... ");
+  
+  for(i = 0; i < 31; i++) {
+    data[i] = i;
+  }
+  CCM_STAR.set_key(key);
+  CCM_STAR.aead(nonce, data + 8, 23, data, 8, mic, 8, 1);
+  
+  if(memcmp(data + 8, oracle, 23) == 0 && memcmp(mic, oracle + 23, 8) == 0) {
+    printf("Success\n");
+  } else {
+    printf("Failure\n");
+  }
+  
+  printf("Testing multi-block decryption ... ");
+  
+  CCM_STAR.aead(nonce, data + 8, 23, data, 8, mic, 8, 0);
+  for(i = 0; i < 23; i++) {
+    if(data[8 + i] != 8 + i) {
+      break;
+    }
+  }
+  if(i == 23 && !ccm_star_mic_cmp(mic, oracle + 23, 8)) {
+    printf("Success\n");
+  } else {
+    printf("Failure\n");
+  }
 }
 /*---------------------------------------------------------------------------*/
 PROCESS(ccm_star_tests_process, "CCM* tests process");
@@ -132,6 +243,8 @@ PROCESS_THREAD(ccm_star_tests_process, ev, data)
   PROCESS_BEGIN();
   
   test_sec_lvl_6();
+  test_sec_lvl_4();
+  test_multi_block();
   
   PROCESS_END();
 }
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Testing anti-replay windows and pairwise keys
+ *
+ *         All nodes run in this one process: the tests switch
+ *         linkaddr_node_addr between securing and parsing a frame.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/linkaddr.h"
+#include "net/llsec/anti-replay.h"
+#include "net/llsec/llsec802154.h"
+#include "net/llsec/pairwisesec/pairwisesec.h"
+#include "net/mac/framer.h"
+#include <stdio.h>
+#include <string.h>
+
+#define FRAMES 4
+
+static const linkaddr_t node_a = {{ 0x00 , 0x12 , 0x74 , 0x01 ,
+                                    0x00 , 0x01 , 0x01 , 0x01 }};
+static const linkaddr_t node_b = {{ 0x00 , 0x12 , 0x74 , 0x02 ,
+                                    0x00 , 0x02 , 0x02 , 0x02 }};
+static const linkaddr_t node_c = {{ 0x00 , 0x12 , 0x74 , 0x03 ,
+                                    0x00 , 0x03 , 0x03 , 0x03 }};
+static const uint8_t key_ab[16] = { 0xA0 , 0xA1 , 0xA2 , 0xA3 ,
+                                    0xA4 , 0xA5 , 0xA6 , 0xA7 ,
+                                    0xA8 , 0xA9 , 0xAA , 0xAB ,
+                                    0xAC , 0xAD , 0xAE , 0xAF };
+static const uint8_t key_cb[16] = { 0xC0 , 0xC1 , 0xC2 , 0xC3 ,
+                                    0xC4 , 0xC5 , 0xC6 , 0xC7 ,
+                                    0xC8 , 0xC9 , 0xCA , 0xCB ,
+                                    0xCC , 0xCD , 0xCE , 0xCF };
+static const char payload[] = "pairwisesec";
+
+static uint8_t frames[FRAMES][PACKETBUF_SIZE];
+static int frame_lens[FRAMES];
+
+/*---------------------------------------------------------------------------*/
+static void
+result(int success)
+{
+  printf(success ? "Success\n" : "Failure\n");
+}
+/*---------------------------------------------------------------------------*/
+/* Checks a frame with the given counter against info */
+static int
+replayed(struct anti_replay_info *info, int broadcast, uint32_t counter)
+{
+  frame802154_frame_counter_t reordered_counter;
+
+  packetbuf_clear();
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER,
+      broadcast ? &linkaddr_null : &node_b);
+  reordered_counter.u32 = LLSEC802154_HTONL(counter);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_0_1, reordered_counter.u16[0]);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_2_3, reordered_counter.u16[1]);
+  return info == NULL ? 0 : anti_replay_was_replayed(info);
+}
+/*---------------------------------------------------------------------------*/
+static void
+test_window(void)
+{
+  struct anti_replay_info info;
+  int success;
+
+  printf("Testing anti-replay window ... ");
+
+  /* The first frame from the sender has counter 100 */
+  replayed(NULL, 0, 100);
+  anti_replay_init_info(&info);
+
+  success = !replayed(&info, 0, 103)
+      /* Reordered frames inside the window are accepted once */
+      && !replayed(&info, 0, 101)
+      && !replayed(&info, 0, 102)
+      && replayed(&info, 0, 101)
+      && replayed(&info, 0, 103)
+      /* Frames sent before the first one received are rejected */
+      && replayed(&info, 0, 100)
+      && replayed(&info, 0, 99)
+      /* Sliding the window forgets the oldest counters */
+      && !replayed(&info, 0, 103 + ANTI_REPLAY_WINDOW_SIZE)
+      && replayed(&info, 0, 103)
+      && !replayed(&info, 0, 104)
+      && replayed(&info, 0, 104)
+      /* A gap larger than the window */
+      && !replayed(&info, 0, 1000)
+      && replayed(&info, 0, 1000 - ANTI_REPLAY_WINDOW_SIZE)
+      && !replayed(&info, 0, 1000 - ANTI_REPLAY_WINDOW_SIZE + 1);
+  result(success);
+
+  printf("Testing separate broadcast window ... ");
+  success = !replayed(&info, 1, 101)
+      && replayed(&info, 1, 101)
+      && !replayed(&info, 1, 1001)
+      && !replayed(&info, 0, 1001)
+      && replayed(&info, 0, 1001);
+  result(success);
+}
+/*---------------------------------------------------------------------------*/
+/* Secures a frame from one node to another and returns its length */
+static int
+send_frame(const linkaddr_t *from, const linkaddr_t *to, uint8_t *frame)
+{
+  linkaddr_copy(&linkaddr_node_addr, from);
+  packetbuf_clear();
+  packetbuf_copyfrom(payload, sizeof(payload));
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, from);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, to);
+  if(pairwisesec_framer.create() == FRAMER_FAILED) {
+    return 0;
+  }
+  return packetbuf_copyto(frame);
+}
+/*---------------------------------------------------------------------------*/
+/* Returns 1 if the receiver accepts the frame */
+static int
+receive_frame(const linkaddr_t *at, const uint8_t *frame, int len)
+{
+  linkaddr_copy(&linkaddr_node_addr, at);
+  packetbuf_clear();
+  packetbuf_copyfrom(frame, len);
+  return pairwisesec_framer.parse() != FRAMER_FAILED
+      && packetbuf_datalen() == sizeof(payload)
+      && !memcmp(packetbuf_dataptr(), payload, sizeof(payload));
+}
+/*---------------------------------------------------------------------------*/
+static void
+test_pairwise_keys(void)
+{
+  int success;
+  int i;
+
+  printf("Testing unicast without key ... ");
+  /* Neither end has a key for this link yet */
+  success = !send_frame(&node_a, &node_b, frames[0]);
+  /* Broadcast frames only need the group key */
+  frame_lens[0] = send_frame(&node_b, &linkaddr_null, frames[0]);
+  success = success && frame_lens[0]
+      && receive_frame(&node_a, frames[0], frame_lens[0]);
+  /* Now A has an entry for B, but still no key */
+  success = success && !send_frame(&node_a, &node_b, frames[0]);
+  result(success);
+
+  printf("Testing unicast with installed keys ... ");
+  /* B is known by key_ab, A by key_ab and C by key_cb */
+  success = pairwisesec_set_key(&node_b, key_ab)
+      && pairwisesec_set_key(&node_a, key_ab)
+      && pairwisesec_set_key(&node_c, key_cb);
+  for(i = 0; i < FRAMES; i++) {
+    frame_lens[i] = send_frame(&node_a, &node_b, frames[i]);
+    success = success && frame_lens[i];
+  }
+  success = success && receive_frame(&node_b, frames[0], frame_lens[0]);
+  result(success);
+
+  printf("Testing reordered and replayed unicast ... ");
+  success = receive_frame(&node_b, frames[2], frame_lens[2])
+      && receive_frame(&node_b, frames[1], frame_lens[1])
+      && !receive_frame(&node_b, frames[1], frame_lens[1])
+      && !receive_frame(&node_b, frames[0], frame_lens[0])
+      && receive_frame(&node_b, frames[3], frame_lens[3]);
+  result(success);
+
+  printf("Testing unauthentic unicast ... ");
+  frame_lens[0] = send_frame(&node_a, &node_b, frames[0]);
+  frames[0][frame_lens[0] - 1] ^= 1;
+  success = !receive_frame(&node_b, frames[0], frame_lens[0]);
+  /*
+   * C secures frames to B with the key installed for B, which is
+   * key_ab, whereas B checks frames from C with key_cb
+   */
+  frame_lens[0] = send_frame(&node_c, &node_b, frames[0]);
+  success = success && frame_lens[0]
+      && !receive_frame(&node_b, frames[0], frame_lens[0]);
+  result(success);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(pairwisesec_tests_process, "pairwisesec tests process");
+AUTOSTART_PROCESSES(&pairwisesec_tests_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(pairwisesec_tests_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  pairwisesec_driver.init();
+
+  test_window();
+  test_pairwise_keys();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -43,4 +43,9 @@ int rtimer_arch_check(void);
 int rtimer_arch_pending(void);
 rtimer_clock_t rtimer_arch_next(void);
 
+/* Rtimer tasks are run from the main loop by rtimer_arch_check(), so
+   they never preempt a caller of rtimer_set() or rtimer_cancel() */
+#define RTIMER_ARCH_DISABLE_IRQ() 0
+#define RTIMER_ARCH_RESTORE_IRQ(s) (void)(s)
+
 #endif /* RTIMER_ARCH_H_ */
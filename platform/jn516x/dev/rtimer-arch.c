@@ -42,6 +42,7 @@
 #include "sys/process.h"
 #include <AppHardwareApi.h>
 #include <PeripheralRegs.h>
+#include <MicroSpecific.h>
 #include "dev/watchdog.h"
 #include "sys/energest.h"
 
@@ -115,6 +116,21 @@ rtimer_arch_now(void)
   return u32AHI_TickTimerRead();
 }
 /*---------------------------------------------------------------------------*/
+int
+rtimer_arch_disable_irq(void)
+{
+  uint32_t saved;
+
+  MICRO_DISABLE_AND_SAVE_INTERRUPTS(saved);
+  return (int)saved;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_restore_irq(int saved)
+{
+  MICRO_RESTORE_INTERRUPTS((uint32_t)saved);
+}
+/*---------------------------------------------------------------------------*/
 void
 rtimer_arch_schedule(rtimer_clock_t t)
 {
@@ -1,5 +1,8 @@
 #ifndef RTIMER_ARCH_H_
 #define RTIMER_ARCH_H_
 
+#define RTIMER_ARCH_DISABLE_IRQ() 0
+#define RTIMER_ARCH_RESTORE_IRQ(s) (void)(s)
+
 
 #endif /* RTIMER_ARCH_H_ */